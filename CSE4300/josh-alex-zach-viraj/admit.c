@@ -0,0 +1,188 @@
+#include "admit.h"
+#include "util.h"
+
+#include <math.h>
+
+const char* admit_policy_name(AdmitPolicy p) {
+    switch (p) {
+        case AD_QUEUE:    return "queue";
+        case AD_TOKEN:    return "token";
+        case AD_DEADLINE: return "deadline";
+        case AD_CODEL:    return "codel";
+    }
+    return "?";
+}
+
+int admit_parse(const char* spec, AdmitConfig* cfg) {
+    char buf[256], *opts, *k, *v;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->policy    = AD_QUEUE;
+    cfg->max_ready = 64;
+    cfg->rate      = 1000.0;
+    cfg->burst     = 16;
+    cfg->deadline  = 50 * SIM_TICK_NS;
+    cfg->target    = 5 * SIM_TICK_NS;
+    cfg->interval  = 100 * SIM_TICK_NS;
+    if (!spec || spec_split(spec, buf, sizeof(buf), 0, NULL, &opts) != 0) return -1;
+
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) {
+            /* a bare word names the policy */
+            if      (strcmp(k, "queue") == 0)    cfg->policy = AD_QUEUE;
+            else if (strcmp(k, "token") == 0)    cfg->policy = AD_TOKEN;
+            else if (strcmp(k, "deadline") == 0) cfg->policy = AD_DEADLINE;
+            else if (strcmp(k, "codel") == 0)    cfg->policy = AD_CODEL;
+            else return -1;
+            continue;
+        }
+        if (strcmp(k, "max") == 0) {
+            cfg->max_ready = atoi(v);
+            if (cfg->max_ready < 1) return -1;
+        } else if (strcmp(k, "reject") == 0) {
+            if      (strcmp(v, "tail") == 0) cfg->head = 0;
+            else if (strcmp(v, "head") == 0) cfg->head = 1;
+            else return -1;
+        } else if (strcmp(k, "rate") == 0) {
+            cfg->rate = atof(v);
+            if (cfg->rate <= 0) return -1;
+        } else if (strcmp(k, "burst") == 0) {
+            cfg->burst = atoi(v);
+            if (cfg->burst < 1) return -1;
+        } else if (strcmp(k, "deadline") == 0) {
+            if (parse_duration(v, &cfg->deadline) != 0 || cfg->deadline <= 0) return -1;
+        } else if (strcmp(k, "target") == 0) {
+            if (parse_duration(v, &cfg->target) != 0 || cfg->target <= 0) return -1;
+        } else if (strcmp(k, "interval") == 0) {
+            if (parse_duration(v, &cfg->interval) != 0 || cfg->interval <= 0) return -1;
+        } else if (strcmp(k, "slo") == 0) {
+            if (parse_duration(v, &cfg->slo) != 0 || cfg->slo <= 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void admit_init(Admitter* a, const AdmitConfig* cfg) {
+    memset(a, 0, sizeof(*a));
+    a->cfg      = *cfg;
+    a->tokens   = cfg->burst;
+    a->above_at = -1;
+}
+
+/* bring the token bucket up to now */
+static void refill(Admitter* a, simtime_t now) {
+    if (now <= a->refilled) return;
+    a->tokens += a->cfg.rate * (double)(now - a->refilled) / NS_PER_S;
+    if (a->tokens > a->cfg.burst) a->tokens = a->cfg.burst;
+    a->refilled = now;
+}
+
+int admit_arrival(Admitter* a, const Thread* t, simtime_t now, int nready, int ncores) {
+    (void)t;
+    const AdmitConfig* c = &a->cfg;
+    a->offered++;
+    switch (c->policy) {
+        case AD_QUEUE:
+            if (nready < c->max_ready) return ADMIT_ACCEPT;
+            return c->head ? ADMIT_SHED : ADMIT_REJECT;
+        case AD_TOKEN:
+            refill(a, now);
+            return a->tokens >= 1.0 ? ADMIT_ACCEPT : ADMIT_REJECT;
+        case AD_DEADLINE: {
+            double wait = ncores > 0 ? nready * a->mean_burst / ncores : 0.0;
+            return wait <= (double)c->deadline ? ADMIT_ACCEPT : ADMIT_REJECT;
+        }
+        case AD_CODEL:
+            return ADMIT_ACCEPT;   // sheds from the queue instead
+    }
+    return ADMIT_ACCEPT;
+}
+
+void admit_accepted(Admitter* a, const Thread* t) {
+    a->admitted++;
+    a->mean_burst += ((double)t->burst_time - a->mean_burst) / a->admitted;
+    if (a->cfg.policy == AD_TOKEN) a->tokens -= 1.0;
+}
+
+int admit_shed(Admitter* a, simtime_t now, simtime_t delay) {
+    const AdmitConfig* c = &a->cfg;
+    if (delay > a->max_delay) a->max_delay = delay;
+    if (c->policy == AD_DEADLINE) return delay > c->deadline;
+    if (c->policy != AD_CODEL) return 0;
+
+    if (delay < c->target) {
+        a->above_at = -1;
+        a->dropping = 0;
+        return 0;
+    }
+    if (a->above_at < 0) {
+        a->above_at = now + c->interval;
+        return 0;
+    }
+    if (!a->dropping) {
+        if (now < a->above_at) return 0;
+        /* resume near the old drop rate if the last dropping state was recent */
+        a->count = a->count > 2 && now - a->drop_next < 16 * c->interval ? a->count - 2 : 1;
+        a->dropping  = 1;
+        a->drop_next = now + (simtime_t)(c->interval / sqrt((double)a->count));
+        return 1;
+    }
+    if (now < a->drop_next) return 0;
+    a->count++;
+    a->drop_next += (simtime_t)(c->interval / sqrt((double)a->count));
+    return 1;
+}
+
+static int cmp_ns(const void* x, const void* y) {
+    simtime_t a = *(const simtime_t*)x, b = *(const simtime_t*)y;
+    return (a > b) - (a < b);
+}
+
+void admit_report(const Admitter* a, const Queue* finished, simtime_t elapsed, FILE* out) {
+    const AdmitConfig* c = &a->cfg;
+    fprintf(out, "# Admission control\n");
+    fprintf(out, "Policy: %s", admit_policy_name(c->policy));
+    switch (c->policy) {
+        case AD_QUEUE:
+            fprintf(out, ", max %d Ready, reject %s", c->max_ready, c->head ? "head" : "tail");
+            break;
+        case AD_TOKEN:
+            fprintf(out, ", rate %g/s, burst %d", c->rate, c->burst);
+            break;
+        case AD_DEADLINE:
+            fprintf(out, ", deadline %.3f", to_ticks(c->deadline));
+            break;
+        case AD_CODEL:
+            fprintf(out, ", target %.3f, interval %.3f", to_ticks(c->target), to_ticks(c->interval));
+            break;
+    }
+    if (c->slo > 0) fprintf(out, ", slo %.3f", to_ticks(c->slo));
+    fprintf(out, "\n");
+
+    double pct = a->offered > 0 ? 100.0 / a->offered : 0.0;
+    fprintf(out, "Offered: %ld, admitted: %ld (%.1f%%), rejected: %ld (%.1f%%), shed: %ld (%.1f%%)\n",
+            a->offered, a->admitted, a->admitted * pct, a->rejected, a->rejected * pct,
+            a->dropped, a->dropped * pct);
+    if (c->policy == AD_DEADLINE || c->policy == AD_CODEL)
+        fprintf(out, "Longest queue delay seen: %.3f\n", to_ticks(a->max_delay));
+
+    simtime_t* turn = (simtime_t*)malloc(sizeof(simtime_t) * (finished->size + 1));
+    int n = 0, good = 0;
+    for (const Thread* p = finished->front; p; p = p->next) {
+        if (p->finish_time < 0) continue;
+        turn[n] = p->finish_time - p->arrival_time;
+        if (c->slo <= 0 || turn[n] <= c->slo) good++;
+        n++;
+    }
+    double ticks = to_ticks(elapsed);
+    fprintf(out, "Completed: %d, throughput: %.4f/tick, goodput: %d (%.4f/tick)\n",
+            n, ticks > 0 ? n / ticks : 0.0, good, ticks > 0 ? good / ticks : 0.0);
+    if (n > 0) {
+        qsort(turn, n, sizeof(simtime_t), cmp_ns);
+        fprintf(out, "Turnaround p50: %.3f, p99: %.3f\n",
+                to_ticks(turn[(n + 1) / 2 - 1]), to_ticks(turn[(99 * n + 99) / 100 - 1]));
+    }
+    free(turn);
+    fprintf(out, "\n");
+}
@@ -0,0 +1,97 @@
+#ifndef ADMIT_H
+#define ADMIT_H
+
+#include "sim.h"
+
+/*
+  Admission control and load shedding for overload runs.
+
+  Every arrival is offered to the controller before it becomes Ready;
+  a rejected thread never runs. Ready threads that have not started yet
+  can also be shed (dropped) later. Rejected and shed threads both end in
+  the engine's dropped queue. Threads of DAG jobs and gangs are always
+  admitted and never shed, since their siblings wait for them.
+
+  Policies:
+    queue     bound the Ready threads at max; a full queue rejects the
+              arrival (reject=tail) or sheds the oldest waiting thread
+              to make room for it (reject=head)
+    token     token bucket: rate admissions per second, up to burst at once
+    deadline  reject an arrival whose estimated wait (Ready threads times
+              the mean burst of admitted ones, over the cores) exceeds
+              deadline, and shed threads that waited longer than that
+    codel     CoDel on the queue delay of the oldest waiting thread: once
+              it has stayed above target for interval, shed one thread
+              and the next ones at interval / sqrt(drops) until the delay
+              falls below target again
+
+  Goodput counts the threads that finished within slo of their arrival
+  (all finished threads without one).
+*/
+
+typedef enum { AD_QUEUE = 0, AD_TOKEN, AD_DEADLINE, AD_CODEL } AdmitPolicy;
+
+/* admit_arrival() results */
+enum { ADMIT_ACCEPT = 0, ADMIT_REJECT, ADMIT_SHED };
+
+/* Static settings. Plain data so checkpoints can store it as is. */
+typedef struct {
+    AdmitPolicy policy;
+    int       max_ready;     // queue: Ready threads allowed
+    int       head;          // queue: shed the oldest waiting thread, not the arrival
+    double    rate;          // token: admissions per second
+    int       burst;         // token: bucket depth
+    simtime_t deadline;      // deadline: longest acceptable wait for a first run
+    simtime_t target;        // codel: acceptable standing queue delay
+    simtime_t interval;      // codel: how long the delay may stay above target
+    simtime_t slo;           // goodput turnaround bound, 0 = none
+} AdmitConfig;
+
+typedef struct {
+    AdmitConfig cfg;
+    double    tokens;        // token bucket fill
+    simtime_t refilled;      // time the bucket was last brought up to date
+    double    mean_burst;    // mean CPU demand of admitted threads (ns)
+
+    /* CoDel state */
+    simtime_t above_at;      // when the delay has stood above target long enough, -1 = below
+    simtime_t drop_next;     // next shed while dropping
+    int       dropping;
+    int       count;         // sheds in the current dropping state
+
+    /* statistics */
+    long      offered, admitted, rejected, dropped;
+    simtime_t max_delay;     // largest queue delay seen by a shedding check
+} Admitter;
+
+/* Parse "policy,key=val,..." with policy queue|token|deadline|codel and
+   keys max=N reject=tail|head (queue), rate=R burst=N (token),
+   deadline=DUR (deadline), target=DUR interval=DUR (codel), slo=DUR.
+   Defaults: queue max=64 reject=tail, rate=1000 burst=16, deadline=50,
+   target=5 interval=100 (ticks), no slo. Returns 0 on success, -1 on
+   error. */
+int  admit_parse(const char* spec, AdmitConfig* cfg);
+
+void admit_init(Admitter* a, const AdmitConfig* cfg);
+
+/* Decide on arrival t at now with nready threads Ready on ncores cores.
+   ADMIT_SHED admits t only if a waiting thread is shed for it; the
+   caller rejects it when there is none. Counts the offer; the caller
+   counts rejected and shed threads. */
+int  admit_arrival(Admitter* a, const Thread* t, simtime_t now, int nready, int ncores);
+
+/* Count an arrival that became Ready, and use up its token. */
+void admit_accepted(Admitter* a, const Thread* t);
+
+/* Shedding check at the end of a tick: delay is the queue delay of the
+   oldest waiting thread that may be shed (-1 = none). Returns 1 if it
+   should be shed now; call again after each shed. */
+int  admit_shed(Admitter* a, simtime_t now, simtime_t delay);
+
+/* Settings, arrivals offered/admitted/rejected/shed and the throughput,
+   goodput and turnaround percentiles of the finished threads. */
+void admit_report(const Admitter* a, const Queue* finished, simtime_t elapsed, FILE* out);
+
+const char* admit_policy_name(AdmitPolicy p);
+
+#endif /* ADMIT_H */
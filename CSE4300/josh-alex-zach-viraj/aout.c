@@ -0,0 +1,197 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "aout.h"
+
+#ifdef __GLIBC__
+
+typedef struct AOut {
+    FILE*  out;                // the file; only the writer thread writes it
+    FILE*  fp;                 // the stream handed out
+    char*  buf[2];
+    size_t len[2];
+    size_t cap;
+    int    fill;               // buffer being filled; the other is the writer's
+    int    pending;            // the writer's buffer holds data
+    int    closing;
+    int    error;
+    pthread_t       writer;
+    pthread_mutex_t lock;
+    pthread_cond_t  cv;
+    struct AOut*    next;      // open streams, drained at exit
+} AOut;
+
+static pthread_mutex_t open_lock = PTHREAD_MUTEX_INITIALIZER;
+static AOut* open_list;
+static pthread_mutex_t stall_lock = PTHREAD_MUTEX_INITIALIZER;
+static long  stalls;
+
+static void* writer_main(void* arg) {
+    AOut* a = (AOut*)arg;
+    pthread_mutex_lock(&a->lock);
+    for (;;) {
+        while (!a->pending && !a->closing) pthread_cond_wait(&a->cv, &a->lock);
+        if (!a->pending) break;   // closing and nothing left
+        int b = 1 - a->fill;
+        pthread_mutex_unlock(&a->lock);
+        int err = fwrite(a->buf[b], 1, a->len[b], a->out) != a->len[b];
+        pthread_mutex_lock(&a->lock);
+        if (err) a->error = 1;
+        a->len[b]  = 0;
+        a->pending = 0;
+        pthread_cond_broadcast(&a->cv);
+    }
+    pthread_mutex_unlock(&a->lock);
+    return NULL;
+}
+
+/* give the filled buffer to the writer and take the other one, waiting
+   if the writer has not finished it yet */
+static void hand_off(AOut* a) {
+    pthread_mutex_lock(&a->lock);
+    if (a->pending) {
+        pthread_mutex_lock(&stall_lock);
+        stalls++;
+        pthread_mutex_unlock(&stall_lock);
+    }
+    while (a->pending) pthread_cond_wait(&a->cv, &a->lock);
+    a->fill    = 1 - a->fill;
+    a->pending = 1;
+    pthread_cond_broadcast(&a->cv);
+    pthread_mutex_unlock(&a->lock);
+}
+
+/* wait until the writer has written everything handed to it */
+static void drain(AOut* a) {
+    if (a->len[a->fill] > 0) hand_off(a);
+    pthread_mutex_lock(&a->lock);
+    while (a->pending) pthread_cond_wait(&a->cv, &a->lock);
+    pthread_mutex_unlock(&a->lock);
+}
+
+static ssize_t aout_write(void* cookie, const char* data, size_t size) {
+    AOut* a = (AOut*)cookie;
+    size_t left = size;
+    while (left > 0) {
+        size_t room = a->cap - a->len[a->fill];
+        size_t k = left < room ? left : room;
+        memcpy(a->buf[a->fill] + a->len[a->fill], data, k);
+        a->len[a->fill] += k;
+        data += k;
+        left -= k;
+        if (a->len[a->fill] == a->cap) hand_off(a);
+    }
+    return (ssize_t)size;
+}
+
+static int aout_close(void* cookie) {
+    AOut* a = (AOut*)cookie;
+    pthread_mutex_lock(&open_lock);
+    for (AOut** p = &open_list; *p; p = &(*p)->next)
+        if (*p == a) {
+            *p = a->next;
+            break;
+        }
+    pthread_mutex_unlock(&open_lock);
+
+    if (a->len[a->fill] > 0) hand_off(a);
+    pthread_mutex_lock(&a->lock);
+    a->closing = 1;
+    pthread_cond_broadcast(&a->cv);
+    pthread_mutex_unlock(&a->lock);
+    pthread_join(a->writer, NULL);
+
+    int rc = fclose(a->out) != 0 || a->error ? -1 : 0;
+    pthread_cond_destroy(&a->cv);
+    pthread_mutex_destroy(&a->lock);
+    free(a->buf[0]);
+    free(a->buf[1]);
+    free(a);
+    return rc;
+}
+
+/* exit() flushes stdio into our buffers but would not write them */
+static void drain_all(void) {
+    pthread_mutex_lock(&open_lock);
+    for (AOut* a = open_list; a; a = a->next) {
+        fflush(a->fp);
+        drain(a);
+        fflush(a->out);
+    }
+    pthread_mutex_unlock(&open_lock);
+}
+
+FILE* aout_open(const char* path, size_t bufsize) {
+    static int registered;
+    if (bufsize == 0) bufsize = AOUT_BUFSIZE;
+    FILE* out = fopen(path, "w");
+    if (!out) return NULL;
+
+    AOut* a = (AOut*)calloc(1, sizeof(AOut));
+    if (a) {
+        a->out    = out;
+        a->cap    = bufsize;
+        a->buf[0] = (char*)malloc(bufsize);
+        a->buf[1] = (char*)malloc(bufsize);
+    }
+    if (!a || !a->buf[0] || !a->buf[1]) goto plain;
+    pthread_mutex_init(&a->lock, NULL);
+    pthread_cond_init(&a->cv, NULL);
+    if (pthread_create(&a->writer, NULL, writer_main, a) != 0) {
+        pthread_cond_destroy(&a->cv);
+        pthread_mutex_destroy(&a->lock);
+        goto plain;
+    }
+
+    cookie_io_functions_t io = { NULL, aout_write, NULL, aout_close };
+    a->fp = fopencookie(a, "w", io);
+    if (!a->fp) {
+        /* nothing handed over yet: stop the writer and fall back */
+        pthread_mutex_lock(&a->lock);
+        a->closing = 1;
+        pthread_cond_broadcast(&a->cv);
+        pthread_mutex_unlock(&a->lock);
+        pthread_join(a->writer, NULL);
+        pthread_cond_destroy(&a->cv);
+        pthread_mutex_destroy(&a->lock);
+        goto plain;
+    }
+    pthread_mutex_lock(&open_lock);
+    a->next   = open_list;
+    open_list = a;
+    if (!registered) registered = atexit(drain_all) == 0;
+    pthread_mutex_unlock(&open_lock);
+    return a->fp;
+
+plain:
+    if (a) {
+        free(a->buf[0]);
+        free(a->buf[1]);
+        free(a);
+    }
+    setvbuf(out, NULL, _IOFBF, bufsize);
+    return out;
+}
+
+long aout_stalls(void) {
+    pthread_mutex_lock(&stall_lock);
+    long n = stalls;
+    pthread_mutex_unlock(&stall_lock);
+    return n;
+}
+
+#else /* !__GLIBC__ */
+
+FILE* aout_open(const char* path, size_t bufsize) {
+    if (bufsize == 0) bufsize = AOUT_BUFSIZE;
+    FILE* out = fopen(path, "w");
+    if (out) setvbuf(out, NULL, _IOFBF, bufsize);
+    return out;
+}
+
+long aout_stalls(void) {
+    return 0;
+}
+
+#endif
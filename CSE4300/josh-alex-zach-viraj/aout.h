@@ -0,0 +1,32 @@
+#ifndef AOUT_H
+#define AOUT_H
+
+#include <stdio.h>
+
+/*
+  Asynchronous output: a stdio stream whose bytes go to one of two large
+  buffers instead of the file. When the buffer being filled is full it is
+  handed to a background writer thread and filling continues in the other
+  one, so the simulation only waits on disk if it produces output faster
+  than the disk takes it.
+
+  The stream works with every stdio output call but cannot seek. fflush()
+  moves stdio's buffer into the current one, not to disk; fclose() hands
+  over what is left, waits for the writer and closes the file, reporting
+  any write error. Streams still open at exit() are drained first.
+
+  Where fopencookie() is not available, or the thread cannot be started,
+  aout_open() returns a plain stream with a buffer of the same size.
+*/
+
+#define AOUT_BUFSIZE (1 << 20)
+
+/* Open path for writing ("w") with two buffers of bufsize bytes
+   (0 = AOUT_BUFSIZE). NULL if the file cannot be opened. */
+FILE* aout_open(const char* path, size_t bufsize);
+
+/* Times the simulation waited for the writer to free a buffer, over
+   every stream so far. */
+long  aout_stalls(void);
+
+#endif /* AOUT_H */
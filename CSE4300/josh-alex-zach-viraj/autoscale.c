@@ -0,0 +1,141 @@
+#include "autoscale.h"
+#include "util.h"
+
+const char* asmetric_name(AsMetric m) {
+    switch (m) {
+        case AS_READY: return "ready";
+        case AS_UTIL:  return "util";
+    }
+    return "?";
+}
+
+int autoscale_parse(const char* spec, AutoscaleConfig* cfg) {
+    char buf[256], *opts, *k, *v;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->metric    = AS_READY;
+    cfg->up        = -1;   // metric default
+    cfg->down      = -1;
+    cfg->min_cores = 1;
+    cfg->max_cores = 64;
+    cfg->step      = 1;
+    cfg->delay     = 3;
+    cfg->cooldown  = 10;
+    cfg->boot_ns   = 0;
+    if (spec_split(spec, buf, sizeof(buf), 0, NULL, &opts) != 0) return -1;
+
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) return -1;
+        if (strcmp(k, "metric") == 0) {
+            if      (strcmp(v, "ready") == 0) cfg->metric = AS_READY;
+            else if (strcmp(v, "util") == 0)  cfg->metric = AS_UTIL;
+            else return -1;
+        } else if (strcmp(k, "up") == 0) {
+            cfg->up = atof(v);
+            if (cfg->up <= 0) return -1;
+        } else if (strcmp(k, "down") == 0) {
+            cfg->down = atof(v);
+            if (cfg->down < 0) return -1;
+        } else if (strcmp(k, "min") == 0) {
+            cfg->min_cores = atoi(v);
+        } else if (strcmp(k, "max") == 0) {
+            cfg->max_cores = atoi(v);
+        } else if (strcmp(k, "step") == 0) {
+            cfg->step = atoi(v);
+            if (cfg->step < 1) return -1;
+        } else if (strcmp(k, "delay") == 0) {
+            cfg->delay = atoi(v);
+            if (cfg->delay < 1) return -1;
+        } else if (strcmp(k, "cooldown") == 0) {
+            cfg->cooldown = atoi(v);
+            if (cfg->cooldown < 0) return -1;
+        } else if (strcmp(k, "boot") == 0) {
+            if (parse_duration(v, &cfg->boot_ns) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    if (cfg->up < 0)   cfg->up   = cfg->metric == AS_UTIL ? 90.0 : 2.0;
+    if (cfg->down < 0) cfg->down = cfg->metric == AS_UTIL ? 30.0 : 0.5;
+    if (cfg->min_cores < 1 || cfg->max_cores < cfg->min_cores || cfg->down >= cfg->up) return -1;
+    return 0;
+}
+
+void autoscale_init(Autoscaler* a, const AutoscaleConfig* cfg, int ncores) {
+    memset(a, 0, sizeof(*a));
+    a->cfg      = *cfg;
+    a->min_seen = a->max_seen = ncores;
+}
+
+int autoscale_tick(Autoscaler* a, simtime_t now, int ncores, int nready, simtime_t busy_ns) {
+    const AutoscaleConfig* c = &a->cfg;
+    if (ncores < a->min_seen) a->min_seen = ncores;
+    if (ncores > a->max_seen) a->max_seen = ncores;
+
+    /* booted cores come online */
+    if (a->pending && now >= a->pending_at) {
+        int n = a->pending;
+        a->pending = 0;
+        a->quiet_until = now + (simtime_t)c->cooldown * SIM_TICK_NS;
+        return n != ncores ? n : 0;
+    }
+
+    double load = c->metric == AS_UTIL
+                ? 100.0 * busy_ns / ((double)ncores * SIM_TICK_NS)
+                : (double)nready / ncores;
+    a->above = load > c->up   ? a->above + 1 : 0;
+    a->below = load < c->down ? a->below + 1 : 0;
+    if (a->above > 0 && ncores >= c->max_cores) a->saturated++;
+    if (a->pending || now < a->quiet_until) return 0;
+
+    int target = ncores;
+    if (a->above >= c->delay)      target = ncores + c->step;
+    else if (a->below >= c->delay) target = ncores - c->step;
+    if (target > c->max_cores) target = c->max_cores;
+    if (target < c->min_cores) target = c->min_cores;
+    if (target == ncores) return 0;
+
+    a->above = a->below = 0;
+    if (target > ncores) {
+        a->ups++;
+        if (c->boot_ns > 0) {
+            a->pending    = target;
+            a->pending_at = now + c->boot_ns;
+            return 0;
+        }
+    } else {
+        a->downs++;
+    }
+    a->quiet_until = now + (simtime_t)c->cooldown * SIM_TICK_NS;
+    return target;
+}
+
+int hotplug_parse(const char* spec, HotplugEvent* ev) {
+    char buf[64];
+    if (!spec || strlen(spec) >= sizeof(buf)) return -1;
+    strcpy(buf, spec);
+    char* n = strchr(buf, ':');
+    if (!n) return -1;
+    *n++ = '\0';
+    char* end;
+    long x = strtol(n, &end, 10);
+    if (parse_duration(buf, &ev->at) != 0 || *end != '\0' || x < 1) return -1;
+    ev->ncores = (int)x;
+    return 0;
+}
+
+void autoscale_report(const Autoscaler* a, simtime_t core_ns, simtime_t elapsed, FILE* out) {
+    fprintf(out, "# Cores\n");
+    fprintf(out, "Average cores: %.3f (%.3f core-ticks)\n",
+            elapsed > 0 ? (double)core_ns / elapsed : 0.0, to_ticks(core_ns));
+    if (a) {
+        const AutoscaleConfig* c = &a->cfg;
+        fprintf(out, "Autoscaler: metric %s, up %g, down %g, cores %d..%d, step %d, "
+                     "delay %d, cooldown %d, boot %.3f\n",
+                asmetric_name(c->metric), c->up, c->down, c->min_cores, c->max_cores,
+                c->step, c->delay, c->cooldown, to_ticks(c->boot_ns));
+        fprintf(out, "Scale-ups: %ld, scale-downs: %ld, cores used %d..%d, "
+                     "ticks over 'up' at max cores: %ld\n",
+                a->ups, a->downs, a->min_seen, a->max_seen, a->saturated);
+    }
+    fprintf(out, "\n");
+}
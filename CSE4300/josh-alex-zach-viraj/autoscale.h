@@ -0,0 +1,76 @@
+#ifndef AUTOSCALE_H
+#define AUTOSCALE_H
+
+#include "sim.h"
+
+/*
+  Core hotplug schedule and a load-driven core autoscaler.
+
+  Hotplug events set the core count at fixed times (applied at the first
+  tick boundary at or after the time). Threads on removed cores go back to
+  Ready and the dispatcher moves them to the remaining cores.
+
+  The autoscaler samples the load at the end of every tick:
+    ready  Ready threads per core
+    util   busy % of the cores over the tick
+  Once the sample has stayed above up (below down) for delay consecutive
+  ticks it adds (removes) step cores, within min..max. Added cores come
+  online boot_ns after the decision; removals take effect at once. After
+  a change (or while cores are booting) it waits cooldown ticks before it
+  looks at the load again.
+*/
+
+typedef enum { AS_READY = 0, AS_UTIL } AsMetric;
+
+typedef struct {
+    simtime_t at;
+    int       ncores;
+} HotplugEvent;
+
+/* Static settings. Plain data so checkpoints can store it as is. */
+typedef struct {
+    AsMetric  metric;
+    double    up, down;        // thresholds in the metric's unit
+    int       min_cores, max_cores;
+    int       step;
+    int       delay;           // ticks a threshold must be crossed before acting
+    int       cooldown;        // ticks after a change before the next decision
+    simtime_t boot_ns;         // time for added cores to come online
+} AutoscaleConfig;
+
+typedef struct {
+    AutoscaleConfig cfg;
+    int       above, below;    // consecutive ticks over up / under down
+    simtime_t quiet_until;     // no decisions before this time
+    int       pending;         // core count that is booting, 0 = none
+    simtime_t pending_at;
+
+    /* statistics */
+    long      ups, downs;
+    long      saturated;       // ticks above up with max_cores already online
+    int       min_seen, max_seen;
+} Autoscaler;
+
+/* Parse "key=val,..." with keys metric=ready|util, up=X, down=X, min=N,
+   max=N, step=N, delay=TICKS, cooldown=TICKS, boot=DUR. Defaults: ready,
+   up=2 down=0.5 (util: up=90 down=30), min=1, max=64, step=1, delay=3,
+   cooldown=10, boot=0. Returns 0 on success, -1 on error. */
+int  autoscale_parse(const char* spec, AutoscaleConfig* cfg);
+
+void autoscale_init(Autoscaler* a, const AutoscaleConfig* cfg, int ncores);
+
+/* End of a tick (now = its end) that ran on ncores cores, with nready
+   threads Ready and busy_ns of core time spent running threads. Returns
+   the core count to switch to now, or 0 to keep the current one. */
+int  autoscale_tick(Autoscaler* a, simtime_t now, int ncores, int nready, simtime_t busy_ns);
+
+/* Parse "T:N" (at time T, N cores). Returns 0 on success, -1 on error. */
+int  hotplug_parse(const char* spec, HotplugEvent* ev);
+
+/* Average core count (core_ns = integral of the core count over the run)
+   and, with an autoscaler, its decisions and the range it used. */
+void autoscale_report(const Autoscaler* a, simtime_t core_ns, simtime_t elapsed, FILE* out);
+
+const char* asmetric_name(AsMetric m);
+
+#endif /* AUTOSCALE_H */
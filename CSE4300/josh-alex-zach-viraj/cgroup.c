@@ -0,0 +1,235 @@
+#include "cgroup.h"
+#include "util.h"
+
+int group_parse(const char* spec, GroupConfig* cfg) {
+    char buf[256], *name, *opts, *k, *v;
+    if (spec_split(spec, buf, sizeof(buf), GROUP_NAME_LEN, &name, &opts) != 0) return -1;
+    memset(cfg, 0, sizeof(*cfg));
+    snprintf(cfg->name, sizeof(cfg->name), "%s", name);
+    cfg->shares    = GROUP_SHARES;
+    cfg->quota_ns  = 0;
+    cfg->period_ns = 100 * NS_PER_MS;
+    cfg->weight    = 1;
+
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) return -1;
+        if (strcmp(k, "parent") == 0) {
+            if (v[0] == '\0' || strlen(v) >= GROUP_NAME_LEN) return -1;
+            snprintf(cfg->parent, sizeof(cfg->parent), "%s", v);
+        } else if (strcmp(k, "shares") == 0) {
+            cfg->shares = atoi(v);
+            if (cfg->shares < 2 || cfg->shares > 262144) return -1;
+        } else if (strcmp(k, "quota") == 0) {
+            if (parse_duration(v, &cfg->quota_ns) != 0 || cfg->quota_ns < 1) return -1;
+        } else if (strcmp(k, "period") == 0) {
+            if (parse_duration(v, &cfg->period_ns) != 0 || cfg->period_ns < 1) return -1;
+        } else if (strcmp(k, "weight") == 0) {
+            cfg->weight = atoi(v);
+            if (cfg->weight < 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void group_init(Group* g, const GroupConfig* cfg, int parent) {
+    memset(g, 0, sizeof(*g));
+    g->cfg          = *cfg;
+    g->parent       = parent;
+    g->leaf         = 1;
+    g->runtime_left = cfg->quota_ns;
+    g->period_end   = cfg->quota_ns > 0 ? cfg->period_ns : SIMTIME_NEVER;
+    q_init(&g->held);
+}
+
+void group_free(Group* g) {
+    q_clear_shallow(&g->held);
+}
+
+int group_find(const Group* groups, int n, const char* name) {
+    for (int i = 0; i < n; ++i)
+        if (strcmp(groups[i].cfg.name, name) == 0) return i;
+    return -1;
+}
+
+void group_assign(Group* groups, int n, Queue* workload, unsigned long long seed) {
+    int total = 0;
+    for (int i = 0; i < n; ++i)
+        if (groups[i].leaf) total += groups[i].cfg.weight;
+    if (total <= 0) return;
+
+    Rng r;
+    rng_seed(&r, seed);
+    for (Thread* t = workload->front; t; t = t->next) {
+        int x = (int)(rng_next(&r) % (unsigned)total);
+        for (int i = 0; i < n; ++i) {
+            if (!groups[i].leaf) continue;
+            x -= groups[i].cfg.weight;
+            if (x < 0) {
+                t->group = i;
+                break;
+            }
+        }
+    }
+}
+
+int group_blocked(const Group* groups, int g) {
+    for (; g >= 0; g = groups[g].parent)
+        if (groups[g].throttled || groups[g].over_share) return 1;
+    return 0;
+}
+
+int group_share_blocked(const Group* groups, int g) {
+    int held = 0;
+    for (; g >= 0; g = groups[g].parent) {
+        if (groups[g].throttled) return 0;
+        if (groups[g].over_share) held = 1;
+    }
+    return held;
+}
+
+void group_charge(Group* groups, int n, const CPU* cpu, simtime_t now, simtime_t dt) {
+    if (n < 1 || dt <= 0) return;
+    for (int c = 0; c < cpu->ncores; ++c) {
+        const Thread* t = cpu->core[c];
+        if (!t) continue;
+        for (int i = t->group; i >= 0; i = groups[i].parent) {
+            Group* g = &groups[i];
+            g->usage_ns     += dt;
+            g->period_usage += dt;
+            g->vruntime     += dt * GROUP_SHARES / g->cfg.shares;
+            if (g->cfg.quota_ns <= 0) continue;
+            g->runtime_left -= dt;
+            if (g->runtime_left <= 0 && !g->throttled) {
+                g->throttled       = 1;
+                g->throttled_since = now + dt;
+                g->nr_throttled++;
+            }
+        }
+    }
+}
+
+int group_refill(Group* groups, int n, simtime_t now) {
+    int woke = 0;
+    for (int i = 0; i < n; ++i) {
+        Group* g = &groups[i];
+        if (now < g->period_end) continue;
+        if (g->period_usage > 0) g->periods++;
+        g->period_usage = 0;
+        /* periods with nothing to run may have passed */
+        simtime_t skipped = (now - g->period_end) / g->cfg.period_ns;
+        g->period_end  += (skipped + 1) * g->cfg.period_ns;
+        g->runtime_left = g->cfg.quota_ns;
+        if (g->throttled) {
+            g->throttled     = 0;
+            g->throttled_ns += now - g->throttled_since;
+            woke++;
+        }
+    }
+    return woke;
+}
+
+simtime_t group_next_event(const Group* groups, int n, const CPU* cpu, simtime_t now) {
+    simtime_t next = SIMTIME_NEVER;
+    int* nrun = (int*)calloc(n, sizeof(int));
+    for (int c = 0; c < cpu->ncores; ++c) {
+        const Thread* t = cpu->core[c];
+        if (!t) continue;
+        for (int i = t->group; i >= 0; i = groups[i].parent) nrun[i]++;
+    }
+    for (int i = 0; i < n; ++i) {
+        const Group* g = &groups[i];
+        if (g->period_end < next) next = g->period_end;
+        if (g->cfg.quota_ns <= 0 || g->throttled || nrun[i] == 0) continue;
+        /* every core running the group uses the budget in parallel */
+        simtime_t out = now + (g->runtime_left + nrun[i] - 1) / nrun[i];
+        if (out < next) next = out;
+    }
+    free(nrun);
+    return next;
+}
+
+void group_count_reset(Group* groups, int n) {
+    for (int i = 0; i < n; ++i) groups[i].nrunnable = 0;
+}
+
+void group_count(Group* groups, const Thread* t) {
+    for (int i = t->group; i >= 0; i = groups[i].parent) groups[i].nrunnable++;
+}
+
+/* least vruntime among g's runnable siblings (g included unless
+   skip_self); throttled ones cannot use the CPU and do not compete */
+static simtime_t sibling_min(const Group* groups, int n, int g, int skip_self) {
+    simtime_t vmin = SIMTIME_NEVER;
+    for (int i = 0; i < n; ++i) {
+        if (groups[i].parent != groups[g].parent || groups[i].nrunnable == 0) continue;
+        if (groups[i].throttled) continue;
+        if (skip_self && i == g) continue;
+        if (groups[i].vruntime < vmin) vmin = groups[i].vruntime;
+    }
+    return vmin;
+}
+
+void group_balance(Group* groups, int n, simtime_t slack) {
+    /* a group coming back from idle starts level with its siblings */
+    for (int i = 0; i < n; ++i) {
+        Group* g = &groups[i];
+        if (g->nrunnable > 0 && !g->active) {
+            simtime_t vmin = sibling_min(groups, n, i, 1);
+            if (vmin != SIMTIME_NEVER && g->vruntime < vmin) g->vruntime = vmin;
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        Group* g = &groups[i];
+        g->active = g->nrunnable > 0;
+        g->over_share = g->active && !g->throttled &&
+                        g->vruntime > sibling_min(groups, n, i, 0) + slack;
+    }
+}
+
+void group_unhold_share(Group* groups, int g) {
+    for (; g >= 0; g = groups[g].parent) groups[g].over_share = 0;
+}
+
+static int in_subtree(const Group* groups, int g, int root) {
+    for (; g >= 0; g = groups[g].parent)
+        if (g == root) return 1;
+    return 0;
+}
+
+void group_report(const Group* groups, int n, const Queue* finished, simtime_t elapsed,
+                  int ncores, FILE* out) {
+    if (n < 1) return;
+    fprintf(out, "# Groups (times in ticks)\n");
+    fprintf(out, "%-12s %-12s %6s %15s %10s %6s %8s %9s %10s %7s %9s %9s\n",
+            "GROUP", "PARENT", "SHARES", "QUOTA/PERIOD", "USAGE", "CPU%", "PERIODS",
+            "THROTTLED", "THR_TIME", "THREADS", "AVG_TURN", "MAX_TURN");
+    double capacity = (double)elapsed * ncores;
+    for (int i = 0; i < n; ++i) {
+        const Group* g = &groups[i];
+        char bw[32];
+        if (g->cfg.quota_ns > 0)
+            snprintf(bw, sizeof(bw), "%g/%g", to_ticks(g->cfg.quota_ns), to_ticks(g->cfg.period_ns));
+        else
+            snprintf(bw, sizeof(bw), "-");
+        simtime_t thr = g->throttled_ns;
+        if (g->throttled) thr += elapsed - g->throttled_since;   // still throttled at the end
+
+        int nt = 0;
+        simtime_t sum = 0, max = 0;
+        for (const Thread* t = finished->front; t; t = t->next) {
+            if (!in_subtree(groups, t->group, i)) continue;
+            simtime_t turn = t->finish_time - t->arrival_time;
+            nt++;
+            sum += turn;
+            if (turn > max) max = turn;
+        }
+        fprintf(out, "%-12s %-12s %6d %15s %10.3f %6.1f %8ld %9ld %10.3f %7d %9.3f %9.3f\n",
+                g->cfg.name, g->parent >= 0 ? groups[g->parent].cfg.name : "-", g->cfg.shares, bw,
+                to_ticks(g->usage_ns), capacity > 0 ? 100.0 * g->usage_ns / capacity : 0.0,
+                g->periods, g->nr_throttled, to_ticks(thr), nt,
+                nt ? to_ticks(sum) / nt : 0.0, to_ticks(max));
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,122 @@
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include "sim.h"
+
+/*
+  Hierarchical CPU bandwidth control, after Linux cgroups (cpu controller).
+
+  Groups form a tree; threads belong to leaf groups (Thread.group). CPU
+  time a thread gets on a core (including switch overhead) is charged to
+  its group and every ancestor.
+
+  Bandwidth (quota/period): a group may use quota_ns of CPU time per
+  period_ns, summed over all cores. When it runs out it is throttled until
+  its next period starts: its running threads are preempted and none of
+  its Ready threads (or those of any group below it) are dispatched. The
+  engine stops exactly when a budget runs out, so throttling is not
+  rounded to ticks.
+
+  Shares: siblings that all have runnable threads split the CPU by shares.
+  Each group's vruntime advances by its CPU time x 1024 / shares; at every
+  tick a group more than one tick of vruntime ahead of its least-served
+  runnable sibling is held back (its running threads preempted) until the
+  others catch up. Held-back groups run anyway whenever a core would
+  otherwise idle, and a group that was idle restarts level with its
+  siblings rather than with a credit.
+
+  Ready threads of a blocked (throttled or held back) leaf wait in its
+  held queue, outside the scheduling policy; they still count as Ready.
+*/
+
+#define GROUP_NAME_LEN 16
+#define GROUP_SHARES   1024   // default shares, and the vruntime scale
+
+/* Static settings. Plain data so checkpoints can store it as is. */
+typedef struct {
+    char      name[GROUP_NAME_LEN];
+    char      parent[GROUP_NAME_LEN];   // "" = top level
+    int       shares;
+    simtime_t quota_ns;      // 0 = no bandwidth limit
+    simtime_t period_ns;
+    int       weight;        // relative number of threads placed in a leaf
+} GroupConfig;
+
+typedef struct {
+    GroupConfig cfg;
+    int        parent;          // index, -1 = top level
+    int        leaf;            // no child groups (threads live here)
+
+    /* bandwidth */
+    simtime_t  runtime_left;    // quota left in the current period
+    simtime_t  period_end;      // next refill, SIMTIME_NEVER without quota
+    int        throttled;
+    simtime_t  throttled_since;
+
+    /* shares */
+    simtime_t  vruntime;
+    int        over_share;      // held back for its siblings
+    int        nrunnable;       // Ready or running threads in the subtree (last count)
+    int        active;          // nrunnable > 0 at the previous count
+
+    Queue      held;            // leaf: Ready threads kept from the policy
+
+    /* statistics */
+    simtime_t  usage_ns;
+    simtime_t  throttled_ns;
+    simtime_t  period_usage;    // CPU time in the current period
+    long       periods;         // periods in which the group ran
+    long       nr_throttled;
+} Group;
+
+/* Parse "name[:key=val,...]" with keys parent=NAME, shares=N, quota=DUR,
+   period=DUR, weight=N (default shares=1024, no quota, period=100ms,
+   weight=1). Returns 0 on success, -1 on error. */
+int  group_parse(const char* spec, GroupConfig* cfg);
+
+/* parent is the index of cfg->parent (-1 = top level); the caller checks
+   that it exists and clears the parent's leaf flag. */
+void group_init(Group* g, const GroupConfig* cfg, int parent);
+void group_free(Group* g);   // the held list, not the threads
+
+/* Index of the group called name, or -1. */
+int  group_find(const Group* groups, int n, const char* name);
+
+/* Put every thread in workload into a leaf group, picked by weight with a
+   generator seeded by seed. */
+void group_assign(Group* groups, int n, Queue* workload, unsigned long long seed);
+
+/* 1 if g or an ancestor is throttled or held back for its share. */
+int  group_blocked(const Group* groups, int g);
+
+/* 1 if g is blocked only by its share (no throttled ancestor). */
+int  group_share_blocked(const Group* groups, int g);
+
+/* Charge dt ns of every busy core to its thread's groups; groups whose
+   quota runs out are throttled as of now + dt. */
+void group_charge(Group* groups, int n, const CPU* cpu, simtime_t now, simtime_t dt);
+
+/* Refill the groups whose period ended by now and unthrottle them.
+   Returns how many were unthrottled. */
+int  group_refill(Group* groups, int n, simtime_t now);
+
+/* Earliest time a running group exhausts its quota or a period ends;
+   SIMTIME_NEVER if none. */
+simtime_t group_next_event(const Group* groups, int n, const CPU* cpu, simtime_t now);
+
+/* Runnable counts: reset, then add each Ready or running thread. */
+void group_count_reset(Group* groups, int n);
+void group_count(Group* groups, const Thread* t);
+
+/* With fresh counts, decide which groups are held back for their share
+   (slack = vruntime lead allowed over the least-served sibling). */
+void group_balance(Group* groups, int n, simtime_t slack);
+
+/* Clear the share hold on g and its ancestors (a core would idle). */
+void group_unhold_share(Group* groups, int g);
+
+/* Per-group usage, throttling and latency of the group's finished threads. */
+void group_report(const Group* groups, int n, const Queue* finished, simtime_t elapsed,
+                  int ncores, FILE* out);
+
+#endif /* CGROUP_H */
@@ -0,0 +1,1045 @@
+#include "checkpoint.h"
+
+#define CKPT_MAGIC   "SIMCKPT"
+#define CKPT_VERSION 16
+
+/* where a thread lives; running threads use LOC_CORE + core index */
+enum { LOC_WORKLOAD = 0, LOC_READY, LOC_WAITING, LOC_FINISHED, LOC_DROPPED, LOC_CORE };
+
+typedef struct {
+    int64_t now;
+    int64_t tick_ns;    // SIM_TICK_NS of the saved run
+    int64_t cs_ns;
+    int smt, smt_gain;
+    int64_t rr_quantum;
+    int age_every;
+    int algo;
+    char policy[SCHED_PATH_LEN];   // external policy, "" = built-in algo
+    int ncores;
+    InterruptConfig intr;
+    unsigned long long rng;
+    int nthreads;
+} CkptHeader;
+
+/* per core switch state, ncores records after the header */
+typedef struct {
+    int64_t cs_left;
+    int     last_tid;
+} CkptCore;
+
+/* device state after the threads: a CkptDevice, then nreq CkptRequest */
+typedef struct {
+    DeviceConfig cfg;
+    int64_t queue_ns, svc_total, busy_ns, busy_since;
+    int64_t completed;
+    int head, dir, max_qlen, nreq;
+} CkptDevice;
+
+typedef struct {
+    int64_t submitted, started, done_at;
+    int tid;
+    int sector;
+    int slot;           // in-service slot, -1 = queued
+} CkptRequest;
+
+/* lock state after the devices: a CkptLock, then nwait waiter tids */
+typedef struct {
+    LockConfig cfg;
+    int64_t owned_since, wait_ns, held_ns;
+    int64_t acquired, contended;
+    int ceiling, owner, max_wait, nwait;   // owner tid, -1 = free
+} CkptLock;
+
+typedef struct {
+    int64_t arrival_time;
+    int64_t burst_time;
+    int64_t remaining;
+    int64_t unblocked_at;
+    int64_t start_time;
+    int64_t finish_time;
+    int64_t wait_time;
+    int64_t ready_since;
+    int64_t quanta_rem;
+    int64_t stop_at;
+    int64_t phase_end;
+    int64_t lock_since;
+    int64_t cp_tail;
+    int64_t cp_due;
+    int64_t mem_at;
+    double energy;
+    int loc;
+    int tid;
+    int state;
+    int priority;
+    int nphases;        // followed by nphases Phase records
+    int phase;
+    int ready_count;
+    int nlockops;       // then nlockops LockOp records
+    int lockop;
+    int blocked_on;
+    int boosted;
+    int base_priority;
+    int group;
+    int job;
+    int task;
+    int deps_left;
+    int gang;
+    int gang_rank;
+    int gang_size;
+    int wset;           // then a CkptPages and wset frame indices, 0 = no paging
+} CkptThread;
+
+typedef struct {
+    int64_t refs, faults;
+    int resident;
+} CkptPages;
+
+static void pack_thread(CkptThread* r, const Thread* t, int loc) {
+    r->loc          = loc;
+    r->tid          = t->tid;
+    r->arrival_time = t->arrival_time;
+    r->burst_time   = t->burst_time;
+    r->remaining    = t->remaining;
+    r->state        = (int)t->state;
+    r->unblocked_at = t->unblocked_at;
+    r->start_time   = t->start_time;
+    r->finish_time  = t->finish_time;
+    r->wait_time    = t->wait_time;
+    r->ready_since  = t->ready_since;
+    r->quanta_rem   = t->quanta_rem;
+    r->priority     = t->priority;
+    r->nphases      = t->phases ? t->nphases : 0;
+    r->phase        = t->phase;
+    r->stop_at      = t->stop_at;
+    r->ready_count  = t->ready_count;
+    r->phase_end    = t->phase_end;
+    r->lock_since   = t->lock_since;
+    r->nlockops     = t->lockops ? t->nlockops : 0;
+    r->lockop       = t->lockop;
+    r->blocked_on   = t->blocked_on;
+    r->boosted      = t->boosted;
+    r->base_priority = t->base_priority;
+    r->energy       = t->energy;
+    r->group        = t->group;
+    r->job          = t->job;
+    r->task         = t->task;
+    r->deps_left    = t->deps_left;
+    r->cp_tail      = t->cp_tail;
+    r->cp_due       = t->cp_due;
+    r->gang         = t->gang;
+    r->gang_rank    = t->gang_rank;
+    r->gang_size    = t->gang_size;
+    r->mem_at       = t->mem_at;
+    r->wset         = t->pages ? t->pages->wset : 0;
+}
+
+static Thread* unpack_thread(const CkptThread* r) {
+    Thread* t = (Thread*)calloc(1, sizeof(Thread));
+    if (!t) return NULL;
+    t->tid          = r->tid;
+    t->arrival_time = r->arrival_time;
+    t->burst_time   = r->burst_time;
+    t->remaining    = r->remaining;
+    t->state        = (ThreadState)r->state;
+    t->unblocked_at = r->unblocked_at;
+    t->start_time   = r->start_time;
+    t->finish_time  = r->finish_time;
+    t->wait_time    = r->wait_time;
+    t->ready_since  = r->ready_since;
+    t->quanta_rem   = r->quanta_rem;
+    t->priority     = r->priority;
+    t->phase        = r->phase;
+    t->stop_at      = r->stop_at;
+    t->ready_count  = r->ready_count;
+    t->phase_end    = r->phase_end;
+    t->lock_since   = r->lock_since;
+    t->lockop       = r->lockop;
+    t->blocked_on   = r->blocked_on;
+    t->boosted      = r->boosted;
+    t->base_priority = r->base_priority;
+    t->energy       = r->energy;
+    t->group        = r->group;
+    t->job          = r->job;
+    t->task         = r->task;
+    t->deps_left    = r->deps_left;
+    t->cp_tail      = r->cp_tail;
+    t->cp_due       = r->cp_due;
+    t->gang         = r->gang;
+    t->gang_rank    = r->gang_rank;
+    t->gang_size    = r->gang_size;
+    t->mem_at       = r->mem_at;
+    t->next         = NULL;
+    return t;
+}
+
+static int write_thread(FILE* f, const Thread* t, int loc) {
+    CkptThread r;
+    pack_thread(&r, t, loc);
+    if (fwrite(&r, sizeof(r), 1, f) != 1) return -1;
+    if (r.nphases > 0 && fwrite(t->phases, sizeof(Phase), r.nphases, f) != (size_t)r.nphases) return -1;
+    if (r.nlockops > 0 && fwrite(t->lockops, sizeof(LockOp), r.nlockops, f) != (size_t)r.nlockops) return -1;
+    if (r.wset > 0) {
+        const PageTable* pt = t->pages;
+        CkptPages k = { pt->refs, pt->faults, pt->resident };
+        if (fwrite(&k, sizeof(k), 1, f) != 1 ||
+            fwrite(pt->frame, sizeof(int), r.wset, f) != (size_t)r.wset) return -1;
+    }
+    return 0;
+}
+
+/* read one thread record and its phases; NULL on error */
+static Thread* read_thread(FILE* f, int* loc) {
+    CkptThread r;
+    if (fread(&r, sizeof(r), 1, f) != 1 || r.nphases < 0 || r.nlockops < 0 || r.wset < 0) return NULL;
+    Thread* t = unpack_thread(&r);
+    if (!t) return NULL;
+    if (r.nphases > 0) {
+        t->phases = (Phase*)malloc(sizeof(Phase) * r.nphases);
+        t->nphases = r.nphases;
+        if (!t->phases || fread(t->phases, sizeof(Phase), r.nphases, f) != (size_t)r.nphases) {
+            thread_free(t);
+            return NULL;
+        }
+    }
+    if (r.nlockops > 0) {
+        t->lockops = (LockOp*)malloc(sizeof(LockOp) * r.nlockops);
+        t->nlockops = r.nlockops;
+        if (!t->lockops || fread(t->lockops, sizeof(LockOp), r.nlockops, f) != (size_t)r.nlockops) {
+            thread_free(t);
+            return NULL;
+        }
+    }
+    if (r.wset > 0) {
+        CkptPages k;
+        t->pages = (PageTable*)calloc(1, sizeof(PageTable) + sizeof(int) * r.wset);
+        if (!t->pages || fread(&k, sizeof(k), 1, f) != 1 ||
+            fread(t->pages->frame, sizeof(int), r.wset, f) != (size_t)r.wset) {
+            thread_free(t);
+            return NULL;
+        }
+        t->pages->wset     = r.wset;
+        t->pages->refs     = (long)k.refs;
+        t->pages->faults   = (long)k.faults;
+        t->pages->resident = k.resident;
+    }
+    *loc = r.loc;
+    return t;
+}
+
+static int write_queue(FILE* f, const Queue* q, int loc) {
+    for (const Thread* p = q->front; p; p = p->next)
+        if (write_thread(f, p, loc) != 0) return -1;
+    return 0;
+}
+
+typedef struct {
+    FILE* f;
+    int   rc;
+} WriteCtx;
+
+static void write_ready_one(Thread* t, void* ctx) {
+    WriteCtx* w = (WriteCtx*)ctx;
+    if (!w->rc && write_thread(w->f, t, LOC_READY) != 0) w->rc = -1;
+}
+
+/* Ready: the policy's threads, then those not yet enqueued, then those
+   held back by their group */
+static int write_ready(FILE* f, const Sim* s) {
+    WriteCtx w = { f, 0 };
+    sched_for_each(&s->sched, write_ready_one, &w);
+    if (w.rc || write_queue(f, &s->ready, LOC_READY) != 0) return -1;
+    for (int i = 0; i < s->ngroup; ++i)
+        if (write_queue(f, &s->group[i].held, LOC_READY) != 0) return -1;
+    return 0;
+}
+
+static int write_request(FILE* f, const IoRequest* r, int slot) {
+    CkptRequest k = { r->submitted, r->started, r->done_at, r->t->tid, r->sector, slot };
+    return fwrite(&k, sizeof(k), 1, f) == 1 ? 0 : -1;
+}
+
+static int write_device(FILE* f, const Device* d) {
+    CkptDevice k;
+    memset(&k, 0, sizeof(k));
+    k.cfg        = d->cfg;
+    k.queue_ns   = d->queue_ns;
+    k.svc_total  = d->svc_total;
+    k.busy_ns    = d->busy_ns;
+    k.busy_since = d->busy_since;
+    k.completed  = d->completed;
+    k.head       = d->head;
+    k.dir        = d->dir;
+    k.max_qlen   = d->max_qlen;
+    k.nreq       = d->qlen;
+    for (int i = 0; i < d->cfg.depth; ++i) if (d->slot[i]) k.nreq++;
+    if (fwrite(&k, sizeof(k), 1, f) != 1) return -1;
+
+    for (const IoRequest* r = d->queue; r; r = r->next)
+        if (write_request(f, r, -1) != 0) return -1;
+    for (int i = 0; i < d->cfg.depth; ++i)
+        if (d->slot[i] && write_request(f, d->slot[i], i) != 0) return -1;
+    return 0;
+}
+
+/* rebuild a device; request threads are looked up in the waiting queue */
+static int read_device(FILE* f, Sim* s) {
+    CkptDevice k;
+    if (fread(&k, sizeof(k), 1, f) != 1 || k.nreq < 0 || k.cfg.depth < 1) return -1;
+    k.cfg.name[DEV_NAME_LEN - 1] = '\0';
+    sim_add_device(s, &k.cfg);
+    Device* d = &s->dev[s->ndev - 1];
+    d->queue_ns   = k.queue_ns;
+    d->svc_total  = k.svc_total;
+    d->busy_ns    = k.busy_ns;
+    d->busy_since = k.busy_since;
+    d->completed  = (long)k.completed;
+    d->head       = k.head;
+    d->dir        = k.dir;
+    d->max_qlen   = k.max_qlen;
+
+    IoRequest** tail = &d->queue;
+    for (int i = 0; i < k.nreq; ++i) {
+        CkptRequest q;
+        if (fread(&q, sizeof(q), 1, f) != 1 || q.slot >= d->cfg.depth) return -1;
+        Thread* t = s->waiting.front;
+        while (t && t->tid != q.tid) t = t->next;
+        if (!t) return -1;
+        IoRequest* r = (IoRequest*)calloc(1, sizeof(IoRequest));
+        r->t         = t;
+        r->sector    = q.sector;
+        r->submitted = q.submitted;
+        r->started   = q.started;
+        r->done_at   = q.done_at;
+        if (q.slot >= 0) {
+            if (d->slot[q.slot]) { free(r); return -1; }
+            d->slot[q.slot] = r;
+        } else {
+            *tail = r;
+            tail = &r->next;
+            d->qlen++;
+        }
+    }
+    return 0;
+}
+
+static int write_lock(FILE* f, const Lock* l) {
+    CkptLock k;
+    memset(&k, 0, sizeof(k));
+    k.cfg         = l->cfg;
+    k.owned_since = l->owned_since;
+    k.wait_ns     = l->wait_ns;
+    k.held_ns     = l->held_ns;
+    k.acquired    = l->acquired;
+    k.contended   = l->contended;
+    k.ceiling     = l->ceiling;
+    k.owner       = l->owner ? l->owner->tid : -1;
+    k.max_wait    = l->max_wait;
+    k.nwait       = l->nwait;
+    if (fwrite(&k, sizeof(k), 1, f) != 1) return -1;
+    for (int i = 0; i < l->nwait; ++i)
+        if (fwrite(&l->wait[i]->tid, sizeof(int), 1, f) != 1) return -1;
+    return 0;
+}
+
+/* power model after the locks: a flag, then CkptPower and per core CkptPowerCore */
+typedef struct {
+    PowerConfig cfg;
+    int64_t switches;
+    double  removed_j;
+} CkptPower;
+
+typedef struct {
+    int64_t idle_since, win_busy, busy_ns, sleep_ns;
+    double  energy, mhz_ns;
+    int     pstate;
+} CkptPowerCore;
+
+static int write_power(FILE* f, const Power* pw) {
+    int on = pw != NULL;
+    if (fwrite(&on, sizeof(on), 1, f) != 1) return -1;
+    if (!on) return 0;
+    CkptPower k;
+    memset(&k, 0, sizeof(k));
+    k.cfg       = pw->cfg;
+    k.switches  = pw->switches;
+    k.removed_j = pw->removed_j;
+    if (fwrite(&k, sizeof(k), 1, f) != 1) return -1;
+    for (int c = 0; c < pw->ncores; ++c) {
+        CkptPowerCore pc;
+        memset(&pc, 0, sizeof(pc));
+        pc.idle_since = pw->idle_since[c];
+        pc.win_busy   = pw->win_busy[c];
+        pc.busy_ns    = pw->busy_ns[c];
+        pc.sleep_ns   = pw->sleep_ns[c];
+        pc.energy     = pw->energy[c];
+        pc.mhz_ns     = pw->mhz_ns[c];
+        pc.pstate     = pw->pstate[c];
+        if (fwrite(&pc, sizeof(pc), 1, f) != 1) return -1;
+    }
+    return 0;
+}
+
+static int read_power(FILE* f, Sim* s) {
+    int on = 0;
+    if (fread(&on, sizeof(on), 1, f) != 1) return -1;
+    if (!on) return 0;
+    CkptPower k;
+    if (fread(&k, sizeof(k), 1, f) != 1 || k.cfg.np < 1 || k.cfg.np > POWER_MAX_PSTATES) return -1;
+    sim_enable_power(s, &k.cfg);
+    Power* pw = s->power;
+    pw->switches  = (long)k.switches;
+    pw->removed_j = k.removed_j;
+    for (int c = 0; c < pw->ncores; ++c) {
+        CkptPowerCore pc;
+        if (fread(&pc, sizeof(pc), 1, f) != 1 || pc.pstate < 0 || pc.pstate >= k.cfg.np) return -1;
+        pw->idle_since[c] = pc.idle_since;
+        pw->win_busy[c]   = pc.win_busy;
+        pw->busy_ns[c]    = pc.busy_ns;
+        pw->sleep_ns[c]   = pc.sleep_ns;
+        pw->energy[c]     = pc.energy;
+        pw->mhz_ns[c]     = pc.mhz_ns;
+        pw->pstate[c]     = pc.pstate;
+    }
+    power_resize(pw, &s->cpu);   // rates from the restored P-states
+    return 0;
+}
+
+/* group state after the power model: ngroup, then a CkptGroup each */
+typedef struct {
+    GroupConfig cfg;
+    int64_t runtime_left, period_end, throttled_since, vruntime;
+    int64_t usage_ns, throttled_ns, period_usage, periods, nr_throttled;
+    int throttled, over_share, nrunnable, active;
+} CkptGroup;
+
+static int write_groups(FILE* f, const Sim* s) {
+    if (fwrite(&s->ngroup, sizeof(s->ngroup), 1, f) != 1) return -1;
+    for (int i = 0; i < s->ngroup; ++i) {
+        const Group* g = &s->group[i];
+        CkptGroup k;
+        memset(&k, 0, sizeof(k));
+        k.cfg             = g->cfg;
+        k.runtime_left    = g->runtime_left;
+        k.period_end      = g->period_end;
+        k.throttled_since = g->throttled_since;
+        k.vruntime        = g->vruntime;
+        k.usage_ns        = g->usage_ns;
+        k.throttled_ns    = g->throttled_ns;
+        k.period_usage    = g->period_usage;
+        k.periods         = g->periods;
+        k.nr_throttled    = g->nr_throttled;
+        k.throttled       = g->throttled;
+        k.over_share      = g->over_share;
+        k.nrunnable       = g->nrunnable;
+        k.active          = g->active;
+        if (fwrite(&k, sizeof(k), 1, f) != 1) return -1;
+    }
+    return 0;
+}
+
+static int read_groups(FILE* f, Sim* s) {
+    int n = 0;
+    if (fread(&n, sizeof(n), 1, f) != 1 || n < 0) return -1;
+    for (int i = 0; i < n; ++i) {
+        CkptGroup k;
+        if (fread(&k, sizeof(k), 1, f) != 1) return -1;
+        k.cfg.name[GROUP_NAME_LEN - 1]   = '\0';
+        k.cfg.parent[GROUP_NAME_LEN - 1] = '\0';
+        if (k.cfg.shares < 1 || k.cfg.period_ns < 1 || sim_add_group(s, &k.cfg) < 0) return -1;
+        Group* g = &s->group[s->ngroup - 1];
+        g->runtime_left    = k.runtime_left;
+        g->period_end      = k.period_end;
+        g->throttled_since = k.throttled_since;
+        g->vruntime        = k.vruntime;
+        g->usage_ns        = k.usage_ns;
+        g->throttled_ns    = k.throttled_ns;
+        g->period_usage    = k.period_usage;
+        g->periods         = (long)k.periods;
+        g->nr_throttled    = (long)k.nr_throttled;
+        g->throttled       = k.throttled;
+        g->over_share      = k.over_share;
+        g->nrunnable       = k.nrunnable;
+        g->active          = k.active;
+    }
+    /* every thread must belong to a restored group */
+    Queue* qs[5] = { &s->workload, &s->ready, &s->waiting, &s->finished, &s->dropped };
+    for (int q = 0; q < 5; ++q)
+        for (Thread* t = qs[q]->front; t; t = t->next)
+            if (t->group >= s->ngroup) return -1;
+    for (int c = 0; c < s->cpu.ncores; ++c)
+        if (s->cpu.core[c] && s->cpu.core[c]->group >= s->ngroup) return -1;
+    return 0;
+}
+
+/* core scaling after the groups: core_ns, the hotplug events not yet
+   applied (count, then the events), then a flag and the autoscaler */
+typedef struct {
+    AutoscaleConfig cfg;
+    int64_t quiet_until, pending_at;
+    int64_t ups, downs, saturated;
+    int above, below, pending, min_seen, max_seen;
+} CkptScale;
+
+static int write_scaling(FILE* f, const Sim* s) {
+    int64_t core_ns = s->core_ns;
+    int n = s->nhotplug - s->hotplug_next;
+    int on = s->scale != NULL;
+    if (fwrite(&core_ns, sizeof(core_ns), 1, f) != 1 ||
+        fwrite(&n, sizeof(n), 1, f) != 1 ||
+        (n > 0 && fwrite(&s->hotplug[s->hotplug_next], sizeof(HotplugEvent), n, f) != (size_t)n) ||
+        fwrite(&on, sizeof(on), 1, f) != 1) return -1;
+    if (!on) return 0;
+    const Autoscaler* a = s->scale;
+    CkptScale k;
+    memset(&k, 0, sizeof(k));
+    k.cfg         = a->cfg;
+    k.quiet_until = a->quiet_until;
+    k.pending_at  = a->pending_at;
+    k.ups         = a->ups;
+    k.downs       = a->downs;
+    k.saturated   = a->saturated;
+    k.above       = a->above;
+    k.below       = a->below;
+    k.pending     = a->pending;
+    k.min_seen    = a->min_seen;
+    k.max_seen    = a->max_seen;
+    return fwrite(&k, sizeof(k), 1, f) == 1 ? 0 : -1;
+}
+
+static int read_scaling(FILE* f, Sim* s) {
+    int64_t core_ns = 0;
+    int n = 0, on = 0;
+    if (fread(&core_ns, sizeof(core_ns), 1, f) != 1 ||
+        fread(&n, sizeof(n), 1, f) != 1 || n < 0) return -1;
+    s->core_ns = core_ns;
+    for (int i = 0; i < n; ++i) {
+        HotplugEvent ev;
+        if (fread(&ev, sizeof(ev), 1, f) != 1 || ev.ncores < 1) return -1;
+        sim_add_hotplug(s, &ev);
+    }
+    if (fread(&on, sizeof(on), 1, f) != 1) return -1;
+    if (!on) return 0;
+    CkptScale k;
+    if (fread(&k, sizeof(k), 1, f) != 1 || k.cfg.min_cores < 1 ||
+        k.cfg.max_cores < k.cfg.min_cores || k.cfg.step < 1 || k.cfg.delay < 1) return -1;
+    sim_enable_autoscale(s, &k.cfg);
+    Autoscaler* a = s->scale;
+    a->quiet_until = k.quiet_until;
+    a->pending_at  = k.pending_at;
+    a->ups         = (long)k.ups;
+    a->downs       = (long)k.downs;
+    a->saturated   = (long)k.saturated;
+    a->above       = k.above;
+    a->below       = k.below;
+    a->pending     = k.pending;
+    a->min_seen    = k.min_seen;
+    a->max_seen    = k.max_seen;
+    return 0;
+}
+
+/* DAG jobs after core scaling: njob, then a CkptJob each followed by its
+   task tids, successor lists, top and bottom levels */
+typedef struct {
+    JobConfig cfg;
+    int64_t arrival, cp, work, finish;
+    int instance, ntask, nsucc, done;
+} CkptJob;
+
+static int write_jobs(FILE* f, const Sim* s) {
+    if (fwrite(&s->njob, sizeof(s->njob), 1, f) != 1) return -1;
+    for (int i = 0; i < s->njob; ++i) {
+        const Job* j = &s->job[i];
+        CkptJob k;
+        memset(&k, 0, sizeof(k));
+        k.cfg      = j->cfg;
+        k.arrival  = j->arrival;
+        k.cp       = j->cp;
+        k.work     = j->work;
+        k.finish   = j->finish;
+        k.instance = j->instance;
+        k.ntask    = j->ntask;
+        k.nsucc    = j->succ_start[j->ntask];
+        k.done     = j->done;
+        if (fwrite(&k, sizeof(k), 1, f) != 1) return -1;
+        for (int t = 0; t < j->ntask; ++t)
+            if (fwrite(&j->task[t]->tid, sizeof(int), 1, f) != 1) return -1;
+        size_t n = (size_t)j->ntask;
+        if (fwrite(j->succ_start, sizeof(int), n + 1, f) != n + 1 ||
+            fwrite(j->succ, sizeof(int), k.nsucc, f) != (size_t)k.nsucc ||
+            fwrite(j->top, sizeof(simtime_t), n, f) != n ||
+            fwrite(j->bottom, sizeof(simtime_t), n, f) != n) return -1;
+    }
+    return 0;
+}
+
+/* index every restored thread by tid (tids are small and dense) */
+static Thread** thread_index(Sim* s, int* max_tid) {
+    Queue* qs[4] = { &s->workload, &s->ready, &s->waiting, &s->finished };
+    int max = 0;
+    for (int q = 0; q < 4; ++q)
+        for (Thread* t = qs[q]->front; t; t = t->next)
+            if (t->tid > max) max = t->tid;
+    for (int c = 0; c < s->cpu.ncores; ++c)
+        if (s->cpu.core[c] && s->cpu.core[c]->tid > max) max = s->cpu.core[c]->tid;
+    Thread** by_tid = (Thread**)calloc(max + 1, sizeof(Thread*));
+    for (int q = 0; q < 4; ++q)
+        for (Thread* t = qs[q]->front; t; t = t->next)
+            if (t->tid >= 0) by_tid[t->tid] = t;
+    for (int c = 0; c < s->cpu.ncores; ++c)
+        if (s->cpu.core[c] && s->cpu.core[c]->tid >= 0) by_tid[s->cpu.core[c]->tid] = s->cpu.core[c];
+    *max_tid = max;
+    return by_tid;
+}
+
+static int read_jobs(FILE* f, Sim* s) {
+    int n = 0;
+    if (fread(&n, sizeof(n), 1, f) != 1 || n < 0) return -1;
+    if (n == 0) return 0;
+    int max_tid = 0;
+    Thread** by_tid = thread_index(s, &max_tid);
+    int bad = 0;
+    s->job = (Job*)calloc(n, sizeof(Job));
+    for (int i = 0; !bad && i < n; ++i) {
+        CkptJob k;
+        if (fread(&k, sizeof(k), 1, f) != 1 || k.ntask < 1 || k.nsucc < 0) {
+            bad = 1;
+            break;
+        }
+        k.cfg.spec.name[JOB_NAME_LEN - 1] = '\0';
+        Job* j = &s->job[s->njob++];
+        job_alloc(j, &k.cfg, k.instance, k.ntask, k.nsucc);
+        j->arrival = k.arrival;
+        j->cp      = k.cp;
+        j->work    = k.work;
+        j->finish  = k.finish;
+        j->done    = k.done;
+        for (int t = 0; !bad && t < k.ntask; ++t) {
+            int tid;
+            if (fread(&tid, sizeof(tid), 1, f) != 1 || tid < 0 || tid > max_tid || !by_tid[tid] ||
+                by_tid[tid]->job != i || by_tid[tid]->task != t) bad = 1;
+            else j->task[t] = by_tid[tid];
+        }
+        size_t nt = (size_t)k.ntask;
+        if (bad ||
+            fread(j->succ_start, sizeof(int), nt + 1, f) != nt + 1 ||
+            fread(j->succ, sizeof(int), k.nsucc, f) != (size_t)k.nsucc ||
+            fread(j->top, sizeof(simtime_t), nt, f) != nt ||
+            fread(j->bottom, sizeof(simtime_t), nt, f) != nt) {
+            bad = 1;
+            break;
+        }
+        for (int e = 0; e < k.nsucc; ++e)
+            if (j->succ[e] < 0 || j->succ[e] >= k.ntask) bad = 1;
+        for (size_t t = 0; t < nt; ++t)
+            if (j->succ_start[t] < 0 || j->succ_start[t] > j->succ_start[t + 1]) bad = 1;
+        if (j->succ_start[nt] != k.nsucc) bad = 1;
+    }
+    free(by_tid);
+    if (bad) return -1;
+    /* every task's job must have been restored */
+    Queue* qs[4] = { &s->workload, &s->ready, &s->waiting, &s->finished };
+    for (int q = 0; q < 4; ++q)
+        for (Thread* t = qs[q]->front; t; t = t->next)
+            if (t->job >= s->njob) return -1;
+    for (int c = 0; c < s->cpu.ncores; ++c)
+        if (s->cpu.core[c] && s->cpu.core[c]->job >= s->njob) return -1;
+    return 0;
+}
+
+/* Gangs after the DAG jobs: ngang, then a CkptGang each followed by its
+   member tids and barrier arrival times, then the idle-while-Ready time */
+typedef struct {
+    GangConfig cfg;
+    int64_t arrival, first_at, ideal, work, skew_ns, wait_ns, finish;
+    int instance, arrived, barriers, done;
+} CkptGang;
+
+static int write_gangs(FILE* f, const Sim* s) {
+    if (fwrite(&s->ngang, sizeof(s->ngang), 1, f) != 1) return -1;
+    for (int i = 0; i < s->ngang; ++i) {
+        const Gang* g = &s->gang[i];
+        CkptGang k;
+        memset(&k, 0, sizeof(k));
+        k.cfg      = g->cfg;
+        k.arrival  = g->arrival;
+        k.first_at = g->first_at;
+        k.ideal    = g->ideal;
+        k.work     = g->work;
+        k.skew_ns  = g->skew_ns;
+        k.wait_ns  = g->wait_ns;
+        k.finish   = g->finish;
+        k.instance = g->instance;
+        k.arrived  = g->arrived;
+        k.barriers = g->barriers;
+        k.done     = g->done;
+        if (fwrite(&k, sizeof(k), 1, f) != 1) return -1;
+        for (int m = 0; m < g->cfg.width; ++m)
+            if (fwrite(&g->member[m]->tid, sizeof(int), 1, f) != 1) return -1;
+        size_t n = (size_t)g->cfg.width;
+        if (fwrite(g->since, sizeof(simtime_t), n, f) != n) return -1;
+    }
+    return fwrite(&s->idle_ready_ns, sizeof(s->idle_ready_ns), 1, f) == 1 ? 0 : -1;
+}
+
+static int read_gangs(FILE* f, Sim* s) {
+    int n = 0;
+    if (fread(&n, sizeof(n), 1, f) != 1 || n < 0) return -1;
+    int max_tid = 0;
+    Thread** by_tid = n > 0 ? thread_index(s, &max_tid) : NULL;
+    int bad = 0;
+    if (n > 0) s->gang = (Gang*)calloc(n, sizeof(Gang));
+    for (int i = 0; !bad && i < n; ++i) {
+        CkptGang k;
+        if (fread(&k, sizeof(k), 1, f) != 1 || k.cfg.width < 1 || k.cfg.width > 4096) {
+            bad = 1;
+            break;
+        }
+        k.cfg.name[JOB_NAME_LEN - 1] = '\0';
+        Gang* g = &s->gang[s->ngang++];
+        gang_alloc(g, &k.cfg, k.instance);
+        g->arrival  = k.arrival;
+        g->first_at = k.first_at;
+        g->ideal    = k.ideal;
+        g->work     = k.work;
+        g->skew_ns  = k.skew_ns;
+        g->wait_ns  = k.wait_ns;
+        g->finish   = k.finish;
+        g->arrived  = k.arrived;
+        g->barriers = k.barriers;
+        g->done     = k.done;
+        for (int m = 0; !bad && m < k.cfg.width; ++m) {
+            int tid;
+            if (fread(&tid, sizeof(tid), 1, f) != 1 || tid < 0 || tid > max_tid || !by_tid[tid] ||
+                by_tid[tid]->gang != i || by_tid[tid]->gang_rank != m) bad = 1;
+            else g->member[m] = by_tid[tid];
+        }
+        size_t w = (size_t)k.cfg.width;
+        if (bad || fread(g->since, sizeof(simtime_t), w, f) != w) bad = 1;
+    }
+    free(by_tid);
+    if (bad || fread(&s->idle_ready_ns, sizeof(s->idle_ready_ns), 1, f) != 1) return -1;
+    /* every member's gang must have been restored */
+    Queue* qs[4] = { &s->workload, &s->ready, &s->waiting, &s->finished };
+    for (int q = 0; q < 4; ++q)
+        for (Thread* t = qs[q]->front; t; t = t->next)
+            if (t->gang >= s->ngang) return -1;
+    for (int c = 0; c < s->cpu.ncores; ++c)
+        if (s->cpu.core[c] && s->cpu.core[c]->gang >= s->ngang) return -1;
+    return 0;
+}
+
+/* a restored thread by tid: ready, waiting or on a core */
+static Thread* find_thread(Sim* s, int tid) {
+    Queue* qs[2] = { &s->ready, &s->waiting };
+    for (int i = 0; i < 2; ++i)
+        for (Thread* t = qs[i]->front; t; t = t->next)
+            if (t->tid == tid) return t;
+    for (int c = 0; c < s->cpu.ncores; ++c)
+        if (s->cpu.core[c] && s->cpu.core[c]->tid == tid) return s->cpu.core[c];
+    return NULL;
+}
+
+static int read_lock(FILE* f, Sim* s) {
+    CkptLock k;
+    if (fread(&k, sizeof(k), 1, f) != 1 || k.nwait < 0) return -1;
+    k.cfg.name[LOCK_NAME_LEN - 1] = '\0';
+    sim_add_lock(s, &k.cfg);
+    Lock* l = &s->lock[s->nlock - 1];
+    l->owned_since = k.owned_since;
+    l->wait_ns     = k.wait_ns;
+    l->held_ns     = k.held_ns;
+    l->acquired    = (long)k.acquired;
+    l->contended   = (long)k.contended;
+    l->ceiling     = k.ceiling;
+    l->max_wait    = k.max_wait;
+    if (k.owner >= 0 && !(l->owner = find_thread(s, k.owner))) return -1;
+    if (k.nwait > 0) {
+        l->wait = (Thread**)malloc(sizeof(Thread*) * k.nwait);
+        if (!l->wait) return -1;
+        l->cap = k.nwait;
+    }
+    for (int i = 0; i < k.nwait; ++i) {
+        int tid;
+        if (fread(&tid, sizeof(tid), 1, f) != 1) return -1;
+        if (!(l->wait[l->nwait++] = find_thread(s, tid))) return -1;
+    }
+    return 0;
+}
+
+/* admission control last: on flag, then the whole Admitter (plain data) */
+static int write_admit(FILE* f, const Admitter* a) {
+    int on = a != NULL;
+    if (fwrite(&on, sizeof(on), 1, f) != 1) return -1;
+    return !on || fwrite(a, sizeof(*a), 1, f) == 1 ? 0 : -1;
+}
+
+static int read_admit(FILE* f, Sim* s) {
+    int on = 0;
+    if (fread(&on, sizeof(on), 1, f) != 1) return -1;
+    if (!on) return 0;
+    Admitter a;
+    if (fread(&a, sizeof(a), 1, f) != 1 || (unsigned)a.cfg.policy > AD_CODEL ||
+        a.cfg.max_ready < 1 || a.cfg.burst < 1 || a.cfg.rate <= 0 || a.cfg.interval <= 0) return -1;
+    sim_enable_admit(s, &a.cfg);
+    *s->admit = a;
+    return 0;
+}
+
+/* paging after admission control: on flag, a CkptMem, its free list and
+   fault channels, then a CkptFrame per frame (owner tid, -1 = free) */
+typedef struct {
+    MemConfig cfg;
+    unsigned long long rng;
+    int64_t demand, max_demand, refs, faults, evictions, fault_wait_ns;
+    int hand, nfree, nactive, max_active;
+    int64_t bucket_refs[MEM_BUCKETS], bucket_faults[MEM_BUCKETS];
+    double bucket_demand[MEM_BUCKETS];
+} CkptMem;
+
+typedef struct {
+    int64_t loaded, used;
+    int tid, page, ref;
+} CkptFrame;
+
+static int write_mem(FILE* f, const Mem* m) {
+    int on = m != NULL;
+    if (fwrite(&on, sizeof(on), 1, f) != 1) return -1;
+    if (!on) return 0;
+    CkptMem k;
+    memset(&k, 0, sizeof(k));
+    k.cfg           = m->cfg;
+    k.rng           = m->rng.s;
+    k.demand        = m->demand;
+    k.max_demand    = m->max_demand;
+    k.refs          = m->refs;
+    k.faults        = m->faults;
+    k.evictions     = m->evictions;
+    k.fault_wait_ns = m->fault_wait_ns;
+    k.hand          = m->hand;
+    k.nfree         = m->nfree;
+    k.nactive       = m->nactive;
+    k.max_active    = m->max_active;
+    for (int b = 0; b < MEM_BUCKETS; ++b) {
+        k.bucket_refs[b]   = m->bucket_refs[b];
+        k.bucket_faults[b] = m->bucket_faults[b];
+        k.bucket_demand[b] = m->bucket_demand[b];
+    }
+    size_t nch = (size_t)m->cfg.channels;
+    if (fwrite(&k, sizeof(k), 1, f) != 1 ||
+        (m->nfree > 0 && fwrite(m->free_list, sizeof(int), m->nfree, f) != (size_t)m->nfree) ||
+        (nch > 0 && fwrite(m->channel, sizeof(simtime_t), nch, f) != nch)) return -1;
+    for (int i = 0; i < m->cfg.frames; ++i) {
+        const Frame* fr = &m->frame[i];
+        CkptFrame c = { fr->loaded, fr->used, fr->owner ? fr->owner->tid : -1, fr->page, fr->ref };
+        if (fwrite(&c, sizeof(c), 1, f) != 1) return -1;
+    }
+    return 0;
+}
+
+static int read_mem(FILE* f, Sim* s) {
+    int on = 0;
+    if (fread(&on, sizeof(on), 1, f) != 1) return -1;
+    if (!on) return 0;
+    CkptMem k;
+    if (fread(&k, sizeof(k), 1, f) != 1 || k.cfg.frames < 1 || k.cfg.ws_min < 1 ||
+        k.cfg.ws_max < k.cfg.ws_min || k.cfg.channels < 0 || k.cfg.touch <= 0 || k.cfg.fault <= 0 ||
+        k.nfree < 0 || k.nfree > k.cfg.frames || k.hand < 0 || k.hand >= k.cfg.frames) return -1;
+    sim_enable_mem(s, &k.cfg, 0);
+    Mem* m = s->mem;
+    m->rng.s         = k.rng;
+    m->demand        = (long)k.demand;
+    m->max_demand    = (long)k.max_demand;
+    m->refs          = (long)k.refs;
+    m->faults        = (long)k.faults;
+    m->evictions     = (long)k.evictions;
+    m->fault_wait_ns = k.fault_wait_ns;
+    m->hand          = k.hand;
+    m->nfree         = k.nfree;
+    m->nactive       = k.nactive;
+    m->max_active    = k.max_active;
+    for (int b = 0; b < MEM_BUCKETS; ++b) {
+        m->bucket_refs[b]   = (long)k.bucket_refs[b];
+        m->bucket_faults[b] = (long)k.bucket_faults[b];
+        m->bucket_demand[b] = k.bucket_demand[b];
+    }
+    size_t nch = (size_t)k.cfg.channels;
+    if ((m->nfree > 0 && fread(m->free_list, sizeof(int), m->nfree, f) != (size_t)m->nfree) ||
+        (nch > 0 && fread(m->channel, sizeof(simtime_t), nch, f) != nch)) return -1;
+
+    int max_tid = 0;
+    Thread** by_tid = thread_index(s, &max_tid);
+    int bad = 0;
+    for (int i = 0; !bad && i < k.cfg.frames; ++i) {
+        CkptFrame c;
+        if (fread(&c, sizeof(c), 1, f) != 1 || c.tid > max_tid) {
+            bad = 1;
+            break;
+        }
+        Frame* fr = &m->frame[i];
+        fr->loaded = c.loaded;
+        fr->used   = c.used;
+        fr->page   = c.page;
+        fr->ref    = c.ref;
+        fr->owner  = c.tid >= 0 ? by_tid[c.tid] : NULL;
+        /* the owner's page table must point back at the frame */
+        if (c.tid >= 0 && (!fr->owner || !fr->owner->pages || c.page < 0 ||
+                           c.page >= fr->owner->pages->wset || fr->owner->pages->frame[c.page] != i)) bad = 1;
+    }
+    free(by_tid);
+    return bad ? -1 : 0;
+}
+
+int sim_checkpoint_save(const Sim* s, const char* path) {
+    if (!s || !path) return 1;
+    FILE* f = fopen(path, "wb");
+    if (!f) return 2;
+
+    CkptHeader h;
+    memset(&h, 0, sizeof(h));
+    h.now        = s->now;
+    h.tick_ns    = SIM_TICK_NS;
+    h.cs_ns      = s->cpu.cs_ns;
+    h.smt        = s->cpu.smt;
+    h.smt_gain   = s->cpu.smt_gain;
+    h.algo       = (int)s->algo;
+    snprintf(h.policy, sizeof(h.policy), "%s", s->sched.path);
+    h.rr_quantum = s->rr_quantum;
+    h.age_every  = s->age_every;
+    h.ncores     = s->cpu.ncores;
+    h.intr       = s->intr;
+    h.rng        = s->rng.s;
+    h.nthreads   = s->workload.size + sim_ready_count(s) + s->waiting.size + s->finished.size +
+                   s->dropped.size;
+    for (int c = 0; c < s->cpu.ncores; ++c)
+        if (s->cpu.core[c]) h.nthreads++;
+
+    int version = CKPT_VERSION;
+    int rc = 0;
+    if (fwrite(CKPT_MAGIC, 1, 8, f) != 8 ||
+        fwrite(&version, sizeof(version), 1, f) != 1 ||
+        fwrite(&h, sizeof(h), 1, f) != 1) rc = 3;
+    for (int c = 0; !rc && c < s->cpu.ncores; ++c) {
+        CkptCore k = { s->cpu.cs_left[c], s->cpu.last_tid[c] };
+        if (fwrite(&k, sizeof(k), 1, f) != 1) rc = 3;
+    }
+
+    if (!rc) rc = write_queue(f, &s->workload, LOC_WORKLOAD) ? 3 : 0;
+    if (!rc) rc = write_ready(f, s)                          ? 3 : 0;
+    if (!rc) rc = write_queue(f, &s->waiting,  LOC_WAITING)  ? 3 : 0;
+    if (!rc) rc = write_queue(f, &s->finished, LOC_FINISHED) ? 3 : 0;
+    if (!rc) rc = write_queue(f, &s->dropped,  LOC_DROPPED)  ? 3 : 0;
+    for (int c = 0; !rc && c < s->cpu.ncores; ++c) {
+        const Thread* t = s->cpu.core[c];
+        if (t && write_thread(f, t, LOC_CORE + c) != 0) rc = 3;
+    }
+    if (!rc && fwrite(&s->ndev, sizeof(s->ndev), 1, f) != 1) rc = 3;
+    for (int d = 0; !rc && d < s->ndev; ++d)
+        if (write_device(f, &s->dev[d]) != 0) rc = 3;
+    if (!rc && fwrite(&s->nlock, sizeof(s->nlock), 1, f) != 1) rc = 3;
+    for (int l = 0; !rc && l < s->nlock; ++l)
+        if (write_lock(f, &s->lock[l]) != 0) rc = 3;
+    if (!rc && write_power(f, s->power) != 0) rc = 3;
+    if (!rc && write_groups(f, s) != 0) rc = 3;
+    if (!rc && write_scaling(f, s) != 0) rc = 3;
+    if (!rc && write_jobs(f, s) != 0) rc = 3;
+    if (!rc && write_gangs(f, s) != 0) rc = 3;
+    if (!rc && write_admit(f, s->admit) != 0) rc = 3;
+    if (!rc && write_mem(f, s->mem) != 0) rc = 3;
+
+    if (fclose(f) != 0 && !rc) rc = 3;
+    return rc;
+}
+
+int sim_checkpoint_load(Sim* s, const char* path, int trace_len) {
+    if (!s || !path) return 1;
+    FILE* f = fopen(path, "rb");
+    if (!f) return 2;
+
+    char magic[8];
+    int version = 0;
+    CkptHeader h;
+    if (fread(magic, 1, 8, f) != 8 || memcmp(magic, CKPT_MAGIC, 8) != 0 ||
+        fread(&version, sizeof(version), 1, f) != 1 || version != CKPT_VERSION ||
+        fread(&h, sizeof(h), 1, f) != 1 || h.ncores < 1 || h.nthreads < 0 ||
+        h.tick_ns < 1 || h.age_every < 1) {
+        fclose(f);
+        return 3;
+    }
+
+    SIM_TICK_NS   = h.tick_ns;   // the run continues on its own tick
+    sim_init(s, (DispatchAlgo)h.algo, h.rr_quantum, h.ncores, trace_len);
+    h.policy[SCHED_PATH_LEN - 1] = '\0';
+    if (h.policy[0] && sim_set_policy(s, s->algo, s->rr_quantum, h.policy) != 0) {
+        fclose(f);
+        sim_free(s);
+        return 5;
+    }
+    s->now        = h.now;
+    s->age_every  = h.age_every;
+    s->intr       = h.intr;
+    s->rng.s      = h.rng;
+    s->cpu.cs_ns  = h.cs_ns;
+    s->cpu.smt    = h.smt;
+    s->cpu.smt_gain = h.smt_gain;
+    for (int c = 0; c < h.ncores; ++c) {
+        CkptCore k;
+        if (fread(&k, sizeof(k), 1, f) != 1) {
+            fclose(f);
+            sim_free(s);
+            return 4;
+        }
+        s->cpu.cs_left[c]  = k.cs_left;
+        s->cpu.last_tid[c] = k.last_tid;
+    }
+
+    Queue* by_loc[LOC_CORE] = { &s->workload, &s->ready, &s->waiting, &s->finished, &s->dropped };
+    for (int i = 0; i < h.nthreads; ++i) {
+        int loc = -1;
+        Thread* t = read_thread(f, &loc);
+        if (!t) {
+            fclose(f);
+            sim_free(s);
+            return 4;
+        }
+        if (loc >= LOC_CORE) {
+            int c = loc - LOC_CORE;
+            if (c >= h.ncores || s->cpu.core[c]) {
+                thread_free(t);
+                fclose(f);
+                sim_free(s);
+                return 4;
+            }
+            s->cpu.core[c] = t;      // direct: start_time already recorded
+        } else if (loc >= 0) {
+            q_push(by_loc[loc], t);
+        } else {
+            thread_free(t);
+            fclose(f);
+            sim_free(s);
+            return 4;
+        }
+    }
+
+    int ndev = 0;
+    int bad = fread(&ndev, sizeof(ndev), 1, f) != 1 || ndev < 0;
+    for (int d = 0; !bad && d < ndev; ++d)
+        if (read_device(f, s) != 0) bad = 1;
+    int nlock = 0;
+    if (!bad && (fread(&nlock, sizeof(nlock), 1, f) != 1 || nlock < 0)) bad = 1;
+    for (int l = 0; !bad && l < nlock; ++l)
+        if (read_lock(f, s) != 0) bad = 1;
+    if (!bad && read_power(f, s) != 0) bad = 1;
+    if (!bad && read_groups(f, s) != 0) bad = 1;
+    if (!bad && read_scaling(f, s) != 0) bad = 1;
+    if (!bad && read_jobs(f, s) != 0) bad = 1;
+    if (!bad && read_gangs(f, s) != 0) bad = 1;
+    if (!bad && read_admit(f, s) != 0) bad = 1;
+    if (!bad && read_mem(f, s) != 0) bad = 1;
+    fclose(f);
+    if (bad) {
+        sim_free(s);
+        return 4;
+    }
+    SIM_TIME = s->now;
+    return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "engine.h"
+
+/*
+  Snapshot / restore of a running simulation.
+
+  A snapshot holds the clock and tick length, RNG state, scheduler
+  settings, SMT topology, interrupt config, per core context switch state
+  and every thread (all fields) tagged with where it lives:
+  workload, ready, waiting, finished, dropped, or the core it is bound
+  to.
+  I/O devices follow with their queued and in-service requests, then
+  locks with their owner and waiters (threads carry their lock scripts),
+  then the power model's per-core state if it is on, then the CPU
+  bandwidth groups, then the pending hotplug events and the autoscaler,
+  then the DAG jobs (task tids and dependency lists), then the gangs
+  (member tids and who waits at the current barrier), then the admission
+  controller, then the frames of the paging model (threads carry their
+  page tables).
+  Threads held back by their group are saved as Ready and go back to
+  their group on the first dispatch.
+  Queue order is preserved. The run trace is not saved.
+
+  Ready threads are saved in the policy's for_each order and handed to it
+  again on restore; any other private state of the policy is not saved.
+  An external policy is reloaded from its saved path.
+
+  Restoring into a different policy or core count is done by the caller
+  after sim_checkpoint_load(): call sim_set_policy() and sim_set_cores().
+*/
+
+/* Returns 0 on success, nonzero on error. */
+int sim_checkpoint_save(const Sim* s, const char* path);
+
+/* Initializes *s from the snapshot with a run trace of trace_len ticks.
+   Returns 0 on success, nonzero on error (s is left freed); 5 if the
+   saved external policy cannot be loaded. */
+int sim_checkpoint_load(Sim* s, const char* path, int trace_len);
+
+#endif /* CHECKPOINT_H */
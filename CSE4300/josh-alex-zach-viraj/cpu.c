@@ -1,12 +1,90 @@
 #include "cpu.h"
 
-int SIM_TIME = 0;  // global clock
+_Thread_local simtime_t SIM_TIME = 0;  // global clock (per host thread)
+simtime_t SIM_TICK_NS = NS_PER_MS;      // timer tick
 
 void cpu_init(CPU* cpu, int ncores) {
     // intialize the cores to 0
     cpu->ncores = ncores;
     cpu->core = (Thread**)calloc(ncores, sizeof(Thread*));
     for (int i = 0; i < ncores; ++i) cpu->core[i] = NULL;
+    cpu->cs_ns = 0;
+    cpu->cs_left = (simtime_t*)calloc(ncores, sizeof(simtime_t));
+    cpu->last_tid = (int*)malloc(sizeof(int) * ncores);
+    for (int i = 0; i < ncores; ++i) cpu->last_tid[i] = -1;
+    cpu->rate = NULL;
+    cpu->smt = 1;
+    cpu->smt_gain = 0;
+    cpu->place_cost = NULL;
+    cpu->place_ctx = NULL;
+    cpu->run_left = cpu->run_q = cpu->run_rate = NULL;
+    cpu->run_thr = NULL;
+    cpu->run_flag = NULL;
+    cpu->run_tid = cpu->trace_at = NULL;
+    cpu->attn = NULL;
+    cpu_resize_load(cpu, 0, ncores);
+    cpu->run_trace = NULL;
+    cpu->trace_len = 0;
+}
+
+void cpu_resize_load(CPU* cpu, int old, int ncores) {
+    size_t n = ncores > 0 ? (size_t)ncores : 1;
+    cpu->run_thr  = (Thread**)realloc(cpu->run_thr, sizeof(Thread*) * n);
+    cpu->run_left = (simtime_t*)realloc(cpu->run_left, sizeof(simtime_t) * n);
+    cpu->run_q    = (simtime_t*)realloc(cpu->run_q, sizeof(simtime_t) * n);
+    cpu->run_rate = (simtime_t*)realloc(cpu->run_rate, sizeof(simtime_t) * n);
+    cpu->run_tid  = (int*)realloc(cpu->run_tid, sizeof(int) * n);
+    cpu->trace_at = (int*)realloc(cpu->trace_at, sizeof(int) * n);
+    cpu->run_flag = (uint8_t*)realloc(cpu->run_flag, CPU_ATTN_WORDS(n) * 64);
+    cpu->attn     = (uint64_t*)realloc(cpu->attn, sizeof(uint64_t) * CPU_ATTN_WORDS(n));
+    for (int c = old; c < ncores; ++c) {
+        cpu->run_thr[c]  = NULL;
+        cpu->trace_at[c] = -1;
+    }
+    memset(cpu->run_flag, 0, CPU_ATTN_WORDS(n) * 64);
+    // flag every core so the next cpu_load copies them all
+    memset(cpu->attn, 0xff, sizeof(uint64_t) * CPU_ATTN_WORDS(n));
+}
+
+void cpu_alloc_trace(CPU* cpu, int len) {
+    // run_trace[c][t] = tid at tick t for core c, or -1 if idle
+    cpu->run_trace = (int**)malloc(sizeof(int*) * cpu->ncores);
+    for (int c = 0; c < cpu->ncores; ++c) {
+        cpu->run_trace[c] = (int*)malloc(sizeof(int) * len);
+        for (int t = 0; t < len; ++t) cpu->run_trace[c][t] = -1;  // idle mark
+    }
+    cpu->trace_len = len;
+}
+
+void cpu_free(CPU* cpu) {
+    if (cpu->run_trace) {
+        for (int c = 0; c < cpu->ncores; ++c) free(cpu->run_trace[c]);
+        free(cpu->run_trace);
+    }
+    free(cpu->core);
+    free(cpu->cs_left);
+    free(cpu->last_tid);
+    free(cpu->rate);
+    free(cpu->run_left);
+    free(cpu->run_q);
+    free(cpu->run_rate);
+    free(cpu->run_flag);
+    free(cpu->run_thr);
+    free(cpu->run_tid);
+    free(cpu->trace_at);
+    free(cpu->attn);
+    cpu->rate = NULL;
+    cpu->run_left = cpu->run_q = cpu->run_rate = NULL;
+    cpu->run_thr = NULL;
+    cpu->run_flag = NULL;
+    cpu->run_tid = cpu->trace_at = NULL;
+    cpu->attn = NULL;
+    cpu->run_trace = NULL;
+    cpu->core = NULL;
+    cpu->cs_left = NULL;
+    cpu->last_tid = NULL;
+    cpu->ncores = 0;
+    cpu->trace_len = 0;
 }
 
 int cpu_idle_count(const CPU* cpu) {
@@ -20,8 +98,14 @@ void cpu_bind_core(CPU* cpu, int core_idx, Thread* t) {
     assert(core_idx >= 0 && core_idx < cpu->ncores);
     assert(cpu->core[core_idx] == NULL);
     cpu->core[core_idx] = t;
+    if (t->state == ST_READY) t->wait_time += SIM_TIME - t->ready_since;
     t->state = ST_RUNNING;
     if (t->start_time < 0) t->start_time = SIM_TIME;  // first response time stamp
+
+    // switching to a different thread costs cs_ns before it makes progress
+    if (cpu->last_tid[core_idx] != t->tid) cpu->cs_left[core_idx] = cpu->cs_ns;
+    cpu->last_tid[core_idx] = t->tid;
+    if (cpu->run_thr) cpu->run_thr[core_idx] = NULL;   // copied again by cpu_load
 }
 
 Thread* cpu_unbind_core(CPU* cpu, int core_idx) {
@@ -34,11 +118,11 @@ Thread* cpu_unbind_core(CPU* cpu, int core_idx) {
 void preempt_to_ready(CPU* cpu, int core_idx, Queue* ready) {
     Thread* t = cpu_unbind_core(cpu, core_idx);
     if (!t) return;
-    t->state = ST_READY;
+    mark_ready(t);
     q_push(ready, t);
 }
 
-void block_to_waiting(CPU* cpu, int core_idx, Queue* waiting, int unblock_at) {
+void block_to_waiting(CPU* cpu, int core_idx, Queue* waiting, simtime_t unblock_at) {
     Thread* t = cpu_unbind_core(cpu, core_idx);
     if (!t) return;
     t->state = ST_WAITING;
@@ -64,29 +148,192 @@ int cpu_bind_first_idle(CPU* cpu, Thread* t) {
     return idx;
 }
 
-void cpu_step(CPU* cpu) {
-    /* One clock tick worth of CPU work on each busy core */
+int cpu_busy_siblings(const CPU* cpu, int core) {
+    if (cpu->smt <= 1) return 0;
+    int lo = core - core % cpu->smt, n = 0;
+    for (int i = lo; i < lo + cpu->smt && i < cpu->ncores; ++i)
+        if (i != core && cpu->core[i]) n++;
+    return n;
+}
+
+/* work per ns of busy core c, in 1/CPU_RATE_ONE */
+static simtime_t core_rate(const CPU* cpu, int c) {
+    simtime_t r = cpu->rate ? cpu->rate[c] : CPU_RATE_ONE;
+    int k = cpu_busy_siblings(cpu, c) + 1;
+    if (k > 1) r = r * (CPU_RATE_ONE + (k - 1) * cpu->smt_gain) / ((simtime_t)k * CPU_RATE_ONE);
+    return r > 0 ? r : 1;
+}
+
+int cpu_pick_idle(const CPU* cpu, const char* skip) {
+    /* physical cores with fewer busy siblings first, then place_cost */
+    int best = -1, best_sib = 0, best_cost = 0;
+    for (int i = 0; i < cpu->ncores; ++i) {
+        if (cpu->core[i] || (skip && skip[i])) continue;
+        int sib = cpu_busy_siblings(cpu, i);
+        if (!cpu->place_cost && sib == 0) return i;
+        int cost = cpu->place_cost ? cpu->place_cost(cpu, i, cpu->place_ctx) : 0;
+        if (best < 0 || sib < best_sib || (sib == best_sib && cost < best_cost)) {
+            best = i;
+            best_sib = sib;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+void cpu_load(CPU* cpu) {
     for (int i = 0; i < cpu->ncores; ++i) {
         Thread* t = cpu->core[i];
-        if (!t) continue;
-        // update run time
-        if (t->remaining > 0) {
-            t->remaining -= 1;  // consume one tick
+        // the copy holds until the core is rebound or cpu_step flags it; an
+        // idle core is cleared every time (it may have been bound and
+        // emptied again since the last load)
+        if (t && t == cpu->run_thr[i] && !(cpu->attn[i / 64] >> (i % 64) & 1)) continue;
+        cpu->run_thr[i] = t;
+        if (!t) {
+            cpu->run_left[i] = cpu->run_q[i] = 0;
+            cpu->run_rate[i] = 0;
+            cpu->run_tid[i]  = -1;
+            continue;
         }
+        cpu->run_left[i] = t->remaining - t->stop_at;
+        cpu->run_q[i]    = t->quanta_rem;
+        cpu->run_rate[i] = CPU_RATE_ONE;
+        cpu->run_tid[i]  = t->tid;
+    }
+    // speeds follow the governor and busy SMT siblings
+    if (cpu->rate || cpu->smt > 1)
+        for (int i = 0; i < cpu->ncores; ++i)
+            if (cpu->core[i]) cpu->run_rate[i] = core_rate(cpu, i);
+}
+
+
+/* The per-core pass below is built for each x86-64 level (v2 brings the
+   64-bit compares it needs, v4 the 64-bit multiply) and the widest the
+   host runs is picked when the program loads; "default" is the scalar
+   fallback. Elsewhere it is plain C for the compiler to vectorize. */
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11 && defined(__x86_64__) && \
+    defined(__GLIBC__)
+#define STEP_CLONES \
+    __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#else
+#define STEP_CLONES
+#endif
+
+/* dt worth of CPU work on each core in one branch-free pass over the
+   arrays (idle cores have rate 0 and do none); flag[i] = 1 where the
+   thread reached its stop point or the end of its slice */
+STEP_CLONES
+static void step_cores(int n, simtime_t dt, simtime_t* restrict left, simtime_t* restrict q,
+                       simtime_t* restrict csl, uint8_t* restrict flag,
+                       const simtime_t* restrict rate) {
+    for (int i = 0; i < n; ++i) {
+        simtime_t r = rate[i];
+        // context switch overhead comes first (idle cores keep theirs)
+        simtime_t cs = csl[i] < dt ? csl[i] : dt;
+        cs = r > 0 ? cs : 0;
+        csl[i] -= cs;
+        // update run time at the core's rate (a scripted thread stops at
+        // its phase end); rate is CPU_RATE_ONE at full speed, so exact
+        simtime_t work = (dt - cs) * r / CPU_RATE_ONE;
+        work = work < left[i] ? work : left[i];
+        simtime_t l = left[i] - work;
+        left[i] = l;
         // update threads quanta (only applicable to RR)
-        if (t->quanta_rem > 0) {
-            t->quanta_rem -= 1;
-            if (t->quanta_rem < 0) t->quanta_rem = 0;
-        }
+        simtime_t q0 = q[i];
+        simtime_t ql = q0 - dt;
+        ql = ql < 0 ? 0 : ql;
+        q[i] = q0 > 0 ? ql : q0;
+        flag[i] = r > 0 && (l <= 0 || (q0 > 0 && ql == 0)) ? 1 : 0;
     }
+}
 
-    // record who runs during [SIM_TIME, SIM_TIME+1)
-    if (SIM_TIME < cpu->trace_len) {
-        for (int c = 0; c < cpu->ncores; ++c) {
-            cpu->run_trace[c][SIM_TIME] = cpu->core[c] ? cpu->core[c]->tid : -1;
+/* earliest cs_left + left over busy full-speed cores; SIMTIME_NEVER if
+   none are busy */
+STEP_CLONES
+static simtime_t next_full_speed(int n, const simtime_t* restrict left,
+                                 const simtime_t* restrict csl,
+                                 const simtime_t* restrict rate) {
+    simtime_t next = SIMTIME_NEVER;
+    for (int i = 0; i < n; ++i) {
+        // idle cores hold zeros, so or-ing in SIMTIME_NEVER under a mask
+        // parks them there without a branch
+        simtime_t idle = -(simtime_t)(rate[i] == 0);
+        simtime_t at = (csl[i] + left[i]) | (idle & SIMTIME_NEVER);
+        next = at < next ? at : next;
+    }
+    return next;
+}
+
+simtime_t cpu_next_event(const CPU* cpu) {
+    if (!cpu->rate && cpu->smt <= 1) {
+        simtime_t d = next_full_speed(cpu->ncores, cpu->run_left, cpu->cs_left, cpu->run_rate);
+        return d == SIMTIME_NEVER ? d : SIM_TIME + d;
+    }
+    simtime_t next = SIMTIME_NEVER;
+    for (int i = 0; i < cpu->ncores; ++i) {
+        simtime_t r = cpu->run_rate[i];
+        if (r == 0) continue;
+        simtime_t at = SIM_TIME + cpu->cs_left[i] + (cpu->run_left[i] * CPU_RATE_ONE + r - 1) / r;
+        if (at < next) next = at;
+    }
+    return next;
+}
+
+void cpu_step(CPU* cpu, simtime_t dt) {
+    const int n = cpu->ncores;
+    const simtime_t* rate = cpu->run_rate;
+
+    step_cores(n, dt, cpu->run_left, cpu->run_q, cpu->cs_left, cpu->run_flag, rate);
+
+    /* pack the flags into attn (the array is padded to whole words and
+       zero past n). On little-endian hosts 8 bytes of 0/1 load as one word
+       with flag j at bit 8j, and a multiply gathers them into the top
+       byte; elsewhere that order is reversed, so pack bit by bit. */
+    for (int w = 0; w < CPU_ATTN_WORDS(n); ++w) {
+        uint64_t m = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        for (int k = 0; k < 8; ++k) {
+            uint64_t x;
+            memcpy(&x, cpu->run_flag + w * 64 + k * 8, 8);
+            m |= (x * 0x0102040810204080ULL >> 56) << (k * 8);
         }
+#else
+        for (int k = 0; k < 64; ++k)
+            m |= (uint64_t)(cpu->run_flag[w * 64 + k] != 0) << k;
+#endif
+        cpu->attn[w] = m;
+    }
+
+    /* write back to the running threads and record who runs during the
+       tick containing SIM_TIME (first runner wins) */
+    simtime_t tick = SIM_TIME / SIM_TICK_NS;
+    int tr = tick < cpu->trace_len ? (int)tick : -1;
+    for (int c = 0; c < n; ++c) {
+        if (!rate[c]) continue;
+        Thread* t = cpu->run_thr[c];
+        t->remaining  = t->stop_at + cpu->run_left[c];
+        t->quanta_rem = cpu->run_q[c];
+        if (tr < 0 || cpu->trace_at[c] == tr) continue;
+        cpu->trace_at[c] = tr;
+        if (cpu->run_trace[c][tr] < 0) cpu->run_trace[c][tr] = cpu->run_tid[c];
     }
 
     /* advance time */
-    SIM_TIME += 1;
+    SIM_TIME += dt;
+}
+
+int cpu_next_attn(const CPU* cpu, int from) {
+    for (int w = from / 64; w < CPU_ATTN_WORDS(cpu->ncores); ++w) {
+        uint64_t m = cpu->attn[w];
+        if (w == from / 64) m &= ~(uint64_t)0 << (from % 64);
+        if (!m) continue;
+#ifdef __GNUC__
+        int c = w * 64 + __builtin_ctzll(m);
+#else
+        int c = w * 64;
+        while (!(m >> (c % 64) & 1)) c++;
+#endif
+        return c < cpu->ncores ? c : -1;
+    }
+    return -1;
 }
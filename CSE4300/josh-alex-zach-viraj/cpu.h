@@ -6,6 +6,16 @@
 /* Initialize CPU with n cores; cores start idle (NULL) */
 void cpu_init(CPU* cpu, int ncores);
 
+/* Size the per-core arrays cpu_load fills after the core count changed
+   from old to ncores (cpu_init calls it with old = 0) */
+void cpu_resize_load(CPU* cpu, int old, int ncores);
+
+/* Allocate run_trace for every core, len ticks, all idle (-1) */
+void cpu_alloc_trace(CPU* cpu, int len);
+
+/* Release cores and run trace (not the threads on them) */
+void cpu_free(CPU* cpu);
+
 /* Return number of idle cores */
 int  cpu_idle_count(const CPU* cpu);
 
@@ -19,7 +29,7 @@ Thread* cpu_unbind_core(CPU* cpu, int core_idx);
 void preempt_to_ready(CPU* cpu, int core_idx, Queue* ready);
 
 /* Block: remove thread from core -> push to Waiting with unblock_at time. */
-void block_to_waiting(CPU* cpu, int core_idx, Queue* waiting, int unblock_at);
+void block_to_waiting(CPU* cpu, int core_idx, Queue* waiting, simtime_t unblock_at);
 
 /* Returns 1 if any core is idle, else 0 */
 int  cpu_any_idle(const CPU* cpu);
@@ -30,9 +40,34 @@ int  cpu_first_idle(const CPU* cpu);
 /* Bind a thread to the first idle core. Returns core index or -1 if none */
 int  cpu_bind_first_idle(CPU* cpu, Thread* t);
 
-/* Advance one clock tick:
-   - decrement remaining on each running thread
-   - if a thread reaches 0, leave it bound (caller can detect and complete) */
-void cpu_step(CPU* cpu);
+/* Number of busy SMT siblings of core (not counting core itself). */
+int  cpu_busy_siblings(const CPU* cpu, int core);
+
+/* Idle core to fill next: fewest busy SMT siblings, then lowest place_cost,
+   then core order. Cores with skip[i] set are passed over (skip may be
+   NULL). -1 if none. */
+int  cpu_pick_idle(const CPU* cpu, const char* skip);
+
+/* Copy the running threads' remaining, stop point, slice and rate into
+   the per-core arrays. Call it after the last change to the cores or
+   their threads and before cpu_next_event / cpu_step. */
+void cpu_load(CPU* cpu);
+
+/* Earliest time a running thread completes or reaches its phase end
+   (including pending context-switch overhead); SIMTIME_NEVER if idle.
+   Reads the state cpu_load copied. */
+simtime_t cpu_next_event(const CPU* cpu);
+
+/* Advance all cores by dt ns (dt never crosses a tick boundary):
+   - pay context-switch overhead first, then decrement remaining by the
+     work done at the core's rate (shared with busy SMT siblings)
+   - if a thread reaches 0, leave it bound (caller can detect and complete)
+   - set attn for cores whose thread reached its stop point or slice end
+   - SIM_TIME += dt
+   Works on the state cpu_load copied and writes it back to the threads. */
+void cpu_step(CPU* cpu, simtime_t dt);
+
+/* First core >= from flagged in attn by the last cpu_step, or -1 */
+int  cpu_next_attn(const CPU* cpu, int from);
 
 #endif /* CPU_H */
@@ -0,0 +1,248 @@
+#include "dag.h"
+#include "util.h"
+
+const char* jobshape_name(JobShape s) {
+    switch (s) {
+        case JOB_FORKJOIN: return "forkjoin";
+        case JOB_LAYERED:  return "layered";
+    }
+    return "?";
+}
+
+int job_spec_parse(const char* spec, JobSpec* js,
+                   int (*extra)(void* ctx, const char* key, const char* val), void* ctx) {
+    char buf[256], *name, *opts, *k, *v;
+    if (spec_split(spec, buf, sizeof(buf), JOB_NAME_LEN, &name, &opts) != 0) return -1;
+    snprintf(js->name, sizeof(js->name), "%s", name);
+
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) return -1;
+        if (strcmp(k, "width") == 0) {
+            js->width = atoi(v);
+            if (js->width < 1 || js->width > 4096) return -1;
+        } else if (strcmp(k, "stages") == 0) {
+            js->stages = atoi(v);
+            if (js->stages < 1 || js->stages > 4096) return -1;
+        } else if (strcmp(k, "work") == 0) {
+            if (parse_duration(v, &js->work) != 0 || js->work < 1) return -1;
+        } else if (strcmp(k, "jitter") == 0) {
+            js->jitter = atoi(v);
+            if (js->jitter < 0 || js->jitter > 99) return -1;
+        } else if (strcmp(k, "at") == 0) {
+            if (parse_duration(v, &js->arrival) != 0) return -1;
+        } else if (strcmp(k, "prio") == 0) {
+            js->priority = atoi(v);
+        } else if (strcmp(k, "count") == 0) {
+            js->count = atoi(v);
+            if (js->count < 1) return -1;
+        } else if (strcmp(k, "every") == 0) {
+            if (parse_duration(v, &js->every) != 0) return -1;
+        } else if (!extra || extra(ctx, k, v) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* the keys only DAG jobs have */
+static int job_opt(void* ctx, const char* k, const char* v) {
+    JobConfig* cfg = (JobConfig*)ctx;
+    if (strcmp(k, "shape") == 0) {
+        if      (strcmp(v, "forkjoin") == 0) cfg->shape = JOB_FORKJOIN;
+        else if (strcmp(v, "layered") == 0)  cfg->shape = JOB_LAYERED;
+        else return -1;
+    } else if (strcmp(k, "fan") == 0) {
+        cfg->fan = atoi(v);
+        if (cfg->fan < 1) return -1;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int job_parse(const char* spec, JobConfig* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->shape       = JOB_FORKJOIN;
+    cfg->fan         = 2;
+    cfg->spec.width  = 4;
+    cfg->spec.stages = 2;
+    cfg->spec.work   = 5 * SIM_TICK_NS;
+    cfg->spec.jitter = 50;
+    cfg->spec.count  = 1;
+    return job_spec_parse(spec, &cfg->spec, job_opt, cfg);
+}
+
+void job_alloc(Job* j, const JobConfig* cfg, int instance, int ntask, int nsucc) {
+    memset(j, 0, sizeof(*j));
+    j->cfg        = *cfg;
+    j->instance   = instance;
+    j->arrival    = cfg->spec.arrival + instance * cfg->spec.every;
+    j->ntask      = ntask;
+    j->task       = (Thread**)calloc(ntask, sizeof(Thread*));
+    j->succ_start = (int*)malloc(sizeof(int) * (ntask + 1));
+    j->succ       = (int*)malloc(sizeof(int) * (nsucc > 0 ? nsucc : 1));
+    j->top        = (simtime_t*)malloc(sizeof(simtime_t) * ntask);
+    j->bottom     = (simtime_t*)malloc(sizeof(simtime_t) * ntask);
+    j->finish     = -1;
+}
+
+void job_free(Job* j) {
+    free(j->task);
+    free(j->succ_start);
+    free(j->succ);
+    free(j->top);
+    free(j->bottom);
+    j->task = NULL;
+    j->succ_start = j->succ = NULL;
+    j->top = j->bottom = NULL;
+}
+
+typedef struct { int from, to; } Edge;
+
+/* edges of the shape, from < to (task indices are a topological order) */
+static int make_edges(const JobConfig* cfg, Rng* r, Edge** out, int* ntask) {
+    int w = cfg->spec.width, st = cfg->spec.stages, n = 0;
+    Edge* e;
+    if (cfg->shape == JOB_FORKJOIN) {
+        *ntask = 1 + st * (w + 1);
+        e = (Edge*)malloc(sizeof(Edge) * 2 * w * st);
+        for (int s = 0; s < st; ++s) {
+            int fork = s * (w + 1), join = fork + w + 1;
+            for (int k = 1; k <= w; ++k) {
+                e[n++] = (Edge){ fork, fork + k };
+                e[n++] = (Edge){ fork + k, join };
+            }
+        }
+    } else {
+        int fan = cfg->fan < w ? cfg->fan : w;
+        *ntask = w * st;
+        e = (Edge*)malloc(sizeof(Edge) * (w * (st - 1) * fan + 1));
+        for (int l = 1; l < st; ++l) {
+            for (int k = 0; k < w; ++k) {
+                /* consecutive tasks of the layer before, so no duplicates */
+                int np = rng_range(r, 1, fan), first = rng_range(r, 0, w - 1);
+                for (int p = 0; p < np; ++p)
+                    e[n++] = (Edge){ (l - 1) * w + (first + p) % w, l * w + k };
+            }
+        }
+    }
+    *out = e;
+    return n;
+}
+
+void job_build(Job* j, const JobConfig* cfg, int instance, int job, int first_tid,
+               unsigned long long seed, Queue* workload) {
+    Rng r;
+    rng_seed(&r, seed * 1000003ULL + (unsigned long long)instance);
+    Edge* e;
+    int ntask;
+    int nsucc = make_edges(cfg, &r, &e, &ntask);
+    job_alloc(j, cfg, instance, ntask, nsucc);
+
+    /* successor lists (CSR) and predecessor counts */
+    int* npred = (int*)calloc(ntask, sizeof(int));
+    for (int i = 0; i <= ntask; ++i) j->succ_start[i] = 0;
+    for (int i = 0; i < nsucc; ++i) {
+        j->succ_start[e[i].from + 1]++;
+        npred[e[i].to]++;
+    }
+    for (int i = 0; i < ntask; ++i) j->succ_start[i + 1] += j->succ_start[i];
+    /* place each edge at its task's start, which moves the start on to the
+       next task's; then shift back */
+    for (int i = 0; i < nsucc; ++i) j->succ[j->succ_start[e[i].from]++] = e[i].to;
+    for (int i = ntask; i > 0; --i) j->succ_start[i] = j->succ_start[i - 1];
+    j->succ_start[0] = 0;
+    free(e);
+
+    simtime_t* burst = (simtime_t*)malloc(sizeof(simtime_t) * ntask);
+    for (int i = 0; i < ntask; ++i) {
+        simtime_t b = cfg->spec.work * (100 + rng_range(&r, -cfg->spec.jitter, cfg->spec.jitter)) / 100;
+        burst[i] = b > 0 ? b : 1;
+        j->work += burst[i];
+    }
+
+    /* levels: indices are topological, so one pass each way */
+    for (int i = 0; i < ntask; ++i) j->top[i] = 0;
+    for (int i = 0; i < ntask; ++i)
+        for (int k = j->succ_start[i]; k < j->succ_start[i + 1]; ++k)
+            if (j->top[i] + burst[i] > j->top[j->succ[k]]) j->top[j->succ[k]] = j->top[i] + burst[i];
+    for (int i = ntask - 1; i >= 0; --i) {
+        simtime_t tail = 0;
+        for (int k = j->succ_start[i]; k < j->succ_start[i + 1]; ++k)
+            if (j->bottom[j->succ[k]] > tail) tail = j->bottom[j->succ[k]];
+        j->bottom[i] = burst[i] + tail;
+        if (j->top[i] + j->bottom[i] > j->cp) j->cp = j->top[i] + j->bottom[i];
+    }
+
+    for (int i = 0; i < ntask; ++i) {
+        workload_add(workload, first_tid + i, j->arrival, burst[i], cfg->spec.priority);
+        Thread* t = workload->rear;
+        t->job       = job;
+        t->task      = i;
+        t->deps_left = npred[i];
+        t->cp_tail   = j->bottom[i] - burst[i];
+        t->cp_due    = j->arrival + j->cp;
+        if (npred[i] > 0) t->arrival_time = SIMTIME_NEVER;   // released by its predecessors
+        j->task[i] = t;
+    }
+    free(burst);
+    free(npred);
+}
+
+void job_task_done(Job* jobs, const Thread* t, simtime_t now) {
+    Job* j = &jobs[t->job];
+    if (++j->done == j->ntask) j->finish = now;
+    for (int k = j->succ_start[t->task]; k < j->succ_start[t->task + 1]; ++k) {
+        Thread* s = j->task[j->succ[k]];
+        if (--s->deps_left == 0) s->arrival_time = now;
+    }
+}
+
+void job_report(const Job* jobs, int n, int ncores, FILE* out) {
+    if (n < 1) return;
+    fprintf(out, "# Jobs (times in ticks)\n");
+    fprintf(out, "%-16s %-8s %7s %9s %10s %9s %9s %9s %7s %6s %5s %9s\n",
+            "JOB", "SHAPE", "TASKS", "ARRIVAL", "MAKESPAN", "CRIT_PATH", "BOUND", "SLACK",
+            "STRETCH", "PAR", "CRIT", "CRIT_WAIT");
+    int nfin = 0;
+    double sum_span = 0, sum_stretch = 0, worst = 0;
+    for (int i = 0; i < n; ++i) {
+        const Job* j = &jobs[i];
+        char name[JOB_NAME_LEN + 12];
+        if (j->cfg.spec.count > 1) snprintf(name, sizeof(name), "%s#%d", j->cfg.spec.name, j->instance);
+        else                       snprintf(name, sizeof(name), "%s", j->cfg.spec.name);
+        /* best possible on this machine: the critical path or the work spread over every core */
+        simtime_t bound = j->work / ncores > j->cp ? j->work / ncores : j->cp;
+
+        int ncrit = 0;
+        simtime_t crit_wait = 0;
+        for (int k = 0; k < j->ntask; ++k) {
+            if (j->top[k] + j->bottom[k] != j->cp) continue;
+            ncrit++;
+            crit_wait += j->task[k]->wait_time;
+        }
+        if (j->finish < 0) {
+            fprintf(out, "%-16s %-8s %3d/%-3d %9.3f %10s %9.3f %9.3f %9s %7s %6s %5d %9.3f\n",
+                    name, jobshape_name(j->cfg.shape), j->done, j->ntask, to_ticks(j->arrival),
+                    "-", to_ticks(j->cp), to_ticks(bound), "-", "-", "-", ncrit, to_ticks(crit_wait));
+            continue;
+        }
+        simtime_t span = j->finish - j->arrival;
+        double stretch = j->cp > 0 ? (double)span / j->cp : 0.0;
+        fprintf(out, "%-16s %-8s %7d %9.3f %10.3f %9.3f %9.3f %9.3f %7.2f %6.2f %5d %9.3f\n",
+                name, jobshape_name(j->cfg.shape), j->ntask, to_ticks(j->arrival), to_ticks(span),
+                to_ticks(j->cp), to_ticks(bound), to_ticks(span - j->cp), stretch,
+                span > 0 ? (double)j->work / span : 0.0, ncrit, to_ticks(crit_wait));
+        nfin++;
+        sum_span    += to_ticks(span);
+        sum_stretch += stretch;
+        if (stretch > worst) worst = stretch;
+    }
+    fprintf(out, "Finished jobs: %d of %d", nfin, n);
+    if (nfin > 0)
+        fprintf(out, "; average makespan %.3f, average stretch %.2f, worst stretch %.2f",
+                sum_span / nfin, sum_stretch / nfin, worst);
+    fprintf(out, "\n(SLACK = makespan - critical path, STRETCH = makespan / critical path,\n"
+                 " BOUND = max(critical path, work / cores), PAR = work / makespan,\n"
+                 " CRIT = critical tasks, CRIT_WAIT = their time in Ready)\n\n");
+}
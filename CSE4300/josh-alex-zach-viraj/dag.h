@@ -0,0 +1,113 @@
+#ifndef DAG_H
+#define DAG_H
+
+#include "sim.h"
+
+/*
+  DAG jobs: groups of threads (tasks) with dependencies.
+
+  A task is an ordinary thread with Thread.job >= 0. It stays in the
+  workload, with arrival_time SIMTIME_NEVER, until all of its predecessors
+  have finished; then its arrival_time becomes that moment and it is
+  admitted like any arrival. Response and turnaround of a task therefore
+  count from its release, and the job as a whole is judged by its
+  makespan: last finish minus the job's arrival.
+
+  The bottom level of a task is its CPU time plus the largest bottom level
+  among its successors. The job's critical path is the largest bottom
+  level of its sources: the makespan it would have with unlimited cores
+  and no overheads. Tasks whose top level (longest path to their start)
+  plus bottom level equals the critical path are critical; any Ready wait
+  of theirs delays the job. Thread.cp_tail holds the largest bottom level
+  of a task's successors, so remaining + cp_tail is the critical path left
+  from that task, and Thread.cp_due (arrival + critical path) minus that
+  is the latest it can start without delaying the job past its ideal
+  finish. DISP_CPF runs the smallest such time first: within a job the
+  longest remaining path, across jobs the one closest to falling behind.
+
+  Shapes:
+    forkjoin  stages rounds of: a fork task, width parallel tasks, a join
+              task (each join is also the next round's fork)
+    layered   stages layers of width tasks; every task after the first
+              layer depends on 1..fan random tasks of the layer before
+*/
+
+#define JOB_NAME_LEN 16
+
+typedef enum { JOB_FORKJOIN = 0, JOB_LAYERED } JobShape;
+
+/* Settings DAG jobs and gangs (gang.h) share: how many threads in how
+   many stages, their work and when instances arrive. Plain data so
+   checkpoints can store it as is. */
+typedef struct {
+    char      name[JOB_NAME_LEN];
+    int       width;
+    int       stages;
+    simtime_t work;          // mean CPU time per task
+    int       jitter;        // task CPU time varies by +-jitter% of work
+    simtime_t arrival;       // first instance
+    int       priority;
+    int       count;         // instances
+    simtime_t every;         // between instance arrivals
+} JobSpec;
+
+/* Static settings. Plain data so checkpoints can store it as is. */
+typedef struct {
+    JobSpec   spec;
+    JobShape  shape;
+    int       fan;           // layered: most predecessors per task
+} JobConfig;
+
+typedef struct {
+    JobConfig  cfg;
+    int        instance;     // 0..cfg.spec.count-1
+    simtime_t  arrival;
+    int        ntask;
+    Thread**   task;         // by task index (the threads live in the sim's queues)
+    int*       succ_start;   // successors of task i: succ[succ_start[i] .. succ_start[i+1]-1]
+    int*       succ;
+    simtime_t* top;          // longest path from the job's start to each task's start
+    simtime_t* bottom;       // each task's CPU time plus its successors' bottom level
+    simtime_t  cp;           // critical path length
+    simtime_t  work;         // total CPU time of the tasks
+    int        done;         // finished tasks
+    simtime_t  finish;       // when the last task finished, -1 = not yet
+} Job;
+
+/* Parse "name[:key=val,...]" with keys shape=forkjoin|layered, width=N,
+   stages=N, fan=N, work=DUR, jitter=PCT, at=DUR, prio=N, count=N,
+   every=DUR (default forkjoin, width=4, stages=2, fan=2, work=5 ticks,
+   jitter=50, at=0, prio=0, count=1, every=0). Returns 0 on success, -1 on
+   error. */
+int  job_parse(const char* spec, JobConfig* cfg);
+
+/* Parse "name[:key=val,...]" into js over the defaults already in it,
+   with keys width=N, stages=N, work=DUR, jitter=PCT, at=DUR, prio=N,
+   count=N, every=DUR. Any other key goes to extra(ctx, key, val), which
+   returns 0 or -1 (NULL = no other keys). Returns 0 on success, -1 on
+   error. */
+int  job_spec_parse(const char* spec, JobSpec* js,
+                    int (*extra)(void* ctx, const char* key, const char* val), void* ctx);
+
+/* Instance instance of cfg: add its tasks to workload as threads first_tid,
+   first_tid + 1, ... with CPU times drawn by a generator seeded from seed
+   and instance. job is the index the Job will have (Thread.job). */
+void job_build(Job* j, const JobConfig* cfg, int instance, int job, int first_tid,
+               unsigned long long seed, Queue* workload);
+
+/* Set up j's bookkeeping for ntask tasks and nsucc edges (arrays left
+   uninitialized), as job_build and checkpoint restore do. */
+void job_alloc(Job* j, const JobConfig* cfg, int instance, int ntask, int nsucc);
+void job_free(Job* j);   // the arrays, not the threads
+
+/* Task t (t->job >= 0) finished at now: release the successors whose
+   predecessors are now all done. */
+void job_task_done(Job* jobs, const Thread* t, simtime_t now);
+
+/* Makespan, critical path and slack of each job, and averages over the
+   finished ones. */
+void job_report(const Job* jobs, int n, int ncores, FILE* out);
+
+const char* jobshape_name(JobShape s);
+
+#endif /* DAG_H */
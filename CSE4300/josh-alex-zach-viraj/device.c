@@ -0,0 +1,216 @@
+#include "device.h"
+#include "util.h"
+#include <math.h>
+
+const char* iosched_name(IoSched s) {
+    switch (s) {
+        case IOS_FIFO:     return "FIFO";
+        case IOS_SCAN:     return "SCAN";
+        case IOS_DEADLINE: return "DEADLINE";
+    }
+    return "?";
+}
+
+static void default_config(DeviceConfig* cfg, const char* name) {
+    memset(cfg, 0, sizeof(*cfg));
+    snprintf(cfg->name, sizeof(cfg->name), "%s", name);
+    cfg->weight    = 1;
+    cfg->expire_ns = 50 * NS_PER_MS;
+    if (strncmp(name, "disk", 4) == 0) {
+        cfg->sched   = IOS_SCAN;
+        cfg->depth   = 1;
+        cfg->dist    = SVC_UNIFORM;
+        cfg->svc_ns  = 2 * NS_PER_MS;
+        cfg->seek_ns = 8 * NS_PER_MS;
+    } else {
+        cfg->sched   = IOS_FIFO;
+        cfg->depth   = 4;
+        cfg->dist    = SVC_EXP;
+        cfg->svc_ns  = 500 * NS_PER_US;
+        cfg->seek_ns = 0;
+    }
+}
+
+int device_parse(const char* spec, DeviceConfig* cfg) {
+    char buf[256], *name, *opts, *k, *v;
+    if (spec_split(spec, buf, sizeof(buf), DEV_NAME_LEN, &name, &opts) != 0) return -1;
+    default_config(cfg, name);
+
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) return -1;
+        if (strcmp(k, "sched") == 0) {
+            if      (strcmp(v, "fifo") == 0)     cfg->sched = IOS_FIFO;
+            else if (strcmp(v, "scan") == 0)     cfg->sched = IOS_SCAN;
+            else if (strcmp(v, "deadline") == 0) cfg->sched = IOS_DEADLINE;
+            else return -1;
+        } else if (strcmp(k, "dist") == 0) {
+            if      (strcmp(v, "fixed") == 0)   cfg->dist = SVC_FIXED;
+            else if (strcmp(v, "uniform") == 0) cfg->dist = SVC_UNIFORM;
+            else if (strcmp(v, "exp") == 0)     cfg->dist = SVC_EXP;
+            else return -1;
+        } else if (strcmp(k, "depth") == 0) {
+            cfg->depth = atoi(v);
+            if (cfg->depth < 1) return -1;
+        } else if (strcmp(k, "weight") == 0) {
+            cfg->weight = atoi(v);
+            if (cfg->weight < 0) return -1;
+        } else if (strcmp(k, "svc") == 0) {
+            if (parse_duration(v, &cfg->svc_ns) != 0 || cfg->svc_ns < 1) return -1;
+        } else if (strcmp(k, "seek") == 0) {
+            if (parse_duration(v, &cfg->seek_ns) != 0) return -1;
+        } else if (strcmp(k, "expire") == 0) {
+            if (parse_duration(v, &cfg->expire_ns) != 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void device_init(Device* d, const DeviceConfig* cfg) {
+    memset(d, 0, sizeof(*d));
+    d->cfg  = *cfg;
+    if (d->cfg.depth < 1) d->cfg.depth = 1;
+    d->slot = (IoRequest**)calloc(d->cfg.depth, sizeof(IoRequest*));
+    d->head = 0;
+    d->dir  = 1;
+}
+
+void device_free(Device* d) {
+    while (d->queue) {
+        IoRequest* r = d->queue;
+        d->queue = r->next;
+        free(r);
+    }
+    for (int i = 0; d->slot && i < d->cfg.depth; ++i) free(d->slot[i]);
+    free(d->slot);
+    d->slot = NULL;
+    d->qlen = 0;
+}
+
+/* transfer time from the configured distribution, at least 1 ns */
+static simtime_t draw_transfer(const DeviceConfig* cfg, Rng* rng) {
+    simtime_t x = cfg->svc_ns;
+    switch (cfg->dist) {
+        case SVC_FIXED:
+            break;
+        case SVC_UNIFORM:
+            x = rng_time(rng, cfg->svc_ns / 2, cfg->svc_ns + cfg->svc_ns / 2);
+            break;
+        case SVC_EXP: {
+            double u = (rng_next(rng) + 0.5) / 4294967296.0;   // (0, 1)
+            x = (simtime_t)(-log(u) * (double)cfg->svc_ns);
+            break;
+        }
+    }
+    return x > 0 ? x : 1;
+}
+
+static int busy_slots(const Device* d) {
+    int n = 0;
+    for (int i = 0; i < d->cfg.depth; ++i) if (d->slot[i]) n++;
+    return n;
+}
+
+/* unlink the request the I/O scheduler serves next */
+static IoRequest* pick_next(Device* d, simtime_t now) {
+    IoRequest** best = &d->queue;   // FIFO: the front
+    if (d->cfg.sched != IOS_FIFO &&
+        !(d->cfg.sched == IOS_DEADLINE && d->queue->submitted + d->cfg.expire_ns <= now)) {
+        /* elevator: nearest sector ahead of the head, else turn around */
+        for (int pass = 0; pass < 2; ++pass) {
+            best = NULL;
+            long best_dist = 0;
+            for (IoRequest** pp = &d->queue; *pp; pp = &(*pp)->next) {
+                long dist = (long)((*pp)->sector - d->head) * d->dir;
+                if (dist < 0) continue;
+                if (!best || dist < best_dist) { best = pp; best_dist = dist; }
+            }
+            if (best) break;
+            d->dir = -d->dir;
+        }
+    }
+    IoRequest* r = *best;
+    *best = r->next;
+    r->next = NULL;
+    d->qlen--;
+    return r;
+}
+
+static void start_request(Device* d, int slot, IoRequest* r, simtime_t now, Rng* rng) {
+    simtime_t seek = 0;
+    if (d->cfg.seek_ns > 0) {
+        long travel = labs((long)r->sector - d->head);
+        seek = (simtime_t)((double)d->cfg.seek_ns * travel / DEV_SPAN);
+    }
+    d->head = r->sector;
+    if (busy_slots(d) == 0) d->busy_since = now;
+
+    r->started = now;
+    r->done_at = now + seek + draw_transfer(&d->cfg, rng);
+    d->slot[slot] = r;
+    d->queue_ns  += now - r->submitted;
+    d->svc_total += r->done_at - now;
+}
+
+/* fill free slots from the queue */
+static void dispatch_io(Device* d, simtime_t now, Rng* rng) {
+    for (int i = 0; i < d->cfg.depth && d->queue; ++i)
+        if (!d->slot[i]) start_request(d, i, pick_next(d, now), now, rng);
+}
+
+void device_submit(Device* d, Thread* t, simtime_t now, Rng* rng) {
+    IoRequest* r = (IoRequest*)calloc(1, sizeof(IoRequest));
+    r->t         = t;
+    r->sector    = (int)(rng_next(rng) % DEV_SPAN);
+    r->submitted = now;
+    r->started   = -1;
+    r->done_at   = SIMTIME_NEVER;
+
+    IoRequest** pp = &d->queue;
+    while (*pp) pp = &(*pp)->next;
+    *pp = r;
+    d->qlen++;
+    if (d->qlen > d->max_qlen) d->max_qlen = d->qlen;
+
+    dispatch_io(d, now, rng);
+}
+
+void device_advance(Device* d, simtime_t now, Rng* rng) {
+    simtime_t last_done = -1;
+    for (int i = 0; i < d->cfg.depth; ++i) {
+        IoRequest* r = d->slot[i];
+        if (!r || r->done_at > now) continue;
+        r->t->unblocked_at = r->done_at;   // waiting_resolve wakes it
+        if (r->done_at > last_done) last_done = r->done_at;
+        d->completed++;
+        d->slot[i] = NULL;
+        free(r);
+    }
+    if (last_done >= 0 && busy_slots(d) == 0) d->busy_ns += last_done - d->busy_since;
+    dispatch_io(d, now, rng);
+}
+
+simtime_t device_next_event(const Device* d) {
+    simtime_t next = SIMTIME_NEVER;
+    for (int i = 0; i < d->cfg.depth; ++i)
+        if (d->slot[i] && d->slot[i]->done_at < next) next = d->slot[i]->done_at;
+    return next;
+}
+
+void device_report(const Device* d, int ndev, simtime_t elapsed, FILE* out) {
+    if (ndev < 1) return;
+    fprintf(out, "# I/O devices (times in ticks)\n");
+    fprintf(out, "%-12s %-9s %5s %9s %10s %10s %7s %6s\n",
+            "DEVICE", "SCHED", "DEPTH", "REQUESTS", "AVG_QUEUE", "AVG_SVC", "UTIL%", "MAXQ");
+    for (int i = 0; i < ndev; ++i, ++d) {
+        double n = d->completed > 0 ? (double)d->completed : 1.0;
+        simtime_t busy = d->busy_ns;
+        if (busy_slots(d) > 0) busy += elapsed - d->busy_since;   // still busy at the end
+        fprintf(out, "%-12s %-9s %5d %9ld %10.3f %10.3f %7.1f %6d\n",
+                d->cfg.name, iosched_name(d->cfg.sched), d->cfg.depth, d->completed,
+                to_ticks(d->queue_ns) / n, to_ticks(d->svc_total) / n,
+                elapsed > 0 ? 100.0 * busy / elapsed : 0.0, d->max_qlen);
+    }
+    fprintf(out, "\n");
+}
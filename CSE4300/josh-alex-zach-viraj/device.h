@@ -0,0 +1,101 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include "sim.h"
+
+/*
+  Simulated I/O devices.
+
+  Without devices a blocked thread just sleeps until unblocked_at, as if
+  every device could serve any number of requests at once. A Device has a
+  request queue, a concurrency limit (depth) and an I/O scheduler, so
+  threads that block on it compete for service and their I/O time grows
+  with the queue.
+
+  A blocked thread stays in the simulation's waiting queue with
+  unblocked_at = SIMTIME_NEVER. When its request completes the device sets
+  unblocked_at to the completion time and waiting_resolve() wakes it as
+  usual.
+
+  Service time = seek + transfer. Transfer is drawn from the configured
+  distribution. Seek is seek_ns scaled by the head travel over the device
+  span (a full stroke costs seek_ns), so request order matters on disks.
+  Devices with seek_ns = 0 (NICs) behave as plain multi-server queues.
+
+  I/O schedulers:
+    FIFO      submission order
+    SCAN      elevator: nearest sector in the head's direction, then reverse
+    DEADLINE  SCAN, but the oldest request goes first once it is expire_ns old
+*/
+
+#define DEV_SPAN     (1 << 20)   // sectors per device
+#define DEV_NAME_LEN 16
+
+typedef enum { IOS_FIFO = 0, IOS_SCAN, IOS_DEADLINE } IoSched;
+typedef enum { SVC_FIXED = 0, SVC_UNIFORM, SVC_EXP } SvcDist;
+
+/* Static settings. Plain data so checkpoints can store it as is. */
+typedef struct {
+    char      name[DEV_NAME_LEN];
+    IoSched   sched;
+    int       depth;       // requests in service at once
+    SvcDist   dist;
+    simtime_t svc_ns;      // mean transfer time (UNIFORM: 0.5x..1.5x)
+    simtime_t seek_ns;     // full-stroke seek time, 0 = no seeks
+    simtime_t expire_ns;   // DEADLINE read expiry
+    int       weight;      // share of random I/O interrupts sent here
+} DeviceConfig;
+
+typedef struct IoRequest {
+    Thread*   t;
+    int       sector;
+    simtime_t submitted;
+    simtime_t started;     // -1 while queued
+    simtime_t done_at;     // completion time once started
+    struct IoRequest* next;
+} IoRequest;
+
+typedef struct {
+    DeviceConfig cfg;
+
+    IoRequest*  queue;     // pending, in submission order
+    int         qlen;
+    IoRequest** slot;      // cfg.depth in-service requests (NULL = free)
+    int         head;      // sector the head last moved to
+    int         dir;       // SCAN direction, +1 / -1
+
+    /* statistics */
+    long        completed;
+    simtime_t   queue_ns;  // total time requests spent queued
+    simtime_t   svc_total; // total service time
+    simtime_t   busy_ns;   // time with at least one request in service
+    simtime_t   busy_since;
+    int         max_qlen;
+} Device;
+
+/* Parse "name[:key=val,...]" with keys sched=fifo|scan|deadline, depth=N,
+   dist=fixed|uniform|exp, svc=DUR, seek=DUR, expire=DUR, weight=N.
+   Names starting with "disk" default to a 1-deep SCAN disk with seeks,
+   anything else to a 4-deep FIFO NIC. Returns 0 on success, -1 on error. */
+int  device_parse(const char* spec, DeviceConfig* cfg);
+
+void device_init(Device* d, const DeviceConfig* cfg);
+void device_free(Device* d);   // frees requests, not their threads
+
+/* Queue a request for t (already in the waiting queue) and start service
+   if a slot is free. */
+void device_submit(Device* d, Thread* t, simtime_t now, Rng* rng);
+
+/* Complete requests done by now (waking their threads) and start queued
+   ones in the freed slots. */
+void device_advance(Device* d, simtime_t now, Rng* rng);
+
+/* Earliest completion in service, or SIMTIME_NEVER. */
+simtime_t device_next_event(const Device* d);
+
+/* Append a per-device summary (requests, queueing, utilization). */
+void device_report(const Device* d, int ndev, simtime_t elapsed, FILE* out);
+
+const char* iosched_name(IoSched s);
+
+#endif /* DEVICE_H */
@@ -1,4 +1,4 @@
-#include "dispatch.h"
+#include "sched_run.h"
 
 const char* dispatch_name(DispatchAlgo algo) {
     switch (algo) {
@@ -6,101 +6,262 @@ const char* dispatch_name(DispatchAlgo algo) {
         case DISP_SJF:   return "SJF (non-preemptive)";
         case DISP_SRTCF: return "SRTCF (preemptive SRTF)";
         case DISP_RR:    return "RR (preemptive)";
+        case DISP_PR:    return "Priority (preemptive)";
+        case DISP_CPF:   return "CPF (critical path first)";
+        case DISP_GANG:  return "Gang";
+        case DISP_GANG_BF: return "Gang (backfilling)";
         default:         return "unknown";
     }
 }
 
-void dispatch_fifo(CPU* cpu, Queue* ready) {
-    while (cpu_any_idle(cpu)) {
-        Thread* t = q_pop(ready);
-        if (!t) break;
-        cpu_bind_first_idle(cpu, t);
+int dispatch_parse(const char* s, DispatchAlgo* out) {
+    static const struct { const char* name; DispatchAlgo algo; } names[] = {
+        { "fifo", DISP_FIFO }, { "sjf", DISP_SJF }, { "srtcf", DISP_SRTCF },
+        { "rr",   DISP_RR   }, { "pr",  DISP_PR  }, { "priority", DISP_PR },
+        { "cpf",  DISP_CPF  }, { "gang", DISP_GANG }, { "gang-bf", DISP_GANG_BF },
+    };
+    if (!s) return -1;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (strcmp(s, names[i].name) == 0) { *out = names[i].algo; return 0; }
     }
+    /* menu numbers as in the interactive prompt */
+    if (s[0] >= '1' && s[0] <= '8' && s[1] == '\0') {
+        *out = (DispatchAlgo)(s[0] - '1');
+        return 0;
+    }
+    return -1;
+}
+
+int dispatch_sliced(DispatchAlgo algo) {
+    return algo == DISP_RR || algo == DISP_GANG || algo == DISP_GANG_BF;
+}
+
+/*
+  Built-in policies as sched ops tables. Each keeps Ready in the structure
+  it needs: FIFO and RR a plain list (O(1) enqueue and pick), SJF, SRTCF,
+  priority and CPF a binary heap (O(log n)) ordered by their key, with ties
+  going to the thread enqueued first, as the old list scans did.
+*/
+
+/* ----------- FIFO / RR: one list ------------- */
+typedef struct {
+    Queue     q;
+    simtime_t quantum;   // RR slice
+} ListPolicy;
+
+static void* list_init(const SchedParams* p) {
+    ListPolicy* l = (ListPolicy*)calloc(1, sizeof(ListPolicy));
+    if (!l) return NULL;
+    q_init(&l->q);
+    l->quantum = p->quantum;
+    return l;
+}
+
+static void list_exit(void* priv) {
+    free(priv);
+}
+
+static void list_enqueue(void* priv, Thread* t) {
+    q_push(&((ListPolicy*)priv)->q, t);
+}
+
+/* unlink t from q (the front if t is NULL) */
+static Thread* q_unlink(Queue* q, Thread* t) {
+    if (!t || q->front == t) return q_pop(q);
+    Thread* prev = q->front;
+    while (prev && prev->next != t) prev = prev->next;
+    if (!prev) return NULL;
+    prev->next = t->next;
+    if (q->rear == t) q->rear = prev;
+    q->size--;
+    t->next = NULL;
+    return t;
+}
+
+static Thread* list_dequeue(void* priv, Thread* t) {
+    return q_unlink(&((ListPolicy*)priv)->q, t);
+}
+
+static Thread* fifo_pick(void* priv, int core) {
+    (void)core;
+    return q_pop(&((ListPolicy*)priv)->q);
+}
+
+static void list_for_each(void* priv, void (*fn)(Thread*, void*), void* ctx) {
+    for (Thread* t = ((ListPolicy*)priv)->q.front; t; t = t->next) fn(t, ctx);
 }
 
-/* SJF (non-preemptive): pick the thread with the smallest *burst_time*
-   from Ready for each idle core. Ties break by first-encountered in the queue. */
-void dispatch_sjf(CPU* cpu, Queue* ready) {
-    while (cpu_any_idle(cpu)) {
-        Thread* t = q_pop_min_burst(ready);   // O(n) scan of Ready
-        if (!t) break;
-        cpu_bind_first_idle(cpu, t);
+/* new bindings get a full slice */
+static Thread* rr_pick(void* priv, int core) {
+    (void)core;
+    ListPolicy* l = (ListPolicy*)priv;
+    Thread* t = q_pop(&l->q);
+    if (t) t->quanta_rem = l->quantum;
+    return t;
+}
+
+/* expired slices (qrem hit 0 at the end of the last step) go to the tail */
+static int rr_preempt(void* priv, const CPU* cpu) {
+    (void)priv;
+    for (int i = 0; i < cpu->ncores; ++i)
+        if (cpu->core[i] && cpu->core[i]->quanta_rem == 0) return i;
+    return -1;
+}
+
+/* ----------- SJF / SRTCF / PRIORITY: min-heap ------------- */
+typedef struct {
+    Thread*   t;
+    simtime_t key;
+    unsigned long seq;   // enqueue order, breaks ties
+} HeapEnt;
+
+typedef struct {
+    HeapEnt*  a;
+    int       n, cap;
+    unsigned long seq;
+    simtime_t (*key)(const Thread* t);
+} HeapPolicy;
+
+static simtime_t key_burst(const Thread* t)     { return t->burst_time; }
+static simtime_t key_remaining(const Thread* t) { return t->remaining; }
+static simtime_t key_priority(const Thread* t)  { return t->priority; }
+/* latest start that keeps the thread's DAG job on its critical path
+   (see dag.h); a thread outside a job is a job of one task */
+static simtime_t key_cpath(const Thread* t) {
+    simtime_t due = t->job >= 0 ? t->cp_due : t->arrival_time + t->burst_time;
+    return due - (t->remaining + t->cp_tail);
+}
+
+static int ent_less(const HeapEnt* x, const HeapEnt* y) {
+    return x->key < y->key || (x->key == y->key && x->seq < y->seq);
+}
+
+static int seq_cmp(const void* x, const void* y) {
+    return ((const HeapEnt*)x)->seq < ((const HeapEnt*)y)->seq ? -1 : 1;
+}
+
+static void sift_up(HeapPolicy* h, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!ent_less(&h->a[i], &h->a[parent])) break;
+        HeapEnt tmp = h->a[i]; h->a[i] = h->a[parent]; h->a[parent] = tmp;
+        i = parent;
     }
 }
 
-/* ------- SRTCF (preemptive SRTF) ------- */
-/* pick core with the largest remaining > threshold; return -1 if none */
-static int core_with_largest_remaining_above(const CPU* cpu, int threshold) {
-    int best_core = -1, best_rem = -1;
-    for (int i = 0; i < cpu->ncores; ++i) {
-        Thread* r = cpu->core[i];
-        if (!r) continue;
-        if (r->remaining > threshold && r->remaining > best_rem) {
-            best_rem = r->remaining;
-            best_core = i;
-        }
+static void sift_down(HeapPolicy* h, int i) {
+    for (;;) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < h->n && ent_less(&h->a[l], &h->a[m])) m = l;
+        if (r < h->n && ent_less(&h->a[r], &h->a[m])) m = r;
+        if (m == i) break;
+        HeapEnt tmp = h->a[i]; h->a[i] = h->a[m]; h->a[m] = tmp;
+        i = m;
     }
-    return best_core;
 }
 
-void dispatch_srtcf(CPU* cpu, Queue* ready) {
-    /* First, fill any idle cores with the smallest-remaining jobs */
-    while (cpu_any_idle(cpu)) {
-        Thread* t = q_pop_min_remaining(ready);
-        if (!t) break;
-        cpu_bind_first_idle(cpu, t);
+static Thread* heap_remove_at(HeapPolicy* h, int i) {
+    Thread* t = h->a[i].t;
+    h->a[i] = h->a[--h->n];
+    if (i < h->n) {
+        sift_down(h, i);
+        sift_up(h, i);
     }
+    t->next = NULL;
+    return t;
+}
 
-    /* Preempt if the best ready job is better than something running */
-    for (;;) {
-        Thread* best = q_pop_min_remaining(ready);
-        if (!best) break;
-
-        /* If an idle core appeared (due to earlier I/O or completion), bind it */
-        int idle = cpu_first_idle(cpu);
-        if (idle >= 0) {
-            cpu_bind_core(cpu, idle, best);
-            continue;
-        }
+static HeapPolicy* heap_new(simtime_t (*key)(const Thread*)) {
+    HeapPolicy* h = (HeapPolicy*)calloc(1, sizeof(HeapPolicy));
+    if (h) h->key = key;
+    return h;
+}
 
-        /* Otherwise, find a running core whose remaining is worse than 'best' */
-        int victim = core_with_largest_remaining_above(cpu, best->remaining);
-        if (victim >= 0) {
-            /* preempt the victim to Ready, run 'best' now */
-            preempt_to_ready(cpu, victim, ready);
-            cpu_bind_core(cpu, victim, best);
-            /* continue loop: there might be another ready job better than some
-               other running job */
-            continue;
-        }
+static void* sjf_init(const SchedParams* p)   { (void)p; return heap_new(key_burst); }
+static void* srtcf_init(const SchedParams* p) { (void)p; return heap_new(key_remaining); }
+static void* pr_init(const SchedParams* p)    { (void)p; return heap_new(key_priority); }
+static void* cpf_init(const SchedParams* p)   { (void)p; return heap_new(key_cpath); }
 
-        /* Nowhere to place 'best' (all running <= best). Put it back and stop. */
-        q_push(ready, best);
-        break;
+static void heap_exit(void* priv) {
+    HeapPolicy* h = (HeapPolicy*)priv;
+    if (!h) return;
+    free(h->a);
+    free(h);
+}
+
+static void heap_enqueue(void* priv, Thread* t) {
+    HeapPolicy* h = (HeapPolicy*)priv;
+    if (h->n == h->cap) {
+        int cap = h->cap ? 2 * h->cap : 64;
+        HeapEnt* a = (HeapEnt*)realloc(h->a, sizeof(HeapEnt) * cap);
+        if (!a) {
+            fprintf(stderr, "dispatch: out of memory\n");
+            exit(1);
+        }
+        h->a = a;
+        h->cap = cap;
     }
+    t->next = NULL;
+    h->a[h->n] = (HeapEnt){ t, h->key(t), h->seq++ };
+    sift_up(h, h->n++);
 }
 
-/* ----------- RR ------------- */
-void dispatch_rr(CPU* cpu, Queue* ready, int quantum) {
-    if (quantum < 1) quantum = 1;
+static Thread* heap_pick(void* priv, int core) {
+    (void)core;
+    HeapPolicy* h = (HeapPolicy*)priv;
+    return h->n > 0 ? heap_remove_at(h, 0) : NULL;
+}
 
-    /* 1) Preempt expired-slice threads (they hit qrem==0 at end of last tick) */
+static Thread* heap_dequeue(void* priv, Thread* t) {
+    HeapPolicy* h = (HeapPolicy*)priv;
+    if (!t) return heap_pick(priv, -1);
+    for (int i = 0; i < h->n; ++i)
+        if (h->a[i].t == t) return heap_remove_at(h, i);
+    return NULL;
+}
+
+/* enqueue order (ties rotate, so this is not just insertion order) */
+static void heap_for_each(void* priv, void (*fn)(Thread*, void*), void* ctx) {
+    HeapPolicy* h = (HeapPolicy*)priv;
+    if (h->n == 0) return;
+    HeapEnt* v = (HeapEnt*)malloc(sizeof(HeapEnt) * h->n);
+    if (!v) return;
+    memcpy(v, h->a, sizeof(HeapEnt) * h->n);
+    qsort(v, h->n, sizeof(HeapEnt), seq_cmp);
+    for (int i = 0; i < h->n; ++i) fn(v[i].t, ctx);
+    free(v);
+}
+
+/* ------- SRTCF (preemptive SRTF) ------- */
+/* pick core with the largest remaining > threshold; return -1 if none */
+static int core_with_largest_remaining_above(const CPU* cpu, simtime_t threshold) {
+    int best_core = -1;
+    simtime_t best_rem = -1;
     for (int i = 0; i < cpu->ncores; ++i) {
-        Thread* t = cpu->core[i];
-        if (!t) continue;
-        if (t->quanta_rem == 0) {
-            preempt_to_ready(cpu, i, ready);  // unbind -> Ready tail; t->qrem unchanged (0)
+        Thread* r = cpu->core[i];
+        if (!r) continue;
+        if (r->remaining > threshold && r->remaining > best_rem) {
+            best_rem = r->remaining;
+            best_core = i;
         }
     }
+    return best_core;
+}
 
-    /* 2) Fill idle cores from Ready; new bindings get a full slice */
-    for (int i = 0; i < cpu->ncores; ++i) {
-        if (cpu->core[i]) continue;
-        Thread* t = q_pop(ready);
-        if (!t) break;
-        t->quanta_rem = quantum;                 // give fresh quantum
-        cpu_bind_core(cpu, i, t);
-    }
+/* The best Ready thread could not preempt anyone: it goes behind the
+   threads with the same key, so equals take turns at the next chance. */
+static int heap_no_victim(HeapPolicy* h) {
+    h->a[0].seq = h->seq++;
+    sift_down(h, 0);
+    return -1;
+}
+
+/* preempt if the best ready job is better than something running */
+static int srtcf_preempt(void* priv, const CPU* cpu) {
+    HeapPolicy* h = (HeapPolicy*)priv;
+    if (h->n == 0 || cpu_any_idle(cpu)) return -1;   // it gets the idle core
+    int victim = core_with_largest_remaining_above(cpu, h->a[0].key);
+    return victim >= 0 ? victim : heap_no_victim(h);
 }
 
 /* ------------ PRIORITY ---------------*/
@@ -119,29 +280,439 @@ static int core_with_worst_priority_above(const CPU* cpu, int threshold) {
     return victim_core;
 }
 
-void dispatch_priority(CPU* cpu, Queue* ready) {
-    /* fill idle cores first */
-    while (cpu_any_idle(cpu)) {
-        Thread* t = q_pop_highest_priority(ready);  /* smallest priority value wins */
-        if (!t) break;
-        cpu_bind_first_idle(cpu, t);
+static int pr_preempt(void* priv, const CPU* cpu) {
+    HeapPolicy* h = (HeapPolicy*)priv;
+    if (h->n == 0 || cpu_any_idle(cpu)) return -1;
+    int victim = core_with_worst_priority_above(cpu, (int)h->a[0].key);
+    return victim >= 0 ? victim : heap_no_victim(h);
+}
+
+/* aging: every Ready thread gains one level per tick, then re-heapify */
+static void pr_tick(void* priv) {
+    HeapPolicy* h = (HeapPolicy*)priv;
+    for (int i = 0; i < h->n; ++i) {
+        Thread* t = h->a[i].t;
+        if (t->priority > 0) t->priority--;
+        h->a[i].key = t->priority;
     }
+    for (int i = h->n / 2 - 1; i >= 0; --i) sift_down(h, i);
+}
 
-    /* preempt if a ready thread beats some running thread */
-    for (;;) {
-        Thread* best = q_pop_highest_priority(ready);
-        if (!best) break;
-
-        // preempt if the current theres a higher priority thread
-        int victim = core_with_worst_priority_above(cpu, best->priority);
-        if (victim >= 0) {
-            preempt_to_ready(cpu, victim, ready);
-            cpu_bind_core(cpu, victim, best);
-            continue;
+/* a lock protocol raised or restored a Ready thread's priority */
+static void pr_prio(void* priv, Thread* t) {
+    HeapPolicy* h = (HeapPolicy*)priv;
+    for (int i = 0; i < h->n; ++i) {
+        if (h->a[i].t != t) continue;
+        h->a[i].key = t->priority;
+        sift_down(h, i);
+        sift_up(h, i);
+        return;
+    }
+}
+
+/* ------------ GANG: Ousterhout matrix ---------------*/
+/*
+  The matrix has one column per core and a row per time slot. Each gang
+  (Thread.gang) gets gang_size cells, first fit in one row (a gang wider
+  than the machine spreads over whole rows of its own); rows take turns
+  for a quantum each, skipping rows with nothing to run, and the row's
+  members run on their columns' cores together. Threads outside gangs run
+  on unallocated cells of any row, and when they are all taken, in a slot
+  of their own after the rows.
+
+  A cell whose member is not Ready (at a barrier, in I/O) is a hole: the
+  plain policy leaves it idle, the backfilling one runs a thread from
+  another row there (the same column first) until its owner is Ready.
+  Rows of finished gangs are dropped; the matrix is laid out again when
+  the core count changes. A restored or switched-to policy places the
+  gangs again in gang order.
+*/
+typedef struct {
+    int      width;
+    int*     row;          // by rank, -1 = not placed
+    int*     col;
+    Thread** member;       // by rank, NULL until first enqueued
+    char*    held;         // by rank: the policy holds it
+    int      placed;
+    int      done;         // every member finished; never placed again
+} GangEnt;
+
+typedef struct {
+    simtime_t slot;        // length of a time slot
+    int       backfill;
+    int       ncols;       // cores the matrix is laid out for, 0 = not yet
+    int       nrows;
+    int*      cg;          // cg[r * ncols + c]: gang in the cell, -1 = unallocated
+    int*      cr;          // its member's rank
+    int*      used;        // allocated cells per row
+    int       cur;         // row of the slot, nrows = the slot of threads outside gangs
+    simtime_t slot_end;
+    GangEnt*  g;           // by Thread.gang
+    int       ng;
+    int       unplaced;    // entries waiting for the matrix layout
+    Queue     solo;        // held threads outside gangs
+    GangMatrixStats st;
+} GangPolicy;
+
+static void* gang_policy_init(const SchedParams* p, int backfill) {
+    GangPolicy* g = (GangPolicy*)calloc(1, sizeof(GangPolicy));
+    if (!g) return NULL;
+    g->slot     = p->quantum > p->tick_ns ? p->quantum : p->tick_ns;
+    g->backfill = backfill;
+    g->cur      = -1;
+    q_init(&g->solo);
+    return g;
+}
+
+static void* gang_init(const SchedParams* p)    { return gang_policy_init(p, 0); }
+static void* gang_bf_init(const SchedParams* p) { return gang_policy_init(p, 1); }
+
+static void gang_exit(void* priv) {
+    GangPolicy* p = (GangPolicy*)priv;
+    if (!p) return;
+    for (int i = 0; i < p->ng; ++i) {
+        free(p->g[i].row);
+        free(p->g[i].col);
+        free(p->g[i].member);
+        free(p->g[i].held);
+    }
+    free(p->g);
+    free(p->cg);
+    free(p->cr);
+    free(p->used);
+    free(p);
+}
+
+/* t's entry, created on first sight */
+static GangEnt* gang_ent(GangPolicy* p, const Thread* t) {
+    if (t->gang >= p->ng) {
+        int n = t->gang + 1;
+        GangEnt* g = (GangEnt*)realloc(p->g, sizeof(GangEnt) * n);
+        if (!g) {
+            fprintf(stderr, "dispatch: out of memory\n");
+            exit(1);
         }
+        memset(g + p->ng, 0, sizeof(GangEnt) * (n - p->ng));
+        p->g  = g;
+        p->ng = n;
+    }
+    GangEnt* e = &p->g[t->gang];
+    if (!e->row) {
+        int w = t->gang_size > t->gang_rank ? t->gang_size : t->gang_rank + 1;
+        e->width  = w;
+        e->row    = (int*)malloc(sizeof(int) * w);
+        e->col    = (int*)malloc(sizeof(int) * w);
+        e->member = (Thread**)calloc(w, sizeof(Thread*));
+        e->held   = (char*)calloc(w, 1);
+        for (int k = 0; k < w; ++k) e->row[k] = e->col[k] = -1;
+        p->unplaced++;
+    }
+    return e;
+}
+
+static void add_row(GangPolicy* p) {
+    int r = p->nrows++;
+    p->cg   = (int*)realloc(p->cg, sizeof(int) * p->nrows * p->ncols);
+    p->cr   = (int*)realloc(p->cr, sizeof(int) * p->nrows * p->ncols);
+    p->used = (int*)realloc(p->used, sizeof(int) * p->nrows);
+    for (int c = 0; c < p->ncols; ++c) p->cg[r * p->ncols + c] = -1;
+    p->used[r] = 0;
+}
 
-        /* no preemption: put it back and stop */
-        q_push(ready, best);
-        break;
+static void place_cell(GangPolicy* p, int gi, int k, int r, int c) {
+    GangEnt* e = &p->g[gi];
+    p->cg[r * p->ncols + c] = gi;
+    p->cr[r * p->ncols + c] = k;
+    p->used[r]++;
+    e->row[k] = r;
+    e->col[k] = c;
+}
+
+/* first fit: the first row with width free cells, else new rows */
+static void place(GangPolicy* p, int gi) {
+    GangEnt* e = &p->g[gi];
+    int r = 0;
+    if (e->width <= p->ncols)
+        while (r < p->nrows && p->ncols - p->used[r] < e->width) r++;
+    else
+        r = p->nrows;
+    for (int k = 0; k < e->width; r++) {
+        if (r == p->nrows) add_row(p);
+        for (int c = 0; c < p->ncols && k < e->width; ++c)
+            if (p->cg[r * p->ncols + c] < 0) place_cell(p, gi, k++, r, c);
+    }
+    e->placed = 1;
+    p->unplaced--;
+}
+
+/* lay the matrix out for ncols cores, placing every live gang again */
+static void relayout(GangPolicy* p, int ncols) {
+    p->ncols = ncols;
+    p->nrows = 0;
+    p->cur   = -1;
+    p->unplaced = 0;
+    for (int i = 0; i < p->ng; ++i) {
+        GangEnt* e = &p->g[i];
+        if (!e->row || e->done) continue;
+        e->placed = 0;
+        p->unplaced++;
+    }
+    for (int i = 0; i < p->ng; ++i)
+        if (p->g[i].row && !p->g[i].done) place(p, i);
+}
+
+/* drop finished gangs and the rows they leave empty */
+static void drop_finished(GangPolicy* p) {
+    int dropped = 0;
+    for (int i = 0; i < p->ng; ++i) {
+        GangEnt* e = &p->g[i];
+        if (!e->placed || e->done) continue;
+        int k = 0;
+        while (k < e->width && e->member[k] && e->member[k]->state == ST_FINISHED) k++;
+        if (k < e->width) continue;
+        for (k = 0; k < e->width; ++k) {
+            p->cg[e->row[k] * p->ncols + e->col[k]] = -1;
+            p->used[e->row[k]]--;
+            e->row[k] = e->col[k] = -1;
+        }
+        e->placed = 0;
+        e->done   = 1;
+        dropped   = 1;
+    }
+    if (!dropped) return;
+    int* map = (int*)malloc(sizeof(int) * (p->nrows + 1));
+    int n = 0;
+    for (int r = 0; r < p->nrows; ++r) {
+        map[r] = p->used[r] > 0 ? n : -1;
+        if (p->used[r] == 0) continue;
+        if (n != r) {
+            memcpy(&p->cg[n * p->ncols], &p->cg[r * p->ncols], sizeof(int) * p->ncols);
+            memcpy(&p->cr[n * p->ncols], &p->cr[r * p->ncols], sizeof(int) * p->ncols);
+            p->used[n] = p->used[r];
+        }
+        n++;
+    }
+    for (int i = 0; i < p->ng; ++i)
+        if (p->g[i].placed)
+            for (int k = 0; k < p->g[i].width; ++k) p->g[i].row[k] = map[p->g[i].row[k]];
+    /* the slot goes on from the row after the dropped ones */
+    if (p->cur >= 0 && p->cur < p->nrows) {
+        int r = p->cur;
+        while (r < p->nrows && map[r] < 0) r++;
+        p->cur = r < p->nrows ? map[r] - 1 : n - 1;
+    } else if (p->cur >= p->nrows) {
+        p->cur = n;
+    }
+    p->nrows = n;
+    free(map);
+}
+
+/* gang and rank in cell (r, c); -1 = unallocated (the solo slot has no cells) */
+static int cell_gang(const GangPolicy* p, int r, int c, int* rank) {
+    if (r < 0 || r >= p->nrows || c >= p->ncols) return -1;
+    *rank = p->cr[r * p->ncols + c];
+    return p->cg[r * p->ncols + c];
+}
+
+/* something in row r could run: a member held or on a core */
+static int row_live(const GangPolicy* p, int r) {
+    if (r == p->nrows) return !q_empty(&p->solo);
+    if (r < 0 || r > p->nrows) return 0;
+    for (int c = 0; c < p->ncols; ++c) {
+        int k, gi = cell_gang(p, r, c, &k);
+        if (gi < 0) continue;
+        const GangEnt* e = &p->g[gi];
+        if (e->held[k] || (e->member[k] && e->member[k]->state == ST_RUNNING)) return 1;
+    }
+    return 0;
+}
+
+/* move to the next row with something to run; a new slot starts there,
+   or in the same row if the slot expired */
+static void next_slot(GangPolicy* p, int expired) {
+    drop_finished(p);
+    int nslots = p->nrows + 1, next = -1;
+    for (int d = 1; d <= nslots; ++d) {
+        int r = ((p->cur < 0 ? -1 : p->cur) + d) % nslots;
+        if (row_live(p, r)) {
+            next = r;
+            break;
+        }
+    }
+    if (next < 0 || (next == p->cur && !expired)) {
+        if (expired) p->slot_end = SIM_TIME + p->slot;
+        return;
     }
-}
\ No newline at end of file
+    p->cur = next;
+    p->slot_end = SIM_TIME + p->slot;
+    if (next < p->nrows) {
+        p->st.slots++;
+        p->st.rows      += p->nrows;
+        p->st.cols      += p->ncols;
+        p->st.free_cols += p->ncols - p->used[next];
+    }
+}
+
+static void gang_enqueue(void* priv, Thread* t) {
+    GangPolicy* p = (GangPolicy*)priv;
+    if (t->gang < 0) {
+        q_push(&p->solo, t);
+        return;
+    }
+    GangEnt* e = gang_ent(p, t);
+    e->member[t->gang_rank] = t;
+    e->held[t->gang_rank]   = 1;
+    t->next = NULL;
+    if (!e->placed && !e->done && p->ncols > 0) place(p, t->gang);
+}
+
+static Thread* take_member(GangEnt* e, int k) {
+    e->held[k] = 0;
+    e->member[k]->next = NULL;
+    return e->member[k];
+}
+
+/* a held member of a row other than the current one for core c: that
+   column first, then any */
+static Thread* take_other(GangPolicy* p, int c) {
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int d = 1; d <= p->nrows; ++d) {
+            int r = ((p->cur < 0 ? 0 : p->cur) + d) % (p->nrows + 1);
+            if (r == p->nrows || r == p->cur) continue;
+            for (int x = pass ? 0 : c; x < (pass ? p->ncols : c + 1); ++x) {
+                int k, gi = cell_gang(p, r, x, &k);
+                if (gi >= 0 && p->g[gi].held[k]) return take_member(&p->g[gi], k);
+            }
+        }
+    }
+    return NULL;
+}
+
+static Thread* gang_dequeue(void* priv, Thread* t) {
+    GangPolicy* p = (GangPolicy*)priv;
+    if (!t) {
+        for (int i = 0; i < p->ng; ++i)
+            for (int k = 0; p->g[i].row && k < p->g[i].width; ++k)
+                if (p->g[i].held[k]) return take_member(&p->g[i], k);
+        return q_pop(&p->solo);
+    }
+    if (t->gang < 0) return q_unlink(&p->solo, t);
+    if (t->gang >= p->ng || !p->g[t->gang].held[t->gang_rank]) return NULL;
+    return take_member(&p->g[t->gang], t->gang_rank);
+}
+
+static Thread* gang_pick(void* priv, int core) {
+    GangPolicy* p = (GangPolicy*)priv;
+    int k, gi = cell_gang(p, p->cur, core, &k);
+    if (gi >= 0) {
+        if (p->g[gi].held[k]) return take_member(&p->g[gi], k);
+        if (!p->backfill) return NULL;   // a hole, kept for its member
+    }
+    if (gi < 0 && !q_empty(&p->solo)) return q_pop(&p->solo);
+    if (!p->backfill) return NULL;
+    Thread* t = q_pop(&p->solo);
+    if (!t) t = take_other(p, core);
+    if (t) p->st.backfills++;
+    return t;
+}
+
+/* may t stay on core c in this slot? */
+static int gang_allowed(const GangPolicy* p, const Thread* t, int c) {
+    if (t->gang >= 0) {
+        if (t->gang >= p->ng || !p->g[t->gang].placed) return 0;   // placed once it is back
+        const GangEnt* e = &p->g[t->gang];
+        if (e->row[t->gang_rank] == p->cur) return e->col[t->gang_rank] == c;
+    }
+    int k, gi = cell_gang(p, p->cur, c, &k);
+    if (gi >= 0) return p->backfill && !p->g[gi].held[k];
+    return t->gang < 0 || p->backfill;
+}
+
+static int gang_preempt(void* priv, const CPU* cpu) {
+    GangPolicy* p = (GangPolicy*)priv;
+    if (cpu->ncores != p->ncols) relayout(p, cpu->ncores);
+    for (int i = 0; p->unplaced > 0 && i < p->ng; ++i)
+        if (p->g[i].row && !p->g[i].placed && !p->g[i].done) place(p, i);
+
+    int expired = SIM_TIME >= p->slot_end;
+    if (expired || !row_live(p, p->cur)) next_slot(p, expired);
+    for (int c = 0; c < cpu->ncores; ++c)
+        if (cpu->core[c] && !gang_allowed(p, cpu->core[c], c)) return c;
+    return -1;
+}
+
+static void gang_for_each(void* priv, void (*fn)(Thread*, void*), void* ctx) {
+    GangPolicy* p = (GangPolicy*)priv;
+    for (int i = 0; i < p->ng; ++i)
+        for (int k = 0; p->g[i].row && k < p->g[i].width; ++k)
+            if (p->g[i].held[k]) fn(p->g[i].member[k], ctx);
+    for (Thread* t = p->solo.front; t; t = t->next) fn(t, ctx);
+}
+
+static const SchedOps ops_table[] = {
+    [DISP_FIFO]  = { SCHED_OPS_ABI, "FIFO", list_init, list_exit,
+                     list_enqueue, list_dequeue, fifo_pick,
+                     NULL, NULL, NULL, NULL, NULL, list_for_each },
+    [DISP_SJF]   = { SCHED_OPS_ABI, "SJF (non-preemptive)", sjf_init, heap_exit,
+                     heap_enqueue, heap_dequeue, heap_pick,
+                     NULL, NULL, NULL, NULL, NULL, heap_for_each },
+    [DISP_SRTCF] = { SCHED_OPS_ABI, "SRTCF (preemptive SRTF)", srtcf_init, heap_exit,
+                     heap_enqueue, heap_dequeue, heap_pick,
+                     NULL, srtcf_preempt, NULL, NULL, NULL, heap_for_each },
+    [DISP_RR]    = { SCHED_OPS_ABI, "RR (preemptive)", list_init, list_exit,
+                     list_enqueue, list_dequeue, rr_pick,
+                     NULL, rr_preempt, NULL, NULL, NULL, list_for_each },
+    [DISP_PR]    = { SCHED_OPS_ABI, "Priority (preemptive)", pr_init, heap_exit,
+                     heap_enqueue, heap_dequeue, heap_pick,
+                     pr_tick, pr_preempt, NULL, NULL, pr_prio, heap_for_each },
+    [DISP_CPF]   = { SCHED_OPS_ABI, "CPF (critical path first)", cpf_init, heap_exit,
+                     heap_enqueue, heap_dequeue, heap_pick,
+                     NULL, NULL, NULL, NULL, NULL, heap_for_each },
+    [DISP_GANG]  = { SCHED_OPS_ABI, "Gang", gang_init, gang_exit,
+                     gang_enqueue, gang_dequeue, gang_pick,
+                     NULL, gang_preempt, NULL, NULL, NULL, gang_for_each },
+    [DISP_GANG_BF] = { SCHED_OPS_ABI, "Gang (backfilling)", gang_bf_init, gang_exit,
+                     gang_enqueue, gang_dequeue, gang_pick,
+                     NULL, gang_preempt, NULL, NULL, NULL, gang_for_each },
+};
+
+const SchedOps* dispatch_ops(DispatchAlgo algo) {
+    if ((unsigned)algo >= sizeof(ops_table) / sizeof(ops_table[0])) algo = DISP_FIFO;
+    return &ops_table[algo];
+}
+
+/* Each built-in's dispatch loop: sched_run() over its own functions, the
+   same ones as in its ops table, so they are inlined into the loop */
+#define DISPATCH_RUN(name, enqueue, pick, preempt)                    \
+    static void name##_run(Sched* s, CPU* cpu, Queue* incoming) {     \
+        sched_run(s, cpu, incoming, enqueue, pick, preempt);          \
+    }
+
+DISPATCH_RUN(fifo,  list_enqueue, fifo_pick, NULL)
+DISPATCH_RUN(rr,    list_enqueue, rr_pick,   rr_preempt)
+DISPATCH_RUN(heap,  heap_enqueue, heap_pick, NULL)   // SJF, CPF
+DISPATCH_RUN(srtcf, heap_enqueue, heap_pick, srtcf_preempt)
+DISPATCH_RUN(pr,    heap_enqueue, heap_pick, pr_preempt)
+DISPATCH_RUN(gang,  gang_enqueue, gang_pick, gang_preempt)
+
+static const SchedRunFn run_table[] = {
+    [DISP_FIFO]  = fifo_run,
+    [DISP_SJF]   = heap_run,
+    [DISP_SRTCF] = srtcf_run,
+    [DISP_RR]    = rr_run,
+    [DISP_PR]    = pr_run,
+    [DISP_CPF]   = heap_run,
+    [DISP_GANG]  = gang_run,
+    [DISP_GANG_BF] = gang_run,
+};
+
+SchedRunFn dispatch_run(DispatchAlgo algo) {
+    if ((unsigned)algo >= sizeof(run_table) / sizeof(run_table[0])) algo = DISP_FIFO;
+    return run_table[algo];
+}
+
+int dispatch_gang_stats(const SchedOps* ops, const void* priv, GangMatrixStats* out) {
+    if (ops != &ops_table[DISP_GANG] && ops != &ops_table[DISP_GANG_BF]) return -1;
+    *out = ((const GangPolicy*)priv)->st;
+    return 0;
+}
@@ -2,6 +2,7 @@
 #define DISPATCH_H
 
 #include "sim.h"
+#include "gang.h"
 
 /* Which scheduler to use */
 typedef enum {
@@ -9,23 +10,29 @@ typedef enum {
     DISP_SJF,          /* non-preemptive */
     DISP_SRTCF,        /* preemptive SRTF */
     DISP_RR,           /* preemptive Round Robin */
-    DISP_PR            /* Priority Queue */
+    DISP_PR,           /* Priority Queue */
+    DISP_CPF,          /* critical path first, non-preemptive (see dag.h) */
+    DISP_GANG,         /* gang scheduling: Ousterhout matrix (see gang.h) */
+    DISP_GANG_BF       /* gang scheduling, idle cells backfilled */
 } DispatchAlgo;
 
-/* Function pointer type for any scheduler */
-typedef void (*DispatchFn)(CPU* cpu, Queue* ready);
+struct SchedOps;
 
-/* Get a scheduler by enum */
-DispatchFn dispatch_get(DispatchAlgo algo);
+/* Built-in policy for algo as a sched ops table (see sched.h) */
+const struct SchedOps* dispatch_ops(DispatchAlgo algo);
 
 /* Optional: name helper */
 const char* dispatch_name(DispatchAlgo algo);
 
-/* Concrete policies */
-void dispatch_fifo(CPU* cpu, Queue* ready);
-void dispatch_sjf(CPU* cpu, Queue* ready);\
-void dispatch_srtcf(CPU* cpu, Queue* ready);
-void dispatch_rr(CPU* cpu, Queue* ready, int quantum);
-void dispatch_priority(CPU* cpu, Queue* ready);
+/* Parse "fifo", "sjf", "srtcf", "rr", "pr", "cpf", "gang", "gang-bf" or a
+   menu number 1-8. Returns 0 and sets *out on success, -1 if unrecognized. */
+int dispatch_parse(const char* s, DispatchAlgo* out);
+
+/* 1 if algo runs threads in time slices of the quantum (RR, gang) */
+int dispatch_sliced(DispatchAlgo algo);
+
+/* Matrix counters of a gang policy instance (ops, priv as in Sched).
+   Returns 0, or -1 if it is not a gang policy. */
+int dispatch_gang_stats(const struct SchedOps* ops, const void* priv, GangMatrixStats* out);
 
 #endif
@@ -0,0 +1,744 @@
+#include "engine.h"
+
+void sim_init(Sim* s, DispatchAlgo algo, simtime_t rr_quantum, int ncores, int trace_len) {
+    q_init(&s->workload);
+    q_init(&s->ready);
+    q_init(&s->waiting);
+    q_init(&s->finished);
+    q_init(&s->dropped);
+
+    cpu_init(&s->cpu, ncores);
+    cpu_alloc_trace(&s->cpu, trace_len);
+
+    s->algo = algo;
+    s->rr_quantum = rr_quantum;
+    s->age_every = 1;
+    sched_open(&s->sched, algo, rr_quantum, NULL);   // built-ins always open
+    s->intr.enable_random = 0;
+    s->intr.pct_io = 10;
+    s->intr.io_min = 2 * SIM_TICK_NS;
+    s->intr.io_max = 6 * SIM_TICK_NS;
+    rng_seed(&s->rng, 42);
+    s->dev  = NULL;
+    s->ndev = 0;
+    s->lock  = NULL;
+    s->nlock = 0;
+    s->power = NULL;
+    s->group  = NULL;
+    s->ngroup = 0;
+    s->hotplug = NULL;
+    s->nhotplug = 0;
+    s->hotplug_next = 0;
+    s->scale = NULL;
+    s->core_ns = 0;
+    s->job  = NULL;
+    s->njob = 0;
+    s->gang  = NULL;
+    s->ngang = 0;
+    s->admit = NULL;
+    s->mem = NULL;
+    s->idle_ready_ns = 0;
+
+    s->now = 0;
+    s->next_wake = SIMTIME_NEVER;
+    s->log = NULL;
+    s->flight = NULL;
+}
+
+/* move finished off the cores cpu_step flagged into finished queue */
+static void collect_completions(Sim* s) {
+    CPU* cpu = &s->cpu;
+    for (int i = cpu_next_attn(cpu, 0); i >= 0; i = cpu_next_attn(cpu, i + 1)) {
+        Thread* t = cpu->core[i];
+        if (!t) continue;
+        if (t->remaining == 0) {
+            (void)cpu_unbind_core(cpu, i);
+            t->state = ST_FINISHED;
+            if (t->finish_time < 0) t->finish_time = SIM_TIME;  // exact, SIM_TIME advanced by cpu_step
+            q_push(&s->finished, t);
+            if (t->job >= 0) job_task_done(s->job, t, SIM_TIME);   // release its successors
+            if (t->gang >= 0) gang_member_done(s->gang, t, SIM_TIME);
+            if (s->mem) mem_release(s->mem, t);                   // its frames are free again
+            if (s->flight)
+                flight_record(s->flight, FE_FINISH, SIM_TIME, i, t->tid, 0, 0,
+                              t->finish_time - t->arrival_time);
+        }
+    }
+}
+
+/* a lock protocol changed t's priority; the policy may hold it by key */
+static void lock_prio_changed(Thread* t, void* ctx) {
+    if (t->state == ST_READY) sched_prio(&((Sim*)ctx)->sched, t);
+}
+
+/* t on core c reached its next lock point; returns 0 if it blocked */
+static int lock_point(Sim* s, int c, Thread* t) {
+    const LockOp* op = &t->lockops[t->lockop];
+    if (!op->acquire) {
+        if (lock_release(s->lock, s->nlock, op->lock, t, SIM_TIME, lock_prio_changed, s))
+            s->next_wake = SIM_TIME;   // the woken waiter
+        return 1;
+    }
+    if (lock_acquire(s->lock, s->nlock, op->lock, t, SIM_TIME, lock_prio_changed, s)) return 1;
+
+    /* wait for a release; it sets unblocked_at */
+    const Lock* l = &s->lock[op->lock];
+    block_to_waiting(&s->cpu, c, &s->waiting, SIMTIME_NEVER);
+    sched_block(&s->sched, t);
+    if (s->log) log_lock_event(s->log, SIM_TIME, c, t->tid, l->cfg.name, l->owner->tid, l->nwait);
+    if (s->flight) flight_record(s->flight, FE_LOCK, SIM_TIME, c, t->tid, op->lock, l->owner->tid, 0);
+    return 0;
+}
+
+/* t on core c referenced its next page; returns 0 if it faulted */
+static int mem_point(Sim* s, int c, Thread* t) {
+    simtime_t served = mem_reference(s->mem, t, SIM_TIME);
+    thread_update_stop(t);
+    if (!served) return 1;
+
+    /* wait for the page; the next reference is past this point */
+    block_to_waiting(&s->cpu, c, &s->waiting, served);
+    sched_block(&s->sched, t);
+    if (s->log) log_fault_event(s->log, SIM_TIME, c, t->tid, served);
+    if (s->flight) flight_record(s->flight, FE_FAULT, SIM_TIME, c, t->tid, 0, 0, served);
+    return 0;
+}
+
+/* Running threads that reached a stop point (cpu_step flagged their
+   cores): lock script points first, then page references, which block
+   for a fault, then the end of a scripted CPU phase, which blocks for its
+   I/O, or for a gang member at the barrier until the last member gets
+   there. lean: no locks, paging or gangs. */
+static SIM_ALWAYS_INLINE void collect_stops(Sim* s, const int lean) {
+    CPU* cpu = &s->cpu;
+    for (int i = cpu_next_attn(cpu, 0); i >= 0; i = cpu_next_attn(cpu, i + 1)) {
+        Thread* t = cpu->core[i];
+        /* loop: several points can fall at the same offset */
+        while (t && t->remaining <= t->stop_at) {
+            if (!lean && lock_due(t)) {
+                if (!lock_point(s, i, t)) t = NULL;
+                continue;
+            }
+            if (!lean && s->mem && mem_due(t)) {
+                if (!mem_point(s, i, t)) t = NULL;
+                continue;
+            }
+            if (!t->phases || t->remaining == 0 || t->remaining > t->phase_end) break;
+            simtime_t io = t->phases[t->phase].io;
+            t->phase++;
+            t->phase_end -= t->phases[t->phase].cpu;   // end of the next phase
+            thread_update_stop(t);
+            if (!lean && t->gang >= 0) {
+                int r = gang_arrive(s->gang, t, SIM_TIME);
+                if (r < 0) {
+                    block_to_waiting(cpu, i, &s->waiting, SIMTIME_NEVER);
+                    sched_block(&s->sched, t);
+                    t = NULL;
+                    continue;
+                }
+                if (r > 0) s->next_wake = SIM_TIME;   // the members it released
+            }
+            if (io > 0) {
+                block_to_waiting(cpu, i, &s->waiting, SIM_TIME + io);
+                sched_block(&s->sched, t);
+                t = NULL;
+            }
+        }
+    }
+}
+
+/* stop when no work is left anywhere */
+int sim_done(const Sim* s) {
+    if (!q_empty(&s->workload)) return 0;
+    if (sim_ready_count(s) > 0) return 0;
+    if (!q_empty(&s->waiting))  return 0;
+    for (int i = 0; i < s->cpu.ncores; ++i)
+        if (s->cpu.core[i]) return 0;
+    return 1;
+}
+
+/* device for one I/O request, chosen by weight */
+static Device* pick_device(Sim* s) {
+    int total = 0;
+    for (int i = 0; i < s->ndev; ++i) total += s->dev[i].cfg.weight;
+    if (total <= 0) return NULL;
+    int r = (int)(rng_next(&s->rng) % (unsigned)total);
+    for (int i = 0; i < s->ndev; ++i) {
+        r -= s->dev[i].cfg.weight;
+        if (r < 0) return &s->dev[i];
+    }
+    return NULL;
+}
+
+// random IO interrupts
+static void random_interrupts(Sim* s) {
+    const InterruptConfig* cfg = &s->intr;
+    if (!cfg->enable_random) return;
+
+    for (int c = 0; c < s->cpu.ncores; ++c) {
+        Thread* t = s->cpu.core[c];
+        if (!t) continue;
+
+        int r = (int)(rng_next(&s->rng) % 100);
+        if (r < cfg->pct_io && s->ndev > 0) {
+            Device* d = pick_device(s);
+            if (!d) continue;
+            /* wait on the device; it sets unblocked_at when served */
+            block_to_waiting(&s->cpu, c, &s->waiting, SIMTIME_NEVER);
+            sched_block(&s->sched, t);
+            device_submit(d, t, SIM_TIME, &s->rng);
+            if (s->log) log_dev_event(s->log, SIM_TIME, c, t->tid, d->cfg.name, d->qlen);
+            if (s->flight)
+                flight_record(s->flight, FE_DEV, SIM_TIME, c, t->tid, (int)(d - s->dev), d->qlen, 0);
+        } else if (r < cfg->pct_io) {
+            simtime_t dur = rng_time(&s->rng, cfg->io_min, cfg->io_max);
+            simtime_t unblock = SIM_TIME + dur;
+
+            /* move running thread to Waiting until unblock time */
+            block_to_waiting(&s->cpu, c, &s->waiting, unblock);
+            sched_block(&s->sched, t);
+            if (unblock < s->next_wake) s->next_wake = unblock;
+
+            /* log the event */
+            if (s->log) log_io_event(s->log, SIM_TIME, c, t->tid, dur, unblock);
+            if (s->flight) flight_record(s->flight, FE_IO, SIM_TIME, c, t->tid, 0, 0, unblock);
+        }
+    }
+}
+
+/* waiting -> ready, telling the policy who woke up */
+static void wake_threads(Sim* s) {
+    Queue woken;
+    q_init(&woken);
+    s->next_wake = waiting_resolve(&s->waiting, &woken, SIM_TIME);
+    while (!q_empty(&woken)) {
+        Thread* t = q_pop(&woken);
+        sched_wake(&s->sched, t);
+        q_push(&s->ready, t);
+    }
+}
+
+int sim_ready_count(const Sim* s) {
+    int n = s->ready.size + s->sched.nready;
+    for (int i = 0; i < s->ngroup; ++i) n += s->group[i].held.size;
+    return n;
+}
+
+void sim_log_snapshot(const Sim* s) {
+    if (!s->log) return;
+    /* not yet enqueued first: they joined Ready after the policy's threads */
+    int n = sim_ready_count(s);
+    Thread** ready = (Thread**)malloc(sizeof(Thread*) * (n > 0 ? n : 1));
+    int k = sched_snapshot(&s->sched, ready);
+    for (Thread* t = s->ready.front; t; t = t->next) ready[k++] = t;
+    for (int i = 0; i < s->ngroup; ++i)
+        for (Thread* t = s->group[i].held.front; t; t = t->next) ready[k++] = t;
+    log_snapshot(s->log, SIM_TIME, ready, k, &s->waiting, &s->cpu, &s->finished);
+    free(ready);
+}
+
+/* ---------------- Groups ---------------- */
+
+/* Threads of blocked groups leave the cores, the incoming queue and the
+   policy for their group's held queue. */
+static void groups_hold(Sim* s) {
+    Group* g = s->group;
+    int any = 0;
+    for (int i = 0; i < s->ngroup && !any; ++i) any = group_blocked(g, i);
+    if (!any) return;
+
+    for (int c = 0; c < s->cpu.ncores; ++c) {
+        Thread* t = s->cpu.core[c];
+        if (!t || t->group < 0 || !group_blocked(g, t->group)) continue;
+        t->quanta_rem = 0;
+        preempt_to_ready(&s->cpu, c, &g[t->group].held);
+    }
+
+    Queue keep;
+    q_init(&keep);
+    while (!q_empty(&s->ready)) {
+        Thread* t = q_pop(&s->ready);
+        q_push(t->group >= 0 && group_blocked(g, t->group) ? &g[t->group].held : &keep, t);
+    }
+    s->ready = keep;
+
+    if (s->sched.nready == 0) return;
+    Thread** held = (Thread**)malloc(sizeof(Thread*) * s->sched.nready);
+    int n = sched_snapshot(&s->sched, held);
+    for (int i = 0; i < n; ++i) {
+        Thread* t = held[i];
+        if (t->group < 0 || !group_blocked(g, t->group)) continue;
+        if (sched_remove(&s->sched, t) == 0) q_push(&g[t->group].held, t);
+    }
+    free(held);
+}
+
+/* held threads of groups no longer blocked become Ready again */
+static void groups_release(Sim* s) {
+    for (int i = 0; i < s->ngroup; ++i) {
+        Group* g = &s->group[i];
+        if (q_empty(&g->held) || group_blocked(s->group, i)) continue;
+        while (!q_empty(&g->held)) q_push(&s->ready, q_pop(&g->held));
+    }
+}
+
+static void count_one(Thread* t, void* ctx) {
+    if (t->group >= 0) group_count((Group*)ctx, t);
+}
+
+/* refill budgets; at a tick, recount runnable threads and rebalance shares;
+   then move threads between the held queues and Ready */
+static void groups_prepare(Sim* s, int at_tick) {
+    group_refill(s->group, s->ngroup, SIM_TIME);
+    if (at_tick) {
+        group_count_reset(s->group, s->ngroup);
+        for (int c = 0; c < s->cpu.ncores; ++c)
+            if (s->cpu.core[c]) count_one(s->cpu.core[c], s->group);
+        for (Thread* t = s->ready.front; t; t = t->next) count_one(t, s->group);
+        for (int i = 0; i < s->ngroup; ++i)
+            for (Thread* t = s->group[i].held.front; t; t = t->next) count_one(t, s->group);
+        sched_for_each(&s->sched, count_one, s->group);
+        group_balance(s->group, s->ngroup, SIM_TICK_NS);
+    }
+    groups_release(s);
+    groups_hold(s);
+}
+
+/* after dispatch: cores that would idle run groups held back for their share */
+static void groups_fill(Sim* s) {
+    if (!cpu_any_idle(&s->cpu)) return;
+    int released = 0;
+    for (int i = 0; i < s->ngroup; ++i) {
+        if (q_empty(&s->group[i].held) || !group_share_blocked(s->group, i)) continue;
+        group_unhold_share(s->group, i);
+        released = 1;
+    }
+    if (!released) return;
+    groups_release(s);
+    sched_dispatch(&s->sched, &s->cpu, &s->ready);
+}
+
+/* longest current wait among Ready threads */
+typedef struct {
+    simtime_t now, wait;
+    int tid;
+} LongestWait;
+
+static void longest_wait(Thread* t, void* ctx) {
+    LongestWait* w = (LongestWait*)ctx;
+    if (w->now - t->ready_since > w->wait) {
+        w->wait = w->now - t->ready_since;
+        w->tid  = t->tid;
+    }
+}
+
+/* flight recorder at a tick, after dispatch: record the state, check the
+   triggers, write a dump that is due. Ready means dispatchable here:
+   threads a group holds back do not count, like for the wait trigger. */
+static void flight_tick(Sim* s) {
+    Flight* f = s->flight;
+    int nready = s->ready.size + s->sched.nready, busy = 0;
+    for (int c = 0; c < s->cpu.ncores; ++c) {
+        const Thread* t = s->cpu.core[c];
+        if (!t) continue;
+        busy++;
+        flight_record(f, FE_CORE, SIM_TIME, c, t->tid, 0, 0, t->remaining);
+    }
+    flight_record(f, FE_TICK, SIM_TIME, busy, -1, nready, s->waiting.size, s->finished.size);
+
+    char why[96];
+    if (f->cfg.ready_len > 0 && nready > f->cfg.ready_len) {
+        snprintf(why, sizeof(why), "%d threads Ready (> %d)", nready, f->cfg.ready_len);
+        flight_trigger(f, SIM_TIME, why);
+    }
+    /* the gang matrix leaves cores idle beside Ready threads by design */
+    if (f->cfg.idle && !s->ngang && nready > 0 && busy < s->cpu.ncores) {
+        snprintf(why, sizeof(why), "core %d idle with %d threads Ready",
+                 cpu_first_idle(&s->cpu), nready);
+        flight_trigger(f, SIM_TIME, why);
+    }
+    if (f->cfg.wait_ns > 0 && nready > 0) {
+        LongestWait w = { SIM_TIME, 0, -1 };
+        sched_for_each(&s->sched, longest_wait, &w);
+        for (Thread* t = s->ready.front; t; t = t->next) longest_wait(t, &w);
+        if (w.wait > f->cfg.wait_ns) {
+            snprintf(why, sizeof(why), "T%d Ready for %.3f ticks (> %.3f)",
+                     w.tid, to_ticks(w.wait), to_ticks(f->cfg.wait_ns));
+            flight_trigger(f, SIM_TIME, why);
+        }
+    }
+    flight_poll(f, SIM_TIME);
+}
+
+/* ---------- admission control ---------- */
+
+/* a Ready thread admission control may shed: it never ran and no job or
+   gang sibling waits for it */
+static int sheddable(const Thread* t) {
+    return t->start_time < 0 && t->job < 0 && t->gang < 0;
+}
+
+typedef struct {
+    Thread* t;
+    Queue*  q;         // queue holding t, NULL = the policy
+} Oldest;
+
+static void oldest_one(Thread* t, void* ctx) {
+    Oldest* o = (Oldest*)ctx;
+    if (sheddable(t) && (!o->t || t->arrival_time < o->t->arrival_time)) {
+        o->t = t;
+        o->q = NULL;
+    }
+}
+
+static void oldest_in(Queue* q, Oldest* o) {
+    for (Thread* t = q->front; t; t = t->next)
+        if (sheddable(t) && (!o->t || t->arrival_time < o->t->arrival_time)) {
+            o->t = t;
+            o->q = q;
+        }
+}
+
+/* the sheddable Ready thread that arrived first, wherever it waits */
+static Oldest oldest_waiting(Sim* s) {
+    Oldest o = { NULL, NULL };
+    sched_for_each(&s->sched, oldest_one, &o);
+    oldest_in(&s->ready, &o);
+    for (int i = 0; i < s->ngroup; ++i) oldest_in(&s->group[i].held, &o);
+    return o;
+}
+
+static void drop_thread(Sim* s, Thread* t, const char* what) {
+    t->state = ST_DROPPED;
+    q_push(&s->dropped, t);
+    if (s->log) log_admit_event(s->log, SIM_TIME, t->tid, what, admit_policy_name(s->admit->cfg.policy));
+}
+
+/* take o's thread off its queue and drop it; 0 if the policy kept it */
+static int shed(Sim* s, const Oldest* o) {
+    if (o->q ? !q_remove(o->q, o->t) : sched_remove(&s->sched, o->t) != 0) return 0;
+    s->admit->dropped++;
+    drop_thread(s, o->t, "shed");
+    return 1;
+}
+
+/* offer each arrival to the controller; jobs and gangs always get in */
+static void admit_arrivals(Sim* s, Queue* arrived) {
+    Admitter* a = s->admit;
+    while (!q_empty(arrived)) {
+        Thread* t = q_pop(arrived);
+        if (t->job < 0 && t->gang < 0) {
+            int d = admit_arrival(a, t, SIM_TIME, sim_ready_count(s), s->cpu.ncores);
+            if (d == ADMIT_SHED) {
+                Oldest o = oldest_waiting(s);
+                d = o.t && shed(s, &o) ? ADMIT_ACCEPT : ADMIT_REJECT;
+            }
+            if (d == ADMIT_REJECT) {
+                a->rejected++;
+                drop_thread(s, t, "rejected");
+                continue;
+            }
+            admit_accepted(a, t);
+        }
+        q_push(&s->ready, t);
+    }
+}
+
+/* end of tick: shed waiting threads while the controller asks for it */
+static void shed_waiting(Sim* s) {
+    for (;;) {
+        Oldest o = oldest_waiting(s);
+        if (!admit_shed(s->admit, SIM_TIME, o.t ? SIM_TIME - o.t->arrival_time : -1) ||
+            !o.t || !shed(s, &o)) break;
+    }
+}
+
+static void change_cores(Sim* s, int ncores, const char* why) {
+    if (ncores == s->cpu.ncores) return;
+    if (s->log) log_cores_event(s->log, SIM_TIME, s->cpu.ncores, ncores, why);
+    sim_set_cores(s, ncores);
+}
+
+static int busy_cores(const CPU* cpu) {
+    int n = 0;
+    for (int c = 0; c < cpu->ncores; ++c)
+        if (cpu->core[c]) n++;
+    return n;
+}
+
+/* Nothing optional is on: no log, flight recorder, random interrupts,
+   devices, locks, groups, power model, gangs, admission control, paging
+   or core count changes */
+static int lean_run(const Sim* s) {
+    return !s->log && !s->flight && !s->intr.enable_random && !s->ndev && !s->nlock &&
+           !s->ngroup && !s->power && !s->scale && !s->ngang && !s->admit && !s->mem &&
+           s->hotplug_next == s->nhotplug;
+}
+
+/* One tick. Instantiated twice: lean = 1 for runs where lean_run() holds,
+   with every test for the optional features compiled out, and lean = 0. */
+static SIM_ALWAYS_INLINE int step(Sim* s, const int lean) {
+    SIM_TIME = s->now;
+    simtime_t tick_end = s->now + SIM_TICK_NS;
+    simtime_t busy_ns = 0;
+    int at_tick = 1;
+
+    /* hotplug events due by this tick boundary */
+    while (!lean && s->hotplug_next < s->nhotplug && s->hotplug[s->hotplug_next].at <= SIM_TIME)
+        change_cores(s, s->hotplug[s->hotplug_next++].ncores, "hotplug");
+
+    /* one timer tick, split at every event inside it */
+    for (;;) {
+        // add processes that have arrived by now to ready qeue
+        Queue arrived;
+        q_init(&arrived);
+        simtime_t next_arrival = workload_admit_tick(&s->workload, !lean && s->admit ? &arrived : &s->ready,
+                                                     SIM_TIME);
+        if (!lean && s->admit) admit_arrivals(s, &arrived);
+        // finish device requests (sets unblocked_at) and start queued ones
+        for (int d = 0; !lean && d < s->ndev; ++d) device_advance(&s->dev[d], SIM_TIME, &s->rng);
+        // move threads from waiting queue to ready queue if block_time has been met
+        wake_threads(s);
+
+        if (!lean && at_tick) random_interrupts(s);  // simulate random IO interrupts
+
+        // Schedule with selected policy (throttled groups sit out)
+        if (!lean && s->ngroup) groups_prepare(s, at_tick);
+        sched_dispatch(&s->sched, &s->cpu, &s->ready);
+        if (!lean && s->ngroup) groups_fill(s);
+        if (!lean && s->power) power_dispatched(s->power, &s->cpu);
+
+        /* log state*/
+        if (!lean && at_tick) sim_log_snapshot(s);
+        if (!lean && at_tick && s->flight) flight_tick(s);
+        at_tick = 0;
+
+        /* run all cores up to the next event or the end of the tick */
+        simtime_t next = tick_end;
+        if (next_arrival < next) next = next_arrival;
+        if (s->next_wake < next) next = s->next_wake;
+        cpu_load(&s->cpu);
+        simtime_t ev = cpu_next_event(&s->cpu);
+        if (ev < next) next = ev;
+        for (int d = 0; !lean && d < s->ndev; ++d) {
+            ev = device_next_event(&s->dev[d]);
+            if (ev < next) next = ev;
+        }
+        if (!lean && s->ngroup) {
+            ev = group_next_event(s->group, s->ngroup, &s->cpu, SIM_TIME);
+            if (ev < next) next = ev;
+            group_charge(s->group, s->ngroup, &s->cpu, SIM_TIME, next - SIM_TIME);
+        }
+        if (!lean && s->power) power_account(s->power, &s->cpu, next - SIM_TIME);
+        if (!lean && s->scale) busy_ns += busy_cores(&s->cpu) * (next - SIM_TIME);
+        if (!lean && s->ngang && sim_ready_count(s) > 0)
+            s->idle_ready_ns += (s->cpu.ncores - busy_cores(&s->cpu)) * (next - SIM_TIME);
+        cpu_step(&s->cpu, next - SIM_TIME);
+
+        /* lock points and phase ends, then completed threads move to finished */
+        collect_stops(s, lean);
+        collect_completions(s);
+
+        if (SIM_TIME >= tick_end) break;
+    }
+
+    /* priority aging: Ready threads belong to the policy, which ages them
+       in its tick; Waiting ones only matter to a policy that orders by
+       priority and to lock protocols choosing a waiter */
+    if ((SIM_TIME / SIM_TICK_NS) % s->age_every == 0) {
+        if (s->sched.ages || (!lean && s->nlock)) decay_priority(&s->waiting, NULL);
+        sched_tick(&s->sched);
+    }
+    if (!lean && s->power) power_tick(s->power, &s->cpu);   // governor
+
+    s->core_ns += (simtime_t)s->cpu.ncores * SIM_TICK_NS;
+    if (!lean && s->admit) shed_waiting(s);
+    if (!lean && s->scale) {
+        int n = autoscale_tick(s->scale, SIM_TIME, s->cpu.ncores, sim_ready_count(s), busy_ns);
+        if (n) change_cores(s, n, "autoscale");
+    }
+
+    s->now = SIM_TIME;
+    return sim_done(s);
+}
+
+static int step_lean(Sim* s) { return step(s, 1); }
+static int step_full(Sim* s) { return step(s, 0); }
+
+int sim_step(Sim* s) {
+    return lean_run(s) ? step_lean(s) : step_full(s);
+}
+
+void sim_run(Sim* s, simtime_t stop_at) {
+    while (stop_at < 0 || s->now < stop_at) {
+        if (sim_step(s)) break;
+    }
+}
+
+int sim_set_policy(Sim* s, DispatchAlgo algo, simtime_t quantum, const char* path) {
+    Sched next;
+    if (sched_open(&next, algo, quantum, path) != 0) return -1;
+
+    /* the old policy's threads go first: they became Ready earlier */
+    Queue ready;
+    q_init(&ready);
+    sched_drain(&s->sched, &ready);
+    while (!q_empty(&s->ready)) q_push(&ready, q_pop(&s->ready));
+    s->ready = ready;
+
+    sched_close(&s->sched);
+    s->sched = next;
+    s->algo = algo;
+    s->rr_quantum = quantum;
+    return 0;
+}
+
+void sim_add_device(Sim* s, const DeviceConfig* cfg) {
+    s->dev = (Device*)realloc(s->dev, sizeof(Device) * (s->ndev + 1));
+    device_init(&s->dev[s->ndev], cfg);
+    s->ndev++;
+}
+
+void sim_enable_power(Sim* s, const PowerConfig* cfg) {
+    if (!s->power) s->power = (Power*)calloc(1, sizeof(Power));
+    else           power_free(s->power);
+    power_init(s->power, cfg, &s->cpu);
+}
+
+void sim_add_lock(Sim* s, const LockConfig* cfg) {
+    s->lock = (Lock*)realloc(s->lock, sizeof(Lock) * (s->nlock + 1));
+    lock_init(&s->lock[s->nlock], cfg);
+    s->nlock++;
+}
+
+int sim_add_group(Sim* s, const GroupConfig* cfg) {
+    int parent = -1;
+    if (cfg->parent[0] && (parent = group_find(s->group, s->ngroup, cfg->parent)) < 0) return -1;
+    if (group_find(s->group, s->ngroup, cfg->name) >= 0) return -1;
+    s->group = (Group*)realloc(s->group, sizeof(Group) * (s->ngroup + 1));
+    group_init(&s->group[s->ngroup], cfg, parent);
+    if (parent >= 0) s->group[parent].leaf = 0;
+    return s->ngroup++;
+}
+
+int sim_add_job(Sim* s, const JobConfig* cfg, int instance, unsigned long long seed) {
+    int tid = 0;
+    for (const Thread* t = s->workload.front; t; t = t->next)
+        if (t->tid > tid) tid = t->tid;
+    s->job = (Job*)realloc(s->job, sizeof(Job) * (s->njob + 1));
+    job_build(&s->job[s->njob], cfg, instance, s->njob, tid + 1, seed, &s->workload);
+    return s->njob++;
+}
+
+int sim_add_gang(Sim* s, const GangConfig* cfg, int instance, unsigned long long seed) {
+    int tid = 0;
+    for (const Thread* t = s->workload.front; t; t = t->next)
+        if (t->tid > tid) tid = t->tid;
+    s->gang = (Gang*)realloc(s->gang, sizeof(Gang) * (s->ngang + 1));
+    gang_build(&s->gang[s->ngang], cfg, instance, s->ngang, tid + 1, seed, &s->workload);
+    return s->ngang++;
+}
+
+void sim_add_hotplug(Sim* s, const HotplugEvent* ev) {
+    s->hotplug = (HotplugEvent*)realloc(s->hotplug, sizeof(HotplugEvent) * (s->nhotplug + 1));
+    int i = s->nhotplug++;
+    for (; i > s->hotplug_next && s->hotplug[i - 1].at > ev->at; --i) s->hotplug[i] = s->hotplug[i - 1];
+    s->hotplug[i] = *ev;
+}
+
+void sim_enable_autoscale(Sim* s, const AutoscaleConfig* cfg) {
+    if (!s->scale) s->scale = (Autoscaler*)malloc(sizeof(Autoscaler));
+    autoscale_init(s->scale, cfg, s->cpu.ncores);
+}
+
+void sim_enable_admit(Sim* s, const AdmitConfig* cfg) {
+    if (!s->admit) s->admit = (Admitter*)malloc(sizeof(Admitter));
+    admit_init(s->admit, cfg);
+}
+
+void sim_enable_mem(Sim* s, const MemConfig* cfg, unsigned long long seed) {
+    if (!s->mem) s->mem = (Mem*)malloc(sizeof(Mem));
+    else         mem_free(s->mem);
+    mem_init(s->mem, cfg, seed);
+}
+
+void sim_set_cores(Sim* s, int ncores) {
+    if (ncores < 1) ncores = 1;
+    CPU* cpu = &s->cpu;
+    int old = cpu->ncores;
+    if (ncores == old) return;
+
+    /* threads on cores that go away are preempted back to Ready */
+    for (int c = ncores; c < old; ++c) {
+        Thread* t = cpu->core[c];
+        if (t) t->quanta_rem = 0;
+        preempt_to_ready(cpu, c, &s->ready);
+        if (cpu->run_trace) free(cpu->run_trace[c]);
+    }
+
+    cpu->core     = (Thread**)realloc(cpu->core, sizeof(Thread*) * ncores);
+    cpu->cs_left  = (simtime_t*)realloc(cpu->cs_left, sizeof(simtime_t) * ncores);
+    cpu->last_tid = (int*)realloc(cpu->last_tid, sizeof(int) * ncores);
+    if (cpu->run_trace) cpu->run_trace = (int**)realloc(cpu->run_trace, sizeof(int*) * ncores);
+    for (int c = old; c < ncores; ++c) {
+        cpu->core[c]     = NULL;
+        cpu->cs_left[c]  = 0;
+        cpu->last_tid[c] = -1;
+        if (!cpu->run_trace) continue;
+        cpu->run_trace[c] = (int*)malloc(sizeof(int) * cpu->trace_len);
+        for (int t = 0; t < cpu->trace_len; ++t) cpu->run_trace[c][t] = -1;
+    }
+    cpu_resize_load(cpu, old, ncores);
+    cpu->ncores = ncores;
+    if (s->power) power_resize(s->power, cpu);
+}
+
+static void free_queue(Queue* q) {
+    while (!q_empty(q)) thread_free(q_pop(q));
+}
+
+void sim_free(Sim* s) {
+    sched_drain(&s->sched, &s->ready);
+    sched_close(&s->sched);
+    free_queue(&s->workload);
+    free_queue(&s->ready);
+    free_queue(&s->waiting);
+    free_queue(&s->finished);
+    free_queue(&s->dropped);
+    for (int i = 0; i < s->ngroup; ++i) free_queue(&s->group[i].held);
+    for (int c = 0; c < s->cpu.ncores; ++c) thread_free(cpu_unbind_core(&s->cpu, c));
+    cpu_free(&s->cpu);
+    for (int d = 0; d < s->ndev; ++d) device_free(&s->dev[d]);   // threads went with waiting
+    free(s->dev);
+    s->dev  = NULL;
+    s->ndev = 0;
+    for (int l = 0; l < s->nlock; ++l) lock_free(&s->lock[l]);
+    free(s->lock);
+    s->lock  = NULL;
+    s->nlock = 0;
+    if (s->power) power_free(s->power);
+    free(s->power);
+    s->power = NULL;
+    for (int i = 0; i < s->ngroup; ++i) group_free(&s->group[i]);
+    free(s->group);
+    s->group  = NULL;
+    s->ngroup = 0;
+    free(s->hotplug);
+    s->hotplug = NULL;
+    s->nhotplug = s->hotplug_next = 0;
+    free(s->scale);
+    s->scale = NULL;
+    for (int j = 0; j < s->njob; ++j) job_free(&s->job[j]);
+    free(s->job);
+    s->job  = NULL;
+    s->njob = 0;
+    for (int g = 0; g < s->ngang; ++g) gang_free(&s->gang[g]);
+    free(s->gang);
+    s->gang  = NULL;
+    s->ngang = 0;
+    free(s->admit);
+    s->admit = NULL;
+    if (s->mem) mem_free(s->mem);
+    free(s->mem);
+    s->mem = NULL;
+}
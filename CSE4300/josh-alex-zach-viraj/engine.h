@@ -0,0 +1,140 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "sim.h"
+#include "sched.h"
+#include "device.h"
+#include "lock.h"
+#include "power.h"
+#include "flight.h"
+#include "cgroup.h"
+#include "autoscale.h"
+#include "dag.h"
+#include "gang.h"
+#include "admit.h"
+#include "mem.h"
+
+/*
+  Simulation engine: the main tick loop pulled out of main() so a run can be
+  paused, checkpointed, restored and driven programmatically.
+
+  Everything one tick reads or writes lives in Sim; the global SIM_TIME is
+  loaded from Sim.now at the top of each step and stored back at the end.
+*/
+
+typedef struct {
+    Queue workload;        // not yet arrived
+    Queue ready;           // became Ready, not yet handed to the policy
+    Queue waiting;         // blocked on I/O until unblocked_at (or a device or lock)
+    Queue finished;
+    Queue dropped;         // rejected or shed by admission control
+    CPU   cpu;
+
+    DispatchAlgo algo;
+    simtime_t rr_quantum;  // ns, time slice (RR and slice-based external policies)
+    int   age_every;       // ticks between priority aging steps (decay and the policy's tick)
+    Sched sched;           // the policy instance; holds the Ready threads
+    InterruptConfig intr;
+    Rng   rng;             // drives random interrupts
+    Device* dev;           // I/O devices; none = I/O is a plain timed sleep
+    int   ndev;
+    Lock* lock;            // shared locks used by the threads' lock scripts
+    int   nlock;
+    Power* power;          // DVFS and energy model, NULL = off
+    Group* group;          // CPU bandwidth groups (threads with group >= 0)
+    int   ngroup;
+    HotplugEvent* hotplug; // core count changes, by time
+    int   nhotplug;
+    int   hotplug_next;    // first event not applied yet
+    Autoscaler* scale;     // load-driven core count, NULL = fixed
+    Job*  job;             // DAG jobs (threads with job >= 0)
+    int   njob;
+    Gang* gang;            // gangs (threads with gang >= 0)
+    int   ngang;
+    Admitter* admit;       // admission control, NULL = admit every arrival
+    Mem*  mem;             // paging model, NULL = threads need no memory
+    simtime_t core_ns;     // core count integrated over time
+    simtime_t idle_ready_ns; // core time idle while threads were Ready (with gangs)
+
+    simtime_t now;         // clock of this simulation (ns, on a tick boundary)
+    simtime_t next_wake;   // earliest pending unblocked_at in waiting
+    Log*  log;             // per-tick snapshots; NULL disables them
+    Flight* flight;        // flight recorder (not owned); NULL = off
+} Sim;
+
+/* Set up empty queues and an idle CPU with a run trace of trace_len ticks. */
+void sim_init(Sim* s, DispatchAlgo algo, simtime_t rr_quantum, int ncores, int trace_len);
+
+/* Switch to built-in policy algo, or the shared object at path if path is
+   non-empty. Ready threads move from the old policy to the new one in the
+   order the old one would have run them. Returns 0 on success; on error
+   the current policy is kept. */
+int  sim_set_policy(Sim* s, DispatchAlgo algo, simtime_t quantum, const char* path);
+
+/* Ready threads: not yet enqueued, those the policy holds and those held
+   back by their group */
+int  sim_ready_count(const Sim* s);
+
+/* Log a snapshot of the queues and cores at SIM_TIME (needs s->log). */
+void sim_log_snapshot(const Sim* s);
+
+/* Run one tick (SIM_TICK_NS), dispatching again at every event inside it.
+   Returns 1 once no work is left anywhere, else 0. */
+int  sim_step(Sim* s);
+
+/* Add an I/O device. Once any exist, random I/O interrupts queue a request
+   on one (picked by weight) instead of sleeping for io_min..io_max. */
+void sim_add_device(Sim* s, const DeviceConfig* cfg);
+
+/* Turn on the DVFS and energy model (see power.h). */
+void sim_enable_power(Sim* s, const PowerConfig* cfg);
+
+/* Add a shared lock (id = nlock before the call). Threads use it once
+   lock_assign() gave them lock scripts. */
+void sim_add_lock(Sim* s, const LockConfig* cfg);
+
+/* Add a group (see cgroup.h) under cfg->parent, which must already exist
+   ("" = top level). Returns its index, or -1 if the parent is unknown or
+   the name is taken. Threads join groups through group_assign(). */
+int  sim_add_group(Sim* s, const GroupConfig* cfg);
+
+/* Add instance instance of DAG job cfg (see dag.h) to the workload, with
+   tids after the largest one there; call before the run. Returns its
+   index. */
+int  sim_add_job(Sim* s, const JobConfig* cfg, int instance, unsigned long long seed);
+
+/* Add instance instance of gang cfg (see gang.h) to the workload, the
+   same way. Returns its index. */
+int  sim_add_gang(Sim* s, const GangConfig* cfg, int instance, unsigned long long seed);
+
+/* Schedule a core count change at ev->at (see autoscale.h); events at
+   the same time apply in the order they were added. */
+void sim_add_hotplug(Sim* s, const HotplugEvent* ev);
+
+/* Let the autoscaler drive the core count (replaces any earlier one). */
+void sim_enable_autoscale(Sim* s, const AutoscaleConfig* cfg);
+
+/* Put arrivals through admission control (replaces any earlier one). */
+void sim_enable_admit(Sim* s, const AdmitConfig* cfg);
+
+/* Turn on the paging model (see mem.h); threads fault once mem_assign()
+   gave them working sets. */
+void sim_enable_mem(Sim* s, const MemConfig* cfg, unsigned long long seed);
+
+/* Step until done, or until now reaches stop_at (stop_at < 0 = never). */
+void sim_run(Sim* s, simtime_t stop_at);
+
+/* 1 if workload, ready (and the policy), waiting and all cores are empty
+   (dropped threads are done) */
+int  sim_done(const Sim* s);
+
+/* Change core count mid-run. Threads on removed cores go back to Ready
+   and the dispatcher places them on the remaining ones; kept cores keep
+   their thread, switch state and run trace, removed cores' trace is
+   dropped and added cores start idle. */
+void sim_set_cores(Sim* s, int ncores);
+
+/* Free every thread still owned by the simulation, and the CPU. */
+void sim_free(Sim* s);
+
+#endif /* ENGINE_H */
@@ -0,0 +1,128 @@
+#include "flight.h"
+#include "util.h"
+#include "aout.h"
+
+int flight_parse(const char* spec, FlightConfig* cfg) {
+    char buf[FLIGHT_PATH_LEN + 128], *opts, *k, *v;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->size      = 4096;
+    cfg->max_dumps = 10;
+    snprintf(cfg->path, sizeof(cfg->path), "flight_dump.txt");
+    if (spec_split(spec, buf, sizeof(buf), 0, NULL, &opts) != 0) return -1;
+
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) return -1;
+        if (strcmp(k, "size") == 0) {
+            cfg->size = atoi(v);
+            if (cfg->size < 1) return -1;
+        } else if (strcmp(k, "wait") == 0) {
+            if (parse_duration(v, &cfg->wait_ns) != 0 || cfg->wait_ns < 1) return -1;
+        } else if (strcmp(k, "ready") == 0) {
+            cfg->ready_len = atoi(v);
+            if (cfg->ready_len < 1) return -1;
+        } else if (strcmp(k, "idle") == 0) {
+            cfg->idle = atoi(v) != 0;
+        } else if (strcmp(k, "after") == 0) {
+            cfg->after_ticks = atoi(v);
+            if (cfg->after_ticks < 0) return -1;
+        } else if (strcmp(k, "max") == 0) {
+            cfg->max_dumps = atoi(v);
+            if (cfg->max_dumps < 1) return -1;
+        } else if (strcmp(k, "out") == 0) {
+            if (v[0] == '\0' || strlen(v) >= sizeof(cfg->path)) return -1;
+            snprintf(cfg->path, sizeof(cfg->path), "%s", v);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int flight_init(Flight* f, const FlightConfig* cfg) {
+    memset(f, 0, sizeof(*f));
+    f->cfg = *cfg;
+    f->out = aout_open(cfg->path, 0);
+    if (!f->out) return -1;
+    f->ring      = (FlightEvent*)malloc(sizeof(FlightEvent) * cfg->size);
+    f->last_dump = -1;
+    f->due       = -1;
+    return 0;
+}
+
+void flight_free(Flight* f) {
+    if (f->out) fclose(f->out);
+    free(f->ring);
+    f->out  = NULL;
+    f->ring = NULL;
+}
+
+static int has_triggers(const FlightConfig* cfg) {
+    return cfg->wait_ns > 0 || cfg->ready_len > 0 || cfg->idle;
+}
+
+static void print_event(FILE* out, const FlightEvent* e) {
+    fprintf(out, "t=%.3f ", to_ticks(e->t));
+    switch ((FlightKind)e->kind) {
+        case FE_TICK:
+            fprintf(out, "tick    ready=%d waiting=%d busy=%d finished=%lld\n",
+                    e->a, e->b, e->core, (long long)e->x);
+            break;
+        case FE_CORE:
+            fprintf(out, "core %-3d T%d remaining=%.3f\n", e->core, e->tid, to_ticks(e->x));
+            break;
+        case FE_IO:
+            fprintf(out, "io      T%d off core %d until t=%.3f\n", e->tid, e->core, to_ticks(e->x));
+            break;
+        case FE_DEV:
+            fprintf(out, "device  T%d off core %d onto device %d (queue %d)\n",
+                    e->tid, e->core, e->a, e->b);
+            break;
+        case FE_LOCK:
+            fprintf(out, "lock    T%d off core %d blocked on lock %d (owner T%d)\n",
+                    e->tid, e->core, e->a, e->b);
+            break;
+        case FE_FINISH:
+            fprintf(out, "finish  T%d on core %d turnaround=%.3f\n", e->tid, e->core, to_ticks(e->x));
+            break;
+        case FE_FAULT:
+            fprintf(out, "fault   T%d off core %d until t=%.3f\n", e->tid, e->core, to_ticks(e->x));
+            break;
+    }
+}
+
+/* the ring, oldest event first */
+static void dump(Flight* f, simtime_t now, const char* reason) {
+    long n = f->count < f->cfg.size ? f->count : f->cfg.size;
+    long first = f->count - n;
+    f->dumps++;
+    fprintf(f->out, "# Flight dump %d at t=%.3f: %s\n", f->dumps, to_ticks(now), reason);
+    if (n > 0)
+        fprintf(f->out, "# %ld events from t=%.3f (%ld dropped before)\n",
+                n, to_ticks(f->ring[first % f->cfg.size].t), first);
+    for (long i = first; i < f->count; ++i) print_event(f->out, &f->ring[i % f->cfg.size]);
+    fprintf(f->out, "\n");
+    f->last_dump = f->count;
+    f->due = -1;
+}
+
+int flight_trigger(Flight* f, simtime_t now, const char* reason) {
+    f->triggers++;
+    if (f->due >= 0 || f->dumps >= f->cfg.max_dumps) return 0;
+    /* a dump shows a full ring of its own, not the tail of the last one */
+    if (f->last_dump >= 0 && f->count - f->last_dump < f->cfg.size) return 0;
+    snprintf(f->reason, sizeof(f->reason), "%s at t=%.3f", reason, to_ticks(now));
+    f->due = now + (simtime_t)f->cfg.after_ticks * SIM_TICK_NS;
+    return 1;
+}
+
+void flight_poll(Flight* f, simtime_t now) {
+    if (f->due >= 0 && now >= f->due) dump(f, now, f->reason);
+}
+
+void flight_finish(Flight* f, simtime_t now, FILE* out) {
+    if (f->due >= 0) dump(f, now, f->reason);
+    else if (!has_triggers(&f->cfg)) dump(f, now, "end of run");
+    fflush(f->out);
+    fprintf(out, "# Flight recorder: %ld events, %ld triggers, %d dumps to %s\n\n",
+            f->count, f->triggers, f->dumps, f->cfg.path);
+}
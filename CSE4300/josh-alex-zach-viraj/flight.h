@@ -0,0 +1,109 @@
+#ifndef FLIGHT_H
+#define FLIGHT_H
+
+#include "sim.h"
+
+/*
+  Flight recorder: the last N events of a run kept in a fixed-size ring in
+  memory, written out only when a trigger fires.
+
+  Recording is a struct copy per event (no formatting, no I/O), so it can
+  stay on for runs far too long to log every tick. The engine records a
+  summary of every tick plus the thread on each busy core, and each I/O,
+  device, lock and completion event as it happens.
+
+  Triggers, checked at every tick after dispatch:
+    wait   a Ready thread has waited longer than wait_ns
+    ready  more than ready_len threads are Ready
+    idle   a core is idle while threads are Ready (off with gangs, whose
+           matrix leaves cores idle on purpose)
+  Ready means dispatchable: threads a group's quota holds back count for
+  none of them.
+  A trigger arms a dump that is written after_ticks later, so the ring
+  holds context from both sides of the event. While a dump is pending, or
+  until the ring has refilled since the last one, further triggers are
+  only counted; at most max_dumps are written. With no trigger set the
+  ring is dumped once at the end of the run.
+*/
+
+#define FLIGHT_PATH_LEN 256
+
+typedef enum {
+    FE_TICK = 0,   // a = Ready (dispatchable), b = Waiting, core = busy cores, x = finished
+    FE_CORE,       // thread tid on core at the tick, x = remaining
+    FE_IO,         // tid blocked for random I/O on core, x = unblock time
+    FE_DEV,        // tid queued on device a (index) from core, b = queue length
+    FE_LOCK,       // tid blocked on lock a (index) from core, b = owner's tid
+    FE_FINISH,     // tid finished on core, x = turnaround
+    FE_FAULT       // tid page faulted on core, x = time the page is in
+} FlightKind;
+
+typedef struct {
+    simtime_t t;
+    simtime_t x;
+    int       kind;
+    int       core;
+    int       tid;
+    int       a, b;
+} FlightEvent;
+
+/* Static settings. */
+typedef struct {
+    int       size;          // ring capacity in events
+    simtime_t wait_ns;       // 0 = off
+    int       ready_len;     // 0 = off
+    int       idle;          // 1 = idle-core-with-Ready trigger on
+    int       after_ticks;   // ticks recorded after a trigger before the dump
+    int       max_dumps;
+    char      path[FLIGHT_PATH_LEN];
+} FlightConfig;
+
+typedef struct {
+    FlightConfig cfg;
+    FlightEvent* ring;
+    long         count;        // events recorded so far (ring index = count % size)
+    long         last_dump;    // count at the last dump, -1 = none yet
+    simtime_t    due;          // time of the pending dump, -1 = none
+    char         reason[128];  // what armed it
+    int          dumps;
+    long         triggers;     // every trigger that fired, dumped or not
+    FILE*        out;
+} Flight;
+
+/* Parse "key=val,..." with keys size=N, wait=DUR, ready=N, idle=0|1,
+   after=TICKS, max=N, out=PATH. An empty spec keeps the defaults (4096
+   events, no triggers, 10 dumps, flight_dump.txt).
+   Returns 0 on success, -1 on error. */
+int  flight_parse(const char* spec, FlightConfig* cfg);
+
+/* Allocate the ring and open cfg->path. Returns 0, or -1 if the file
+   cannot be created. */
+int  flight_init(Flight* f, const FlightConfig* cfg);
+
+/* Close the dump file and release the ring. */
+void flight_free(Flight* f);
+
+static inline void flight_record(Flight* f, FlightKind kind, simtime_t t, int core, int tid,
+                                 int a, int b, simtime_t x) {
+    FlightEvent* e = &f->ring[f->count++ % f->cfg.size];
+    e->t = t;
+    e->x = x;
+    e->kind = kind;
+    e->core = core;
+    e->tid = tid;
+    e->a = a;
+    e->b = b;
+}
+
+/* A trigger fired at now (reason is printed in the dump header). Returns
+   1 if it armed a dump, 0 if it was only counted. */
+int  flight_trigger(Flight* f, simtime_t now, const char* reason);
+
+/* Write the pending dump once its time has come. */
+void flight_poll(Flight* f, simtime_t now);
+
+/* End of the run: write a pending dump (or the whole ring if no trigger
+   is set), then a one-line summary to out. */
+void flight_finish(Flight* f, simtime_t now, FILE* out);
+
+#endif /* FLIGHT_H */
@@ -0,0 +1,134 @@
+#include "gang.h"
+#include "util.h"
+
+int gang_parse(const char* spec, GangConfig* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->width  = 4;
+    cfg->stages = 8;
+    cfg->work   = 2 * SIM_TICK_NS;
+    cfg->jitter = 20;
+    cfg->count  = 1;
+    return job_spec_parse(spec, cfg, NULL, NULL);
+}
+
+void gang_alloc(Gang* g, const GangConfig* cfg, int instance) {
+    memset(g, 0, sizeof(*g));
+    g->cfg      = *cfg;
+    g->instance = instance;
+    g->arrival  = cfg->arrival + instance * cfg->every;
+    g->member   = (Thread**)calloc(cfg->width, sizeof(Thread*));
+    g->since    = (simtime_t*)malloc(sizeof(simtime_t) * cfg->width);
+    for (int k = 0; k < cfg->width; ++k) g->since[k] = -1;
+    g->finish   = -1;
+}
+
+void gang_free(Gang* g) {
+    free(g->member);
+    free(g->since);
+    g->member = NULL;
+    g->since  = NULL;
+}
+
+void gang_build(Gang* g, const GangConfig* cfg, int instance, int gang, int first_tid,
+                unsigned long long seed, Queue* workload) {
+    Rng r;
+    rng_seed(&r, seed * 1000003ULL + (unsigned long long)instance);
+    gang_alloc(g, cfg, instance);
+
+    int w = cfg->width, st = cfg->stages;
+    Phase* ph = (Phase*)malloc(sizeof(Phase) * w * st);
+    for (int s = 0; s < st; ++s) {
+        simtime_t slowest = 0;
+        for (int k = 0; k < w; ++k) {
+            simtime_t c = cfg->work * (100 + rng_range(&r, -cfg->jitter, cfg->jitter)) / 100;
+            if (c < 1) c = 1;
+            ph[k * st + s] = (Phase){ c, 0 };
+            if (c > slowest) slowest = c;
+            g->work += c;
+        }
+        g->ideal += slowest;
+    }
+
+    for (int k = 0; k < w; ++k) {
+        workload_add_phases(workload, first_tid + k, g->arrival, &ph[k * st], st, cfg->priority);
+        Thread* t = workload->rear;
+        t->gang      = gang;
+        t->gang_rank = k;
+        t->gang_size = w;
+        g->member[k] = t;
+    }
+    free(ph);
+}
+
+int gang_arrive(Gang* gangs, Thread* t, simtime_t now) {
+    Gang* g = &gangs[t->gang];
+    if (g->arrived++ == 0) g->first_at = now;
+    if (g->arrived < g->cfg.width) {
+        g->since[t->gang_rank] = now;
+        return -1;
+    }
+    /* the last one in opens the barrier */
+    int released = 0;
+    for (int k = 0; k < g->cfg.width; ++k) {
+        if (g->since[k] < 0) continue;
+        g->member[k]->unblocked_at = now;
+        g->wait_ns += now - g->since[k];
+        g->since[k] = -1;
+        released++;
+    }
+    g->skew_ns += now - g->first_at;
+    g->barriers++;
+    g->arrived = 0;
+    return released;
+}
+
+void gang_member_done(Gang* gangs, const Thread* t, simtime_t now) {
+    Gang* g = &gangs[t->gang];
+    if (++g->done == g->cfg.width) g->finish = now;
+}
+
+void gang_report(const Gang* gangs, int n, const GangMatrixStats* m,
+                 simtime_t idle_ready_ns, simtime_t core_ns, FILE* out) {
+    if (n < 1) return;
+    fprintf(out, "# Gangs (times in ticks)\n");
+    fprintf(out, "%-16s %6s %6s %9s %10s %9s %8s %9s %12s\n",
+            "GANG", "WIDTH", "STAGES", "ARRIVAL", "MAKESPAN", "IDEAL", "SLOWDOWN",
+            "SKEW", "BARRIER_WAIT");
+    int nfin = 0;
+    double sum_slow = 0, worst = 0;
+    for (int i = 0; i < n; ++i) {
+        const Gang* g = &gangs[i];
+        char name[JOB_NAME_LEN + 12];
+        if (g->cfg.count > 1) snprintf(name, sizeof(name), "%s#%d", g->cfg.name, g->instance);
+        else                  snprintf(name, sizeof(name), "%s", g->cfg.name);
+        double skew = g->barriers > 0 ? to_ticks(g->skew_ns) / g->barriers : 0.0;
+        if (g->finish < 0) {
+            fprintf(out, "%-16s %6d %6d %9.3f %10s %9.3f %8s %9.3f %12.3f\n",
+                    name, g->cfg.width, g->cfg.stages, to_ticks(g->arrival), "-",
+                    to_ticks(g->ideal), "-", skew, to_ticks(g->wait_ns));
+            continue;
+        }
+        simtime_t span = g->finish - g->arrival;
+        double slow = g->ideal > 0 ? (double)span / g->ideal : 0.0;
+        fprintf(out, "%-16s %6d %6d %9.3f %10.3f %9.3f %8.2f %9.3f %12.3f\n",
+                name, g->cfg.width, g->cfg.stages, to_ticks(g->arrival), to_ticks(span),
+                to_ticks(g->ideal), slow, skew, to_ticks(g->wait_ns));
+        nfin++;
+        sum_slow += slow;
+        if (slow > worst) worst = slow;
+    }
+    fprintf(out, "Finished gangs: %d of %d", nfin, n);
+    if (nfin > 0)
+        fprintf(out, "; average slowdown %.2f, worst %.2f", sum_slow / nfin, worst);
+    fprintf(out, "\nCores idle while threads were Ready: %.1f%% of core time\n",
+            core_ns > 0 ? 100.0 * idle_ready_ns / core_ns : 0.0);
+    if (m && m->slots > 0)
+        fprintf(out, "Ousterhout matrix: %ld slots, %.2f rows on average, %.1f%% of the "
+                     "cells in the row run unallocated, %ld backfills\n",
+                m->slots, (double)m->rows / m->slots,
+                m->cols > 0 ? 100.0 * m->free_cols / m->cols : 0.0, m->backfills);
+    fprintf(out, "(IDEAL = sum over stages of the slowest member's work, every member on\n"
+                 " its own core at once; SLOWDOWN = makespan / IDEAL; SKEW = mean time from\n"
+                 " the first to the last member at a barrier; BARRIER_WAIT = member time\n"
+                 " blocked at barriers)\n\n");
+}
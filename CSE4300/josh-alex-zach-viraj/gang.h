@@ -0,0 +1,85 @@
+#ifndef GANG_H
+#define GANG_H
+
+#include "sim.h"
+#include "dag.h"
+
+/*
+  Gangs: tightly synchronized parallel jobs.
+
+  A gang is width threads (Thread.gang >= 0, Thread.gang_rank 0..width-1)
+  that arrive together and compute in stages separated by barriers: each
+  member's CPU time is a script of stages phases without I/O, and at the
+  end of every phase but the last it waits until all members have got
+  there. The member that arrives last releases the others (their
+  unblocked_at becomes that moment) and carries on; the rest block in the
+  waiting queue with unblocked_at = SIMTIME_NEVER.
+
+  A gang's ideal makespan is the sum over stages of its slowest member's
+  work: what it takes with every member on its own core at once. Any
+  scheduler that runs members at different times stretches the stages,
+  and the members that got there first sit at the barrier. The gang
+  policies (DISP_GANG, see dispatch.h) co-schedule them instead.
+*/
+
+/* Static settings: the fields a DAG job has too (see dag.h). */
+typedef JobSpec GangConfig;
+
+typedef struct {
+    GangConfig cfg;
+    int        instance;     // 0..cfg.count-1
+    simtime_t  arrival;
+    Thread**   member;       // by rank (the threads live in the sim's queues)
+    simtime_t* since;        // when each member blocked at the barrier, -1 = not there
+    int        arrived;      // members at the current barrier
+    simtime_t  first_at;     // first arrival at the current barrier
+    int        barriers;     // barriers passed
+    simtime_t  ideal;        // sum over stages of the slowest member's work
+    simtime_t  work;         // total CPU time of the members
+    simtime_t  skew_ns;      // over barriers passed: last arrival - first arrival
+    simtime_t  wait_ns;      // member time blocked at barriers
+    int        done;         // finished members
+    simtime_t  finish;       // when the last member finished, -1 = not yet
+} Gang;
+
+/* Counters of the Ousterhout matrix kept by the gang policies */
+typedef struct {
+    long slots;              // time slots started
+    long rows;               // sum over slots of the matrix rows
+    long cols;               // sum over slots of the columns (cores)
+    long free_cols;          // sum over slots of unallocated cells in the row run
+    long backfills;          // threads run in another row's slot
+} GangMatrixStats;
+
+/* Parse "name[:key=val,...]" with keys width=N, stages=N, work=DUR,
+   jitter=PCT, at=DUR, prio=N, count=N, every=DUR (default width=4,
+   stages=8, work=2 ticks, jitter=20, at=0, prio=0, count=1, every=0).
+   Returns 0 on success, -1 on error. */
+int  gang_parse(const char* spec, GangConfig* cfg);
+
+/* Instance instance of cfg: add its members to workload as threads
+   first_tid, first_tid + 1, ... with stage work drawn by a generator
+   seeded from seed and instance. gang is the index the Gang will have
+   (Thread.gang). */
+void gang_build(Gang* g, const GangConfig* cfg, int instance, int gang, int first_tid,
+                unsigned long long seed, Queue* workload);
+
+/* Set up g's bookkeeping (members NULL), as gang_build and checkpoint
+   restore do. */
+void gang_alloc(Gang* g, const GangConfig* cfg, int instance);
+void gang_free(Gang* g);   // the arrays, not the threads
+
+/* Member t reached a barrier at now. Returns -1 if it must wait, else
+   the number of waiting members it released. */
+int  gang_arrive(Gang* gangs, Thread* t, simtime_t now);
+
+/* Member t finished at now. */
+void gang_member_done(Gang* gangs, const Thread* t, simtime_t now);
+
+/* Makespan against the ideal, barrier skew and waits of each gang, then
+   the matrix counters (m NULL if no gang policy ran) and the core time
+   left idle while threads were Ready, out of core_ns. */
+void gang_report(const Gang* gangs, int n, const GangMatrixStats* m,
+                 simtime_t idle_ready_ns, simtime_t core_ns, FILE* out);
+
+#endif /* GANG_H */
@@ -0,0 +1,285 @@
+#include <limits.h>
+#include "lock.h"
+#include "util.h"
+
+const char* lockproto_name(LockProto p) {
+    switch (p) {
+        case LP_NONE:    return "none";
+        case LP_INHERIT: return "inherit";
+        case LP_CEILING: return "ceiling";
+    }
+    return "?";
+}
+
+int lock_parse(const char* spec, LockConfig* cfg) {
+    char buf[256], *name, *opts, *k, *v;
+    if (spec_split(spec, buf, sizeof(buf), LOCK_NAME_LEN, &name, &opts) != 0) return -1;
+    memset(cfg, 0, sizeof(*cfg));
+    snprintf(cfg->name, sizeof(cfg->name), "%s", name);
+    cfg->proto    = LP_NONE;
+    cfg->handoff  = 1;
+    cfg->hold_ns  = 500 * NS_PER_US;
+    cfg->every_ns = 2 * NS_PER_MS;
+    cfg->share    = 100;
+
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) return -1;
+        if (strcmp(k, "proto") == 0) {
+            if      (strcmp(v, "none") == 0)    cfg->proto = LP_NONE;
+            else if (strcmp(v, "inherit") == 0) cfg->proto = LP_INHERIT;
+            else if (strcmp(v, "ceiling") == 0) cfg->proto = LP_CEILING;
+            else return -1;
+        } else if (strcmp(k, "release") == 0) {
+            if      (strcmp(v, "handoff") == 0) cfg->handoff = 1;
+            else if (strcmp(v, "retry") == 0)   cfg->handoff = 0;
+            else return -1;
+        } else if (strcmp(k, "hold") == 0) {
+            if (parse_duration(v, &cfg->hold_ns) != 0 || cfg->hold_ns < 1) return -1;
+        } else if (strcmp(k, "every") == 0) {
+            if (parse_duration(v, &cfg->every_ns) != 0 || cfg->every_ns < 1) return -1;
+        } else if (strcmp(k, "share") == 0) {
+            cfg->share = atoi(v);
+            if (cfg->share < 0 || cfg->share > 100) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void lock_init(Lock* l, const LockConfig* cfg) {
+    memset(l, 0, sizeof(*l));
+    l->cfg     = *cfg;
+    l->ceiling = INT_MAX;
+}
+
+void lock_free(Lock* l) {
+    free(l->wait);
+    l->wait  = NULL;
+    l->nwait = l->cap = 0;
+    l->owner = NULL;
+}
+
+/* ---------------- Scripts ---------------- */
+
+void thread_update_stop(Thread* t) {
+    t->stop_at = t->phase_end;
+    if (t->lockop < t->nlockops) {
+        simtime_t at = t->burst_time - t->lockops[t->lockop].at;
+        if (at > t->stop_at) t->stop_at = at;
+    }
+    if (t->mem_at > t->stop_at) t->stop_at = t->mem_at;   // next page reference
+}
+
+int lock_due(const Thread* t) {
+    return t->lockop < t->nlockops &&
+           t->burst_time - t->remaining >= t->lockops[t->lockop].at;
+}
+
+void thread_set_lockops(Thread* t, const LockOp* ops, int n) {
+    free(t->lockops);
+    t->lockops  = NULL;
+    t->nlockops = 0;
+    t->lockop   = 0;
+    if (n > 0) {
+        t->lockops = (LockOp*)malloc(sizeof(LockOp) * n);
+        memcpy(t->lockops, ops, sizeof(LockOp) * n);
+        t->nlockops = n;
+    }
+    thread_update_stop(t);
+}
+
+static int op_cmp(const void* x, const void* y) {
+    const LockOp* a = (const LockOp*)x;
+    const LockOp* b = (const LockOp*)y;
+    if (a->at != b->at) return a->at < b->at ? -1 : 1;
+    return a->lock - b->lock;
+}
+
+void lock_assign(Lock* locks, int nlock, Queue* workload, unsigned long long seed) {
+    Rng r;
+    rng_seed(&r, seed);
+    int cap = 64;
+    LockOp* cand = (LockOp*)malloc(sizeof(LockOp) * cap);
+    LockOp* ops  = (LockOp*)malloc(sizeof(LockOp) * 2 * cap);
+
+    for (Thread* t = workload->front; t; t = t->next) {
+        if (t->gang >= 0) continue;   // a section around a barrier would deadlock the gang
+        /* candidate acquisitions of every lock this thread uses */
+        int n = 0;
+        for (int k = 0; k < nlock; ++k) {
+            const LockConfig* c = &locks[k].cfg;
+            if ((int)(rng_next(&r) % 100) >= c->share) continue;
+            for (simtime_t at = c->every_ns; at + c->hold_ns <= t->burst_time; at += c->every_ns) {
+                if (n == cap) {
+                    cap *= 2;
+                    cand = (LockOp*)realloc(cand, sizeof(LockOp) * cap);
+                    ops  = (LockOp*)realloc(ops, sizeof(LockOp) * 2 * cap);
+                }
+                cand[n++] = (LockOp){ at, k, 1 };
+            }
+        }
+        qsort(cand, n, sizeof(LockOp), op_cmp);
+
+        /* one section at a time: no nesting, so no lock-order deadlocks */
+        int m = 0;
+        simtime_t free_at = 0;
+        for (int i = 0; i < n; ++i) {
+            const Lock* l = &locks[cand[i].lock];
+            simtime_t at = cand[i].at > free_at ? cand[i].at : free_at;
+            if (at + l->cfg.hold_ns > t->burst_time) continue;
+            ops[m++] = (LockOp){ at, cand[i].lock, 1 };
+            ops[m++] = (LockOp){ at + l->cfg.hold_ns, cand[i].lock, 0 };
+            free_at = at + l->cfg.hold_ns;
+            if (t->priority < locks[cand[i].lock].ceiling) locks[cand[i].lock].ceiling = t->priority;
+        }
+        thread_set_lockops(t, ops, m);
+    }
+    free(cand);
+    free(ops);
+}
+
+/* ---------------- Priority protocols ---------------- */
+
+static void set_priority(Thread* t, int prio, LockPrioFn fn, void* ctx) {
+    if (t->priority == prio) return;
+    t->priority = prio;
+    if (fn) fn(t, ctx);
+}
+
+/* raise t to prio; never lowers it */
+static void boost(Thread* t, int prio, LockPrioFn fn, void* ctx) {
+    if (prio >= t->priority) return;
+    if (!t->boosted) {
+        t->base_priority = t->priority;
+        t->boosted = 1;
+    }
+    set_priority(t, prio, fn, ctx);
+}
+
+/* best priority the locks t owns entitle it to, starting from prio */
+static int owed_priority(const Lock* locks, int nlock, const Thread* t, int prio) {
+    for (int k = 0; k < nlock; ++k) {
+        const Lock* l = &locks[k];
+        if (l->owner != t) continue;
+        if (l->cfg.proto == LP_CEILING && l->ceiling < prio) prio = l->ceiling;
+        if (l->cfg.proto == LP_INHERIT)
+            for (int i = 0; i < l->nwait; ++i)
+                if (l->wait[i]->priority < prio) prio = l->wait[i]->priority;
+    }
+    return prio;
+}
+
+/* drop whatever boost t is no longer owed */
+static void unboost(const Lock* locks, int nlock, Thread* t, LockPrioFn fn, void* ctx) {
+    if (!t->boosted) return;
+    int prio = owed_priority(locks, nlock, t, t->base_priority);
+    if (prio >= t->base_priority) t->boosted = 0;
+    set_priority(t, prio, fn, ctx);
+}
+
+/* pass prio to l's owner, and on to the owner of the lock that one waits
+   for, as long as the locks in the chain inherit */
+static void inherit(Lock* locks, int nlock, Lock* l, int prio, LockPrioFn fn, void* ctx) {
+    for (int depth = 0; depth < nlock && l->owner; ++depth) {
+        Thread* o = l->owner;
+        if (prio >= o->priority) break;
+        boost(o, prio, fn, ctx);
+        if (o->blocked_on < 0) break;
+        l = &locks[o->blocked_on];
+        if (l->cfg.proto != LP_INHERIT) break;
+    }
+}
+
+/* ---------------- Acquire / release ---------------- */
+
+static void take(Lock* l, Thread* t, simtime_t now, LockPrioFn fn, void* ctx) {
+    l->owner       = t;
+    l->owned_since = now;
+    l->acquired++;
+    if (t->lock_since >= 0) {
+        l->contended++;
+        l->wait_ns += now - t->lock_since;
+        t->lock_since = -1;
+    }
+    t->blocked_on = -1;
+    t->lockop++;
+    thread_update_stop(t);
+    if (l->cfg.proto == LP_CEILING) boost(t, l->ceiling, fn, ctx);
+}
+
+/* waiter served next: arrival order, or best priority under a protocol */
+static Thread* pop_waiter(Lock* l) {
+    int best = 0;
+    if (l->cfg.proto != LP_NONE)
+        for (int i = 1; i < l->nwait; ++i)
+            if (l->wait[i]->priority < l->wait[best]->priority) best = i;
+    Thread* w = l->wait[best];
+    memmove(&l->wait[best], &l->wait[best + 1], sizeof(Thread*) * (l->nwait - best - 1));
+    l->nwait--;
+    return w;
+}
+
+int lock_acquire(Lock* locks, int nlock, int id, Thread* t, simtime_t now,
+                 LockPrioFn fn, void* ctx) {
+    Lock* l = &locks[id];
+    if (!l->owner) {
+        take(l, t, now, fn, ctx);
+        return 1;
+    }
+    assert(l->owner != t);   // scripts never acquire a lock twice
+
+    if (l->nwait == l->cap) {
+        l->cap  = l->cap ? 2 * l->cap : 8;
+        l->wait = (Thread**)realloc(l->wait, sizeof(Thread*) * l->cap);
+    }
+    l->wait[l->nwait++] = t;
+    if (l->nwait > l->max_wait) l->max_wait = l->nwait;
+    if (t->lock_since < 0) t->lock_since = now;
+    t->blocked_on = id;
+    if (l->cfg.proto == LP_INHERIT) inherit(locks, nlock, l, t->priority, fn, ctx);
+    return 0;
+}
+
+Thread* lock_release(Lock* locks, int nlock, int id, Thread* t, simtime_t now,
+                     LockPrioFn fn, void* ctx) {
+    Lock* l = &locks[id];
+    t->lockop++;
+    thread_update_stop(t);
+    if (l->owner != t) return NULL;
+
+    l->held_ns += now - l->owned_since;
+    l->owner = NULL;
+    Thread* w = NULL;
+    if (l->nwait > 0) {
+        w = pop_waiter(l);
+        w->blocked_on   = -1;
+        w->unblocked_at = now;   // waiting_resolve wakes it
+        if (l->cfg.handoff) {
+            take(l, w, now, fn, ctx);
+            /* the new owner inherits from those still waiting */
+            if (l->cfg.proto == LP_INHERIT)
+                boost(w, owed_priority(locks, nlock, w, w->priority), fn, ctx);
+        }
+    }
+    unboost(locks, nlock, t, fn, ctx);
+    return w;
+}
+
+void lock_report(const Lock* locks, int nlock, simtime_t elapsed, FILE* out) {
+    if (nlock < 1) return;
+    fprintf(out, "# Locks (times in ticks)\n");
+    fprintf(out, "%-12s %-8s %-8s %9s %9s %10s %10s %8s %6s\n",
+            "LOCK", "PROTO", "RELEASE", "ACQUIRED", "CONTEND%", "AVG_WAIT", "AVG_HOLD", "CS", "MAXQ");
+    for (int i = 0; i < nlock; ++i) {
+        const Lock* l = &locks[i];
+        double n = l->acquired > 0 ? (double)l->acquired : 1.0;
+        simtime_t held = l->held_ns;
+        if (l->owner) held += elapsed - l->owned_since;   // still held at the end
+        fprintf(out, "%-12s %-8s %-8s %9ld %9.1f %10.3f %10.3f %8.3f %6d\n",
+                l->cfg.name, lockproto_name(l->cfg.proto), l->cfg.handoff ? "handoff" : "retry",
+                l->acquired, 100.0 * l->contended / n, to_ticks(l->wait_ns) / n,
+                to_ticks(held) / n, to_ticks(l->cfg.hold_ns), l->max_wait);
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,110 @@
+#ifndef LOCK_H
+#define LOCK_H
+
+#include "sim.h"
+
+/*
+  Shared locks (mutexes) between simulated threads.
+
+  A thread's lock script (Thread.lockops) lists acquire and release points
+  as offsets into its CPU time. The CPU stops the thread at each point (it
+  is folded into Thread.stop_at) and the engine calls lock_acquire() or
+  lock_release(). A thread that finds the lock taken leaves its core for
+  the waiting queue with unblocked_at = SIMTIME_NEVER, like a thread
+  waiting on a device, until a release wakes it.
+
+  Release modes:
+    handoff  ownership passes straight to the first waiter, which holds the
+             lock until it is dispatched and gets past its critical section
+             (lock convoys: every waiter pays for the one before it)
+    retry    the first waiter is only woken; whoever reaches the lock first
+             takes it, and the woken thread tries again when it runs
+
+  Priority protocols (smaller priority wins, as in the priority policy):
+    none     waiters are served in arrival order
+    inherit  the owner runs at the best priority among the waiters, through
+             chains of owners blocked on other locks; waiters are served
+             best priority first
+    ceiling  the owner runs at the lock's ceiling (the best priority of any
+             thread whose script uses it) from the moment it acquires
+
+  Generated scripts (lock_assign) never nest critical sections, so they
+  cannot deadlock.
+*/
+
+#define LOCK_NAME_LEN 16
+
+typedef enum { LP_NONE = 0, LP_INHERIT, LP_CEILING } LockProto;
+
+/* Static settings. Plain data so checkpoints can store it as is. */
+typedef struct {
+    char      name[LOCK_NAME_LEN];
+    LockProto proto;
+    int       handoff;     // 1 = handoff, 0 = retry
+    simtime_t hold_ns;     // CPU time inside one critical section
+    simtime_t every_ns;    // CPU time from one acquisition to the next
+    int       share;       // % of threads whose script uses the lock
+} LockConfig;
+
+typedef struct {
+    LockConfig cfg;
+    int        ceiling;    // best priority among the lock's users
+    Thread*    owner;      // NULL = free
+    simtime_t  owned_since;
+    Thread**   wait;       // blocked threads, in arrival order
+    int        nwait, cap;
+
+    /* statistics */
+    long       acquired;
+    long       contended;  // acquisitions that had to wait
+    simtime_t  wait_ns;    // total time from first attempt to acquisition
+    simtime_t  held_ns;    // total time owned (includes time not running)
+    int        max_wait;
+} Lock;
+
+/* Called for every thread whose priority a protocol changed. */
+typedef void (*LockPrioFn)(Thread* t, void* ctx);
+
+/* Parse "name[:key=val,...]" with keys hold=DUR, every=DUR, share=PCT,
+   proto=none|inherit|ceiling, release=handoff|retry.
+   Returns 0 on success, -1 on error. */
+int  lock_parse(const char* spec, LockConfig* cfg);
+
+void lock_init(Lock* l, const LockConfig* cfg);
+void lock_free(Lock* l);   // the wait list, not the threads
+
+/* Give threads in workload lock scripts: each lock is used by share% of
+   them (picked with a generator seeded by seed), one critical section of
+   hold_ns every every_ns of CPU time. Sections that would overlap are
+   pushed back, and ones that no longer fit the burst are dropped. Gang
+   members (see gang.h) get no script. Also sets every lock's ceiling. */
+void lock_assign(Lock* locks, int nlock, Queue* workload, unsigned long long seed);
+
+/* Set t's lock script (copied), replacing any previous one. ops must be
+   sorted by offset. */
+void thread_set_lockops(Thread* t, const LockOp* ops, int n);
+
+/* Recompute t->stop_at from its phase end, next lock point and next
+   page reference (see mem.h). */
+void thread_update_stop(Thread* t);
+
+/* 1 if t is at (or past) its next lock point */
+int  lock_due(const Thread* t);
+
+/* t (running) wants lock id. Returns 1 if it now owns it; 0 if it must
+   block, in which case it was added to the wait list and the caller moves
+   it to the waiting queue. */
+int  lock_acquire(Lock* locks, int nlock, int id, Thread* t, simtime_t now,
+                  LockPrioFn fn, void* ctx);
+
+/* t releases lock id. Returns the waiter that was woken (its unblocked_at
+   is now), or NULL. */
+Thread* lock_release(Lock* locks, int nlock, int id, Thread* t, simtime_t now,
+                     LockPrioFn fn, void* ctx);
+
+/* Append a per-lock summary (acquisitions, contention, wait and hold). */
+void lock_report(const Lock* locks, int nlock, simtime_t elapsed, FILE* out);
+
+const char* lockproto_name(LockProto p);
+
+#endif /* LOCK_H */
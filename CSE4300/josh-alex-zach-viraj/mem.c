@@ -0,0 +1,243 @@
+#include "mem.h"
+#include "lock.h"
+#include "util.h"
+
+const char* mem_policy_name(MemPolicy p) {
+    switch (p) {
+        case MR_LRU:   return "lru";
+        case MR_FIFO:  return "fifo";
+        case MR_CLOCK: return "clock";
+    }
+    return "?";
+}
+
+int mem_parse(const char* spec, MemConfig* cfg) {
+    char buf[256], *opts, *k, *v;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->frames   = 256;
+    cfg->ws_min   = cfg->ws_max = 32;
+    cfg->hot      = 80;
+    cfg->policy   = MR_LRU;
+    cfg->touch    = 100 * NS_PER_US;
+    cfg->fault    = NS_PER_MS;
+    cfg->channels = 0;
+    if (spec_split(spec, buf, sizeof(buf), 0, NULL, &opts) != 0) return -1;
+
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) return -1;
+        if (strcmp(k, "frames") == 0) {
+            cfg->frames = atoi(v);
+            if (cfg->frames < 1) return -1;
+        } else if (strcmp(k, "ws") == 0) {
+            char* hi = strchr(v, '-');
+            cfg->ws_min = atoi(v);
+            cfg->ws_max = hi ? atoi(hi + 1) : cfg->ws_min;
+            if (cfg->ws_min < 1 || cfg->ws_max < cfg->ws_min) return -1;
+        } else if (strcmp(k, "hot") == 0) {
+            cfg->hot = atoi(v);
+            if (cfg->hot < 0 || cfg->hot > 100) return -1;
+        } else if (strcmp(k, "policy") == 0) {
+            if      (strcmp(v, "lru") == 0)   cfg->policy = MR_LRU;
+            else if (strcmp(v, "fifo") == 0)  cfg->policy = MR_FIFO;
+            else if (strcmp(v, "clock") == 0) cfg->policy = MR_CLOCK;
+            else return -1;
+        } else if (strcmp(k, "touch") == 0) {
+            if (parse_duration(v, &cfg->touch) != 0 || cfg->touch <= 0) return -1;
+        } else if (strcmp(k, "fault") == 0) {
+            if (parse_duration(v, &cfg->fault) != 0 || cfg->fault <= 0) return -1;
+        } else if (strcmp(k, "channels") == 0) {
+            cfg->channels = atoi(v);
+            if (cfg->channels < 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void mem_init(Mem* m, const MemConfig* cfg, unsigned long long seed) {
+    memset(m, 0, sizeof(*m));
+    m->cfg       = *cfg;
+    m->frame     = (Frame*)calloc(cfg->frames, sizeof(Frame));
+    m->free_list = (int*)malloc(sizeof(int) * cfg->frames);
+    for (int i = 0; i < cfg->frames; ++i) m->free_list[i] = cfg->frames - 1 - i;   // frame 0 first
+    m->nfree     = cfg->frames;
+    if (cfg->channels > 0) m->channel = (simtime_t*)calloc(cfg->channels, sizeof(simtime_t));
+    rng_seed(&m->rng, seed);
+}
+
+void mem_free(Mem* m) {
+    free(m->frame);
+    free(m->free_list);
+    free(m->channel);
+    m->frame     = NULL;
+    m->free_list = NULL;
+    m->channel   = NULL;
+    m->nfree     = 0;
+}
+
+void mem_assign(Mem* m, Queue* workload, unsigned long long seed) {
+    Rng r;
+    rng_seed(&r, seed);
+    for (Thread* t = workload->front; t; t = t->next) {
+        int ws = rng_range(&r, m->cfg.ws_min, m->cfg.ws_max);
+        PageTable* pt = (PageTable*)calloc(1, sizeof(PageTable) + sizeof(int) * ws);
+        pt->wset = ws;
+        for (int p = 0; p < ws; ++p) pt->frame[p] = -1;
+        free(t->pages);
+        t->pages  = pt;
+        t->mem_at = t->remaining > m->cfg.touch ? t->remaining - m->cfg.touch : 0;
+        thread_update_stop(t);
+    }
+}
+
+int mem_due(const Thread* t) {
+    return t->mem_at > 0 && t->remaining <= t->mem_at;
+}
+
+/* next page t references: hot % to the first fifth of its working set */
+static int pick_page(Mem* m, const PageTable* pt) {
+    int hot = pt->wset / 5 > 0 ? pt->wset / 5 : 1;
+    if (hot == pt->wset || (int)(rng_next(&m->rng) % 100) < m->cfg.hot)
+        return (int)(rng_next(&m->rng) % (unsigned)hot);
+    return hot + (int)(rng_next(&m->rng) % (unsigned)(pt->wset - hot));
+}
+
+/* frame the replacement policy takes a page from */
+static int victim(Mem* m) {
+    int n = m->cfg.frames;
+    if (m->cfg.policy == MR_CLOCK) {
+        for (;;) {
+            Frame* f = &m->frame[m->hand];
+            int i = m->hand;
+            m->hand = (m->hand + 1) % n;
+            if (!f->ref) return i;
+            f->ref = 0;
+        }
+    }
+    int best = 0;
+    for (int i = 1; i < n; ++i) {
+        const Frame* f = &m->frame[i];
+        const Frame* b = &m->frame[best];
+        if (m->cfg.policy == MR_FIFO ? f->loaded < b->loaded : f->used < b->used) best = i;
+    }
+    return best;
+}
+
+/* 1, 2-3, 4-7, ... active threads */
+static int bucket(int nactive) {
+    int b = 0;
+    while (nactive > 1 && b < MEM_BUCKETS - 1) {
+        nactive >>= 1;
+        b++;
+    }
+    return b;
+}
+
+simtime_t mem_reference(Mem* m, Thread* t, simtime_t now) {
+    PageTable* pt = t->pages;
+    t->mem_at = t->mem_at > m->cfg.touch ? t->mem_at - m->cfg.touch : 0;
+
+    if (pt->refs == 0) {
+        m->nactive++;
+        m->demand += pt->wset;
+        if (m->nactive > m->max_active) m->max_active = m->nactive;
+        if (m->demand > m->max_demand) m->max_demand = m->demand;
+    }
+    int b = bucket(m->nactive);
+    m->refs++;
+    m->bucket_refs[b]++;
+    m->bucket_demand[b] += m->demand;
+    pt->refs++;
+
+    int page = pick_page(m, pt);
+    int i = pt->frame[page];
+    if (i >= 0) {
+        m->frame[i].used = now;
+        m->frame[i].ref  = 1;
+        return 0;
+    }
+
+    /* fault: a free frame, or one taken from its owner */
+    m->faults++;
+    m->bucket_faults[b]++;
+    pt->faults++;
+    if (m->nfree > 0) {
+        i = m->free_list[--m->nfree];
+    } else {
+        i = victim(m);
+        PageTable* old = m->frame[i].owner->pages;
+        old->frame[m->frame[i].page] = -1;
+        old->resident--;
+        m->evictions++;
+    }
+    Frame* f = &m->frame[i];
+    f->owner  = t;
+    f->page   = page;
+    f->ref    = 1;
+    f->loaded = f->used = now;
+    pt->frame[page] = i;
+    pt->resident++;
+
+    /* served at once, or by the channel that frees up first */
+    simtime_t start = now;
+    if (m->channel) {
+        int c = 0;
+        for (int k = 1; k < m->cfg.channels; ++k)
+            if (m->channel[k] < m->channel[c]) c = k;
+        if (m->channel[c] > start) start = m->channel[c];
+        m->channel[c] = start + m->cfg.fault;
+    }
+    m->fault_wait_ns += start + m->cfg.fault - now;
+    return start + m->cfg.fault;
+}
+
+void mem_release(Mem* m, Thread* t) {
+    PageTable* pt = t->pages;
+    if (!pt) return;
+    for (int p = 0; p < pt->wset; ++p) {
+        int i = pt->frame[p];
+        if (i < 0) continue;
+        m->frame[i].owner = NULL;
+        m->free_list[m->nfree++] = i;
+        pt->frame[p] = -1;
+    }
+    pt->resident = 0;
+    if (pt->refs > 0) {
+        m->nactive--;
+        m->demand -= pt->wset;
+    }
+}
+
+void mem_report(const Mem* m, simtime_t cpu_ns, FILE* out) {
+    const MemConfig* c = &m->cfg;
+    fprintf(out, "# Paging\n");
+    fprintf(out, "Frames: %d, working set %d", c->frames, c->ws_min);
+    if (c->ws_max > c->ws_min) fprintf(out, "-%d", c->ws_max);
+    fprintf(out, " pages, hot %d%%, policy %s, touch %.3f, fault %.3f, channels ",
+            c->hot, mem_policy_name(c->policy), to_ticks(c->touch), to_ticks(c->fault));
+    if (c->channels > 0) fprintf(out, "%d\n", c->channels);
+    else                 fprintf(out, "unlimited\n");
+    fprintf(out, "References: %ld, faults: %ld (%.2f%%), evictions: %ld\n",
+            m->refs, m->faults, m->refs > 0 ? 100.0 * m->faults / m->refs : 0.0, m->evictions);
+    fprintf(out, "Fault wait: %.3f ticks, %.3f per fault, %.1f%% of the CPU time run (%.3f)%s\n",
+            to_ticks(m->fault_wait_ns), m->faults > 0 ? to_ticks(m->fault_wait_ns) / m->faults : 0.0,
+            cpu_ns > 0 ? 100.0 * m->fault_wait_ns / cpu_ns : 0.0, to_ticks(cpu_ns),
+            m->fault_wait_ns > cpu_ns ? "  THRASHING" : "");
+    fprintf(out, "Most threads active: %d, largest demand: %ld pages (%.2fx the frames)\n",
+            m->max_active, m->max_demand, (double)m->max_demand / c->frames);
+    fprintf(out, "%-10s %10s %10s %8s %8s\n", "Active", "Refs", "Faults", "Rate", "Demand");
+    for (int b = 0; b < MEM_BUCKETS; ++b) {
+        if (m->bucket_refs[b] == 0) continue;
+        char range[24];
+        int lo = 1 << b, hi = (1 << (b + 1)) - 1;
+        if (b == MEM_BUCKETS - 1) snprintf(range, sizeof(range), "%d+", lo);
+        else if (lo == hi)        snprintf(range, sizeof(range), "%d", lo);
+        else                      snprintf(range, sizeof(range), "%d-%d", lo, hi);
+        fprintf(out, "%-10s %10ld %10ld %7.2f%% %7.2fx\n", range, m->bucket_refs[b], m->bucket_faults[b],
+                100.0 * m->bucket_faults[b] / m->bucket_refs[b],
+                m->bucket_demand[b] / m->bucket_refs[b] / c->frames);
+    }
+    fprintf(out, "(Demand: working set pages of the active threads over the frames; "
+                 "THRASHING: more time waiting for faults than running)\n\n");
+}
@@ -0,0 +1,118 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include "sim.h"
+
+/*
+  Demand paging over a shared pool of physical frames.
+
+  Every thread gets a working set of ws pages (mem_assign) and references
+  one of them every touch ns of CPU time; the CPU stops it at each
+  reference like at a lock point (folded into Thread.stop_at). A
+  reference to a page without a frame is a fault: the page gets a frame
+  (a free one, or one taken from any thread by the replacement policy)
+  and the thread leaves its core for the waiting queue until the fault
+  is served. References are skewed: hot % of them go to the first fifth
+  of the working set, the rest to the other pages.
+
+  Replacement policies (global, over all threads' frames):
+    lru    the frame used longest ago
+    fifo   the frame loaded longest ago
+    clock  second chance: a hand sweeps the frames, clearing reference
+           bits, and takes the first frame whose bit is clear
+
+  A fault takes fault ns to serve. With channels = N at most N faults are
+  served at once and the others queue in order (a paging device); 0 serves
+  every fault at once.
+
+  Finished threads give their frames back. Once the working sets of the
+  running threads no longer fit in the frames, threads evict each other's
+  pages and spend more time waiting for faults than running: thrashing.
+  The report breaks the fault rate down by the number of threads active
+  at the reference.
+*/
+
+typedef enum { MR_LRU = 0, MR_FIFO, MR_CLOCK } MemPolicy;
+
+/* Static settings. Plain data so checkpoints can store it as is. */
+typedef struct {
+    int       frames;        // physical frames shared by all threads
+    int       ws_min, ws_max;   // working set pages per thread, drawn in this range
+    int       hot;           // % of references to the first fifth of the working set
+    MemPolicy policy;
+    simtime_t touch;         // CPU time between page references
+    simtime_t fault;         // time to serve one fault
+    int       channels;      // faults served at once, 0 = no limit
+} MemConfig;
+
+/* A thread's pages (Thread.pages, owned by the thread). */
+typedef struct PageTable {
+    int  wset;               // pages in the working set
+    int  resident;           // pages that have a frame
+    long refs, faults;
+    int  frame[];            // frame of each page, -1 = not resident
+} PageTable;
+
+typedef struct {
+    Thread*   owner;         // NULL = free
+    int       page;
+    int       ref;           // clock reference bit
+    simtime_t loaded, used;
+} Frame;
+
+/* active-thread buckets of the report: 1, 2-3, 4-7, ... */
+#define MEM_BUCKETS 16
+
+typedef struct {
+    MemConfig cfg;
+    Frame*    frame;
+    int*      free_list;     // free frames, used from the end
+    int       nfree;
+    int       hand;          // clock hand
+    simtime_t* channel;      // when each fault channel is free
+    Rng       rng;           // page references
+    int       nactive;       // threads that referenced a page and did not finish
+    long      demand;        // working set pages of the active threads
+
+    /* statistics */
+    long      refs, faults, evictions;
+    simtime_t fault_wait_ns; // from each fault to its page being in
+    int       max_active;
+    long      max_demand;
+    long      bucket_refs[MEM_BUCKETS];
+    long      bucket_faults[MEM_BUCKETS];
+    double    bucket_demand[MEM_BUCKETS];   // demand summed over the references
+} Mem;
+
+/* Parse "key=val,..." with keys frames=N ws=N or ws=MIN-MAX hot=PCT
+   policy=lru|fifo|clock touch=DUR fault=DUR channels=N. Defaults:
+   frames=256, ws=32, hot=80, lru, touch=100us, fault=1ms, channels=0.
+   Returns 0 on success, -1 on error. */
+int  mem_parse(const char* spec, MemConfig* cfg);
+
+/* All frames free; seed drives the page references. */
+void mem_init(Mem* m, const MemConfig* cfg, unsigned long long seed);
+void mem_free(Mem* m);
+
+/* Give every thread in workload a working set (size drawn with seed) and
+   its first reference touch ns into its burst. */
+void mem_assign(Mem* m, Queue* workload, unsigned long long seed);
+
+/* 1 if t is at its next page reference */
+int  mem_due(const Thread* t);
+
+/* t references a page at now and moves on to its next reference. Returns
+   0 on a hit, else the time the fault is served (t must wait until then). */
+simtime_t mem_reference(Mem* m, Thread* t, simtime_t now);
+
+/* Finished thread t gives its frames back. */
+void mem_release(Mem* m, Thread* t);
+
+/* Settings, references, faults, evictions, time waiting for faults and
+   the fault rate by the number of active threads. cpu_ns: CPU time the
+   threads ran. */
+void mem_report(const Mem* m, simtime_t cpu_ns, FILE* out);
+
+const char* mem_policy_name(MemPolicy p);
+
+#endif /* MEM_H */
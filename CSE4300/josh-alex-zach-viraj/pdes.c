@@ -0,0 +1,238 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include "pdes.h"
+
+/* hand every thread of q to the partitions, round robin starting at *next */
+static void deal_queue(PSim* ps, Queue* q, Queue* (*slot)(Sim*), int* next) {
+    while (!q_empty(q)) {
+        Thread* t = q_pop(q);
+        q_push(slot(&ps->part[*next]), t);
+        *next = (*next + 1) % ps->nparts;
+    }
+}
+
+static Queue* slot_workload(Sim* s) { return &s->workload; }
+static Queue* slot_ready(Sim* s)    { return &s->ready; }
+static Queue* slot_waiting(Sim* s)  { return &s->waiting; }
+
+int psim_init(PSim* ps, Sim* src, int nparts, int window, int balance) {
+    int ncores = src->cpu.ncores;
+    if (nparts < 1 || nparts > ncores) return 1;
+    /* not modeled per partition */
+    if (src->ndev > 0 || src->nlock > 0 || src->ngroup > 0 || src->power || src->cpu.smt > 1 ||
+        src->scale || src->hotplug_next < src->nhotplug || src->njob > 0 || src->ngang > 0 ||
+        src->admit || src->mem)
+        return 3;
+    if (window < 1) window = 1;
+
+    ps->nparts  = nparts;
+    ps->window  = window;
+    ps->balance = balance;
+    ps->now     = src->now;
+    ps->end_time = src->now;
+    ps->done    = 0;
+    ps->part    = (Sim*)calloc(nparts, sizeof(Sim));
+    if (!ps->part) return 2;
+
+    /* running threads go back to Ready before dealing */
+    sched_drain(&src->sched, &src->ready);
+    for (int c = 0; c < ncores; ++c) preempt_to_ready(&src->cpu, c, &src->ready);
+
+    for (int p = 0; p < nparts; ++p) {
+        int lo = p * ncores / nparts, hi = (p + 1) * ncores / nparts;
+        Sim* s = &ps->part[p];
+        sim_init(s, src->algo, src->rr_quantum, hi - lo, src->cpu.trace_len);
+        if (src->sched.path[0] &&
+            sim_set_policy(s, src->algo, src->rr_quantum, src->sched.path) != 0) {
+            for (int q = 0; q <= p; ++q) sim_free(&ps->part[q]);
+            free(ps->part);
+            ps->part = NULL;
+            return 4;
+        }
+        s->intr = src->intr;
+        s->cpu.cs_ns = src->cpu.cs_ns;
+        s->age_every = src->age_every;
+        s->now  = src->now;
+        unsigned long long hi_bits = rng_next(&src->rng);
+        unsigned long long lo_bits = rng_next(&src->rng);
+        rng_seed(&s->rng, (hi_bits << 32) | lo_bits);
+    }
+
+    int next = 0;
+    deal_queue(ps, &src->workload, slot_workload, &next);
+    deal_queue(ps, &src->ready,    slot_ready,    &next);
+    deal_queue(ps, &src->waiting,  slot_waiting,  &next);
+    while (!q_empty(&src->finished)) q_push(&ps->part[0].finished, q_pop(&src->finished));
+
+    /* one CPU view over all partitions' traces, in core order */
+    ps->view.ncores    = ncores;
+    ps->view.core      = (Thread**)calloc(ncores, sizeof(Thread*));
+    ps->view.run_trace = (int**)malloc(sizeof(int*) * ncores);
+    ps->view.trace_len = src->cpu.trace_len;
+    ps->view.cs_left   = NULL;
+    ps->view.last_tid  = NULL;
+    ps->view.rate      = NULL;
+    ps->view.smt       = 1;
+    ps->view.place_cost = NULL;
+    for (int p = 0, c = 0; p < nparts; ++p)
+        for (int i = 0; i < ps->part[p].cpu.ncores; ++i, ++c)
+            ps->view.run_trace[c] = ps->part[p].cpu.run_trace[i];
+    return 0;
+}
+
+/* step one partition to the end of the current window */
+static void run_window(PSim* ps, int p) {
+    Sim* s = &ps->part[p];
+    simtime_t until = ps->now + (simtime_t)ps->window * SIM_TICK_NS;
+    if (!sim_done(s)) sim_run(s, until);
+    s->now = until;   // a finished partition idles to the boundary
+}
+
+/* even out Ready lengths: the longest gives the thread it would run next
+   to the shortest (whose policy picks it up at its next dispatch) */
+static void balance_ready(PSim* ps) {
+    for (;;) {
+        int hi = 0, lo = 0;
+        for (int p = 1; p < ps->nparts; ++p) {
+            if (sim_ready_count(&ps->part[p]) > sim_ready_count(&ps->part[hi])) hi = p;
+            if (sim_ready_count(&ps->part[p]) < sim_ready_count(&ps->part[lo])) lo = p;
+        }
+        if (sim_ready_count(&ps->part[hi]) - sim_ready_count(&ps->part[lo]) <= 1) break;
+        Sim* from = &ps->part[hi];
+        Thread* t = from->sched.nready > 0 ? sched_take(&from->sched) : q_pop(&from->ready);
+        q_push(&ps->part[lo].ready, t);
+    }
+}
+
+/* window boundary work; single threaded. Records end time and balances. */
+static void sync_point(PSim* ps, const simtime_t* last_busy) {
+    int all_done = 1;
+    for (int p = 0; p < ps->nparts; ++p) {
+        if (last_busy[p] > ps->end_time) ps->end_time = last_busy[p];
+        if (!sim_done(&ps->part[p])) all_done = 0;
+    }
+    ps->now += (simtime_t)ps->window * SIM_TICK_NS;
+    ps->done = all_done;
+    if (!all_done && ps->balance) balance_ready(ps);
+}
+
+/* when a partition's last thread finished, or -1 if none has; threads
+   join finished in finish-time order */
+static simtime_t finished_at(const Sim* s) {
+    return s->finished.rear ? s->finished.rear->finish_time : -1;
+}
+
+static void finish(PSim* ps) {
+    for (int p = 0; p < ps->nparts; ++p) ps->part[p].now = ps->end_time;
+    SIM_TIME = ps->end_time;
+}
+
+void psim_run_sequential(PSim* ps) {
+    simtime_t* last = (simtime_t*)calloc(ps->nparts, sizeof(simtime_t));
+    while (!ps->done) {
+        for (int p = 0; p < ps->nparts; ++p) {
+            run_window(ps, p);
+            last[p] = finished_at(&ps->part[p]);
+        }
+        sync_point(ps, last);
+    }
+    free(last);
+    finish(ps);
+}
+
+/* Start gate: the workers that did start wait here until the calling
+   thread knows how many there are and has sized the barrier for them. */
+typedef struct {
+    pthread_mutex_t   lock;
+    pthread_cond_t    cond;
+    int               go;         // 1 = start
+    int               nworkers;   // threads that started, the caller included
+    pthread_barrier_t bar;
+} Gate;
+
+typedef struct {
+    PSim* ps;
+    int   id;
+    simtime_t* last;
+    Gate* gate;
+} Worker;
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    PSim* ps = w->ps;
+    Gate* g = w->gate;
+    pthread_mutex_lock(&g->lock);
+    while (!g->go) pthread_cond_wait(&g->cond, &g->lock);
+    pthread_mutex_unlock(&g->lock);
+    for (;;) {
+        for (int p = w->id; p < ps->nparts; p += g->nworkers) {
+            run_window(ps, p);
+            w->last[p] = finished_at(&ps->part[p]);
+        }
+        /* serial thread runs the sync point between the two barriers */
+        if (pthread_barrier_wait(&g->bar) == PTHREAD_BARRIER_SERIAL_THREAD)
+            sync_point(ps, w->last);
+        pthread_barrier_wait(&g->bar);
+        if (ps->done) break;
+    }
+    return NULL;
+}
+
+int psim_run_parallel(PSim* ps, int nworkers) {
+    if (nworkers > ps->nparts) nworkers = ps->nparts;
+    if (nworkers <= 1) {
+        psim_run_sequential(ps);
+        return 1;
+    }
+
+    simtime_t* last = (simtime_t*)calloc(ps->nparts, sizeof(simtime_t));
+    Gate gate;
+    pthread_mutex_init(&gate.lock, NULL);
+    pthread_cond_init(&gate.cond, NULL);
+    gate.go = 0;
+
+    /* worker i is the i-th thread that started, so the partitions stay
+       dealt over 0..started-1 when the host refuses some threads */
+    pthread_t* tids = (pthread_t*)malloc(sizeof(pthread_t) * nworkers);
+    Worker*    ws   = (Worker*)malloc(sizeof(Worker) * nworkers);
+    int started = 1;   // the calling thread is worker 0
+    ws[0] = (Worker){ ps, 0, last, &gate };
+    for (int i = 1; i < nworkers; ++i) {
+        ws[started] = (Worker){ ps, started, last, &gate };
+        if (pthread_create(&tids[started], NULL, worker_main, &ws[started]) == 0) started++;
+    }
+
+    pthread_mutex_lock(&gate.lock);
+    gate.nworkers = started;
+    pthread_barrier_init(&gate.bar, NULL, (unsigned)started);
+    gate.go = 1;
+    pthread_cond_broadcast(&gate.cond);
+    pthread_mutex_unlock(&gate.lock);
+
+    worker_main(&ws[0]);
+    for (int i = 1; i < started; ++i) pthread_join(tids[i], NULL);
+
+    pthread_barrier_destroy(&gate.bar);
+    pthread_cond_destroy(&gate.cond);
+    pthread_mutex_destroy(&gate.lock);
+    free(ws);
+    free(tids);
+    free(last);
+    finish(ps);
+    return started;
+}
+
+void psim_collect_finished(PSim* ps, Queue* out) {
+    for (int p = 0; p < ps->nparts; ++p)
+        while (!q_empty(&ps->part[p].finished))
+            q_push(out, q_pop(&ps->part[p].finished));
+}
+
+void psim_free(PSim* ps) {
+    for (int p = 0; p < ps->nparts; ++p) sim_free(&ps->part[p]);
+    free(ps->part);
+    free(ps->view.core);
+    free(ps->view.run_trace);   // rows belonged to the partitions
+    ps->part = NULL;
+    ps->nparts = 0;
+}
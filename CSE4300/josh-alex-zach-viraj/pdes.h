@@ -0,0 +1,51 @@
+#ifndef PDES_H
+#define PDES_H
+
+#include "engine.h"
+
+/*
+  Partitioned simulation: the cores are split into nparts partitions, each a
+  full Sim with its own policy instance (run queue), Waiting queue, RNG
+  stream and slice of cores. Threads are assigned to partitions up front
+  (round robin in workload order), so partitions only interact at window
+  boundaries, where an optional load balancer moves Ready threads from the
+  longest to the shortest queue.
+
+  The window is the lookahead: within it no partition can affect another,
+  so psim_run_parallel() lets worker threads step their partitions for a
+  whole window before meeting at a barrier. psim_run_sequential() walks the
+  same windows on one thread and produces identical results.
+*/
+
+typedef struct {
+    int   nparts;
+    Sim*  part;          // nparts simulations
+    int   window;        // lookahead / balancing interval in ticks
+    int   balance;       // 1 = rebalance Ready queues at window boundaries
+    simtime_t now;       // start of the next window
+    simtime_t end_time;  // latest time at which any partition finished
+    int   done;
+    CPU   view;          // all partitions' cores as one CPU (for traces)
+} PSim;
+
+/* Split src (threads, cores, settings) into nparts partitions.
+   src is left empty but still needs sim_free(). Returns 0 on success;
+   simulations with I/O devices, locks, groups, the power model, SMT,
+   hotplug events, an autoscaler, DAG jobs, gangs, admission control or
+   paging are not supported (3); 4 if src's external policy cannot be
+   loaded once per partition. */
+int  psim_init(PSim* ps, Sim* src, int nparts, int window, int balance);
+
+void psim_run_sequential(PSim* ps);
+
+/* nworkers host threads, each owning partitions p with p % nworkers == w.
+   Returns the number of workers that ran: fewer than asked for if the host
+   would not create every thread (the results are the same either way). */
+int  psim_run_parallel(PSim* ps, int nworkers);
+
+/* Move every finished thread into one queue (for stats). */
+void psim_collect_finished(PSim* ps, Queue* out);
+
+void psim_free(PSim* ps);
+
+#endif /* PDES_H */
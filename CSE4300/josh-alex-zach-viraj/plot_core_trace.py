@@ -2,11 +2,15 @@
 """
 timeline_plot.py
 Usage:
-    python timeline_plot.py input.txt [output.png]
+    python timeline_plot.py [input.txt | input.bin] [output.png]
 
 Input format example:
 Core 0: [T1, T1, T1, T1, T2, T2, T3, T3]
 Core 1: [T2, T2, T2, T1, T1, T1, T1]
+
+A .bin input is the interval file from write_core_trace_bin() (./sim --trace-bin).
+It is memory-mapped with numpy and rasterized to the figure's pixel width,
+so long many-core traces render in seconds.
 """
 
 import sys
@@ -19,6 +23,10 @@ from matplotlib.patches import Patch
 from matplotlib import ticker
 from matplotlib import ticker, colors as mcolors
 
+# binary trace layout (see write_core_trace_bin in util.h)
+BIN_MAGIC = b"CTRB"
+BIN_HEADER_BYTES = 20
+
 def parse_line(line):
     """
     Returns (label, timeline_list_of_tokens_as_str)
@@ -183,10 +191,130 @@ def plot_timelines(cores, title="CPU Run Timeline", seed=None):
     plt.show()
 
 
+# ---------------- binary trace fast path ----------------
+
+def read_bin_trace(path):
+    """
+    Returns (ncores, nticks, recs) where recs is a read-only structured
+    memmap with fields core, tid, start, len (int32).
+    """
+    import numpy as np
+    with open(path, "rb") as f:
+        head = f.read(BIN_HEADER_BYTES)
+    if len(head) < BIN_HEADER_BYTES or head[:4] != BIN_MAGIC:
+        raise ValueError(f"{path}: not a binary core trace")
+    version, ncores, nticks, nrec = np.frombuffer(head[4:], dtype="<i4")
+    if version != 1:
+        raise ValueError(f"{path}: unsupported trace version {version}")
+    dt = np.dtype([("core", "<i4"), ("tid", "<i4"), ("start", "<i4"), ("len", "<i4")])
+    if nrec == 0:
+        return int(ncores), int(nticks), np.zeros(0, dtype=dt)
+    recs = np.memmap(path, dtype=dt, mode="r", offset=BIN_HEADER_BYTES, shape=(int(nrec),))
+    return int(ncores), int(nticks), recs
+
+def merge_intervals(core, tid, start, length):
+    """
+    Merge back-to-back intervals of the same tid on the same core.
+    Inputs must be sorted by (core, start), as the simulator writes them.
+    Returns (core, tid, start, end) arrays.
+    """
+    import numpy as np
+    end = start + length
+    if core.size == 0:
+        return core, tid, start, end
+    # an interval opens a new run unless it continues the previous one exactly
+    cont = np.zeros(core.size, dtype=bool)
+    cont[1:] = (core[1:] == core[:-1]) & (tid[1:] == tid[:-1]) & (start[1:] == end[:-1])
+    heads = np.flatnonzero(~cont)
+    tails = np.append(heads[1:], core.size) - 1
+    return core[heads], tid[heads], start[heads], end[tails]
+
+def rasterize(ncores, nticks, core, tid, start, end, width_px):
+    """
+    Downsample intervals to one cell per (core, pixel column).
+    Each cell gets the tid that covers the most ticks of that column's
+    bucket, approximated by letting the longest interval that touches
+    the cell win. Returns an int32 image (ncores x ncols), -1 = idle.
+    """
+    import numpy as np
+    ncols = max(1, min(width_px, nticks))
+    bucket = max(1, -(-nticks // ncols))          # ticks per column, ceil
+    ncols = max(1, -(-nticks // bucket))
+    img = np.full((ncores, ncols), -1, dtype=np.int32)
+    if core.size == 0:
+        return img, bucket
+
+    c0 = start // bucket
+    c1 = (end - 1) // bucket
+    order = np.argsort(end - start, kind="stable")
+    c0, c1 = c0[order], c1[order]
+    rows, tids = core[order], tid[order]
+
+    # expand every interval into the columns it touches, all at once
+    span = (c1 - c0 + 1).astype(np.int64)
+    rep = np.repeat(np.arange(span.size), span)
+    offs = np.arange(rep.size) - np.repeat(np.cumsum(span) - span, span)
+    cell = rows[rep].astype(np.int64) * ncols + c0[rep] + offs
+    vals = tids[rep]
+
+    # the longest interval of each cell wins: expansion keeps the stable
+    # length order, so take the last entry per cell (first when reversed)
+    cells, last = np.unique(cell[::-1], return_index=True)
+    img.ravel()[cells] = vals[::-1][last]
+    return img, bucket
+
+def tid_colors(tids, seed=None):
+    """Vectorized stable color per tid (golden-ratio hue walk)."""
+    import numpy as np
+    off = random.Random(seed).random() if seed is not None else 0.0
+    h = np.mod(tids.astype(np.float64) * 0.6180339887 + off, 1.0)
+    s = 0.65 + 0.25 * np.mod(tids * 0.37, 1.0)
+    v = 0.85 + 0.15 * np.mod(tids * 0.71, 1.0)
+    return mcolors.hsv_to_rgb(np.stack([h, s, v], axis=-1))
+
+def plot_bin_trace(path, title="CPU Run Timeline", out=None, width_px=2000):
+    import numpy as np
+    ncores, nticks, recs = read_bin_trace(path)
+    core, tid, start, end = merge_intervals(
+        np.asarray(recs["core"]), np.asarray(recs["tid"]),
+        np.asarray(recs["start"]), np.asarray(recs["len"]))
+
+    img, bucket = rasterize(ncores, max(1, nticks), core, tid, start, end, width_px)
+
+    idle_color = np.array([0.75, 0.75, 0.75])
+    rgb = np.empty(img.shape + (3,))
+    busy = img >= 0
+    rgb[~busy] = idle_color
+    rgb[busy] = tid_colors(img[busy])
+
+    width  = min(18, max(8, 6 + math.log10(max(10, nticks)) * 4))
+    height = min(16, max(3, 0.6 * ncores))
+    fig, ax = plt.subplots(figsize=(width, height))
+    ax.imshow(rgb, aspect="auto", interpolation="nearest",
+              extent=(0, img.shape[1] * bucket, ncores, 0))
+    ax.set_xlim(0, max(1, nticks))
+    ax.set_xlabel("Tick" if bucket == 1 else f"Tick ({bucket} ticks/column)")
+    ax.set_title(title)
+    if ncores <= 64:
+        ax.set_yticks(np.arange(ncores) + 0.5)
+        ax.set_yticklabels([f"Core {c}" for c in range(ncores)])
+    else:
+        ax.set_ylabel("Core")
+
+    plt.tight_layout()
+    if out:
+        fig.savefig(out, dpi=100)
+    else:
+        plt.show()
 
 
 def main():
-    cores = read_timelines("core_trace.txt")  # fixed file name
+    path = sys.argv[1] if len(sys.argv) > 1 else "core_trace.txt"
+    out = sys.argv[2] if len(sys.argv) > 2 else None
+    if path.endswith(".bin"):
+        plot_bin_trace(path, out=out)
+        return
+    cores = read_timelines(path)
     if not cores:
         print("No valid lines found in input")
         sys.exit(1)
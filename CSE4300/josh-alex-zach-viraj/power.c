@@ -0,0 +1,263 @@
+#include <limits.h>
+#include "power.h"
+
+const char* governor_name(Governor g) {
+    switch (g) {
+        case GOV_PERFORMANCE: return "performance";
+        case GOV_POWERSAVE:   return "powersave";
+        case GOV_ONDEMAND:    return "ondemand";
+        case GOV_SCHEDUTIL:   return "schedutil";
+    }
+    return "?";
+}
+
+static void default_config(PowerConfig* cfg) {
+    static const PState ps[] = { { 800, 1.5 }, { 1600, 4.0 }, { 2400, 8.0 }, { 3200, 14.0 } };
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->np = (int)(sizeof(ps) / sizeof(ps[0]));
+    memcpy(cfg->p, ps, sizeof(ps));
+    cfg->idle_w      = 1.0;
+    cfg->sleep_w     = 0.1;
+    cfg->sleep_after = 2 * NS_PER_MS;
+    cfg->wake_ns     = 100 * NS_PER_US;
+    cfg->switch_ns   = 20 * NS_PER_US;
+    cfg->gov         = GOV_SCHEDUTIL;
+    cfg->up_pct      = 80;
+    cfg->eas         = 0;
+}
+
+/* "MHZ:W/MHZ:W/..." by increasing frequency */
+static int parse_pstates(char* v, PowerConfig* cfg) {
+    cfg->np = 0;
+    for (char* p = v; p && *p; ) {
+        char* next = strchr(p, '/');
+        if (next) *next++ = '\0';
+        char* w = strchr(p, ':');
+        if (!w || cfg->np == POWER_MAX_PSTATES) return -1;
+        *w++ = '\0';
+        PState* s = &cfg->p[cfg->np];
+        s->mhz    = atoi(p);
+        s->busy_w = atof(w);
+        if (s->mhz < 1 || s->busy_w < 0) return -1;
+        if (cfg->np > 0 && s->mhz <= cfg->p[cfg->np - 1].mhz) return -1;
+        cfg->np++;
+        p = next;
+    }
+    return cfg->np > 0 ? 0 : -1;
+}
+
+int power_parse(const char* spec, PowerConfig* cfg) {
+    char buf[256];
+    default_config(cfg);
+    if (!spec) return 0;
+    if (strlen(spec) >= sizeof(buf)) return -1;
+    strcpy(buf, spec);
+
+    /* pstates uses '/' and ':' inside its value, so split on ',' by hand */
+    for (char* kv = buf[0] ? buf : NULL; kv; ) {
+        char* next = strchr(kv, ',');
+        if (next) *next++ = '\0';
+        char* v = strchr(kv, '=');
+        if (!v) return -1;
+        *v++ = '\0';
+        if (strcmp(kv, "gov") == 0) {
+            if      (strcmp(v, "performance") == 0) cfg->gov = GOV_PERFORMANCE;
+            else if (strcmp(v, "powersave") == 0)   cfg->gov = GOV_POWERSAVE;
+            else if (strcmp(v, "ondemand") == 0)    cfg->gov = GOV_ONDEMAND;
+            else if (strcmp(v, "schedutil") == 0)   cfg->gov = GOV_SCHEDUTIL;
+            else return -1;
+        } else if (strcmp(kv, "pstates") == 0) {
+            if (parse_pstates(v, cfg) != 0) return -1;
+        } else if (strcmp(kv, "idle") == 0) {
+            cfg->idle_w = atof(v);
+            if (cfg->idle_w < 0) return -1;
+        } else if (strcmp(kv, "sleep") == 0) {
+            cfg->sleep_w = atof(v);
+            if (cfg->sleep_w < 0) return -1;
+        } else if (strcmp(kv, "sleep-after") == 0) {
+            if (parse_duration(v, &cfg->sleep_after) != 0) return -1;
+        } else if (strcmp(kv, "wake") == 0) {
+            if (parse_duration(v, &cfg->wake_ns) != 0) return -1;
+        } else if (strcmp(kv, "switch") == 0) {
+            if (parse_duration(v, &cfg->switch_ns) != 0) return -1;
+        } else if (strcmp(kv, "up") == 0) {
+            cfg->up_pct = atoi(v);
+            if (cfg->up_pct < 1 || cfg->up_pct > 100) return -1;
+        } else if (strcmp(kv, "eas") == 0) {
+            cfg->eas = atoi(v) != 0;
+        } else {
+            return -1;
+        }
+        kv = next;
+    }
+    return 0;
+}
+
+static void set_rate(const Power* pw, CPU* cpu, int c) {
+    int fmax = pw->cfg.p[pw->cfg.np - 1].mhz;
+    cpu->rate[c] = (int)((long long)pw->cfg.p[pw->pstate[c]].mhz * CPU_RATE_ONE / fmax);
+    if (cpu->rate[c] < 1) cpu->rate[c] = 1;
+}
+
+/* eas: awake idle cores first, the most recently busy first; then the
+   sleeping ones in core order */
+static int eas_cost(const CPU* cpu, int c, void* ctx) {
+    const Power* pw = (const Power*)ctx;
+    (void)cpu;
+    simtime_t idle = pw->idle_since[c] >= 0 ? SIM_TIME - pw->idle_since[c] : 0;
+    if (idle >= pw->cfg.sleep_after) return INT_MAX;
+    idle /= NS_PER_US;
+    return idle < INT_MAX - 1 ? (int)idle : INT_MAX - 1;
+}
+
+static int start_pstate(const PowerConfig* cfg) {
+    return cfg->gov == GOV_POWERSAVE ? 0 : cfg->np - 1;
+}
+
+void power_init(Power* pw, const PowerConfig* cfg, CPU* cpu) {
+    memset(pw, 0, sizeof(*pw));
+    pw->cfg = *cfg;
+    if (pw->cfg.np < 1) default_config(&pw->cfg);
+    pw->ncores = 0;
+    power_resize(pw, cpu);
+}
+
+void power_resize(Power* pw, CPU* cpu) {
+    int n = cpu->ncores, old = pw->ncores;
+    for (int c = n; c < old; ++c) pw->removed_j += pw->energy[c];
+    pw->pstate     = (int*)realloc(pw->pstate, sizeof(int) * n);
+    pw->idle_since = (simtime_t*)realloc(pw->idle_since, sizeof(simtime_t) * n);
+    pw->win_busy   = (simtime_t*)realloc(pw->win_busy, sizeof(simtime_t) * n);
+    pw->energy     = (double*)realloc(pw->energy, sizeof(double) * n);
+    pw->busy_ns    = (simtime_t*)realloc(pw->busy_ns, sizeof(simtime_t) * n);
+    pw->sleep_ns   = (simtime_t*)realloc(pw->sleep_ns, sizeof(simtime_t) * n);
+    pw->mhz_ns     = (double*)realloc(pw->mhz_ns, sizeof(double) * n);
+    for (int c = old; c < n; ++c) {
+        pw->pstate[c]     = start_pstate(&pw->cfg);
+        pw->idle_since[c] = cpu->core[c] ? -1 : SIM_TIME;
+        pw->win_busy[c]   = 0;
+        pw->energy[c]     = 0;
+        pw->busy_ns[c]    = 0;
+        pw->sleep_ns[c]   = 0;
+        pw->mhz_ns[c]     = 0;
+    }
+    pw->ncores = n;
+
+    free(cpu->rate);
+    cpu->rate = (int*)malloc(sizeof(int) * n);
+    for (int c = 0; c < n; ++c) set_rate(pw, cpu, c);
+    cpu->place_cost = pw->cfg.eas ? eas_cost : NULL;
+    cpu->place_ctx  = pw->cfg.eas ? pw : NULL;
+}
+
+void power_free(Power* pw) {
+    free(pw->pstate);
+    free(pw->idle_since);
+    free(pw->win_busy);
+    free(pw->energy);
+    free(pw->busy_ns);
+    free(pw->sleep_ns);
+    free(pw->mhz_ns);
+    memset(pw, 0, sizeof(*pw));
+}
+
+void power_dispatched(Power* pw, CPU* cpu) {
+    for (int c = 0; c < cpu->ncores; ++c) {
+        if (!cpu->core[c]) {
+            if (pw->idle_since[c] < 0) pw->idle_since[c] = SIM_TIME;
+        } else if (pw->idle_since[c] >= 0) {
+            /* just got a thread: leaving sleep costs the exit latency */
+            if (SIM_TIME - pw->idle_since[c] >= pw->cfg.sleep_after)
+                cpu->cs_left[c] += pw->cfg.wake_ns;
+            pw->idle_since[c] = -1;
+        }
+    }
+}
+
+void power_account(Power* pw, CPU* cpu, simtime_t dt) {
+    const PowerConfig* cfg = &pw->cfg;
+    for (int c = 0; c < cpu->ncores; ++c) {
+        Thread* t = cpu->core[c];
+        if (t) {
+            const PState* p = &cfg->p[pw->pstate[c]];
+            double j = p->busy_w * (double)dt / NS_PER_S;
+            pw->energy[c]   += j;
+            t->energy       += j;
+            pw->busy_ns[c]  += dt;
+            pw->win_busy[c] += dt;
+            pw->mhz_ns[c]   += (double)p->mhz * dt;
+            continue;
+        }
+        /* idle until sleep_after, asleep from then on */
+        simtime_t awake = cfg->sleep_after - (SIM_TIME - pw->idle_since[c]);
+        if (awake < 0) awake = 0;
+        if (awake > dt) awake = dt;
+        pw->energy[c]   += (cfg->idle_w * awake + cfg->sleep_w * (dt - awake)) / NS_PER_S;
+        pw->sleep_ns[c] += dt - awake;
+    }
+}
+
+/* lowest P-state with at least mhz, or the top one */
+static int pstate_for(const PowerConfig* cfg, double mhz) {
+    for (int i = 0; i < cfg->np; ++i)
+        if (cfg->p[i].mhz >= mhz) return i;
+    return cfg->np - 1;
+}
+
+void power_tick(Power* pw, CPU* cpu) {
+    const PowerConfig* cfg = &pw->cfg;
+    int fmax = cfg->p[cfg->np - 1].mhz;
+    for (int c = 0; c < cpu->ncores; ++c) {
+        double util = (double)pw->win_busy[c] / SIM_TICK_NS;
+        double cur  = cfg->p[pw->pstate[c]].mhz;
+        pw->win_busy[c] = 0;
+
+        int next = pw->pstate[c];
+        switch (cfg->gov) {
+            case GOV_PERFORMANCE: next = cfg->np - 1; break;
+            case GOV_POWERSAVE:   next = 0; break;
+            case GOV_ONDEMAND:
+                next = util * 100 >= cfg->up_pct ? cfg->np - 1
+                                                 : pstate_for(cfg, cur * util * 100 / cfg->up_pct);
+                break;
+            case GOV_SCHEDUTIL:
+                /* util * cur / fmax is the frequency-invariant load */
+                next = pstate_for(cfg, 1.25 * fmax * (util * cur / fmax));
+                break;
+        }
+        if (next == pw->pstate[c]) continue;
+        pw->pstate[c] = next;
+        pw->switches++;
+        set_rate(pw, cpu, c);
+        if (cpu->core[c]) cpu->cs_left[c] += cfg->switch_ns;   // the transition stalls it
+    }
+}
+
+void power_report(const Power* pw, const Queue* finished, simtime_t elapsed, FILE* out) {
+    const PowerConfig* cfg = &pw->cfg;
+    double total = pw->removed_j;
+    for (int c = 0; c < pw->ncores; ++c) total += pw->energy[c];
+
+    fprintf(out, "# Energy (governor %s%s, %ld P-state switches)\n",
+            governor_name(cfg->gov), cfg->eas ? ", energy-aware placement" : "", pw->switches);
+    fprintf(out, "Total energy:  %.6f J\n", total);
+    fprintf(out, "Average power: %.3f W\n", elapsed > 0 ? total * NS_PER_S / elapsed : 0.0);
+    fprintf(out, "%-6s %7s %7s %9s %12s\n", "CORE", "BUSY%", "SLEEP%", "AVG_MHZ", "ENERGY_J");
+    for (int c = 0; c < pw->ncores; ++c) {
+        fprintf(out, "%-6d %7.1f %7.1f %9.0f %12.6f\n", c,
+                elapsed > 0 ? 100.0 * pw->busy_ns[c] / elapsed : 0.0,
+                elapsed > 0 ? 100.0 * pw->sleep_ns[c] / elapsed : 0.0,
+                pw->busy_ns[c] > 0 ? pw->mhz_ns[c] / pw->busy_ns[c] : 0.0, pw->energy[c]);
+    }
+
+    double task_total = 0;
+    for (const Thread* t = finished->front; t; t = t->next) task_total += t->energy;
+    fprintf(out, "Energy per task: %.6f J average over %d tasks (%.1f%% of the total;"
+            " the rest is idle and sleep)\n",
+            finished->size > 0 ? task_total / finished->size : 0.0, finished->size,
+            total > 0 ? 100.0 * task_total / total : 0.0);
+    fprintf(out, "%-6s %12s\n", "TID", "ENERGY_mJ");
+    for (const Thread* t = finished->front; t; t = t->next)
+        fprintf(out, "%-6d %12.3f\n", t->tid, t->energy * 1000.0);
+    fprintf(out, "\n");
+}
@@ -0,0 +1,101 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "sim.h"
+
+/*
+  DVFS and energy model.
+
+  Every core has a frequency (P-state) chosen by a governor at each timer
+  tick. A core at f MHz does f / fmax of full-speed work per ns (CPU.rate);
+  switching P-states stalls a busy core for switch_ns. An idle core draws
+  idle_w until it has been idle sleep_after ns, then sleep_w, and pays
+  wake_ns of exit latency (as switch overhead) when a thread lands on it.
+
+  A busy core draws the busy power of its P-state; that energy is also
+  charged to the thread it runs (Thread.energy).
+
+  Governors (per core, sampled every tick):
+    performance  highest P-state
+    powersave    lowest P-state
+    ondemand     highest once utilization reaches up_pct, else the lowest
+                 P-state that keeps it under up_pct at the current load
+    schedutil    1.25 x frequency-invariant utilization x fmax
+
+  Energy-aware placement (eas) fills idle cores that are awake first, the
+  most recently busy one first, so the others can stay asleep.
+*/
+
+#define POWER_MAX_PSTATES 8
+
+typedef enum { GOV_PERFORMANCE = 0, GOV_POWERSAVE, GOV_ONDEMAND, GOV_SCHEDUTIL } Governor;
+
+typedef struct {
+    int    mhz;
+    double busy_w;    // power of a busy core at this frequency
+} PState;
+
+/* Static settings. Plain data so checkpoints can store it as is. */
+typedef struct {
+    PState    p[POWER_MAX_PSTATES];   // by increasing frequency
+    int       np;
+    double    idle_w;
+    double    sleep_w;
+    simtime_t sleep_after;   // idle time before a core sleeps
+    simtime_t wake_ns;       // exit latency from sleep
+    simtime_t switch_ns;     // P-state transition latency
+    Governor  gov;
+    int       up_pct;        // ondemand threshold
+    int       eas;           // energy-aware placement
+} PowerConfig;
+
+typedef struct {
+    PowerConfig cfg;
+    int        ncores;
+    int*       pstate;       // current P-state of each core
+    simtime_t* idle_since;   // -1 while busy
+    simtime_t* win_busy;     // busy time in the current governor window
+
+    /* statistics, per core */
+    double*    energy;       // joules
+    simtime_t* busy_ns;
+    simtime_t* sleep_ns;
+    double*    mhz_ns;       // sum of frequency x busy time, for the average
+    double     removed_j;    // energy of cores taken away by power_resize
+    long       switches;
+} Power;
+
+/* Parse "key=val,..." with keys gov=performance|powersave|ondemand|schedutil,
+   pstates=MHZ:W/MHZ:W/..., idle=W, sleep=W, sleep-after=DUR, wake=DUR,
+   switch=DUR, up=PCT, eas=0|1. An empty spec keeps the defaults.
+   Returns 0 on success, -1 on error. */
+int  power_parse(const char* spec, PowerConfig* cfg);
+
+/* Set up the model for cpu (all cores awake at the governor's starting
+   P-state) and give the CPU its rates and, with eas, its placement. */
+void power_init(Power* pw, const PowerConfig* cfg, CPU* cpu);
+void power_free(Power* pw);
+
+/* Re-attach to cpu after its core count changed (new cores start awake at
+   the governor's starting P-state; removed cores' energy stays in the
+   total). */
+void power_resize(Power* pw, CPU* cpu);
+
+/* After dispatching: note cores that went idle, and charge the wake
+   latency of cores that were just given a thread after sleeping. */
+void power_dispatched(Power* pw, CPU* cpu);
+
+/* Charge the next dt ns of the cores' current state (call before
+   cpu_step): energy and busy time. */
+void power_account(Power* pw, CPU* cpu, simtime_t dt);
+
+/* End of a timer tick: let the governor pick each core's P-state. */
+void power_tick(Power* pw, CPU* cpu);
+
+/* Total energy, average power, per-core residency and frequency, and
+   energy per finished thread. */
+void power_report(const Power* pw, const Queue* finished, simtime_t elapsed, FILE* out);
+
+const char* governor_name(Governor g);
+
+#endif /* POWER_H */
@@ -0,0 +1,217 @@
+#include "qmodel.h"
+#include "dispatch.h"
+#include "util.h"
+#include <math.h>
+
+static int parse_dist(const char* v, SvcDist* d) {
+    if      (strcmp(v, "fixed") == 0)   *d = SVC_FIXED;
+    else if (strcmp(v, "uniform") == 0) *d = SVC_UNIFORM;
+    else if (strcmp(v, "exp") == 0)     *d = SVC_EXP;
+    else return -1;
+    return 0;
+}
+
+int qmodel_parse(const char* spec, QModelConfig* cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->n        = 1000;
+    cfg->arrive   = SVC_EXP;
+    cfg->gap_ns   = SIM_TICK_NS;
+    cfg->dist     = SVC_EXP;
+    cfg->burst_ns = 2 * SIM_TICK_NS;
+
+    char buf[256], *opts, *k, *v;
+    if (spec_split(spec, buf, sizeof(buf), 0, NULL, &opts) != 0) return -1;
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) return -1;
+        if (strcmp(k, "n") == 0) {
+            cfg->n = atoi(v);
+            if (cfg->n < 1) return -1;
+        } else if (strcmp(k, "arrive") == 0) {
+            if (parse_dist(v, &cfg->arrive) != 0) return -1;
+        } else if (strcmp(k, "dist") == 0) {
+            if (parse_dist(v, &cfg->dist) != 0) return -1;
+        } else if (strcmp(k, "gap") == 0) {
+            if (parse_duration(v, &cfg->gap_ns) != 0 || cfg->gap_ns < 1) return -1;
+        } else if (strcmp(k, "burst") == 0) {
+            if (parse_duration(v, &cfg->burst_ns) != 0 || cfg->burst_ns < 1) return -1;
+        } else if (strcmp(k, "load") == 0) {
+            cfg->load = atoi(v);
+            if (cfg->load < 1) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+simtime_t qmodel_gap(const QModelConfig* cfg, int ncores) {
+    if (cfg->load <= 0) return cfg->gap_ns;
+    if (ncores < 1) ncores = 1;
+    simtime_t g = cfg->burst_ns * 100 / ((simtime_t)ncores * cfg->load);
+    return g > 0 ? g : 1;
+}
+
+/* a draw from d with the given mean, at least 1 ns */
+static simtime_t draw(SvcDist d, simtime_t mean, Rng* rng) {
+    simtime_t x = mean;
+    switch (d) {
+        case SVC_FIXED:
+            break;
+        case SVC_UNIFORM:
+            x = rng_time(rng, mean / 2, mean + mean / 2);
+            break;
+        case SVC_EXP: {
+            double u = (rng_next(rng) + 0.5) / 4294967296.0;   // (0, 1)
+            x = (simtime_t)(-log(u) * (double)mean);
+            break;
+        }
+    }
+    return x > 0 ? x : 1;
+}
+
+int qmodel_generate(const QModelConfig* cfg, int ncores, unsigned long long seed,
+                    Queue* workload) {
+    simtime_t gap = qmodel_gap(cfg, ncores);
+    Rng r;
+    rng_seed(&r, seed);
+    simtime_t at = 0;
+    for (int i = 1; i <= cfg->n; ++i) {
+        at += draw(cfg->arrive, gap, &r);
+        simtime_t burst = draw(cfg->dist, cfg->burst_ns, &r);
+        workload_add(workload, i, at, burst, rng_range(&r, 1, 10));
+    }
+    return cfg->n;
+}
+
+/* squared coefficient of variation of d */
+static double scv(SvcDist d) {
+    switch (d) {
+        case SVC_FIXED:   return 0.0;
+        case SVC_UNIFORM: return 1.0 / 12.0;   // variance of U(0.5, 1.5)
+        case SVC_EXP:     return 1.0;
+    }
+    return 1.0;
+}
+
+/* Kendall letter of d */
+static char kendall(SvcDist d) {
+    switch (d) {
+        case SVC_FIXED:   return 'D';
+        case SVC_UNIFORM: return 'G';
+        case SVC_EXP:     return 'M';
+    }
+    return 'G';
+}
+
+double qmodel_util(const QModelConfig* cfg, int ncores) {
+    return (double)cfg->burst_ns / qmodel_gap(cfg, ncores) / ncores;
+}
+
+/* Erlang C: probability that an arrival waits, c servers, offered load
+   a < c. Erlang B by its recurrence, which stays finite for large c. */
+static double erlang_c(int c, double a) {
+    double b = 1.0;
+    for (int k = 1; k <= c; ++k) b = a * b / (k + a * b);
+    double rho = a / c;
+    return b / (1.0 - rho * (1.0 - b));
+}
+
+int qmodel_predict(const QModelConfig* cfg, int ncores, QPrediction* fcfs, QPrediction* ps) {
+    double rho = qmodel_util(cfg, ncores);
+    char ka = kendall(cfg->arrive), ks = kendall(cfg->dist);
+    snprintf(fcfs->name, sizeof(fcfs->name), "%c/%c/%d", ka, ks, ncores);
+    snprintf(ps->name, sizeof(ps->name), "%c/%c/%d-PS", ka, ks, ncores);
+    fcfs->exact = cfg->arrive == SVC_EXP && (cfg->dist == SVC_EXP || ncores == 1);
+    ps->exact   = cfg->arrive == SVC_EXP;
+    if (rho >= 1.0) return -1;
+
+    double s  = to_ticks(cfg->burst_ns);
+    double a  = rho * ncores;
+    double ca = scv(cfg->arrive), cs = scv(cfg->dist);
+    double wq = erlang_c(ncores, a) * s / (ncores - a);   // M/M/c
+
+    fcfs->wait = wq * (ca + cs) / 2.0;
+    fcfs->turn = s + fcfs->wait;
+    ps->wait   = wq * (ca + 1.0) / 2.0;
+    ps->turn   = s + ps->wait;
+    return 0;
+}
+
+static const char* dist_name(SvcDist d) {
+    switch (d) {
+        case SVC_FIXED:   return "fixed";
+        case SVC_UNIFORM: return "uniform";
+        case SVC_EXP:     return "exp";
+    }
+    return "?";
+}
+
+/* one model row, with the simulated times if this is the scheduler that ran */
+static void report_row(const char* kind, const QPrediction* p, int ran,
+                       double sim_wait, double sim_turn, FILE* out) {
+    fprintf(out, "%-4s %-14s %c %9.3f %10.3f", kind, p->name, p->exact ? '=' : '~',
+            p->wait, p->turn);
+    if (ran && sim_turn >= 0)
+        fprintf(out, " %9.3f %10.3f %+7.1f%%\n", sim_wait, sim_turn,
+                100.0 * (sim_turn - p->turn) / p->turn);
+    else
+        fprintf(out, " %9s %10s %8s\n", "-", "-", "-");
+}
+
+void qmodel_report(const QModelConfig* cfg, int ncores, int algo,
+                   double sim_wait, double sim_turn, FILE* out) {
+    simtime_t gap = qmodel_gap(cfg, ncores);
+    double rho = qmodel_util(cfg, ncores);
+    fprintf(out, "# Queueing model (times in ticks)\n");
+    fprintf(out, "Synthetic workload: %d threads, gaps %s mean %.3f, bursts %s mean %.3f\n",
+            cfg->n, dist_name(cfg->arrive), to_ticks(gap), dist_name(cfg->dist),
+            to_ticks(cfg->burst_ns));
+
+    QPrediction fcfs, ps;
+    if (qmodel_predict(cfg, ncores, &fcfs, &ps) != 0) {
+        fprintf(out, "Offered load %.3f on %d cores: utilization %.3f >= 1, no steady state\n"
+                     "(the Ready queue grows for as long as threads arrive)\n\n",
+                rho * ncores, ncores, rho);
+        return;
+    }
+    fprintf(out, "Offered load %.3f on %d cores: utilization %.3f, P(wait) %.3f (Erlang C)\n",
+            rho * ncores, ncores, rho, erlang_c(ncores, rho * ncores));
+    fprintf(out, "%-4s %-14s %c %9s %10s %9s %10s %8s\n",
+            "", "MODEL", ' ', "WAIT", "TURNAROUND", "SIM_WAIT", "SIM_TURN", "ERR");
+    report_row("FCFS", &fcfs, algo == DISP_FIFO, sim_wait, sim_turn, out);
+    report_row("PS",   &ps,   algo == DISP_RR,   sim_wait, sim_turn, out);
+    fprintf(out, "(= exact, ~ approximation; ERR = simulated turnaround against the model.\n"
+                 " FIFO is compared with FCFS, RR with PS, which it approaches as the quantum\n"
+                 " shrinks. The run starts empty and drains at the end, the model is steady state.)\n\n");
+}
+
+void qmodel_plan(const QModelConfig* cfg, int ncores, FILE* out) {
+    /* one arrival rate for every row */
+    QModelConfig fixed = *cfg;
+    fixed.gap_ns = qmodel_gap(cfg, ncores);
+    fixed.load   = 0;
+
+    double a = (double)fixed.burst_ns / fixed.gap_ns;
+    int cmin = (int)floor(a) + 1;
+    int first = cmin;
+    if (ncores > cmin + 3) first = ncores - 3;
+
+    fprintf(out, "# Capacity plan (times in ticks)\n");
+    fprintf(out, "Synthetic workload: gaps %s mean %.3f, bursts %s mean %.3f: "
+                 "offered load %.3f, at least %d cores\n",
+            dist_name(fixed.arrive), to_ticks(fixed.gap_ns), dist_name(fixed.dist),
+            to_ticks(fixed.burst_ns), a, cmin);
+    fprintf(out, "%6s %6s %8s %10s %10s %10s\n",
+            "CORES", "UTIL", "P(WAIT)", "FCFS_WAIT", "FCFS_TURN", "PS_TURN");
+    for (int c = first; c < first + 8; ++c) {
+        QPrediction fcfs, ps;
+        if (qmodel_predict(&fixed, c, &fcfs, &ps) != 0) continue;
+        fprintf(out, "%6d %6.3f %8.3f %10.3f %10.3f %10.3f%s\n",
+                c, a / c, erlang_c(c, a), fcfs.wait, fcfs.turn, ps.turn,
+                c == ncores ? "  <-" : "");
+    }
+    QPrediction fcfs, ps;
+    qmodel_predict(&fixed, cmin, &fcfs, &ps);
+    fprintf(out, "(FCFS model %s, PS model %s for these distributions)\n",
+            fcfs.exact ? "exact" : "approximate", ps.exact ? "exact" : "approximate");
+}
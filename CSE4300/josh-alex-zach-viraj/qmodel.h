@@ -0,0 +1,86 @@
+#ifndef QMODEL_H
+#define QMODEL_H
+
+#include "sim.h"
+#include "device.h"
+
+/*
+  Analytic queueing models as a cross-check of the simulation.
+
+  A synthetic workload (--synth) draws n threads whose gaps between
+  arrivals and CPU bursts are independent draws from known distributions
+  (the --device ones: fixed, uniform over 0.5x..1.5x the mean, or
+  exponential). With arrival rate lambda = 1 / E[gap], mean burst E[S],
+  offered load a = lambda E[S] and c cores (utilization rho = a / c),
+  queueing theory predicts the steady-state waiting time Wq and
+  turnaround E[S] + Wq:
+
+    FCFS  M/M/c: Wq = C(c, a) E[S] / (c - a), C the Erlang C probability
+          that an arrival waits. M/G/1: Wq = lambda E[S^2] / (2 (1 - rho))
+          (Pollaczek-Khinchine). Other cases use the Allen-Cunneen
+          approximation Wq(M/M/c) (ca^2 + cs^2) / 2, with ca^2 and cs^2
+          the squared coefficients of variation of the gaps and bursts;
+          it reduces to both exact forms.
+    PS    round robin tends to processor sharing as the quantum shrinks
+          against the bursts. With Poisson arrivals PS on c cores is
+          insensitive to the burst distribution and its mean turnaround
+          is that of M/M/c: E[S] + Wq(M/M/c) (E[S] / (1 - rho) on one
+          core). Other arrivals scale Wq(M/M/c) by (ca^2 + 1) / 2.
+
+  FIFO runs are compared with the FCFS model and RR runs with PS; other
+  schedulers get the predictions alone. The models assume no I/O,
+  overheads or core changes, and a steady state: a run of n threads
+  starts empty and ends when the last one drains, which matters near
+  rho = 1.
+*/
+
+/* Static settings. Plain data so it can be copied into every replica. */
+typedef struct {
+    int       n;             // threads
+    SvcDist   arrive;        // gap distribution
+    simtime_t gap_ns;        // mean gap between arrivals
+    int       load;          // >0: gap chosen for this utilization (percent)
+    SvcDist   dist;          // burst distribution
+    simtime_t burst_ns;      // mean burst
+} QModelConfig;
+
+/* One model's prediction, in ticks */
+typedef struct {
+    char   name[32];         // Kendall notation, e.g. "M/M/4-PS"
+    int    exact;            // 0 = approximation
+    double wait;
+    double turn;
+} QPrediction;
+
+/* Parse "key=val,..." with keys n=N, arrive=fixed|uniform|exp, gap=DUR,
+   load=PCT (overrides gap), dist=fixed|uniform|exp, burst=DUR (default
+   1000 threads, exponential gaps of 1 tick and bursts of 2 ticks). spec
+   may be NULL. Returns 0 on success, -1 on error. */
+int    qmodel_parse(const char* spec, QModelConfig* cfg);
+
+/* Mean gap on ncores cores (load= depends on the core count) */
+simtime_t qmodel_gap(const QModelConfig* cfg, int ncores);
+
+/* Add cfg.n threads (tids 1..n, priorities 1..10) to workload, drawn by
+   a generator seeded from seed. Returns the number added. */
+int    qmodel_generate(const QModelConfig* cfg, int ncores, unsigned long long seed,
+                       Queue* workload);
+
+/* Utilization on ncores cores; >= 1 means no steady state */
+double qmodel_util(const QModelConfig* cfg, int ncores);
+
+/* FCFS and PS predictions on ncores cores; -1 if the load is unstable. */
+int    qmodel_predict(const QModelConfig* cfg, int ncores, QPrediction* fcfs, QPrediction* ps);
+
+/* Predictions next to the simulated mean waiting and turnaround times
+   (ticks; negative = not simulated). algo is the built-in scheduler
+   that ran, or -1 for an external policy. */
+void   qmodel_report(const QModelConfig* cfg, int ncores, int algo,
+                     double sim_wait, double sim_turn, FILE* out);
+
+/* Capacity plan: predictions for a range of core counts around the
+   smallest stable one, including ncores if > 0. The arrival rate is the
+   one on ncores (or the configured gap) for every row. */
+void   qmodel_plan(const QModelConfig* cfg, int ncores, FILE* out);
+
+#endif /* QMODEL_H */
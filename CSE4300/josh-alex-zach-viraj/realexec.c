@@ -0,0 +1,284 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <math.h>
+#include "realexec.h"
+
+int realexec_parse_policy(const char* s, RxPolicy* out) {
+    if      (strcmp(s, "fifo") == 0)  *out = RX_FIFO;
+    else if (strcmp(s, "rr") == 0)    *out = RX_RR;
+    else if (strcmp(s, "other") == 0) *out = RX_OTHER;
+    else return -1;
+    return 0;
+}
+
+static const char* policy_name(RxPolicy p) {
+    switch (p) {
+        case RX_FIFO:  return "SCHED_FIFO";
+        case RX_RR:    return "SCHED_RR";
+        case RX_OTHER: return "SCHED_OTHER";
+    }
+    return "?";
+}
+
+int realexec_capture(RealExec* rx, const Queue* workload) {
+    memset(rx, 0, sizeof(*rx));
+    rx->task = (RxTask*)calloc(workload->size > 0 ? workload->size : 1, sizeof(RxTask));
+    if (!rx->task) return -1;
+    for (const Thread* p = workload->front; p; p = p->next) {
+        RxTask* t = &rx->task[rx->ntasks++];
+        t->tid      = p->tid;
+        t->priority = p->priority;
+        t->arrival  = p->arrival_time;
+        t->nphases  = p->phases ? p->nphases : 1;
+        t->phases   = (Phase*)malloc(sizeof(Phase) * t->nphases);
+        if (p->phases) {
+            memcpy(t->phases, p->phases, sizeof(Phase) * t->nphases);
+        } else {
+            t->phases[0].cpu = p->burst_time;
+            t->phases[0].io  = 0;
+        }
+    }
+    return 0;
+}
+
+/* ---- timing helpers ---- */
+
+static simtime_t ts_ns(const struct timespec* ts) {
+    return (simtime_t)ts->tv_sec * NS_PER_S + ts->tv_nsec;
+}
+
+static struct timespec ns_ts(simtime_t ns) {
+    struct timespec ts = { (time_t)(ns / NS_PER_S), (long)(ns % NS_PER_S) };
+    return ts;
+}
+
+static simtime_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts_ns(&ts);
+}
+
+static simtime_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts_ns(&ts);
+}
+
+/* burn ns of this thread's CPU time */
+static void spin(simtime_t ns) {
+    simtime_t end = thread_cpu_ns() + ns;
+    volatile unsigned sink = 0;
+    while (thread_cpu_ns() < end)
+        for (unsigned i = 0; i < 256; ++i) sink += i;
+}
+
+static void sleep_until(simtime_t mono) {
+    struct timespec ts = ns_ts(mono);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) { }
+}
+
+/* ---- worker threads ---- */
+
+/* Start gate: workers check in and wait for go, so the main thread can
+   release however many it managed to create. */
+typedef struct {
+    RealExec*       rx;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int             waiting;    // workers at the gate
+    int             go;         // 1 = start, -1 = return at once
+    simtime_t       epoch;      // CLOCK_MONOTONIC of simulated time 0
+    cpu_set_t       cpus;
+} RxShared;
+
+typedef struct {
+    RxShared* sh;
+    RxTask*   t;
+} RxArg;
+
+static void* rx_worker(void* arg) {
+    RxArg* a = (RxArg*)arg;
+    RxShared* sh = a->sh;
+    RxTask* t = a->t;
+    double scale = sh->rx->scale;
+
+    sched_setaffinity(0, sizeof(sh->cpus), &sh->cpus);   // 0 = this thread
+    pthread_mutex_lock(&sh->lock);
+    sh->waiting++;
+    pthread_cond_broadcast(&sh->cond);
+    while (!sh->go) pthread_cond_wait(&sh->cond, &sh->lock);
+    int go = sh->go;
+    pthread_mutex_unlock(&sh->lock);
+    if (go < 0) return NULL;
+
+    simtime_t release = (simtime_t)(t->arrival * scale);
+    sleep_until(sh->epoch + release);
+    t->released  = release;
+    t->first_run = mono_ns() - sh->epoch;
+
+    simtime_t cpu0 = thread_cpu_ns();
+    for (int k = 0; k < t->nphases; ++k) {
+        spin((simtime_t)(t->phases[k].cpu * scale));
+        if (t->phases[k].io > 0)
+            sleep_until(mono_ns() + (simtime_t)(t->phases[k].io * scale));
+    }
+    t->finished = mono_ns() - sh->epoch;
+    t->cpu_used = thread_cpu_ns() - cpu0;
+    return NULL;
+}
+
+/* first n CPUs of this process's affinity mask; returns how many were found */
+static int pick_cpus(int n, cpu_set_t* out) {
+    cpu_set_t avail;
+    CPU_ZERO(out);
+    if (sched_getaffinity(0, sizeof(avail), &avail) != 0) return 0;
+    int got = 0;
+    for (int c = 0; c < CPU_SETSIZE && got < n; ++c)
+        if (CPU_ISSET(c, &avail)) { CPU_SET(c, out); got++; }
+    return got;
+}
+
+static int os_policy(RxPolicy p) {
+    switch (p) {
+        case RX_FIFO: return SCHED_FIFO;
+        case RX_RR:   return SCHED_RR;
+        default:      return SCHED_OTHER;
+    }
+}
+
+/* smaller simulator priority -> higher real-time priority */
+static int rt_priority(int pol, int priority) {
+    int lo = sched_get_priority_min(pol), hi = sched_get_priority_max(pol);
+    int p = hi - 1 - priority;
+    if (p < lo) p = lo;
+    if (p > hi) p = hi;
+    return p;
+}
+
+int realexec_run(RealExec* rx, int ncores, RxPolicy policy, double scale, int use_priority) {
+    if (rx->ntasks == 0) return 0;
+    if (scale <= 0) scale = 1.0;
+    rx->policy    = policy;
+    rx->policy_ok = 1;
+    rx->scale     = scale;
+
+    RxShared sh;
+    sh.rx = rx;
+    rx->ncores = pick_cpus(ncores, &sh.cpus);
+    if (rx->ncores < 1) return 1;
+
+    pthread_t* th = (pthread_t*)malloc(sizeof(pthread_t) * rx->ntasks);
+    RxArg* args   = (RxArg*)malloc(sizeof(RxArg) * rx->ntasks);
+    if (!th || !args) {
+        free(th);
+        free(args);
+        return 2;
+    }
+    pthread_mutex_init(&sh.lock, NULL);
+    pthread_cond_init(&sh.cond, NULL);
+    sh.waiting = 0;
+    sh.go      = 0;
+
+    int pol = os_policy(policy);
+    int created = 0;
+    for (int i = 0; i < rx->ntasks; ++i) {
+        args[i].sh = &sh;
+        args[i].t  = &rx->task[i];
+
+        int rc = EPERM;
+        if (pol != SCHED_OTHER && rx->policy_ok) {
+            pthread_attr_t attr;
+            struct sched_param sp;
+            sp.sched_priority = rt_priority(pol, use_priority ? rx->task[i].priority : 0);
+            pthread_attr_init(&attr);
+            pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+            pthread_attr_setschedpolicy(&attr, pol);
+            pthread_attr_setschedparam(&attr, &sp);
+            rc = pthread_create(&th[i], &attr, rx_worker, &args[i]);
+            pthread_attr_destroy(&attr);
+            if (rc == EPERM) rx->policy_ok = 0;   // no CAP_SYS_NICE: fall back
+        }
+        if (rc != 0) rc = pthread_create(&th[i], NULL, rx_worker, &args[i]);
+        if (rc != 0) break;
+        created++;
+    }
+
+    /* wait for every worker at the gate; a partial set (host thread
+       limit) is sent home instead of run */
+    pthread_mutex_lock(&sh.lock);
+    while (sh.waiting < created) pthread_cond_wait(&sh.cond, &sh.lock);
+    /* leave the workers time to wake and settle */
+    sh.epoch = mono_ns() + 20 * NS_PER_MS;
+    sh.go    = created < rx->ntasks ? -1 : 1;
+    pthread_cond_broadcast(&sh.cond);
+    pthread_mutex_unlock(&sh.lock);
+    for (int i = 0; i < created; ++i) pthread_join(th[i], NULL);
+
+    int rc = created < rx->ntasks ? 3 : 0;
+    pthread_cond_destroy(&sh.cond);
+    pthread_mutex_destroy(&sh.lock);
+    free(th);
+    free(args);
+    return rc;
+}
+
+void realexec_report(const RealExec* rx, const Queue* finished, FILE* out) {
+    const char* actual = rx->policy_ok ? policy_name(rx->policy) : policy_name(RX_OTHER);
+    fprintf(out, "# Real execution: %d threads on %d cores, %s%s, scale=%g real ns per simulated ns\n",
+            rx->ntasks, rx->ncores, actual,
+            rx->policy_ok ? "" : " (requested policy not permitted)", rx->scale);
+    fprintf(out, "# Times in ticks of simulated time (1 tick = %lld ns)\n", (long long)SIM_TICK_NS);
+    fprintf(out, "%-6s %10s %10s %10s %10s %10s %10s %8s\n", "TID",
+            "SIM_RESP", "REAL_RESP", "DIFF", "SIM_TURN", "REAL_TURN", "DIFF", "CPU%");
+
+    int n = 0;
+    double sum_sr = 0, sum_rr = 0, sum_st = 0, sum_rt = 0;
+    double err_r = 0, err_t = 0, max_err_t = 0, sum_cpu = 0;
+    for (int i = 0; i < rx->ntasks; ++i) {
+        const RxTask* t = &rx->task[i];
+        const Thread* p = finished->front;
+        while (p && p->tid != t->tid) p = p->next;
+        if (!p || p->start_time < 0) continue;
+
+        double s = rx->scale;
+        double sim_resp  = to_ticks(p->start_time  - p->arrival_time);
+        double sim_turn  = to_ticks(p->finish_time - p->arrival_time);
+        double real_resp = to_ticks((simtime_t)((t->first_run - t->released) / s));
+        double real_turn = to_ticks((simtime_t)((t->finished  - t->released) / s));
+
+        simtime_t want = 0;
+        for (int k = 0; k < t->nphases; ++k) want += t->phases[k].cpu;
+        double cpu_pct = want > 0 ? 100.0 * t->cpu_used / (want * s) : 100.0;
+
+        fprintf(out, "%-6d %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %8.1f\n", t->tid,
+                sim_resp, real_resp, real_resp - sim_resp,
+                sim_turn, real_turn, real_turn - sim_turn, cpu_pct);
+        sum_sr += sim_resp;  sum_rr += real_resp;
+        sum_st += sim_turn;  sum_rt += real_turn;
+        err_r  += fabs(real_resp - sim_resp);
+        err_t  += fabs(real_turn - sim_turn);
+        if (fabs(real_turn - sim_turn) > max_err_t) max_err_t = fabs(real_turn - sim_turn);
+        sum_cpu += cpu_pct;
+        n++;
+    }
+
+    fprintf(out, "\n# Summary (%d threads)\n", n);
+    if (n > 0) {
+        fprintf(out, "Average response:   simulated %.3f, real %.3f, mean |error| %.3f\n",
+                sum_sr / n, sum_rr / n, err_r / n);
+        fprintf(out, "Average turnaround: simulated %.3f, real %.3f, mean |error| %.3f, max %.3f\n",
+                sum_st / n, sum_rt / n, err_t / n, max_err_t);
+        fprintf(out, "Busy-work calibration: %.1f%% of requested CPU time consumed\n", sum_cpu / n);
+    }
+    fprintf(out, "\n");
+}
+
+void realexec_free(RealExec* rx) {
+    for (int i = 0; i < rx->ntasks; ++i) free(rx->task[i].phases);
+    free(rx->task);
+    rx->task = NULL;
+    rx->ntasks = 0;
+}
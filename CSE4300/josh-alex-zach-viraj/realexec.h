@@ -0,0 +1,72 @@
+#ifndef REALEXEC_H
+#define REALEXEC_H
+
+#include "sim.h"
+
+/*
+  Real-execution validation.
+
+  Turns a workload into real pthreads on this machine and measures what the
+  kernel scheduler actually does with it, so simulated response and
+  turnaround can be checked against real ones.
+
+  Each thread sleeps until its arrival, then runs its CPU phases as busy
+  work and its I/O phases as sleeps. Busy work spins until the thread's own
+  CPU clock (CLOCK_THREAD_CPUTIME_ID) has advanced by the burst, so it is
+  calibrated by the kernel's accounting rather than a loop count and does
+  not stretch when the thread is preempted. All threads are pinned with
+  sched_setaffinity() to the first ncores CPUs this process may use and run
+  under the chosen policy. SCHED_FIFO and SCHED_RR need CAP_SYS_NICE; without
+  it the run falls back to SCHED_OTHER and says so in the report.
+
+  Times are scaled by `scale` (real ns per simulated ns), so a workload
+  defined in 1 ms ticks can be run faster or slower than real time.
+  Random I/O interrupts and devices are simulator-only and not reproduced.
+*/
+
+typedef enum { RX_OTHER = 0, RX_FIFO, RX_RR } RxPolicy;
+
+/* what one thread was asked to do, copied from the workload */
+typedef struct {
+    int       tid;
+    int       priority;       // simulator priority (smaller = more important)
+    simtime_t arrival;        // simulated ns
+    Phase*    phases;         // owned; one phase for plain threads
+    int       nphases;
+
+    /* measured, real ns relative to the common start */
+    simtime_t released;       // when it woke for its arrival
+    simtime_t first_run;      // first instruction after the release
+    simtime_t finished;
+    simtime_t cpu_used;       // thread CPU time actually consumed
+} RxTask;
+
+typedef struct {
+    RxTask*  task;
+    int      ntasks;
+    int      ncores;          // cores used (may be fewer than requested)
+    RxPolicy policy;          // requested policy
+    int      policy_ok;       // 0 if the policy could not be set (fell back)
+    double   scale;           // real ns per simulated ns
+} RealExec;
+
+/* Parse "fifo", "rr" or "other". Returns 0 on success, -1 if unknown. */
+int  realexec_parse_policy(const char* s, RxPolicy* out);
+
+/* Copy every thread in workload (must be called before simulating). */
+int  realexec_capture(RealExec* rx, const Queue* workload);
+
+/* Run the captured threads for real. With use_priority, SCHED_FIFO/RR
+   priorities follow the threads' priorities (for comparing against the
+   priority scheduler); otherwise all threads share one priority.
+   Returns 0 on success, 1 if no CPU is usable, 2 if out of memory, 3 if
+   the host would not create every thread (none of them run then). */
+int  realexec_run(RealExec* rx, int ncores, RxPolicy policy, double scale, int use_priority);
+
+/* Per-thread simulated vs measured response and turnaround (in ticks),
+   plus a summary. finished holds the threads after the simulation ran. */
+void realexec_report(const RealExec* rx, const Queue* finished, FILE* out);
+
+void realexec_free(RealExec* rx);
+
+#endif /* REALEXEC_H */
@@ -0,0 +1,353 @@
+#include <ctype.h>
+#include <math.h>
+#include "replay.h"
+
+enum { TS_UNKNOWN = 0, TS_RUNNING, TS_RUNNABLE, TS_SLEEPING };
+
+/* ---------------- pid -> task table ---------------- */
+
+static void table_grow(ReplayTrace* tr) {
+    int n = tr->nslots ? tr->nslots * 2 : 1024;
+    int* slot = (int*)calloc(n, sizeof(int));
+    for (int i = 0; i < tr->ntasks; ++i) {
+        unsigned h = (unsigned)tr->task[i].pid * 2654435761u % (unsigned)n;
+        while (slot[h]) h = (h + 1) % (unsigned)n;
+        slot[h] = i + 1;
+    }
+    free(tr->slot);
+    tr->slot = slot;
+    tr->nslots = n;
+}
+
+static ReplayTask* get_task(ReplayTrace* tr, int pid, const char* comm) {
+    if (2 * (tr->ntasks + 1) > tr->nslots) table_grow(tr);
+    unsigned h = (unsigned)pid * 2654435761u % (unsigned)tr->nslots;
+    while (tr->slot[h]) {
+        ReplayTask* t = &tr->task[tr->slot[h] - 1];
+        if (t->pid == pid) return t;
+        h = (h + 1) % (unsigned)tr->nslots;
+    }
+    if (tr->ntasks == tr->cap) {
+        tr->cap = tr->cap ? tr->cap * 2 : 64;
+        tr->task = (ReplayTask*)realloc(tr->task, sizeof(ReplayTask) * tr->cap);
+    }
+    ReplayTask* t = &tr->task[tr->ntasks];
+    memset(t, 0, sizeof(*t));
+    t->pid = pid;
+    t->prio = 120;
+    if (comm) snprintf(t->comm, sizeof(t->comm), "%s", comm);
+    tr->slot[h] = ++tr->ntasks;
+    return t;
+}
+
+static void push_phase(ReplayTask* t, double cpu_us) {
+    if (t->nphases == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 8;
+        t->phases = (ReplayPhase*)realloc(t->phases, sizeof(ReplayPhase) * t->cap);
+    }
+    t->phases[t->nphases].cpu_us = cpu_us;
+    t->phases[t->nphases].io_us  = 0;
+    t->nphases++;
+}
+
+/* ---------------- line parsing ---------------- */
+
+typedef struct {
+    int    is_switch;          // 1 = sched_switch, 0 = wakeup
+    double ts_us;
+    int    cpu;
+    int    prev_pid, next_pid, pid;
+    char   prev_state;
+    int    next_prio, prio;
+    char   next_comm[32], comm[32];
+} Event;
+
+/* value after key (e.g. "prev_pid=") as int; -1 if missing */
+static int kv_int(const char* s, const char* key) {
+    const char* p = strstr(s, key);
+    return p ? atoi(p + strlen(key)) : -1;
+}
+
+/* value after key up to the next " <word>=" or end of line */
+static void kv_str(const char* s, const char* key, char* out, size_t n) {
+    out[0] = '\0';
+    const char* p = strstr(s, key);
+    if (!p) return;
+    p += strlen(key);
+    const char* e = p;
+    while (*e && *e != '\n') {
+        if (*e == ' ') {
+            const char* w = e + 1;
+            while (*w && !isspace((unsigned char)*w) && *w != '=') ++w;
+            if (*w == '=') break;
+        }
+        ++e;
+    }
+    size_t len = (size_t)(e - p) < n - 1 ? (size_t)(e - p) : n - 1;
+    memcpy(out, p, len);
+    out[len] = '\0';
+}
+
+/* perf style "comm:pid [prio]" ending before end; returns pid, -1 if none */
+static int perf_task(const char* s, const char* end, char* comm, size_t n, int* prio) {
+    const char* br = NULL;
+    for (const char* p = s; p < end; ++p) if (*p == '[') br = p;
+    if (!br) return -1;
+    const char* colon = NULL;
+    for (const char* p = s; p < br; ++p) if (*p == ':') colon = p;
+    if (!colon) return -1;
+    while (s < colon && isspace((unsigned char)*s)) ++s;
+    size_t len = (size_t)(colon - s) < n - 1 ? (size_t)(colon - s) : n - 1;
+    memcpy(comm, s, len);
+    comm[len] = '\0';
+    if (prio) *prio = atoi(br + 1);
+    return atoi(colon + 1);
+}
+
+/* timestamp "12345.678901:" and cpu "[003]" from the line prefix */
+static int parse_prefix(const char* line, const char* ev, double* ts_us, int* cpu) {
+    int found = 0;
+    const char* p = line;
+    *cpu = -1;
+    while (p < ev) {
+        while (p < ev && isspace((unsigned char)*p)) ++p;
+        const char* tok = p;
+        while (p < ev && !isspace((unsigned char)*p)) ++p;
+        if (p - tok >= 3 && tok[0] == '[' && p[-1] == ']' && isdigit((unsigned char)tok[1])) {
+            *cpu = atoi(tok + 1);
+        } else if (p - tok >= 2 && p[-1] == ':' && isdigit((unsigned char)tok[0])) {
+            char* end;
+            double v = strtod(tok, &end);
+            if (end == p - 1 && memchr(tok, '.', (size_t)(p - tok))) {
+                *ts_us = v * 1e6;
+                found = 1;
+            }
+        }
+    }
+    return found;
+}
+
+static int parse_line(const char* line, Event* e) {
+    const char* ev = strstr(line, "sched_switch:");
+    const char* payload;
+    memset(e, 0, sizeof(*e));
+    if (ev) {
+        e->is_switch = 1;
+        payload = ev + strlen("sched_switch:");
+    } else {
+        ev = strstr(line, "sched_wakeup");
+        if (!ev) return 0;
+        payload = ev + strlen("sched_wakeup");
+        if (strncmp(payload, "_new", 4) == 0) payload += 4;
+        if (*payload != ':') return 0;
+        ++payload;
+    }
+    /* perf prints "sched:sched_switch:", back up over the "sched:" group */
+    const char* pre_end = ev;
+    if (pre_end - line >= 6 && strncmp(pre_end - 6, "sched:", 6) == 0) pre_end -= 6;
+    if (!parse_prefix(line, pre_end, &e->ts_us, &e->cpu)) return 0;
+
+    if (e->is_switch) {
+        if (strstr(payload, "prev_pid=")) {
+            char st[8];
+            e->prev_pid  = kv_int(payload, "prev_pid=");
+            e->next_pid  = kv_int(payload, "next_pid=");
+            e->next_prio = kv_int(payload, "next_prio=");
+            kv_str(payload, "prev_state=", st, sizeof(st));
+            e->prev_state = st[0] ? st[0] : 'R';
+            kv_str(payload, "next_comm=", e->next_comm, sizeof(e->next_comm));
+        } else {
+            /* perf: "prev:pid [prio] S ==> next:pid [prio]" */
+            const char* arrow = strstr(payload, "==>");
+            if (!arrow) return 0;
+            char tmp[32];
+            e->prev_pid = perf_task(payload, arrow, tmp, sizeof(tmp), NULL);
+            const char* st = NULL;          // state letter follows the last ']'
+            for (const char* p = payload; p < arrow; ++p) if (*p == ']') st = p;
+            e->prev_state = 'R';
+            if (st) {
+                ++st;
+                while (isspace((unsigned char)*st)) ++st;
+                if (st < arrow) e->prev_state = *st;
+            }
+            e->next_pid = perf_task(arrow + 3, arrow + strlen(arrow), e->next_comm,
+                                    sizeof(e->next_comm), &e->next_prio);
+        }
+        return e->prev_pid >= 0 && e->next_pid >= 0;
+    }
+
+    if (strstr(payload, "pid=")) {
+        e->pid  = kv_int(payload, " pid=");
+        if (e->pid < 0) e->pid = kv_int(payload, "pid=");
+        e->prio = kv_int(payload, "prio=");
+        kv_str(payload, "comm=", e->comm, sizeof(e->comm));
+    } else {
+        e->pid = perf_task(payload, payload + strlen(payload), e->comm, sizeof(e->comm), &e->prio);
+    }
+    return e->pid >= 0;
+}
+
+/* ---------------- reconstruction ---------------- */
+
+static void on_switch(ReplayTrace* tr, const Event* e) {
+    if (e->prev_pid > 0) {
+        ReplayTask* t = get_task(tr, e->prev_pid, NULL);
+        if (t->st == TS_UNKNOWN) {          // already running when the trace began
+            t->arrival_us = tr->t0;
+            t->run_start = tr->t0;
+            t->st = TS_RUNNING;
+        }
+        if (t->st == TS_RUNNING) {
+            t->cur_cpu_us += e->ts_us - t->run_start;
+            t->last_us = e->ts_us;
+            if (e->prev_state == 'R') {     // preempted, still runnable
+                t->st = TS_RUNNABLE;
+                t->runnable_since = e->ts_us;
+            } else {                        // went to sleep: CPU phase ends
+                push_phase(t, t->cur_cpu_us);
+                t->cur_cpu_us = 0;
+                t->st = TS_SLEEPING;
+                t->sleep_start = e->ts_us;
+            }
+        }
+    }
+    if (e->next_pid > 0) {
+        ReplayTask* t = get_task(tr, e->next_pid, e->next_comm);
+        if (e->next_prio >= 0) t->prio = e->next_prio;
+        if (t->st == TS_UNKNOWN) {
+            t->arrival_us = e->ts_us;
+        } else if (t->st == TS_RUNNABLE) {
+            t->rec_wait_us += e->ts_us - t->runnable_since;
+            t->rec_episodes++;
+        } else if (t->st == TS_SLEEPING && t->nphases > 0) {   // missed wakeup
+            t->phases[t->nphases - 1].io_us = e->ts_us - t->sleep_start;
+        }
+        t->st = TS_RUNNING;
+        t->run_start = e->ts_us;
+    }
+}
+
+static void on_wakeup(ReplayTrace* tr, const Event* e) {
+    if (e->pid <= 0) return;
+    ReplayTask* t = get_task(tr, e->pid, e->comm);
+    if (e->prio >= 0) t->prio = e->prio;
+    if (t->st == TS_UNKNOWN) {
+        t->arrival_us = e->ts_us;
+    } else if (t->st == TS_SLEEPING) {
+        if (t->nphases > 0) t->phases[t->nphases - 1].io_us = e->ts_us - t->sleep_start;
+    } else {
+        return;                             // already runnable or running
+    }
+    t->st = TS_RUNNABLE;
+    t->runnable_since = e->ts_us;
+}
+
+int replay_load(ReplayTrace* tr, const char* path) {
+    memset(tr, 0, sizeof(*tr));
+    FILE* f = fopen(path, "r");
+    if (!f) return 1;
+
+    char line[1024];
+    long nswitch = 0;
+    int first = 1;
+    Event e;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || !parse_line(line, &e)) continue;
+        if (first) { tr->t0 = e.ts_us; first = 0; }
+        tr->t_end = e.ts_us;
+        if (e.cpu + 1 > tr->ncpus) tr->ncpus = e.cpu + 1;
+        if (e.is_switch) { on_switch(tr, &e); nswitch++; }
+        else             on_wakeup(tr, &e);
+        tr->nevents++;
+    }
+    fclose(f);
+
+    /* close CPU phases still open at the end of the capture */
+    for (int i = 0; i < tr->ntasks; ++i) {
+        ReplayTask* t = &tr->task[i];
+        if (t->st == TS_RUNNING) {
+            t->cur_cpu_us += tr->t_end - t->run_start;
+            t->last_us = tr->t_end;
+        }
+        if (t->cur_cpu_us > 0) push_phase(t, t->cur_cpu_us);
+        t->cur_cpu_us = 0;
+        if (t->nphases > 0) t->phases[t->nphases - 1].io_us = 0;   // no trailing sleep
+    }
+    if (tr->ncpus < 1) tr->ncpus = 1;
+    return nswitch > 0 ? 0 : 2;
+}
+
+static simtime_t us_to_ns(double us) {
+    return (simtime_t)llround(us * NS_PER_US);
+}
+
+int replay_build_workload(const ReplayTrace* tr, Queue* workload) {
+    int added = 0;
+    int cap = 0;
+    Phase* ph = NULL;
+    for (int i = 0; i < tr->ntasks; ++i) {
+        const ReplayTask* t = &tr->task[i];
+        if (t->nphases == 0) continue;
+        if (t->nphases > cap) {
+            cap = t->nphases;
+            ph = (Phase*)realloc(ph, sizeof(Phase) * cap);
+        }
+        for (int k = 0; k < t->nphases; ++k) {
+            ph[k].cpu = us_to_ns(t->phases[k].cpu_us);
+            if (ph[k].cpu < 1) ph[k].cpu = 1;            // every burst runs at least 1 ns
+            ph[k].io  = us_to_ns(t->phases[k].io_us);
+        }
+        int prio = t->prio - 100;                        // kernel 100..139 -> 0..39
+        if (prio < 0) prio = 0;
+        workload_add_phases(workload, i + 1, us_to_ns(t->arrival_us - tr->t0),
+                            ph, t->nphases, prio);
+        added++;
+    }
+    free(ph);
+    return added;
+}
+
+void replay_report(const ReplayTrace* tr, const Queue* finished, FILE* out) {
+    fprintf(out, "# Replay: %ld events, %d tasks, %d CPUs, %.3f s captured, tick=%.1f us\n",
+            tr->nevents, tr->ntasks, tr->ncpus, (tr->t_end - tr->t0) / 1e6,
+            (double)SIM_TICK_NS / NS_PER_US);
+    fprintf(out, "%-8s %-16s %8s %12s %12s %12s %12s %12s\n", "PID", "COMM", "BURSTS",
+            "REC_LAT_us", "SIM_LAT_us", "DIFF_us", "REC_TURN_us", "SIM_TURN_us");
+
+    int n = 0;
+    double sum_rec = 0, sum_sim = 0, sum_abs = 0, sum_turn_abs = 0;
+    for (const Thread* p = finished->front; p; p = p->next) {
+        if (p->tid < 1 || p->tid > tr->ntasks) continue;
+        const ReplayTask* t = &tr->task[p->tid - 1];
+
+        double rec_lat = t->rec_episodes ? t->rec_wait_us / t->rec_episodes : 0.0;
+        double sim_lat = p->ready_count ? (double)p->wait_time / p->ready_count / NS_PER_US : 0.0;
+        double rec_turn = t->last_us - t->arrival_us;
+        double sim_turn = (double)(p->finish_time - p->arrival_time) / NS_PER_US;
+
+        fprintf(out, "%-8d %-16s %8d %12.1f %12.1f %12.1f %12.1f %12.1f\n",
+                t->pid, t->comm[0] ? t->comm : "?", t->nphases,
+                rec_lat, sim_lat, sim_lat - rec_lat, rec_turn, sim_turn);
+        sum_rec += rec_lat;
+        sum_sim += sim_lat;
+        sum_abs += fabs(sim_lat - rec_lat);
+        sum_turn_abs += fabs(sim_turn - rec_turn);
+        n++;
+    }
+
+    fprintf(out, "\n# Divergence summary (%d tasks)\n", n);
+    if (n > 0) {
+        fprintf(out, "Mean recorded latency:    %.1f us\n", sum_rec / n);
+        fprintf(out, "Mean simulated latency:   %.1f us\n", sum_sim / n);
+        fprintf(out, "Mean |latency error|:     %.1f us\n", sum_abs / n);
+        fprintf(out, "Mean |turnaround error|:  %.1f us\n", sum_turn_abs / n);
+    }
+    fprintf(out, "\n");
+}
+
+void replay_free(ReplayTrace* tr) {
+    for (int i = 0; i < tr->ntasks; ++i) free(tr->task[i].phases);
+    free(tr->task);
+    free(tr->slot);
+    memset(tr, 0, sizeof(*tr));
+}
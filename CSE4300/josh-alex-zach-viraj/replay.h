@@ -0,0 +1,70 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "sim.h"
+
+/*
+  Replay of real kernel scheduling traces.
+
+  Reads the text output of ftrace (sched_switch / sched_wakeup events, e.g.
+  /sys/kernel/tracing/trace) or `perf sched script`, rebuilds each task as
+  an arrival time plus alternating CPU bursts and sleeps, and turns that into
+  scripted threads (see workload_add_phases) that any DispatchAlgo can run.
+  After the run, replay_report() puts the recorded per-task scheduling
+  latency (runnable -> on CPU) next to the simulated one.
+
+  Capture, for example:
+    trace-cmd record -e sched_switch -e sched_wakeup ... ; trace-cmd report > t.txt
+    perf sched record ... ; perf sched script > t.txt
+*/
+
+/* one CPU burst followed by a sleep, in microseconds */
+typedef struct {
+    double cpu_us;
+    double io_us;
+} ReplayPhase;
+
+typedef struct {
+    int    pid;
+    char   comm[32];
+    int    prio;            // kernel prio (lower is more important)
+    double arrival_us;      // first time seen runnable
+    double last_us;         // last time seen running
+    ReplayPhase* phases;
+    int    nphases, cap;
+
+    /* recorded latency: time runnable before getting a CPU */
+    double rec_wait_us;
+    int    rec_episodes;
+
+    /* reconstruction state */
+    int    st;
+    double run_start, runnable_since, sleep_start, cur_cpu_us;
+} ReplayTask;
+
+typedef struct {
+    ReplayTask* task;
+    int    ntasks, cap;
+    int*   slot;            // pid -> task index + 1 (open addressing)
+    int    nslots;
+    int    ncpus;           // highest CPU number seen + 1
+    double t0, t_end;       // first and last timestamp (us)
+    long   nevents;
+} ReplayTrace;
+
+/* Parse a trace file. Returns 0 on success, nonzero on error
+   (including a file with no sched_switch events). */
+int  replay_load(ReplayTrace* tr, const char* path);
+
+/* Add one scripted thread per task (tid = index + 1) with the recorded
+   burst and sleep lengths at full (ns) resolution. Returns the number of
+   threads added. */
+int  replay_build_workload(const ReplayTrace* tr, Queue* workload);
+
+/* Per-task recorded vs simulated latency and turnaround, plus a summary.
+   finished holds the threads after the simulation ran. */
+void replay_report(const ReplayTrace* tr, const Queue* finished, FILE* out);
+
+void replay_free(ReplayTrace* tr);
+
+#endif /* REPLAY_H */
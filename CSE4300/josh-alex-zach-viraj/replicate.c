@@ -0,0 +1,266 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <unistd.h>
+#include <math.h>
+#include "replicate.h"
+#include "checkpoint.h"
+#include "util.h"
+
+static const char* const metric_key[REP_NMETRIC] = {
+    "resp", "turn", "wait", "p99", "makespan", "tput"
+};
+
+const char* repmetric_name(RepMetric m) {
+    switch (m) {
+        case REP_RESP:     return "mean response";
+        case REP_TURN:     return "mean turnaround";
+        case REP_WAIT:     return "mean waiting";
+        case REP_P99:      return "p99 response";
+        case REP_MAKESPAN: return "makespan";
+        case REP_TPUT:     return "throughput";
+        case REP_NMETRIC:  break;
+    }
+    return "?";
+}
+
+int replicate_parse(const char* spec, ReplicateConfig* cfg) {
+    char buf[512], *opts, *k, *v;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->metric   = REP_P99;
+    cfg->ci       = 2.0;
+    cfg->min_reps = 5;
+    cfg->max_reps = 50;
+    snprintf(cfg->out, sizeof(cfg->out), "replicate_report.txt");
+    if (spec_split(spec, buf, sizeof(buf), 0, NULL, &opts) != 0) return -1;
+
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) return -1;
+        if (strcmp(k, "metric") == 0) {
+            int m = 0;
+            while (m < REP_NMETRIC && strcmp(v, metric_key[m]) != 0) m++;
+            if (m == REP_NMETRIC) return -1;
+            cfg->metric = (RepMetric)m;
+        } else if (strcmp(k, "ci") == 0) {
+            cfg->ci = atof(v);
+            if (cfg->ci <= 0) return -1;
+        } else if (strcmp(k, "min") == 0) {
+            cfg->min_reps = atoi(v);
+        } else if (strcmp(k, "max") == 0) {
+            cfg->max_reps = atoi(v);
+        } else if (strcmp(k, "workers") == 0) {
+            cfg->workers = atoi(v);
+            if (cfg->workers < 1) return -1;
+        } else if (strcmp(k, "out") == 0) {
+            if (v[0] == '\0' || strlen(v) >= sizeof(cfg->out)) return -1;
+            snprintf(cfg->out, sizeof(cfg->out), "%s", v);
+        } else {
+            return -1;
+        }
+    }
+    if (cfg->min_reps < 2 || cfg->max_reps < cfg->min_reps) return -1;
+    return 0;
+}
+
+/* two-sided 95% quantile of Student's t with df degrees of freedom */
+static double t95(int df) {
+    static const double t[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (df < 1) return HUGE_VAL;
+    if (df <= 30) return t[df];
+    return 1.960 + 2.37 / df;   // Cornish-Fisher, close enough past 30
+}
+
+static void stats(const Replicator* r, RepMetric m, double* mean, double* sd) {
+    double sum = 0, sq = 0;
+    for (int i = 0; i < r->n; ++i) sum += r->val[i * REP_NMETRIC + m];
+    *mean = r->n > 0 ? sum / r->n : 0.0;
+    for (int i = 0; i < r->n; ++i) {
+        double d = r->val[i * REP_NMETRIC + m] - *mean;
+        sq += d * d;
+    }
+    *sd = r->n > 1 ? sqrt(sq / (r->n - 1)) : 0.0;
+}
+
+void replicate_ci(const Replicator* r, RepMetric m, double* mean, double* half) {
+    double sd;
+    stats(r, m, mean, &sd);
+    *half = r->n > 1 ? t95(r->n - 1) * sd / sqrt((double)r->n) : HUGE_VAL;
+}
+
+/* ---------------- Running replicas ---------------- */
+
+typedef struct {
+    Sim     sim;
+    int     ok;
+    double* val;             // REP_NMETRIC slots
+} Replica;
+
+typedef struct {
+    Replica* rep;
+    int n;
+    int next;                // next replica to take
+    pthread_mutex_t lock;
+    simtime_t t0;            // start state's clock
+    int base_finished;       // threads already finished in the start state
+} Batch;
+
+static void measure(const Sim* s, const Batch* b, double* v) {
+    FinishStats st;
+    finish_stats(&s->finished, &st);
+    double span = to_ticks(s->now - b->t0);
+    v[REP_RESP]     = st.resp;
+    v[REP_TURN]     = st.turn;
+    v[REP_WAIT]     = st.wait;
+    v[REP_P99]      = st.p99_resp;
+    v[REP_MAKESPAN] = span;
+    v[REP_TPUT]     = span > 0 ? (s->finished.size - b->base_finished) / span : 0.0;
+}
+
+static void* rep_worker(void* arg) {
+    Batch* b = (Batch*)arg;
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        int i = b->next++;
+        pthread_mutex_unlock(&b->lock);
+        if (i >= b->n) break;
+        Replica* p = &b->rep[i];
+        if (!p->ok) continue;
+        sim_run(&p->sim, -1);
+        measure(&p->sim, b, p->val);
+        sim_free(&p->sim);
+    }
+    return NULL;
+}
+
+/* replica from the snapshot, with its own random stream */
+static int load_snapshot(Sim* s, unsigned long long seed, void* ctx) {
+    if (sim_checkpoint_load(s, (const char*)ctx, 1) != 0) return 1;
+    rng_seed(&s->rng, seed);
+    return 0;
+}
+
+int replicate_run(Replicator* r, const ReplicateConfig* cfg, const Sim* base,
+                  unsigned long long seed, ReplicaBuild build, void* ctx) {
+    memset(r, 0, sizeof(*r));
+    r->cfg  = *cfg;
+    r->seed = seed;
+    r->workers = cfg->workers;
+    if (r->workers < 1) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        r->workers = n < 1 ? 1 : n > 64 ? 64 : (int)n;
+    }
+
+    char snap[REP_PATH_LEN + 16] = "";
+    if (!build) {
+        snprintf(snap, sizeof(snap), "%s.XXXXXX", cfg->out);
+        int fd = mkstemp(snap);
+        if (fd < 0) return 1;
+        close(fd);
+        if (sim_checkpoint_save(base, snap) != 0) {
+            remove(snap);
+            return 1;
+        }
+        build = load_snapshot;
+        ctx   = snap;
+    }
+
+    r->val = (double*)malloc(sizeof(double) * REP_NMETRIC * cfg->max_reps);
+    int tried = 0;
+    while (tried < cfg->max_reps) {
+        Batch b;
+        b.n = cfg->max_reps - tried < r->workers ? cfg->max_reps - tried : r->workers;
+        b.rep  = (Replica*)calloc(b.n, sizeof(Replica));
+        b.next = 0;
+        b.t0   = base->now;
+        b.base_finished = base->finished.size;
+        pthread_mutex_init(&b.lock, NULL);
+
+        /* built here: loading sets the global tick length */
+        int built = 0;
+        for (int i = 0; i < b.n; ++i) {
+            Replica* p = &b.rep[i];
+            p->ok = build(&p->sim, seed + tried + i, ctx) == 0;
+            if (!p->ok) continue;
+            p->val = &r->val[(r->n + built) * REP_NMETRIC];
+            built++;
+        }
+        pthread_t* tids = (pthread_t*)malloc(sizeof(pthread_t) * b.n);
+        /* workers draw from the shared batch, so one the host refuses
+           only means fewer hands; join the ones that started */
+        int started = 1;   // the calling thread is worker 0
+        for (int w = 1; w < b.n; ++w)
+            if (pthread_create(&tids[started], NULL, rep_worker, &b) == 0) started++;
+        rep_worker(&b);
+        for (int w = 1; w < started; ++w) pthread_join(tids[w], NULL);
+        pthread_mutex_destroy(&b.lock);
+        free(tids);
+        free(b.rep);
+
+        r->n      += built;
+        r->failed += b.n - built;
+        tried     += b.n;
+        if (built == 0) break;
+
+        if (r->n >= cfg->min_reps) {
+            double mean, half;
+            replicate_ci(r, cfg->metric, &mean, &half);
+            if (half <= cfg->ci / 100.0 * fabs(mean)) {
+                r->stopped_early = tried < cfg->max_reps;
+                break;
+            }
+        }
+    }
+    if (snap[0]) remove(snap);
+    return 0;
+}
+
+void replicate_free(Replicator* r) {
+    free(r->val);
+    r->val = NULL;
+    r->n = 0;
+}
+
+void replicate_report(const Replicator* r, FILE* out) {
+    const ReplicateConfig* c = &r->cfg;
+    fprintf(out, "# Replications (times in ticks)\n");
+    fprintf(out, "Seeds %llu..%llu on %d workers: %d runs", r->seed,
+            r->seed + (unsigned long long)(r->n + r->failed) - 1, r->workers, r->n);
+    if (r->failed) fprintf(out, ", %d could not be built", r->failed);
+    fprintf(out, "\n");
+    if (r->n == 0) {
+        fprintf(out, "\n");
+        return;
+    }
+
+    double mean, half;
+    replicate_ci(r, c->metric, &mean, &half);
+    fprintf(out, "Target: %s within %g%% of the mean; %s (half-width %.2f%%)\n\n",
+            repmetric_name(c->metric), c->ci,
+            r->stopped_early ? "met early"
+                             : half <= c->ci / 100.0 * fabs(mean) ? "met at max" : "not met",
+            mean != 0 ? 100.0 * half / fabs(mean) : 0.0);
+
+    fprintf(out, "%-16s %12s %12s %12s %12s %8s\n",
+            "METRIC", "MEAN", "STDDEV", "CI95_LO", "CI95_HI", "HALF%");
+    for (int m = 0; m < REP_NMETRIC; ++m) {
+        double sd;
+        stats(r, (RepMetric)m, &mean, &sd);
+        replicate_ci(r, (RepMetric)m, &mean, &half);
+        fprintf(out, "%-16s %12.4f %12.4f %12.4f %12.4f %8.2f\n",
+                repmetric_name((RepMetric)m), mean, sd, mean - half, mean + half,
+                mean != 0 ? 100.0 * half / fabs(mean) : 0.0);
+    }
+
+    fprintf(out, "\n%8s %10s %10s %10s %10s %10s %8s\n",
+            "RUN", "RESP", "TURN", "WAIT", "P99", "MAKESPAN", "TPUT");
+    for (int i = 0; i < r->n; ++i) {
+        const double* v = &r->val[i * REP_NMETRIC];
+        fprintf(out, "%8d %10.3f %10.3f %10.3f %10.3f %10.3f %8.4f\n", i,
+                v[REP_RESP], v[REP_TURN], v[REP_WAIT], v[REP_P99], v[REP_MAKESPAN], v[REP_TPUT]);
+    }
+    fprintf(out, "(CI95 = mean +- t(0.975, n-1) * stddev / sqrt(n), HALF%% = half-width / mean,\n"
+                 " TPUT = finished threads per tick)\n\n");
+}
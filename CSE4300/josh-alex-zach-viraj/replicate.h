@@ -0,0 +1,80 @@
+#ifndef REPLICATE_H
+#define REPLICATE_H
+
+#include "engine.h"
+
+/*
+  Monte Carlo replications: the same set-up simulation run under
+  independent seeds, with each metric reported as a mean, a standard
+  deviation and a 95% confidence interval (Student's t).
+
+  Replication i uses seed base + i, so replication 0 is the single run a
+  normal invocation with that seed makes. A replica is built either by the
+  caller's callback (which can draw a fresh workload from the seed) or,
+  without one, by loading a snapshot of the base Sim and reseeding its
+  generator, which varies random interrupts and I/O but not the workload.
+
+  Replications run in batches of one per worker thread. After each batch,
+  once at least min have run, the runner stops if the confidence interval
+  of the chosen metric is within ci percent of its mean (half-width), or
+  when max have run.
+*/
+
+#define REP_PATH_LEN 256
+
+typedef enum {
+    REP_RESP = 0,    // mean response time
+    REP_TURN,        // mean turnaround
+    REP_WAIT,        // mean waiting time
+    REP_P99,         // 99th percentile response time
+    REP_MAKESPAN,    // start state to the last finish
+    REP_TPUT,        // finished threads per tick
+    REP_NMETRIC
+} RepMetric;
+
+typedef struct {
+    RepMetric metric;        // drives the early stop
+    double    ci;            // target half-width, percent of the mean
+    int       min_reps;
+    int       max_reps;
+    int       workers;       // host threads, 0 = online CPUs
+    char      out[REP_PATH_LEN];
+} ReplicateConfig;
+
+/* Build replica *s for seed on the calling thread; 0 on success (s ready
+   to run, with its own run trace), nonzero on error (s left freed). */
+typedef int (*ReplicaBuild)(Sim* s, unsigned long long seed, void* ctx);
+
+typedef struct {
+    ReplicateConfig cfg;
+    unsigned long long seed;  // of replication 0
+    int     workers;          // host threads used
+    int     n;                // replications run
+    int     failed;           // of those, could not be built
+    double* val;              // val[i * REP_NMETRIC + m]
+    int     stopped_early;    // the target was met before max
+} Replicator;
+
+/* Parse "key=val,..." with keys metric=resp|turn|wait|p99|makespan|tput,
+   ci=PCT, min=N, max=N, workers=N, out=PATH (default p99, 2%, 5..50
+   replications, replicate_report.txt). Returns 0 on success, -1 on error. */
+int  replicate_parse(const char* spec, ReplicateConfig* cfg);
+
+/* Run the replications from base's current state; base is not changed.
+   build may be NULL (see above). Returns 0 on success, nonzero if the
+   snapshot could not be written. */
+int  replicate_run(Replicator* r, const ReplicateConfig* cfg, const Sim* base,
+                   unsigned long long seed, ReplicaBuild build, void* ctx);
+
+/* Mean, standard deviation and 95% confidence interval of every metric,
+   then the metrics of each replication. */
+void replicate_report(const Replicator* r, FILE* out);
+
+/* Mean and confidence half-width of metric m over the replications run */
+void replicate_ci(const Replicator* r, RepMetric m, double* mean, double* half);
+
+void replicate_free(Replicator* r);
+
+const char* repmetric_name(RepMetric m);
+
+#endif /* REPLICATE_H */
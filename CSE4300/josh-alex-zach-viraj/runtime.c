@@ -0,0 +1,301 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <ucontext.h>
+#include <stdint.h>
+#include <time.h>
+#include "runtime.h"
+
+#define RT_STACK_SIZE (64 * 1024)
+
+struct RtWorker;
+
+/* a task; the Thread comes first so Queue/CPU code can carry it */
+typedef struct Fiber {
+    Thread      t;
+    ucontext_t  ctx;
+    void*       stack;
+    TaskFn      fn;
+    void*       arg;
+    simtime_t   ran;                // CPU time actually used
+    int         done;
+    struct RtWorker* volatile on;   // worker currently running it
+} Fiber;
+
+typedef struct RtWorker {
+    Runtime*    rt;
+    int         id;
+    pthread_t   th;
+    int         started;            // th is a running thread
+    ucontext_t  sched;              // the worker's scheduling loop
+    CPU         view;               // one-core window onto rt->cpu
+    long        switches;
+} RtWorker;
+
+struct Runtime {
+    pthread_mutex_t lock;           // guards everything below
+    pthread_cond_t  work;           // Ready gained a task, or all done
+    Sched       sched;              // holds the Ready tasks
+    Queue       ready;              // spawned, not yet handed to the policy
+    Queue       finished;
+    CPU         cpu;                // core[w] = task bound to worker w
+    int         live;               // spawned and not finished
+    int         next_tid;
+    simtime_t   epoch;              // CLOCK_MONOTONIC at rt_create()
+
+    int         nworkers;
+    int         nstarted;           // workers rt_run() could start
+    RtWorker*   worker;
+};
+
+/* task running on this host thread, NULL outside tasks */
+static _Thread_local Fiber* cur_fiber;
+
+static simtime_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (simtime_t)ts.tv_sec * NS_PER_S + ts.tv_nsec;
+}
+
+static simtime_t rt_now(const Runtime* rt) {
+    return mono_ns() - rt->epoch;
+}
+
+Runtime* rt_create(int nworkers, DispatchAlgo algo, simtime_t quantum, const char* path) {
+    if (nworkers < 1) nworkers = 1;
+    Runtime* rt = (Runtime*)calloc(1, sizeof(Runtime));
+    if (!rt) return NULL;
+    if (sched_open(&rt->sched, algo, quantum, path) != 0) {
+        free(rt);
+        return NULL;
+    }
+    pthread_mutex_init(&rt->lock, NULL);
+    pthread_cond_init(&rt->work, NULL);
+    q_init(&rt->ready);
+    q_init(&rt->finished);
+    cpu_init(&rt->cpu, nworkers);
+    rt->next_tid = 1;
+    rt->epoch    = mono_ns();
+
+    rt->nworkers = nworkers;
+    rt->worker   = (RtWorker*)calloc(nworkers, sizeof(RtWorker));
+    for (int i = 0; i < nworkers; ++i) {
+        RtWorker* w = &rt->worker[i];
+        w->rt = rt;
+        w->id = i;
+        /* policies only ever see this worker's core */
+        w->view.ncores   = 1;
+        w->view.core     = &rt->cpu.core[i];
+        w->view.cs_ns    = 0;
+        w->view.cs_left  = &rt->cpu.cs_left[i];
+        w->view.last_tid = &rt->cpu.last_tid[i];
+        w->view.run_trace = NULL;
+        w->view.trace_len = 0;
+    }
+    return rt;
+}
+
+/* makecontext passes ints, so the Fiber pointer comes in two halves */
+static void fiber_entry(unsigned hi, unsigned lo) {
+    Fiber* f = (Fiber*)(((uintptr_t)hi << 16 << 16) | lo);
+    f->fn(f->arg);
+    f->done = 1;
+    setcontext(&f->on->sched);   // whichever worker runs it now
+}
+
+int rt_spawn(Runtime* rt, TaskFn fn, void* arg, simtime_t expected, int priority) {
+    Fiber* f = (Fiber*)calloc(1, sizeof(Fiber));
+    if (!f) return -1;
+    f->stack = malloc(RT_STACK_SIZE);
+    if (!f->stack || getcontext(&f->ctx) != 0) {
+        free(f->stack);
+        free(f);
+        return -1;
+    }
+    f->fn  = fn;
+    f->arg = arg;
+    f->ctx.uc_stack.ss_sp   = f->stack;
+    f->ctx.uc_stack.ss_size = RT_STACK_SIZE;
+    f->ctx.uc_link = NULL;
+    uintptr_t p = (uintptr_t)f;
+    makecontext(&f->ctx, (void (*)(void))fiber_entry, 2,
+                (unsigned)(p >> 16 >> 16), (unsigned)(p & 0xffffffffu));
+
+    Thread* t = &f->t;
+    t->burst_time  = expected > 0 ? expected : 1;
+    t->remaining   = t->burst_time;
+    t->start_time  = -1;
+    t->finish_time = -1;
+    t->unblocked_at = -1;
+    t->priority    = priority;
+    t->gang        = -1;
+
+    pthread_mutex_lock(&rt->lock);
+    SIM_TIME = rt_now(rt);
+    t->tid = rt->next_tid++;
+    t->arrival_time = SIM_TIME;
+    mark_ready(t);
+    q_push(&rt->ready, t);
+    rt->live++;
+    pthread_cond_signal(&rt->work);
+    pthread_mutex_unlock(&rt->lock);
+    return t->tid;
+}
+
+void rt_yield(void) {
+    Fiber* f = cur_fiber;
+    if (!f) return;
+    swapcontext(&f->ctx, &f->on->sched);
+    /* may resume on a different worker */
+}
+
+static simtime_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (simtime_t)ts.tv_sec * NS_PER_S + ts.tv_nsec;
+}
+
+void rt_spin(simtime_t ns, simtime_t slice) {
+    if (slice < 1) slice = ns;
+    volatile unsigned sink = 0;
+    while (ns > 0) {
+        /* the worker's CPU clock only counts this task between yields */
+        simtime_t t0 = thread_cpu_ns(), used = 0;
+        simtime_t want = ns < slice ? ns : slice;
+        while (used < want) {
+            for (unsigned i = 0; i < 256; ++i) sink += i;
+            used = thread_cpu_ns() - t0;
+        }
+        ns -= used;
+        if (ns > 0) rt_yield();
+    }
+}
+
+/* charge a run of ran ns to f; remaining stays >= 1 until the task returns */
+static void charge(Fiber* f, simtime_t ran) {
+    Thread* t = &f->t;
+    f->ran += ran;
+    t->remaining -= ran;
+    if (t->remaining < 1) t->remaining = 1;
+    t->quanta_rem -= ran;
+    if (t->quanta_rem < 0) t->quanta_rem = 0;
+}
+
+static void* worker_main(void* arg) {
+    RtWorker* w = (RtWorker*)arg;
+    Runtime* rt = w->rt;
+
+    pthread_mutex_lock(&rt->lock);
+    for (;;) {
+        SIM_TIME = rt_now(rt);
+        sched_dispatch(&rt->sched, &w->view, &rt->ready);
+        Fiber* f = (Fiber*)rt->cpu.core[w->id];
+        if (!f) {
+            if (rt->live == 0) break;
+            pthread_cond_wait(&rt->work, &rt->lock);
+            continue;
+        }
+        if (rt->sched.nready > 0) pthread_cond_signal(&rt->work);   // wake an idle worker
+        pthread_mutex_unlock(&rt->lock);
+
+        f->on = w;
+        cur_fiber = f;
+        /* charge CPU time, not wall time, so an oversubscribed host
+           does not bill tasks for time their worker was descheduled */
+        simtime_t t0 = thread_cpu_ns();
+        swapcontext(&w->sched, &f->ctx);
+        simtime_t ran = thread_cpu_ns() - t0;
+        cur_fiber = NULL;
+        w->switches++;
+
+        pthread_mutex_lock(&rt->lock);
+        SIM_TIME = rt_now(rt);
+        charge(f, ran);
+        if (f->done) {
+            cpu_unbind_core(&rt->cpu, w->id);
+            f->t.state       = ST_FINISHED;
+            f->t.remaining   = 0;
+            f->t.finish_time = SIM_TIME;
+            free(f->stack);
+            f->stack = NULL;
+            q_push(&rt->finished, &f->t);
+            if (--rt->live == 0) pthread_cond_broadcast(&rt->work);
+        }
+    }
+    pthread_cond_broadcast(&rt->work);   // let the others see live == 0
+    pthread_mutex_unlock(&rt->lock);
+    return NULL;
+}
+
+int rt_run(Runtime* rt) {
+    /* a worker only dispatches to its own core, so the ones that started
+       share the tasks if the host refuses some */
+    rt->nstarted = 0;
+    for (int i = 0; i < rt->nworkers; ++i) {
+        RtWorker* w = &rt->worker[i];
+        w->started = pthread_create(&w->th, NULL, worker_main, w) == 0;
+        rt->nstarted += w->started;
+    }
+    for (int i = 0; i < rt->nworkers; ++i)
+        if (rt->worker[i].started) pthread_join(rt->worker[i].th, NULL);
+    return rt->nstarted > 0 ? 0 : -1;
+}
+
+void rt_report(const Runtime* rt, FILE* out) {
+    long switches = 0;
+    for (int i = 0; i < rt->nworkers; ++i) switches += rt->worker[i].switches;
+    fprintf(out, "# M:N runtime: %d workers", rt->nstarted);
+    if (rt->nstarted < rt->nworkers) fprintf(out, " (of %d, the host refused the others)", rt->nworkers);
+    fprintf(out, ", %s, %ld fiber switches (times in us)\n", sched_name(&rt->sched), switches);
+    fprintf(out, "%-6s %10s %10s %10s %12s %10s\n",
+            "TID", "EXPECTED", "RAN", "RESPONSE", "TURNAROUND", "WAIT");
+
+    int n = 0;
+    double sum_resp = 0, sum_turn = 0, sum_wait = 0;
+    for (const Thread* t = rt->finished.front; t; t = t->next) {
+        const Fiber* f = (const Fiber*)t;
+        double resp = (double)(t->start_time  - t->arrival_time) / NS_PER_US;
+        double turn = (double)(t->finish_time - t->arrival_time) / NS_PER_US;
+        double wait = (double)t->wait_time / NS_PER_US;
+        fprintf(out, "%-6d %10.1f %10.1f %10.1f %12.1f %10.1f\n", t->tid,
+                (double)t->burst_time / NS_PER_US, (double)f->ran / NS_PER_US,
+                resp, turn, wait);
+        sum_resp += resp;
+        sum_turn += turn;
+        sum_wait += wait;
+        n++;
+    }
+    if (n > 0) {
+        fprintf(out, "\nAverage response time:   %.1f us\n", sum_resp / n);
+        fprintf(out, "Average turnaround time: %.1f us\n", sum_turn / n);
+        fprintf(out, "Average waiting time:    %.1f us\n", sum_wait / n);
+    }
+    fprintf(out, "\n");
+}
+
+static void free_fibers(Queue* q) {
+    while (!q_empty(q)) {
+        Fiber* f = (Fiber*)q_pop(q);
+        free(f->stack);
+        free(f);
+    }
+}
+
+void rt_destroy(Runtime* rt) {
+    if (!rt) return;
+    sched_drain(&rt->sched, &rt->ready);
+    sched_close(&rt->sched);
+    free_fibers(&rt->ready);
+    free_fibers(&rt->finished);
+    for (int c = 0; c < rt->cpu.ncores; ++c) {
+        Fiber* f = (Fiber*)cpu_unbind_core(&rt->cpu, c);
+        if (f) {
+            free(f->stack);
+            free(f);
+        }
+    }
+    cpu_free(&rt->cpu);
+    pthread_mutex_destroy(&rt->lock);
+    pthread_cond_destroy(&rt->work);
+    free(rt->worker);
+    free(rt);
+}
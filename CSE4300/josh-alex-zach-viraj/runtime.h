@@ -0,0 +1,63 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include "sim.h"
+#include "sched.h"
+
+/*
+  User-level M:N task runtime.
+
+  Real tasks (ucontext fibers, each with its own stack) are multiplexed onto
+  a pool of worker pthreads and scheduled by the simulator's own policies
+  (sched.h). Every task carries a Thread record, so the policies see
+  exactly what they see in the simulator: enqueue/pick_next of Ready tasks,
+  one core per worker, remaining/priority/quanta_rem.
+
+  Scheduling is cooperative. A task runs until it returns or calls
+  rt_yield(); at that point its worker charges the CPU time it used
+  (remaining, quanta_rem) and runs the policy on its own core only.
+  Non-preemptive policies keep the task running; RR switches once the quantum is used up;
+  SRTCF and priority switch if a better task is Ready. Idle workers take
+  from Ready as soon as something arrives.
+
+  Times are CLOCK_MONOTONIC ns since rt_create(), so the Thread fields
+  (start_time, finish_time, wait_time) use the same units as a simulation.
+
+  The Runtime is opaque: ucontext and pthread types stay out of this header
+  so it can be included from strict C11 code.
+*/
+
+typedef void (*TaskFn)(void* arg);
+
+typedef struct Runtime Runtime;
+
+/* A runtime with nworkers workers (not started yet) scheduled by built-in
+   policy algo, or by the shared object at path if path is non-empty
+   (see sched_open). NULL on error. */
+Runtime* rt_create(int nworkers, DispatchAlgo algo, simtime_t quantum, const char* path);
+
+/* Create a task running fn(arg). expected is the caller's estimate of its
+   CPU time (used by SJF/SRTCF), priority as in the simulator (smaller
+   wins). Safe to call before rt_run() or from inside a task.
+   Returns the task id, or -1 on error. */
+int  rt_spawn(Runtime* rt, TaskFn fn, void* arg, simtime_t expected, int priority);
+
+/* Scheduling point for the calling task; a no-op outside a task. */
+void rt_yield(void);
+
+/* Busy work for benchmarks: burn ns of CPU time in the calling task,
+   calling rt_yield() after every slice ns. */
+void rt_spin(simtime_t ns, simtime_t slice);
+
+/* Start the workers and return once every task has finished. Workers the
+   host will not create are skipped. Returns 0, or -1 if no worker could
+   be started (no task ran). */
+int  rt_run(Runtime* rt);
+
+/* Per-task response, turnaround and wait (us) plus averages. */
+void rt_report(const Runtime* rt, FILE* out);
+
+/* Free all tasks and the runtime. */
+void rt_destroy(Runtime* rt);
+
+#endif /* RUNTIME_H */
@@ -0,0 +1,126 @@
+#define _POSIX_C_SOURCE 200809L
+#include <dlfcn.h>
+#include "sched_run.h"
+
+/* load a policy from a shared object; 0 on success */
+static int load_so(Sched* s, const char* path) {
+    void* dl = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!dl) {
+        fprintf(stderr, "sched: %s\n", dlerror());
+        return -1;
+    }
+    const SchedOps* ops = (const SchedOps*)dlsym(dl, "sched_ops");
+    if (!ops) {
+        fprintf(stderr, "sched: %s does not export sched_ops\n", path);
+        dlclose(dl);
+        return -1;
+    }
+    if (ops->abi != SCHED_OPS_ABI || !ops->enqueue || !ops->dequeue ||
+        !ops->pick_next || !ops->for_each) {
+        fprintf(stderr, "sched: %s: incompatible or incomplete sched_ops (abi %d, want %d)\n",
+                path, ops->abi, SCHED_OPS_ABI);
+        dlclose(dl);
+        return -1;
+    }
+    s->ops = ops;
+    s->dl  = dl;
+    snprintf(s->path, sizeof(s->path), "%s", path);
+    return 0;
+}
+
+int sched_open(Sched* s, DispatchAlgo algo, simtime_t quantum, const char* path) {
+    memset(s, 0, sizeof(*s));
+    if (path && path[0]) {
+        if (strlen(path) >= SCHED_PATH_LEN) {
+            fprintf(stderr, "sched: path too long: %s\n", path);
+            return -1;
+        }
+        if (load_so(s, path) != 0) return -1;
+        s->ages = 1;
+    } else {
+        s->ops  = dispatch_ops(algo);
+        s->run  = dispatch_run(algo);
+        s->ages = algo == DISP_PR;
+    }
+
+    SchedParams p = { quantum > 0 ? quantum : SIM_TICK_NS, SIM_TICK_NS };
+    s->priv = s->ops->init ? s->ops->init(&p) : NULL;
+    if (s->ops->init && !s->priv) {
+        fprintf(stderr, "sched: %s failed to initialize\n", s->ops->name);
+        sched_close(s);
+        return -1;
+    }
+    return 0;
+}
+
+void sched_close(Sched* s) {
+    if (s->ops && s->ops->exit) s->ops->exit(s->priv);
+    if (s->dl) dlclose(s->dl);
+    memset(s, 0, sizeof(*s));
+}
+
+const char* sched_name(const Sched* s) {
+    return s->ops ? s->ops->name : "none";
+}
+
+void sched_dispatch(Sched* s, CPU* cpu, Queue* incoming) {
+    if (s->run) {
+        s->run(s, cpu, incoming);
+        return;
+    }
+    sched_run(s, cpu, incoming, s->ops->enqueue, s->ops->pick_next, s->ops->preempt_check);
+}
+
+void sched_tick(Sched* s) {
+    if (s->ops->tick) s->ops->tick(s->priv);
+}
+
+void sched_block(Sched* s, Thread* t) {
+    if (s->ops->on_block) s->ops->on_block(s->priv, t);
+}
+
+void sched_wake(Sched* s, Thread* t) {
+    if (s->ops->on_wake) s->ops->on_wake(s->priv, t);
+}
+
+void sched_prio(Sched* s, Thread* t) {
+    if (s->ops->on_prio) s->ops->on_prio(s->priv, t);
+}
+
+Thread* sched_take(Sched* s) {
+    if (s->nready == 0) return NULL;
+    Thread* t = s->ops->dequeue(s->priv, NULL);
+    if (t) s->nready--;
+    return t;
+}
+
+int sched_remove(Sched* s, Thread* t) {
+    if (s->nready == 0 || s->ops->dequeue(s->priv, t) != t) return -1;
+    s->nready--;
+    return 0;
+}
+
+void sched_drain(Sched* s, Queue* out) {
+    Thread* t;
+    while ((t = sched_take(s)) != NULL) q_push(out, t);
+}
+
+void sched_for_each(const Sched* s, void (*fn)(Thread* t, void* ctx), void* ctx) {
+    if (s->nready > 0) s->ops->for_each(s->priv, fn, ctx);
+}
+
+typedef struct {
+    Thread** out;
+    int      n, max;
+} SnapCtx;
+
+static void snap_one(Thread* t, void* ctx) {
+    SnapCtx* c = (SnapCtx*)ctx;
+    if (c->n < c->max) c->out[c->n++] = t;
+}
+
+int sched_snapshot(const Sched* s, Thread** out) {
+    SnapCtx c = { out, 0, s->nready };
+    sched_for_each(s, snap_one, &c);
+    return c.n;
+}
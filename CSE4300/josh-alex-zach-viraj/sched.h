@@ -0,0 +1,124 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "sim.h"
+#include "dispatch.h"
+
+/*
+  Pluggable scheduling policies (in the style of Linux sched_ext).
+
+  A policy is a table of callbacks plus private state it allocates in
+  init(). Ready threads belong to the policy: the engine hands them over
+  with enqueue() and asks for them back with pick_next() / dequeue(), so
+  each policy keeps them in whatever structure suits it (a list for FIFO,
+  a heap for SJF, per-level queues for MLFQ, ...). The engine never looks
+  inside.
+
+  sched_dispatch() is the only dispatcher:
+    1) threads that became Ready since the last call are enqueued
+    2) while preempt_check() names a running core, its thread goes back
+       through enqueue() and the core is left idle
+    3) every idle core, in core order (or, with SMT or CPU.place_cost set,
+       the order of cpu_pick_idle), gets pick_next(core) (NULL = stay idle)
+    4) 2 and 3 repeat until neither changes anything (at most ncores
+       preemptions per call)
+  A policy that preempts to make room for a better thread should return -1
+  while a core is idle: step 3 places that thread first. Built-ins run a
+  copy of this loop with their callbacks inlined (see sched_run.h).
+
+  External policies are shared objects exporting
+      const SchedOps sched_ops = { SCHED_OPS_ABI, "name", ... };
+  built against this header and loaded with sched_open(..., "path.so").
+  They may read and write Thread/CPU fields but must not call back into
+  the simulator (it is not linked with -rdynamic). Example: sched_mlfq.c.
+
+  Threads passed to a policy are linked through Thread.next only while the
+  policy holds them; the policy may use that field for its own lists.
+*/
+
+#define SCHED_OPS_ABI  2
+#define SCHED_PATH_LEN 256
+
+typedef struct {
+    simtime_t quantum;     // time slice for policies that use one (ns)
+    simtime_t tick_ns;     // SIM_TICK_NS of the run
+} SchedParams;
+
+typedef struct SchedOps {
+    int         abi;       // SCHED_OPS_ABI
+    const char* name;
+
+    /* private state; NULL from init() means failure */
+    void*   (*init)(const SchedParams* p);
+    void    (*exit)(void* priv);
+
+    /* required */
+    void    (*enqueue)(void* priv, Thread* t);        // t is Ready
+    Thread* (*dequeue)(void* priv, Thread* t);        // remove t; NULL = the next to run
+    Thread* (*pick_next)(void* priv, int core);       // remove and return, or NULL
+
+    /* optional (may be NULL) */
+    void    (*tick)(void* priv);                      // once per timer tick
+    int     (*preempt_check)(void* priv, const CPU* cpu);  // core to preempt, or -1
+    void    (*on_block)(void* priv, Thread* t);       // t left its core for Waiting
+    void    (*on_wake)(void* priv, Thread* t);        // t left Waiting (enqueue follows)
+    void    (*on_prio)(void* priv, Thread* t);        // a lock protocol changed t's priority
+                                                      // while Ready (t may not be held yet)
+
+    /* required: visit every held thread, in an order such that enqueueing
+       them again in that order rebuilds the same queue (checkpoints do) */
+    void    (*for_each)(void* priv, void (*fn)(Thread* t, void* ctx), void* ctx);
+} SchedOps;
+
+struct Sched;
+/* sched_dispatch() specialized for one policy */
+typedef void (*SchedRunFn)(struct Sched* s, CPU* cpu, Queue* incoming);
+
+/* one policy instance */
+typedef struct Sched {
+    const SchedOps* ops;
+    void* priv;
+    int   nready;                  // threads the policy holds
+    void* dl;                      // dlopen handle, NULL for built-ins
+    char  path[SCHED_PATH_LEN];    // shared object, "" for built-ins
+    SchedRunFn run;                // built-in's own dispatch loop, NULL = generic
+    int   ages;                    // orders by priority, so Waiting threads age
+                                   // too (priority; external ones may)
+} Sched;
+
+/* Built-in policy algo, or the shared object at path if path is non-empty.
+   Returns 0 on success, nonzero (with a message on stderr) on error. */
+int  sched_open(Sched* s, DispatchAlgo algo, simtime_t quantum, const char* path);
+
+/* Release the policy. Threads it still holds are not freed: drain first. */
+void sched_close(Sched* s);
+
+const char* sched_name(const Sched* s);
+
+/* Run the policy over cpu; incoming holds threads that became Ready. */
+void sched_dispatch(Sched* s, CPU* cpu, Queue* incoming);
+
+/* The dispatch loop of built-in algo (see dispatch.c) */
+SchedRunFn dispatch_run(DispatchAlgo algo);
+
+void sched_tick(Sched* s);
+void sched_block(Sched* s, Thread* t);
+void sched_wake(Sched* s, Thread* t);
+void sched_prio(Sched* s, Thread* t);
+
+/* Move every held thread to the end of out, in the order they would run. */
+void sched_drain(Sched* s, Queue* out);
+
+/* Remove the thread the policy would run next; NULL if it holds none. */
+Thread* sched_take(Sched* s);
+
+/* Remove t, which the policy holds. Returns 0, or -1 if it did not. */
+int  sched_remove(Sched* s, Thread* t);
+
+/* Call fn on every held thread, in the policy's for_each order. */
+void sched_for_each(const Sched* s, void (*fn)(Thread* t, void* ctx), void* ctx);
+
+/* Store up to nready held threads in out (for_each order); returns the count. */
+int  sched_snapshot(const Sched* s, Thread** out);
+
+#endif /* SCHED_H */
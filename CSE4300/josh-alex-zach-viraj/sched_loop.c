@@ -0,0 +1,81 @@
+/*
+  Regression policy: FIFO whose preempt_check never gives up.
+
+  Build:  make sched_loop.so
+  Run:    ./sim --policy ./sched_loop.so --cores 3   (make check does)
+
+  preempt_check names the first busy core for as long as two or more are
+  busy, so every dispatch would preempt and refill forever. The
+  dispatcher's preemption budget has to stop it; the run must finish.
+
+  Only uses the types in sched.h (see there for the rules).
+*/
+#include "sched.h"
+
+typedef struct {
+    Thread* head;
+    Thread* tail;
+} Fifo;
+
+static void* loop_init(const SchedParams* p) {
+    (void)p;
+    return calloc(1, sizeof(Fifo));
+}
+
+static void loop_exit(void* priv) {
+    free(priv);
+}
+
+static void loop_enqueue(void* priv, Thread* t) {
+    Fifo* q = (Fifo*)priv;
+    t->next = NULL;
+    if (q->tail) q->tail->next = t;
+    else         q->head = t;
+    q->tail = t;
+}
+
+static Thread* loop_dequeue(void* priv, Thread* t) {
+    Fifo* q = (Fifo*)priv;
+    Thread* prev = NULL;
+    for (Thread* p = q->head; p; prev = p, p = p->next) {
+        if (t && p != t) continue;
+        if (prev) prev->next = p->next;
+        else      q->head = p->next;
+        if (q->tail == p) q->tail = prev;
+        p->next = NULL;
+        return p;
+    }
+    return NULL;
+}
+
+static Thread* loop_pick(void* priv, int core) {
+    (void)core;
+    return loop_dequeue(priv, NULL);
+}
+
+static int loop_preempt(void* priv, const CPU* cpu) {
+    (void)priv;
+    int first = -1, busy = 0;
+    for (int c = 0; c < cpu->ncores; ++c) {
+        if (!cpu->core[c]) continue;
+        if (first < 0) first = c;
+        busy++;
+    }
+    return busy >= 2 ? first : -1;
+}
+
+static void loop_for_each(void* priv, void (*fn)(Thread*, void*), void* ctx) {
+    for (Thread* t = ((Fifo*)priv)->head; t; t = t->next) fn(t, ctx);
+}
+
+const SchedOps sched_ops = {
+    .abi           = SCHED_OPS_ABI,
+    .name          = "preemption loop (regression)",
+    .init          = loop_init,
+    .exit          = loop_exit,
+    .enqueue       = loop_enqueue,
+    .dequeue       = loop_dequeue,
+    .pick_next     = loop_pick,
+    .preempt_check = loop_preempt,
+    .for_each      = loop_for_each,
+};
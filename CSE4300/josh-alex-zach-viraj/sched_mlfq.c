@@ -0,0 +1,194 @@
+/*
+  Example external policy: multi-level feedback queue.
+
+  Build:  make sched_mlfq.so
+  Run:    ./sim --policy ./sched_mlfq.so [--quantum DUR]
+
+  MLFQ_LEVELS round-robin queues; level k runs with a slice of quantum << k.
+  A thread that uses up its slice drops a level, one that wakes from I/O
+  rises a level, and every MLFQ_BOOST ticks everything returns to the top
+  so long jobs cannot starve. A ready thread on a higher level preempts
+  the lowest-level running thread.
+
+  Only uses the types in sched.h (see there for the rules).
+*/
+#include "sched.h"
+
+#define MLFQ_LEVELS  3
+#define MLFQ_BOOST   100    // ticks between priority boosts
+#define MLFQ_BUCKETS 1024
+
+typedef struct {
+    Thread* head;
+    Thread* tail;
+} List;
+
+/* level of every thread seen so far, by tid */
+typedef struct LevelEnt {
+    int tid;
+    int level;
+    struct LevelEnt* next;
+} LevelEnt;
+
+typedef struct {
+    List      lvl[MLFQ_LEVELS];
+    simtime_t slice;
+    LevelEnt* bucket[MLFQ_BUCKETS];
+    int       ticks;
+} Mlfq;
+
+static LevelEnt* level_of(Mlfq* m, const Thread* t) {
+    unsigned b = (unsigned)t->tid % MLFQ_BUCKETS;
+    for (LevelEnt* e = m->bucket[b]; e; e = e->next)
+        if (e->tid == t->tid) return e;
+    LevelEnt* e = (LevelEnt*)calloc(1, sizeof(LevelEnt));
+    if (!e) abort();
+    e->tid  = t->tid;
+    e->next = m->bucket[b];
+    m->bucket[b] = e;
+    return e;
+}
+
+static void list_push(List* l, Thread* t) {
+    t->next = NULL;
+    if (l->tail) l->tail->next = t;
+    else         l->head = t;
+    l->tail = t;
+}
+
+static Thread* list_pop(List* l) {
+    Thread* t = l->head;
+    if (!t) return NULL;
+    l->head = t->next;
+    if (!l->head) l->tail = NULL;
+    t->next = NULL;
+    return t;
+}
+
+static int list_remove(List* l, Thread* t) {
+    Thread* prev = NULL;
+    for (Thread* p = l->head; p; prev = p, p = p->next) {
+        if (p != t) continue;
+        if (prev) prev->next = p->next;
+        else      l->head = p->next;
+        if (l->tail == p) l->tail = prev;
+        p->next = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+static void* mlfq_init(const SchedParams* p) {
+    Mlfq* m = (Mlfq*)calloc(1, sizeof(Mlfq));
+    if (m) m->slice = p->quantum;
+    return m;
+}
+
+static void mlfq_exit(void* priv) {
+    Mlfq* m = (Mlfq*)priv;
+    for (int b = 0; b < MLFQ_BUCKETS; ++b) {
+        while (m->bucket[b]) {
+            LevelEnt* e = m->bucket[b];
+            m->bucket[b] = e->next;
+            free(e);
+        }
+    }
+    free(m);
+}
+
+static void mlfq_enqueue(void* priv, Thread* t) {
+    Mlfq* m = (Mlfq*)priv;
+    list_push(&m->lvl[level_of(m, t)->level], t);
+}
+
+static Thread* mlfq_dequeue(void* priv, Thread* t) {
+    Mlfq* m = (Mlfq*)priv;
+    for (int k = 0; k < MLFQ_LEVELS; ++k) {
+        if (!t) {
+            Thread* x = list_pop(&m->lvl[k]);
+            if (x) return x;
+        } else if (list_remove(&m->lvl[k], t)) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static Thread* mlfq_pick(void* priv, int core) {
+    (void)core;
+    Mlfq* m = (Mlfq*)priv;
+    Thread* t = mlfq_dequeue(priv, NULL);
+    if (t) t->quanta_rem = m->slice << level_of(m, t)->level;
+    return t;
+}
+
+static int best_ready_level(const Mlfq* m) {
+    for (int k = 0; k < MLFQ_LEVELS; ++k)
+        if (m->lvl[k].head) return k;
+    return MLFQ_LEVELS;
+}
+
+static int mlfq_preempt(void* priv, const CPU* cpu) {
+    Mlfq* m = (Mlfq*)priv;
+    /* used up its slice: demote and requeue */
+    for (int c = 0; c < cpu->ncores; ++c) {
+        Thread* t = cpu->core[c];
+        if (!t || t->quanta_rem > 0) continue;
+        LevelEnt* e = level_of(m, t);
+        if (e->level < MLFQ_LEVELS - 1) e->level++;
+        return c;
+    }
+    /* a higher level is waiting: preempt the lowest-level runner */
+    for (int c = 0; c < cpu->ncores; ++c)
+        if (!cpu->core[c]) return -1;   // it will get the idle core
+    int best = best_ready_level(m), victim = -1, worst = best;
+    for (int c = 0; c < cpu->ncores; ++c) {
+        Thread* t = cpu->core[c];
+        if (!t) continue;
+        int k = level_of(m, t)->level;
+        if (k > worst) {
+            worst = k;
+            victim = c;
+        }
+    }
+    return victim;
+}
+
+/* interactive threads move up */
+static void mlfq_wake(void* priv, Thread* t) {
+    LevelEnt* e = level_of((Mlfq*)priv, t);
+    if (e->level > 0) e->level--;
+}
+
+/* periodic boost: every thread back to level 0 */
+static void mlfq_tick(void* priv) {
+    Mlfq* m = (Mlfq*)priv;
+    if (++m->ticks < MLFQ_BOOST) return;
+    m->ticks = 0;
+    for (int b = 0; b < MLFQ_BUCKETS; ++b)
+        for (LevelEnt* e = m->bucket[b]; e; e = e->next) e->level = 0;
+    for (int k = 1; k < MLFQ_LEVELS; ++k) {
+        Thread* t;
+        while ((t = list_pop(&m->lvl[k])) != NULL) list_push(&m->lvl[0], t);
+    }
+}
+
+static void mlfq_for_each(void* priv, void (*fn)(Thread*, void*), void* ctx) {
+    Mlfq* m = (Mlfq*)priv;
+    for (int k = 0; k < MLFQ_LEVELS; ++k)
+        for (Thread* t = m->lvl[k].head; t; t = t->next) fn(t, ctx);
+}
+
+const SchedOps sched_ops = {
+    .abi           = SCHED_OPS_ABI,
+    .name          = "MLFQ (external)",
+    .init          = mlfq_init,
+    .exit          = mlfq_exit,
+    .enqueue       = mlfq_enqueue,
+    .dequeue       = mlfq_dequeue,
+    .pick_next     = mlfq_pick,
+    .tick          = mlfq_tick,
+    .preempt_check = mlfq_preempt,
+    .on_wake       = mlfq_wake,
+    .for_each      = mlfq_for_each,
+};
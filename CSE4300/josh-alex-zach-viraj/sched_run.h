@@ -0,0 +1,77 @@
+#ifndef SCHED_RUN_H
+#define SCHED_RUN_H
+
+#include "sched.h"
+
+/*
+  The body of sched_dispatch() as an inline template over the policy's
+  enqueue, pick_next and preempt_check. sched.c instantiates it with the
+  ops table's pointers for external policies; dispatch.c with each
+  built-in's own functions, which the compiler then calls directly and
+  inlines (a NULL preempt drops the preemption pass).
+*/
+
+typedef void    (*SchedEnqueueFn)(void* priv, Thread* t);
+typedef Thread* (*SchedPickFn)(void* priv, int core);
+typedef int     (*SchedPreemptFn)(void* priv, const CPU* cpu);
+
+/* give every idle core the policy's choice, in the CPU's placement order;
+   returns how many were bound */
+static SIM_ALWAYS_INLINE int sched_fill_idle(Sched* s, CPU* cpu, SchedPickFn pick) {
+    int bound = 0;
+    if (!cpu->place_cost && cpu->smt <= 1) {
+        for (int c = 0; c < cpu->ncores && s->nready > 0; ++c) {
+            if (cpu->core[c]) continue;
+            Thread* t = pick(s->priv, c);
+            if (!t) continue;
+            s->nready--;
+            cpu_bind_core(cpu, c, t);
+            bound++;
+        }
+        return bound;
+    }
+    /* the cost of a core can depend on what was just placed */
+    char* tried = (char*)calloc(cpu->ncores, 1);
+    int c;
+    while (s->nready > 0 && (c = cpu_pick_idle(cpu, tried)) >= 0) {
+        tried[c] = 1;
+        Thread* t = pick(s->priv, c);
+        if (!t) continue;
+        s->nready--;
+        cpu_bind_core(cpu, c, t);
+        bound++;
+    }
+    free(tried);
+    return bound;
+}
+
+static SIM_ALWAYS_INLINE void sched_run(Sched* s, CPU* cpu, Queue* incoming, SchedEnqueueFn enqueue,
+                                        SchedPickFn pick, SchedPreemptFn preempt) {
+    while (!q_empty(incoming)) {
+        enqueue(s->priv, q_pop(incoming));
+        s->nready++;
+    }
+
+    /* rounds of "preempt what the policy names, then fill idle cores" until
+       neither happens; at most ncores preemptions over all rounds, so a
+       policy cannot loop */
+    int budget = cpu->ncores;
+    for (;;) {
+        int changed = 0;
+        while (preempt) {
+            int c = preempt(s->priv, cpu);
+            if (c < 0 || c >= cpu->ncores || !cpu->core[c]) break;
+            if (budget <= 0) break;
+            budget--;
+            Thread* t = cpu_unbind_core(cpu, c);
+            mark_ready(t);
+            enqueue(s->priv, t);
+            s->nready++;
+            changed = 1;
+        }
+        if (sched_fill_idle(s, cpu, pick) > 0) changed = 1;
+        if (!changed) break;
+    }
+}
+
+#endif /* SCHED_RUN_H */
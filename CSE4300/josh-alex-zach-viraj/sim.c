@@ -1,11 +1,32 @@
 #include "sim.h"
 #include "dispatch.h"
+#include "engine.h"
+#include "checkpoint.h"
+#include "pdes.h"
+#include "replay.h"
+#include "realexec.h"
+#include "runtime.h"
+#include "tune.h"
+#include "replicate.h"
+#include "qmodel.h"
 
 // max simulation ticks
 #define MAX_TICKS 50000
+// max --device options
+#define MAX_DEVICES 8
+// max --lock options
+#define MAX_LOCKS 8
+// max --cgroup options
+#define MAX_GROUPS 16
+// max --hotplug options
+#define MAX_HOTPLUG 32
+// max --job options
+#define MAX_JOBS 16
+// max --gang options
+#define MAX_GANGS 16
 
 /* make a new thread object */
-static Thread* make_thread(int tid, int arrival, int burst, int priority) {
+static Thread* make_thread(int tid, simtime_t arrival, simtime_t burst, int priority) {
     Thread* t = (Thread*)calloc(1, sizeof(Thread));
     t->tid = tid;
     t->arrival_time = arrival;
@@ -17,90 +38,93 @@ static Thread* make_thread(int tid, int arrival, int burst, int priority) {
     t->start_time  = -1;
     t->finish_time = -1;
     t->wait_time   = 0;
+    t->ready_since = -1;
     t->quanta_rem = 0;
     t->priority = priority;
+    t->phases = NULL;
+    t->nphases = 0;
+    t->phase = 0;
+    t->stop_at = 0;
+    t->ready_count = 0;
+    t->phase_end = 0;
+    t->lockops = NULL;
+    t->nlockops = 0;
+    t->lockop = 0;
+    t->blocked_on = -1;
+    t->boosted = 0;
+    t->base_priority = priority;
+    t->lock_since = -1;
+    t->group = -1;
+    t->job = -1;
+    t->task = 0;
+    t->deps_left = 0;
+    t->cp_tail = 0;
+    t->cp_due = 0;
+    t->gang = -1;
+    t->gang_rank = 0;
+    t->gang_size = 0;
+    t->pages = NULL;
+    t->mem_at = 0;
     return t;
 }
 
+void thread_free(Thread* t) {
+    if (!t) return;
+    free(t->phases);
+    free(t->lockops);
+    free(t->pages);
+    free(t);
+}
+
 /* workload api */
 void workload_init(Queue* workload) {
     q_init(workload);
 }
 
-void workload_add(Queue* workload, int tid, int arrival, int burst, int priority) {
+void workload_add(Queue* workload, int tid, simtime_t arrival, simtime_t burst, int priority) {
     Thread* t = make_thread(tid, arrival, burst, priority);
     /* do not reorder here, user adds in any order */
     q_push(workload, t);
 }
 
-// if a thread's arrival time is the current time, add it to ready queue
-void workload_admit_tick(Queue* workload, Queue* ready, int now) {
+void workload_add_phases(Queue* workload, int tid, simtime_t arrival,
+                         const Phase* phases, int nphases, int priority) {
+    simtime_t burst = 0;
+    for (int i = 0; i < nphases; ++i) burst += phases[i].cpu;
+    Thread* t = make_thread(tid, arrival, burst, priority);
+    t->phases = (Phase*)malloc(sizeof(Phase) * nphases);
+    memcpy(t->phases, phases, sizeof(Phase) * nphases);
+    t->nphases = nphases;
+    t->phase_end = burst - phases[0].cpu;   // end of the first phase
+    t->stop_at = t->phase_end;
+    q_push(workload, t);
+}
+
+// if a thread's arrival time has come, add it to ready queue
+simtime_t workload_admit_tick(Queue* workload, Queue* ready, simtime_t now) {
     /* If your workload is unsorted, we scan it fully each tick.
        Complexity is fine for class-sized inputs. */
 
-    if (q_empty(workload)) return;
+    simtime_t next = SIMTIME_NEVER;
+    if (q_empty(workload)) return next;
 
     Queue keep;
     q_init(&keep);  // threads not arriving this tick
 
     while (!q_empty(workload)) {
         Thread* t = q_pop(workload);
-        if (t->arrival_time == now) {
-            t->state = ST_READY;
+        if (t->arrival_time <= now) {
+            mark_ready(t);
+            t->ready_since = t->arrival_time;   // exact, even if admitted late
             q_push(ready, t);
         } else {
+            if (t->arrival_time < next) next = t->arrival_time;
             q_push(&keep, t);
         }
     }
     /* put back the non-arrivals in original order */
     while (!q_empty(&keep)) q_push(workload, q_pop(&keep));
-}
-
-/* move finished off cores into finished queue */
-static void collect_completions(CPU* cpu, Queue* finished) {
-    for (int i = 0; i < cpu->ncores; ++i) {
-        Thread* t = cpu->core[i];
-        if (!t) continue;
-        if (t->remaining == 0) {
-            (void)cpu_unbind_core(cpu, i);
-            t->state = ST_FINISHED;
-            if (t->finish_time < 0) t->finish_time = SIM_TIME;  // SIM_TIME advanced after cpu_step_one
-            q_push(finished, t);
-        }
-    }
-}
-
-/* stop when no work is left anywhere */
-static int all_done(const Queue* ready, const Queue* waiting, const CPU* cpu) {
-    if (!q_empty((Queue*)ready))   return 0;
-    if (!q_empty((Queue*)waiting)) return 0;
-    for (int i = 0; i < cpu->ncores; ++i)
-        if (cpu->core[i]) return 0;
-    return 1;
-}
-
-// random IO interrupts
-static int rnd(int a, int b) { return a + rand() % (b - a + 1); }
-
-static void random_interrupts(const InterruptConfig* cfg, CPU* cpu, Queue* waiting, Log* log)  {
-    if (!cfg || !cfg->enable_random) return;
-
-    for (int c = 0; c < cpu->ncores; ++c) {
-        Thread* t = cpu->core[c];
-        if (!t) continue;
-
-        int r = rand() % 100;
-        if (r < cfg->pct_io) {
-            int dur = rnd(cfg->io_min, cfg->io_max);
-            int unblock = SIM_TIME + dur;
-
-            /* move running thread to Waiting until unblock time */
-            block_to_waiting(cpu, c, waiting, unblock);
-
-            /* log the event */
-            log_io_event(log, SIM_TIME, c, t->tid, dur, unblock);
-        }
-    }
+    return next;
 }
 
 /* read an int with a prompt and basic validation */
@@ -120,7 +144,7 @@ static int prompt_int(FILE* in, FILE* out, const char* msg, int min_allowed) {
 
 /* Prompts user for workload:
    - number of threads N
-   - for i in 1..N: arrival_i, burst_i
+   - for i in 1..N: arrival_i, burst_i (ticks, fractions allowed)
    Adds TIDs 1..N in the order entered. */
 int workload_prompt(Queue* workload, FILE* in, FILE* out) {
     if (!in) in = stdin;
@@ -132,86 +156,867 @@ int workload_prompt(Queue* workload, FILE* in, FILE* out) {
     if (n < 1) return -1;
 
     for (int i = 1; i <= n; ++i) {
-        int arrival, burst, priority;
+        double arrival, burst;
+        int priority;
         if (out) fprintf(out, "Thread %d - enter arrival and burst (e.g. 0 5 0): ", i);
         for (;;) {
-            int rc = fscanf(in, "%d %d %d", &arrival, &burst, &priority);
+            int rc = fscanf(in, "%lf %lf %d", &arrival, &burst, &priority);
             if (rc == 3 && arrival >= 0 && burst > 0) break;
             if (out) fprintf(out, "Invalid. Format: <arrival>=>=0 <burst>>0 <priority=int>. Try again: ");
             int ch;
             while ((ch = fgetc(in)) != '\n' && ch != EOF) { /* discard */ }
             if (feof(in)) return -1;
         }
-        workload_add(workload, /*tid*/ i, arrival, burst, priority);
+        workload_add(workload, /*tid*/ i, (simtime_t)(arrival * SIM_TICK_NS + 0.5),
+                     (simtime_t)(burst * SIM_TICK_NS + 0.5), priority);
     }
 
     if (out) fprintf(out, "Loaded %d threads.\n\n", n);
     return n;
 }
 
-int main(void) {
-    /* --------- INIT LOGGING ----------- */
-    /* open log */
-    Log log;
-    if (log_open(&log, "sim_log.txt") != 0) {
-        fprintf(stderr, "cannot open sim_log.txt\n");
-        return 1;
+/* command line options (everything else is prompted for) */
+typedef struct {
+    const char* trace_bin;   // binary core trace path, NULL = text trace only
+    int max_ticks;           // length of the per-core run trace
+    int algo_set;            // --algo given: skip the scheduler prompt
+    DispatchAlgo algo;
+    const char* policy;      // --policy shared object, NULL = built-in algo
+    simtime_t rr_quantum;    // --quantum, 0 = prompt (RR only)
+    int ncores;              // --cores, 0 = prompt
+    simtime_t ctx_switch;    // per context switch overhead
+    int smt;                 // --smt, 0 = not given
+    int smt_gain;            // --smt-gain percent, -1 = not given
+    simtime_t io_min, io_max;  // random interrupt I/O durations, 0 = default
+    DeviceConfig dev[MAX_DEVICES];  // --device, in order given
+    int ndev;
+    LockConfig lock[MAX_LOCKS];     // --lock, in order given
+    int nlock;
+    GroupConfig group[MAX_GROUPS];  // --cgroup, parents first
+    int ngroup;
+    JobConfig job[MAX_JOBS];        // --job, in order given
+    int njob;
+    GangConfig gang[MAX_GANGS];     // --gang, in order given
+    int ngang;
+    int power;               // --power given
+    PowerConfig power_cfg;
+    int flight;              // --flight given
+    FlightConfig flight_cfg;
+    HotplugEvent hotplug[MAX_HOTPLUG];  // --hotplug, in order given
+    int nhotplug;
+    int autoscale;           // --autoscale given
+    AutoscaleConfig autoscale_cfg;
+    int admit;               // --admit given
+    AdmitConfig admit_cfg;
+    int mem;                 // --mem given
+    MemConfig mem_cfg;
+    int aging;               // --aging ticks, 0 = not given
+    unsigned long long seed; // presets, random interrupts and assignments
+    int seed_set;            // --seed given
+    int tune;                // --tune given
+    TuneConfig tune_cfg;
+    int replicate;           // --replicate given
+    ReplicateConfig replicate_cfg;
+    int synth;               // --synth given: draw the workload, no prompt
+    QModelConfig synth_cfg;
+    int predict;             // --predict: print the capacity plan and exit
+    simtime_t checkpoint_at; // time to pause at, -1 = run to completion
+    const char* checkpoint;  // snapshot path written at checkpoint_at
+    const char* restore;     // snapshot path to resume from (no prompts)
+    int partitions;          // >0: partitioned engine with this many run queues
+    int workers;             // host threads for the partitioned engine
+    int window;              // lookahead window in ticks
+    int balance;             // rebalance partitions at window boundaries
+    const char* replay;      // ftrace / perf sched text to replay (no prompts)
+    const char* replay_report;
+    int validate;            // also run the workload as real pthreads
+    RxPolicy validate_policy;
+    double validate_scale;   // real ns per simulated ns
+    const char* validate_report;
+    int mn_bench;            // also run the workload on the M:N runtime
+    simtime_t mn_slice;      // busy work between yields
+    const char* mn_report;
+} SimOptions;
+
+static void usage(FILE* out, const char* prog) {
+    fprintf(out,
+        "usage: %s [options]\n"
+        "Durations take a unit (ns, us, ms, s); a bare number means ticks.\n"
+        "  --tick DUR           timer tick length (default 1ms)\n"
+        "  --ctx-switch DUR     overhead per context switch (default 0)\n"
+        "  --smt N              N logical cores per physical core (consecutive core\n"
+        "                       numbers); busy siblings share its throughput and idle\n"
+        "                       physical cores are filled first\n"
+        "  --smt-gain PCT       extra throughput of a physical core per additional busy\n"
+        "                       sibling (default 25)\n"
+        "  --io-min DUR         shortest random I/O block (default 2 ticks)\n"
+        "  --io-max DUR         longest random I/O block (default 6 ticks)\n"
+        "  --device SPEC        add an I/O device; random I/O queues on it instead of\n"
+        "                       sleeping. SPEC is name[:key=val,...] with keys\n"
+        "                       sched=fifo|scan|deadline depth=N dist=fixed|uniform|exp\n"
+        "                       svc=DUR seek=DUR expire=DUR weight=N (repeatable)\n"
+        "  --lock SPEC          add a shared lock; threads acquire it at points in their\n"
+        "                       CPU time and block while another holds it. SPEC is\n"
+        "                       name[:key=val,...] with keys hold=DUR every=DUR share=PCT\n"
+        "                       proto=none|inherit|ceiling release=handoff|retry\n"
+        "                       (default hold=500us every=2ms share=100, repeatable;\n"
+        "                       --validate and --mn-bench ignore locks)\n"
+        "  --cgroup SPEC        add a CPU bandwidth group; threads are spread over the\n"
+        "                       leaf groups. SPEC is name[:key=val,...] with keys\n"
+        "                       parent=NAME (defined earlier) shares=N quota=DUR\n"
+        "                       period=DUR weight=N (default shares=1024, no quota,\n"
+        "                       period=100ms, weight=1; repeatable, --validate and\n"
+        "                       --mn-bench ignore groups)\n"
+        "  --job SPEC           add a DAG job whose tasks start once their predecessors\n"
+        "                       finish. SPEC is name[:key=val,...] with keys\n"
+        "                       shape=forkjoin|layered width=N stages=N fan=N work=DUR\n"
+        "                       jitter=PCT at=DUR prio=N count=N every=DUR (default\n"
+        "                       forkjoin, width=4 stages=2 fan=2 work=5 jitter=50,\n"
+        "                       one instance at 0; repeatable, not with --validate)\n"
+        "  --gang SPEC          add a gang: width threads that compute in stages and\n"
+        "                       wait at a barrier for each other after every stage.\n"
+        "                       SPEC is name[:key=val,...] with keys width=N stages=N\n"
+        "                       work=DUR jitter=PCT at=DUR prio=N count=N every=DUR\n"
+        "                       (default width=4 stages=8 work=2 jitter=20, one\n"
+        "                       instance at 0; repeatable, not with --validate); see\n"
+        "                       --algo gang\n"
+        "  --power [SPEC]       model DVFS and energy; SPEC is key=val,... with keys\n"
+        "                       gov=performance|powersave|ondemand|schedutil\n"
+        "                       pstates=MHZ:W/MHZ:W/... idle=W sleep=W sleep-after=DUR\n"
+        "                       wake=DUR switch=DUR up=PCT eas=0|1 (energy-aware\n"
+        "                       placement); with --restore it replaces the saved model\n"
+        "  --flight [SPEC]      keep the last events in an in-memory ring instead of\n"
+        "                       logging every tick, and dump it when a trigger fires.\n"
+        "                       SPEC is key=val,... with keys size=N wait=DUR (a Ready\n"
+        "                       thread waits longer) ready=N (more threads Ready)\n"
+        "                       idle=1 (a core idles while threads are Ready; off\n"
+        "                       with gangs; quota-held threads are not Ready here)\n"
+        "                       after=TICKS max=N out=PATH (default 4096 events,\n"
+        "                       10 dumps to flight_dump.txt; no trigger = dump at end)\n"
+        "  --hotplug T:N        switch to N cores at time T (first tick boundary at or\n"
+        "                       after T); threads on removed cores move to the\n"
+        "                       remaining ones (repeatable)\n"
+        "  --autoscale [SPEC]   change the core count with the load; SPEC is\n"
+        "                       key=val,... with keys metric=ready|util (Ready threads\n"
+        "                       per core or busy %%) up=X down=X min=N max=N step=N\n"
+        "                       delay=TICKS cooldown=TICKS boot=DUR (default ready,\n"
+        "                       up=2 down=0.5 (util: 90/30), 1..64 cores, step 1,\n"
+        "                       delay 3, cooldown 10, boot 0); with --restore it\n"
+        "                       replaces the saved autoscaler\n"
+        "  --admit SPEC         admission control under overload; SPEC is a policy\n"
+        "                       queue|token|deadline|codel then key=val,... with\n"
+        "                       max=N reject=tail|head (queue, default 64, tail),\n"
+        "                       rate=R burst=N (token, default 1000/s, 16),\n"
+        "                       deadline=DUR (default 50), target=DUR interval=DUR\n"
+        "                       (codel, default 5 and 100) and slo=DUR (goodput\n"
+        "                       bound); rejected and shed threads never finish;\n"
+        "                       with --restore it replaces the saved controller\n"
+        "  --mem [SPEC]         demand paging: threads reference pages of a working set\n"
+        "                       and wait on the waiting queue for every fault. SPEC is\n"
+        "                       key=val,... with keys frames=N ws=N|MIN-MAX hot=PCT\n"
+        "                       policy=lru|fifo|clock touch=DUR fault=DUR channels=N\n"
+        "                       (default 256 frames, 32 pages, 80%% of references to\n"
+        "                       the hottest fifth, lru, a reference every 100us of\n"
+        "                       CPU, 1ms per fault, no limit on faults at once;\n"
+        "                       --validate and --mn-bench ignore paging)\n"
+        "  --seed N             seed of the large preset, random interrupts, I/O,\n"
+        "                       lock, group and job assignment and gang work (default\n"
+        "                       42); with --restore it reseeds the saved random state\n"
+        "  --aging N            age priorities every N ticks instead of every tick\n"
+        "  --tune [SPEC]        instead of one run, search the quantum, aging interval\n"
+        "                       and core count on parallel runs of the workload and\n"
+        "                       write the best setting and the Pareto front. SPEC is\n"
+        "                       key=val,... with keys obj=p99|turn|tput quantum=LO:HI\n"
+        "                       aging=LO:HI (off = fixed) cores=LO:HI probes=N\n"
+        "                       rounds=N workers=N out=PATH (default p99, quantum\n"
+        "                       1:50 ticks for rr, gang and --policy, aging 1:32 for\n"
+        "                       pr and --policy, current cores, 5 probes, 2 rounds,\n"
+        "                       one worker per CPU, tune_report.txt)\n"
+        "  --replicate [SPEC]   instead of one run, run the workload under seeds\n"
+        "                       --seed, --seed + 1, ... in parallel and report each\n"
+        "                       metric's mean and 95%% confidence interval. Presets\n"
+        "                       and --synth are drawn again per seed; other workloads\n"
+        "                       keep their threads and vary interrupts and I/O. SPEC is\n"
+        "                       key=val,... with keys metric=resp|turn|wait|p99|\n"
+        "                       makespan|tput ci=PCT min=N max=N workers=N out=PATH\n"
+        "                       (stop once the p99 interval is within 2%% of its\n"
+        "                       mean, 5..50 runs, one worker per CPU,\n"
+        "                       replicate_report.txt)\n"
+        "  --synth [SPEC]       instead of the workload prompt, draw threads with\n"
+        "                       known gap and burst distributions and compare the\n"
+        "                       run with queueing models (M/M/c, M/G/1, processor\n"
+        "                       sharing for RR). SPEC is key=val,... with keys n=N\n"
+        "                       arrive=fixed|uniform|exp gap=DUR load=PCT (gap for\n"
+        "                       this utilization) dist=fixed|uniform|exp burst=DUR\n"
+        "                       (default 1000 threads, exp gaps of 1 tick and exp\n"
+        "                       bursts of 2 ticks)\n"
+        "  --predict            with --synth, print the models' predictions for a\n"
+        "                       range of core counts and exit without simulating\n"
+        "  --trace-bin [PATH]   also write a binary core trace (default core_trace.bin)\n"
+        "  --max-ticks N        per-core trace length in ticks (default %d)\n"
+        "  --algo NAME          fifo|sjf|srtcf|rr|pr|cpf|gang|gang-bf (or 1-8), skips\n"
+        "                       the prompt; gang co-schedules each gang's threads in\n"
+        "                       time slots of an Ousterhout matrix, gang-bf also runs\n"
+        "                       other threads on the cores their idle members leave\n"
+        "  --policy PATH.so     load an external scheduling policy (exports\n"
+        "                       'const SchedOps sched_ops', see sched.h); skips the\n"
+        "                       scheduler prompt, --quantum sets its time slice\n"
+        "  --quantum DUR        RR quantum or gang time slot, skips the prompt\n"
+        "  --cores N            number of CPU cores, skips the prompt\n"
+        "  --checkpoint-at T    pause at time T (rounded down to a tick), save a\n"
+        "                       snapshot and exit\n"
+        "  --checkpoint PATH    snapshot file (default sim.ckpt)\n"
+        "  --restore PATH       resume from a snapshot; --algo/--quantum/--cores\n"
+        "                       override the saved settings\n"
+        "  --partitions P       split cores into P partitions with their own run queues\n"
+        "  --workers N          run partitions on N host threads (default 1)\n"
+        "  --window W           partition lookahead/sync window in ticks (default 16)\n"
+        "  --balance            move Ready threads between partitions at each window\n"
+        "  --replay FILE        replay an ftrace sched_switch/sched_wakeup or\n"
+        "                       'perf sched script' capture and report latency divergence\n"
+        "  --replay-report PATH divergence report (default replay_report.txt)\n"
+        "  --validate [POLICY]  after simulating, run the workload as real pinned\n"
+        "                       pthreads under fifo|rr|other (default other) and\n"
+        "                       compare response and turnaround\n"
+        "  --validate-scale X   real ns per simulated ns (default 1)\n"
+        "  --validate-report PATH  comparison report (default validate_report.txt)\n"
+        "  --mn-bench           after simulating, run every thread's CPU time as a\n"
+        "                       fiber on the M:N runtime (one worker per core)\n"
+        "                       under the same policy; arrivals and I/O are ignored\n"
+        "  --mn-slice DUR       work between cooperative yields (default 100us)\n"
+        "  --mn-report PATH     runtime report (default runtime_report.txt)\n"
+        "  -h, --help           show this help\n",
+        prog, MAX_TICKS);
+}
+
+/* integer option value >= min; prints the error itself */
+static int arg_int(const char* name, const char* v, int min, int* out) {
+    char* end;
+    long x = strtol(v, &end, 10);
+    if (*end != '\0' || x < min) {
+        fprintf(stderr, "%s must be an integer >= %d\n", name, min);
+        return -1;
     }
-    log_set_multiline(&log, 1);  // turn on the indented block style
+    *out = (int)x;
+    return 0;
+}
+
+/* duration option value (see parse_duration), > 0 unless allow_zero */
+static int arg_duration(const char* name, const char* v, int allow_zero, simtime_t* out) {
+    if (parse_duration(v, out) != 0 || (*out == 0 && !allow_zero)) {
+        fprintf(stderr, "%s: bad duration '%s' (e.g. 4, 250us, 2ms)\n", name, v);
+        return -1;
+    }
+    return 0;
+}
+
+/* returns 0 on success, 1 if the program should exit (help), -1 on error */
+static int parse_args(int argc, char** argv, SimOptions* opt) {
+    opt->trace_bin = NULL;
+    opt->max_ticks = MAX_TICKS;
+    opt->algo_set = 0;
+    opt->algo = DISP_FIFO;
+    opt->policy = NULL;
+    opt->rr_quantum = 0;
+    opt->ncores = 0;
+    opt->ctx_switch = 0;
+    opt->smt = 0;
+    opt->smt_gain = -1;
+    opt->io_min = opt->io_max = 0;
+    opt->ndev = 0;
+    opt->nlock = 0;
+    opt->ngroup = 0;
+    opt->njob = 0;
+    opt->ngang = 0;
+    opt->power = 0;
+    opt->flight = 0;
+    opt->nhotplug = 0;
+    opt->autoscale = 0;
+    opt->admit = 0;
+    opt->mem = 0;
+    opt->aging = 0;
+    opt->seed = 42;
+    opt->seed_set = 0;
+    opt->tune = 0;
+    opt->replicate = 0;
+    opt->synth = 0;
+    opt->predict = 0;
+    opt->checkpoint_at = -1;
+    opt->checkpoint = "sim.ckpt";
+    opt->restore = NULL;
+    opt->partitions = 0;
+    opt->workers = 1;
+    opt->window = 16;
+    opt->balance = 0;
+    opt->replay = NULL;
+    opt->replay_report = "replay_report.txt";
+    opt->validate = 0;
+    opt->validate_policy = RX_OTHER;
+    opt->validate_scale = 1.0;
+    opt->validate_report = "validate_report.txt";
+    opt->mn_bench = 0;
+    opt->mn_slice = 100 * NS_PER_US;
+    opt->mn_report = "runtime_report.txt";
+
+    /* the tick comes first: bare durations elsewhere are in ticks */
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (strcmp(argv[i], "--tick") != 0) continue;
+        simtime_t tick;
+        const char* v = argv[i + 1];
+        /* a bare number here would be circular, so it means ns */
+        char* end;
+        strtod(v, &end);
+        if (*end == '\0') tick = atoll(v);
+        else if (arg_duration("--tick", v, 0, &tick) != 0) return -1;
+        if (tick < 1) {
+            fprintf(stderr, "--tick must be > 0\n");
+            return -1;
+        }
+        SIM_TICK_NS = tick;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        int has_val = i + 1 < argc;
+        int rc = 0;
+        if (strcmp(a, "--tick") == 0 && has_val) {
+            ++i;   // handled above
+        } else if (strcmp(a, "--ctx-switch") == 0 && has_val) {
+            rc = arg_duration(a, argv[++i], 1, &opt->ctx_switch);
+        } else if (strcmp(a, "--io-min") == 0 && has_val) {
+            rc = arg_duration(a, argv[++i], 0, &opt->io_min);
+        } else if (strcmp(a, "--io-max") == 0 && has_val) {
+            rc = arg_duration(a, argv[++i], 0, &opt->io_max);
+        } else if (strcmp(a, "--device") == 0 && has_val) {
+            if (opt->ndev == MAX_DEVICES) {
+                fprintf(stderr, "at most %d devices\n", MAX_DEVICES);
+                return -1;
+            }
+            if (device_parse(argv[++i], &opt->dev[opt->ndev]) != 0) {
+                fprintf(stderr, "bad device spec: %s\n", argv[i]);
+                return -1;
+            }
+            opt->ndev++;
+        } else if (strcmp(a, "--lock") == 0 && has_val) {
+            if (opt->nlock == MAX_LOCKS) {
+                fprintf(stderr, "at most %d locks\n", MAX_LOCKS);
+                return -1;
+            }
+            if (lock_parse(argv[++i], &opt->lock[opt->nlock]) != 0) {
+                fprintf(stderr, "bad lock spec: %s\n", argv[i]);
+                return -1;
+            }
+            opt->nlock++;
+        } else if (strcmp(a, "--cgroup") == 0 && has_val) {
+            if (opt->ngroup == MAX_GROUPS) {
+                fprintf(stderr, "at most %d groups\n", MAX_GROUPS);
+                return -1;
+            }
+            GroupConfig* g = &opt->group[opt->ngroup];
+            if (group_parse(argv[++i], g) != 0) {
+                fprintf(stderr, "bad group spec: %s\n", argv[i]);
+                return -1;
+            }
+            int known = !g->parent[0], dup = 0;
+            for (int k = 0; k < opt->ngroup; ++k) {
+                if (strcmp(opt->group[k].name, g->parent) == 0) known = 1;
+                if (strcmp(opt->group[k].name, g->name) == 0) dup = 1;
+            }
+            if (!known || dup) {
+                fprintf(stderr, "group %s: %s\n", g->name,
+                        dup ? "defined twice" : "parent must be defined first");
+                return -1;
+            }
+            opt->ngroup++;
+        } else if (strcmp(a, "--job") == 0 && has_val) {
+            if (opt->njob == MAX_JOBS) {
+                fprintf(stderr, "at most %d jobs\n", MAX_JOBS);
+                return -1;
+            }
+            if (job_parse(argv[++i], &opt->job[opt->njob]) != 0) {
+                fprintf(stderr, "bad job spec: %s\n", argv[i]);
+                return -1;
+            }
+            opt->njob++;
+        } else if (strcmp(a, "--gang") == 0 && has_val) {
+            if (opt->ngang == MAX_GANGS) {
+                fprintf(stderr, "at most %d gangs\n", MAX_GANGS);
+                return -1;
+            }
+            if (gang_parse(argv[++i], &opt->gang[opt->ngang]) != 0) {
+                fprintf(stderr, "bad gang spec: %s\n", argv[i]);
+                return -1;
+            }
+            opt->ngang++;
+        } else if (strcmp(a, "--power") == 0) {
+            /* optional spec */
+            const char* spec = has_val && argv[i + 1][0] != '-' ? argv[++i] : NULL;
+            if (power_parse(spec, &opt->power_cfg) != 0) {
+                fprintf(stderr, "bad power spec: %s\n", spec);
+                return -1;
+            }
+            opt->power = 1;
+        } else if (strcmp(a, "--flight") == 0) {
+            /* optional spec */
+            const char* spec = has_val && argv[i + 1][0] != '-' ? argv[++i] : NULL;
+            if (flight_parse(spec, &opt->flight_cfg) != 0) {
+                fprintf(stderr, "bad flight recorder spec: %s\n", spec);
+                return -1;
+            }
+            opt->flight = 1;
+        } else if (strcmp(a, "--hotplug") == 0 && has_val) {
+            if (opt->nhotplug == MAX_HOTPLUG) {
+                fprintf(stderr, "at most %d hotplug events\n", MAX_HOTPLUG);
+                return -1;
+            }
+            if (hotplug_parse(argv[++i], &opt->hotplug[opt->nhotplug]) != 0) {
+                fprintf(stderr, "bad hotplug event: %s (expected TIME:CORES)\n", argv[i]);
+                return -1;
+            }
+            opt->nhotplug++;
+        } else if (strcmp(a, "--autoscale") == 0) {
+            /* optional spec */
+            const char* spec = has_val && argv[i + 1][0] != '-' ? argv[++i] : NULL;
+            if (autoscale_parse(spec, &opt->autoscale_cfg) != 0) {
+                fprintf(stderr, "bad autoscale spec: %s\n", spec);
+                return -1;
+            }
+            opt->autoscale = 1;
+        } else if (strcmp(a, "--admit") == 0 && has_val) {
+            if (admit_parse(argv[++i], &opt->admit_cfg) != 0) {
+                fprintf(stderr, "bad admission control spec: %s\n", argv[i]);
+                return -1;
+            }
+            opt->admit = 1;
+        } else if (strcmp(a, "--mem") == 0) {
+            /* optional spec */
+            const char* spec = has_val && argv[i + 1][0] != '-' ? argv[++i] : NULL;
+            if (mem_parse(spec, &opt->mem_cfg) != 0) {
+                fprintf(stderr, "bad paging spec: %s\n", spec);
+                return -1;
+            }
+            opt->mem = 1;
+        } else if (strcmp(a, "--aging") == 0 && has_val) {
+            rc = arg_int(a, argv[++i], 1, &opt->aging);
+        } else if (strcmp(a, "--seed") == 0 && has_val) {
+            char* end;
+            opt->seed = strtoull(argv[++i], &end, 10);
+            if (*end != '\0' || argv[i][0] == '-') {
+                fprintf(stderr, "--seed must be a non-negative integer\n");
+                return -1;
+            }
+            opt->seed_set = 1;
+        } else if (strcmp(a, "--tune") == 0) {
+            /* optional spec */
+            const char* spec = has_val && argv[i + 1][0] != '-' ? argv[++i] : NULL;
+            if (tune_parse(spec, &opt->tune_cfg) != 0) {
+                fprintf(stderr, "bad tune spec: %s\n", spec);
+                return -1;
+            }
+            opt->tune = 1;
+        } else if (strcmp(a, "--replicate") == 0) {
+            /* optional spec */
+            const char* spec = has_val && argv[i + 1][0] != '-' ? argv[++i] : NULL;
+            if (replicate_parse(spec, &opt->replicate_cfg) != 0) {
+                fprintf(stderr, "bad replicate spec: %s\n", spec);
+                return -1;
+            }
+            opt->replicate = 1;
+        } else if (strcmp(a, "--synth") == 0) {
+            /* optional spec */
+            const char* spec = has_val && argv[i + 1][0] != '-' ? argv[++i] : NULL;
+            if (qmodel_parse(spec, &opt->synth_cfg) != 0) {
+                fprintf(stderr, "bad synthetic workload spec: %s\n", spec);
+                return -1;
+            }
+            opt->synth = 1;
+        } else if (strcmp(a, "--predict") == 0) {
+            opt->predict = 1;
+        } else if (strcmp(a, "--trace-bin") == 0) {
+            /* optional path argument */
+            if (has_val && argv[i + 1][0] != '-') opt->trace_bin = argv[++i];
+            else                                  opt->trace_bin = "core_trace.bin";
+        } else if (strcmp(a, "--max-ticks") == 0 && has_val) {
+            rc = arg_int(a, argv[++i], 1, &opt->max_ticks);
+        } else if (strcmp(a, "--algo") == 0 && has_val) {
+            if (dispatch_parse(argv[++i], &opt->algo) != 0) {
+                fprintf(stderr, "unknown scheduler: %s\n", argv[i]);
+                return -1;
+            }
+            opt->algo_set = 1;
+        } else if (strcmp(a, "--policy") == 0 && has_val) {
+            opt->policy = argv[++i];
+        } else if (strcmp(a, "--quantum") == 0 && has_val) {
+            rc = arg_duration(a, argv[++i], 0, &opt->rr_quantum);
+        } else if (strcmp(a, "--smt") == 0 && has_val) {
+            rc = arg_int(a, argv[++i], 1, &opt->smt);
+        } else if (strcmp(a, "--smt-gain") == 0 && has_val) {
+            rc = arg_int(a, argv[++i], 0, &opt->smt_gain);
+            if (rc == 0 && opt->smt_gain > 100) {
+                fprintf(stderr, "--smt-gain must be at most 100\n");
+                rc = -1;
+            }
+        } else if (strcmp(a, "--cores") == 0 && has_val) {
+            rc = arg_int(a, argv[++i], 1, &opt->ncores);
+        } else if (strcmp(a, "--checkpoint-at") == 0 && has_val) {
+            rc = arg_duration(a, argv[++i], 1, &opt->checkpoint_at);
+            opt->checkpoint_at -= opt->checkpoint_at % SIM_TICK_NS;
+        } else if (strcmp(a, "--checkpoint") == 0 && has_val) {
+            opt->checkpoint = argv[++i];
+        } else if (strcmp(a, "--restore") == 0 && has_val) {
+            opt->restore = argv[++i];
+        } else if (strcmp(a, "--partitions") == 0 && has_val) {
+            rc = arg_int(a, argv[++i], 1, &opt->partitions);
+        } else if (strcmp(a, "--workers") == 0 && has_val) {
+            rc = arg_int(a, argv[++i], 1, &opt->workers);
+        } else if (strcmp(a, "--window") == 0 && has_val) {
+            rc = arg_int(a, argv[++i], 1, &opt->window);
+        } else if (strcmp(a, "--balance") == 0) {
+            opt->balance = 1;
+        } else if (strcmp(a, "--replay") == 0 && has_val) {
+            opt->replay = argv[++i];
+        } else if (strcmp(a, "--replay-report") == 0 && has_val) {
+            opt->replay_report = argv[++i];
+        } else if (strcmp(a, "--validate") == 0) {
+            /* optional policy argument */
+            opt->validate = 1;
+            if (has_val && argv[i + 1][0] != '-' &&
+                realexec_parse_policy(argv[i + 1], &opt->validate_policy) == 0) ++i;
+        } else if (strcmp(a, "--validate-scale") == 0 && has_val) {
+            char* end;
+            opt->validate_scale = strtod(argv[++i], &end);
+            if (*end != '\0' || opt->validate_scale <= 0) {
+                fprintf(stderr, "--validate-scale must be a number > 0\n");
+                return -1;
+            }
+        } else if (strcmp(a, "--validate-report") == 0 && has_val) {
+            opt->validate_report = argv[++i];
+        } else if (strcmp(a, "--mn-bench") == 0) {
+            opt->mn_bench = 1;
+        } else if (strcmp(a, "--mn-slice") == 0 && has_val) {
+            rc = arg_duration(a, argv[++i], 0, &opt->mn_slice);
+        } else if (strcmp(a, "--mn-report") == 0 && has_val) {
+            opt->mn_report = argv[++i];
+        } else if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0) {
+            usage(stdout, argv[0]);
+            return 1;
+        } else {
+            fprintf(stderr, "unknown option: %s\n", a);
+            usage(stderr, argv[0]);
+            return -1;
+        }
+        if (rc != 0) return -1;
+    }
+    if (opt->partitions > 0 && opt->checkpoint_at >= 0) {
+        fprintf(stderr, "--checkpoint-at is not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->mn_bench && opt->restore) {
+        fprintf(stderr, "--mn-bench needs the whole workload and cannot follow --restore\n");
+        return -1;
+    }
+    if (opt->validate && opt->restore) {
+        fprintf(stderr, "--validate needs the whole workload and cannot follow --restore\n");
+        return -1;
+    }
+    if (opt->partitions > 0 && opt->ndev > 0) {
+        fprintf(stderr, "--device is not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->partitions > 0 && opt->flight) {
+        fprintf(stderr, "--flight is not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->partitions > 0 && opt->smt > 1) {
+        fprintf(stderr, "--smt is not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->partitions > 0 && opt->power) {
+        fprintf(stderr, "--power is not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->partitions > 0 && opt->nlock > 0) {
+        fprintf(stderr, "--lock is not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->partitions > 0 && opt->ngroup > 0) {
+        fprintf(stderr, "--cgroup is not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->partitions > 0 && (opt->nhotplug > 0 || opt->autoscale)) {
+        fprintf(stderr, "--hotplug and --autoscale are not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->partitions > 0 && opt->njob > 0) {
+        fprintf(stderr, "--job is not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->partitions > 0 && opt->ngang > 0) {
+        fprintf(stderr, "--gang is not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->admit && (opt->partitions > 0 || opt->validate || opt->mn_bench)) {
+        fprintf(stderr, "--admit is not supported with --partitions, --validate or --mn-bench\n");
+        return -1;
+    }
+    if ((opt->tune || opt->replicate) &&
+        (opt->partitions > 0 || opt->checkpoint_at >= 0 || opt->flight ||
+         opt->validate || opt->mn_bench)) {
+        fprintf(stderr, "--tune and --replicate run the workload themselves and cannot be combined "
+                        "with --partitions, --checkpoint-at, --flight, --validate or --mn-bench\n");
+        return -1;
+    }
+    if (opt->tune && opt->replicate) {
+        fprintf(stderr, "--tune and --replicate are separate modes\n");
+        return -1;
+    }
+    if (opt->njob > 0 && opt->validate) {
+        fprintf(stderr, "--validate runs threads at their arrival and cannot follow --job dependencies\n");
+        return -1;
+    }
+    if (opt->njob > 0 && opt->restore) {
+        fprintf(stderr, "--job adds to a new workload; a snapshot keeps its own jobs\n");
+        return -1;
+    }
+    if (opt->ngang > 0 && opt->validate) {
+        fprintf(stderr, "--validate runs threads at their arrival and cannot follow --gang barriers\n");
+        return -1;
+    }
+    if (opt->ngang > 0 && opt->restore) {
+        fprintf(stderr, "--gang adds to a new workload; a snapshot keeps its own gangs\n");
+        return -1;
+    }
+    if (opt->ngroup > 0 && opt->restore) {
+        fprintf(stderr, "--cgroup places a new workload; a snapshot keeps its own groups\n");
+        return -1;
+    }
+    if (opt->mem && opt->partitions > 0) {
+        fprintf(stderr, "--mem is not supported with --partitions\n");
+        return -1;
+    }
+    if (opt->mem && opt->restore) {
+        fprintf(stderr, "--mem pages a new workload; a snapshot keeps its own paging model\n");
+        return -1;
+    }
+    if (opt->nlock > 0 && opt->restore) {
+        fprintf(stderr, "--lock scripts a new workload; a snapshot keeps its own locks\n");
+        return -1;
+    }
+    if (opt->predict && !opt->synth) {
+        fprintf(stderr, "--predict needs the distributions of --synth\n");
+        return -1;
+    }
+    if (opt->predict && opt->synth_cfg.load > 0 && opt->ncores < 1) {
+        fprintf(stderr, "--predict with load= needs --cores to fix the arrival rate\n");
+        return -1;
+    }
+    if (opt->synth && (opt->restore || opt->replay)) {
+        fprintf(stderr, "--synth draws a new workload and cannot follow --restore or --replay\n");
+        return -1;
+    }
+    if (opt->io_min && opt->io_max && opt->io_max < opt->io_min) {
+        fprintf(stderr, "--io-max must be >= --io-min\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* --smt / --smt-gain over the CPU's topology */
+static void apply_smt(CPU* cpu, const SimOptions* opt) {
+    if (opt->smt > 0) cpu->smt = opt->smt;
+    if (opt->smt_gain >= 0) cpu->smt_gain = opt->smt_gain * CPU_RATE_ONE / 100;
+    else if (opt->smt > 0) cpu->smt_gain = 25 * CPU_RATE_ONE / 100;
+}
+
+/* --hotplug / --autoscale */
+static void apply_scaling(Sim* sim, const SimOptions* opt) {
+    for (int h = 0; h < opt->nhotplug; ++h) sim_add_hotplug(sim, &opt->hotplug[h]);
+    if (opt->autoscale) sim_enable_autoscale(sim, &opt->autoscale_cfg);
+}
+
+/* --admit */
+static void apply_admit(Sim* sim, const SimOptions* opt) {
+    if (opt->admit) sim_enable_admit(sim, &opt->admit_cfg);
+}
+
+/* context switch cost, SMT, I/O durations, devices, power, core scaling,
+   admission control and the random seed from the command line */
+static void apply_timing(Sim* sim, const SimOptions* opt) {
+    sim->cpu.cs_ns = opt->ctx_switch;
+    rng_seed(&sim->rng, opt->seed);
+    apply_smt(&sim->cpu, opt);
+    if (opt->aging) sim->age_every = opt->aging;
+    if (opt->io_min) sim->intr.io_min = opt->io_min;
+    if (opt->io_max) sim->intr.io_max = opt->io_max;
+    if (sim->intr.io_max < sim->intr.io_min) sim->intr.io_max = sim->intr.io_min;
+    for (int d = 0; d < opt->ndev; ++d) sim_add_device(sim, &opt->dev[d]);
+    if (opt->power) sim_enable_power(sim, &opt->power_cfg);
+    apply_scaling(sim, opt);
+    apply_admit(sim, opt);
+}
+
+/* --job: add every instance of each job to the loaded workload */
+static void apply_jobs(Sim* sim, const SimOptions* opt, unsigned long long seed) {
+    for (int j = 0; j < opt->njob; ++j)
+        for (int k = 0; k < opt->job[j].spec.count; ++k) sim_add_job(sim, &opt->job[j], k, seed + j);
+}
+
+/* --gang: add every instance of each gang after the jobs */
+static void apply_gangs(Sim* sim, const SimOptions* opt, unsigned long long seed) {
+    for (int g = 0; g < opt->ngang; ++g)
+        for (int k = 0; k < opt->gang[g].count; ++k)
+            sim_add_gang(sim, &opt->gang[g], k, seed + MAX_JOBS + g);
+}
+
+/* --lock: add the locks and give the loaded workload its lock scripts */
+static void apply_locks(Sim* sim, const SimOptions* opt, unsigned long long seed) {
+    if (opt->nlock == 0) return;
+    for (int l = 0; l < opt->nlock; ++l) sim_add_lock(sim, &opt->lock[l]);
+    lock_assign(sim->lock, sim->nlock, &sim->workload, seed);
+}
+
+/* --cgroup: add the groups and place the loaded workload's threads */
+static void apply_groups(Sim* sim, const SimOptions* opt, unsigned long long seed) {
+    if (opt->ngroup == 0) return;
+    for (int g = 0; g < opt->ngroup; ++g) sim_add_group(sim, &opt->group[g]);
+    group_assign(sim->group, sim->ngroup, &sim->workload, seed);
+}
+
+static void add_run(Thread* t, void* ctx) {
+    *(simtime_t*)ctx += t->burst_time - t->remaining;
+}
+
+/* CPU time every thread has run so far */
+static simtime_t cpu_time_run(Sim* sim) {
+    simtime_t ns = 0;
+    const Queue* qs[3] = { &sim->ready, &sim->waiting, &sim->finished };
+    for (int q = 0; q < 3; ++q)
+        for (Thread* t = qs[q]->front; t; t = t->next) add_run(t, &ns);
+    for (int i = 0; i < sim->ngroup; ++i)
+        for (Thread* t = sim->group[i].held.front; t; t = t->next) add_run(t, &ns);
+    for (int c = 0; c < sim->cpu.ncores; ++c)
+        if (sim->cpu.core[c]) add_run(sim->cpu.core[c], &ns);
+    sched_for_each(&sim->sched, add_run, &ns);
+    return ns;
+}
 
-    /* --------- INIT WORKLOAD ---------- */
-    Queue workload;
-    workload_init(&workload);
+/* --mem: turn on paging and give the loaded workload its working sets */
+static void apply_mem(Sim* sim, const SimOptions* opt, unsigned long long seed) {
+    if (!opt->mem) return;
+    sim_enable_mem(sim, &opt->mem_cfg, seed);
+    mem_assign(sim->mem, &sim->workload, seed);
+}
+
+/* load --policy over the built-in one; prints the error itself */
+static int apply_policy(Sim* sim, const SimOptions* opt) {
+    if (!opt->policy) return 0;
+    if (sim_set_policy(sim, sim->algo, sim->rr_quantum, opt->policy) != 0) {
+        fprintf(stderr, "cannot load scheduling policy %s\n", opt->policy);
+        return -1;
+    }
+    return 0;
+}
 
-    /* sim queues */
-    Queue ready, waiting, finished;
-    q_init(&ready);
-    q_init(&waiting);
-    q_init(&finished);
+/* answers to the setup prompts, so the run can be rebuilt (--replicate) */
+typedef struct {
+    DispatchAlgo algo;
+    simtime_t quantum;
+    int ncores;
+    int intr;              // random interrupts
+    int workload;          // 1 small preset, 2 large randomized, 3 manual, 4 --synth
+} Setup;
 
+/* workload preset which (1 or 2); the large one is drawn from seed */
+static int load_preset(Queue* workload, int which, unsigned long long seed) {
+    simtime_t T = SIM_TICK_NS;
+    if (which == 1) {
+        workload_add(workload, 1, 0 * T, 5 * T, 10);
+        workload_add(workload, 2, 0 * T, 3 * T, 7);
+        workload_add(workload, 3, 2 * T, 6 * T, 5);
+        workload_add(workload, 4, 4 * T, 4 * T, 4);
+        return 4;
+    }
+    int N = 1000;
+    Rng r;
+    rng_seed(&r, seed);
+    for (int i = 1; i <= N; ++i) {
+        int prio = rng_range(&r, 1, 10);
+        simtime_t burst   = rng_range(&r, 1, 30) * T;
+        simtime_t arrival = rng_range(&r, 0, 300) * T;
+        workload_add(workload, i, arrival, burst, prio);
+    }
+    return N;
+}
+
+/* workload setup.workload drawn for seed: a preset or --synth */
+static void load_drawn(Queue* workload, const SimOptions* opt, const Setup* setup,
+                       unsigned long long seed) {
+    if (setup->workload == 4) qmodel_generate(&opt->synth_cfg, setup->ncores, seed, workload);
+    else                      load_preset(workload, setup->workload, seed);
+}
+
+/* Interactive setup: scheduler, cores, interrupts and workload.
+   Prompts are skipped for anything already given on the command line.
+   The answers go to *answers. Returns 0 on success, nonzero if input
+   failed. */
+static int setup_interactive(Sim* sim, const SimOptions* opt, Setup* answers) {
     /* ------------------- USER INPUT FOR SCHEDULER -------------------*/
-    printf("\nSelect scheduler:\n");
-    printf("  1) FIFO\n");
-    printf("  2) SJF\n");
-    printf("  3) SRTCF\n");
-    printf("  4) Round Robin\n");
-    printf("  5) Priority\n");
+    DispatchAlgo algo = opt->algo;
     int choice = 1;
-    for (;;) {
-        choice = prompt_int(stdin, stdout, "Enter choice [1-5]: ", 1);
-        if (choice >= 1 && choice <= 5) break;
-        fprintf(stdout, "Please enter a number between 1 and 5.\n");
+    if (!opt->algo_set && !opt->policy) {
+        printf("\nSelect scheduler:\n");
+        printf("  1) FIFO\n");
+        printf("  2) SJF\n");
+        printf("  3) SRTCF\n");
+        printf("  4) Round Robin\n");
+        printf("  5) Priority\n");
+        printf("  6) Critical path first\n");
+        printf("  7) Gang\n");
+        printf("  8) Gang with backfilling\n");
+        for (;;) {
+            choice = prompt_int(stdin, stdout, "Enter choice [1-8]: ", 1);
+            if (choice >= 1 && choice <= 8) break;
+            fprintf(stdout, "Please enter a number between 1 and 8.\n");
+        }
+
+        algo = DISP_FIFO;  // default to fifo
+        switch (choice) {
+            case 2:  algo = DISP_SJF;    break;
+            case 3:  algo = DISP_SRTCF;  break;
+            case 4:  algo = DISP_RR;     break;
+            case 5:  algo = DISP_PR;     break;
+            case 6:  algo = DISP_CPF;    break;
+            case 7:  algo = DISP_GANG;   break;
+            case 8:  algo = DISP_GANG_BF; break;
+            case 1: break;
+            default: algo = DISP_FIFO;   break;
+        }
     }
-    
-    DispatchAlgo algo = DISP_FIFO;  // default to fifo
-    switch (choice) {
-        case 2:  algo = DISP_SJF;    break;
-        case 3:  algo = DISP_SRTCF;  break;
-        case 4:  algo = DISP_RR;     break;
-        case 5:  algo = DISP_PR;     break;
-        case 1: break;
-        default: algo = DISP_FIFO;   break;
-    }
-
-    // case for RR chosen (need quantum)
-    int rr_quantum = 0;  // init to 0
-    if (algo == DISP_RR) {
-        printf("\nEnter RR quantum in ticks (>=1): ");
+
+    // case for RR or gang chosen (need quantum / slot)
+    simtime_t rr_quantum = opt->rr_quantum;
+    if (dispatch_sliced(algo) && !opt->policy && rr_quantum < 1) {
+        if (algo == DISP_RR) printf("\nEnter RR quantum in ticks (>=1): ");
+        else                 printf("\nEnter gang time slot in ticks (>=1): ");
         int choice = 1;
         if (scanf("%d", &choice) != 1) choice = 1;
-        rr_quantum = choice;
+        rr_quantum = choice * SIM_TICK_NS;
     }
-        
+
     /* ------------------- USER INPUT FOR CORES -------------------*/
-    int ncores = 1;  // init to 1
-    choice = 1;
-    for (;;) {
-        choice = prompt_int(stdin, stdout, "Enter number of CPU cores (>=1): ", 1);
-        if (choice >= 1) break;
-        fprintf(stdout, "Please enter an integer >=1:\n");
+    int ncores = opt->ncores;
+    if (ncores < 1) {
+        for (;;) {
+            choice = prompt_int(stdin, stdout, "Enter number of CPU cores (>=1): ", 1);
+            if (choice >= 1) break;
+            fprintf(stdout, "Please enter an integer >=1:\n");
+        }
+        ncores = choice;
     }
-    ncores = choice;
 
+    sim_init(sim, algo, rr_quantum, ncores, opt->max_ticks);
+    if (apply_policy(sim, opt) != 0) return 1;
+    apply_timing(sim, opt);
 
     /*-------  USER INPUT FOR INTERRUPT CONFIGURATION ----------------*/
     choice = 0;
@@ -220,13 +1025,15 @@ int main(void) {
         if (choice >= 0) break;
         fprintf(stdout, "Please enter 0 or 1:\n");
     }
-    int interrupt_enable = choice;
-    InterruptConfig intr = {.enable_random = interrupt_enable, .pct_io = 10, .io_min = 2, .io_max = 6};
-    srand(42);
-    log_interrupts_config(&log, intr.enable_random, intr.pct_io, intr.io_min, intr.io_max);
-
+    sim->intr.enable_random = choice;
 
     /* ------------- USER INPUT FOR WORKLOAD CHOICE -------------- */
+    if (opt->synth) {
+        *answers = (Setup){ algo, rr_quantum, ncores, sim->intr.enable_random, 4 };
+        int N = qmodel_generate(&opt->synth_cfg, ncores, opt->seed, &sim->workload);
+        printf("Drew synthetic workload with %d threads\n\n", N);
+        return 0;
+    }
     printf("\nSelect workload mode:\n");
     printf("  1) Preset small example\n");
     printf("  2) Preset large randomized\n");
@@ -240,120 +1047,480 @@ int main(void) {
     /* clear trailing line */
     int ch; while ((ch = fgetc(stdin)) != '\n' && ch != EOF) {}
 
+    *answers = (Setup){ algo, rr_quantum, ncores, sim->intr.enable_random, choice };
     switch (choice) {
-        case 1: {
-            /* small preset */
-            workload_add(&workload, 1, 0, 5, 10);
-            workload_add(&workload, 2, 0, 3, 7);
-            workload_add(&workload, 3, 2, 6, 5);
-            workload_add(&workload, 4, 4, 4, 4);
+        case 1:
+            load_preset(&sim->workload, 1, opt->seed);
             printf("Loaded preset small workload\n\n");
             break;
-        }
         case 2: {
-            /* large randomized preset */
-            int N = 1000;
-            /* simple local rnd helper if you do not already have one */
-            srand(42);
-            for (int i = 1; i <= N; ++i) {
-                workload_add(&workload, i, rnd(0, 300), rnd(1, 30), rnd(1, 10));
-            }
+            int N = load_preset(&sim->workload, 2, opt->seed);
             printf("Loaded preset large randomized workload with %d threads\n\n", N);
             break;
         }
         case 3:
         default: {
             // user defined workload
-            if (workload_prompt(&workload, stdin, stdout) < 0) {
+            if (workload_prompt(&sim->workload, stdin, stdout) < 0) {
                 fprintf(stderr, "Failed to read workload\n");
                 return 1;
             }
             break;
         }
     }
+    return 0;
+}
+
+/* write the core traces requested on the command line */
+static void write_traces(const CPU* cpu, const SimOptions* opt) {
+    // output CPU core trace
+    if (write_core_trace_default(cpu) == 0) {
+        printf("Wrote per-core trace to core trace.txt\n");
+    } else {
+        printf("Failed to write per-core trace\n");
+    }
+    if (opt->trace_bin) {
+        if (write_core_trace_bin(cpu, opt->trace_bin) == 0)
+            printf("Wrote binary core trace to %s\n", opt->trace_bin);
+        else
+            printf("Failed to write binary core trace\n");
+    }
+}
 
-    /* ------------ INIT CPU AND CPU TRACE MEMBERS ------------ */
-    CPU cpu; cpu_init(&cpu, ncores);
+/* --synth: the queueing models next to the run's averages, in the log and
+   in one line on stdout for the model of the scheduler that ran */
+static void report_model(const Sim* sim, const SimOptions* opt, int ncores, FILE* out) {
+    if (!opt->synth) return;
+    FinishStats st;
+    finish_stats(&sim->finished, &st);
+    int algo = sim->sched.path[0] ? -1 : (int)sim->algo;
+    qmodel_report(&opt->synth_cfg, ncores, algo, st.n > 0 ? st.wait : -1,
+                  st.n > 0 ? st.turn : -1, out);
+
+    QPrediction fcfs, ps;
+    if (qmodel_predict(&opt->synth_cfg, ncores, &fcfs, &ps) != 0) {
+        printf("Queueing model: utilization %.3f >= 1, no steady state\n",
+               qmodel_util(&opt->synth_cfg, ncores));
+        return;
+    }
+    const QPrediction* p = algo == DISP_FIFO ? &fcfs : algo == DISP_RR ? &ps : NULL;
+    if (p && st.n > 0)
+        printf("Queueing model %s: turnaround %.3f, simulated %.3f (%+.1f%%)\n",
+               p->name, p->turn, st.turn, 100.0 * (st.turn - p->turn) / p->turn);
+}
+
+/* Partitioned engine (sequential or on worker threads). Per-tick snapshots
+   are not logged since partitions advance independently within a window. */
+static int run_partitioned(Sim* sim, const SimOptions* opt, Log* log) {
+    PSim ps;
+    int nparts = opt->partitions;
+    int rc = psim_init(&ps, sim, nparts, opt->window, opt->balance);
+    if (rc == 3) {
+        fprintf(stderr, "the partitioned engine does not model I/O devices, locks, groups, "
+                        "power, SMT, core scaling, DAG jobs or gangs\n");
+        return 1;
+    }
+    if (rc == 4) {
+        fprintf(stderr, "cannot load %s for every partition\n", sim->sched.path);
+        return 1;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "cannot split %d cores into %d partitions\n", sim->cpu.ncores, nparts);
+        return 1;
+    }
+    fprintf(log->fp, "# Partitioned engine: %d partitions, %d workers, window=%d%s\n\n",
+            nparts, opt->workers, opt->window, opt->balance ? ", balanced" : "");
 
-    /* run_trace[c][t] = tid at tick t for core c, or -1 if idle */
-    int **run_trace = NULL;
-    int ncores_for_trace = cpu.ncores;
-    // create arrays for tracking cpu run schedule
-    run_trace = (int**)malloc(sizeof(int*) * ncores_for_trace);
-    for (int c = 0; c < ncores_for_trace; ++c) {
-        run_trace[c] = (int *)malloc(sizeof(int) * MAX_TICKS);
-        for (int t = 0; t < MAX_TICKS; ++t) run_trace[c][t] = -1;  // idle mark
+    if (opt->workers > 1) {
+        int ran = psim_run_parallel(&ps, opt->workers);
+        if (ran < opt->workers && ran < nparts) {
+            printf("Could create only %d of %d worker threads (host thread limit?)\n", ran, opt->workers);
+            fprintf(log->fp, "# Ran on %d workers: the host refused the others\n\n", ran);
+        }
+    } else {
+        psim_run_sequential(&ps);
     }
-    cpu.run_trace = run_trace;
-    cpu.trace_len = MAX_TICKS;
 
-    /* TICK AT ZERO*/
-    SIM_TIME = 0;
+    psim_collect_finished(&ps, &sim->finished);
+    fprintf(log->fp, "Finished at t=%g\n", to_ticks(ps.end_time));
+    log_final_averages(log, &sim->finished);
+    report_model(sim, opt, sim->cpu.ncores, log->fp);
+    write_traces(&ps.view, opt);
+    psim_free(&ps);
+    return 0;
+}
 
-    /* show what will be simulated */
-    log_workload(&log, "Workload before simulation", &workload);
+/* Search the policy parameters on copies of the set-up simulation. */
+static int run_tuning(const Sim* sim, const SimOptions* opt, Log* log) {
+    Tuner t;
+    printf("Tuning %s on %d threads...\n", sched_name(&sim->sched),
+           sim->workload.size + sim_ready_count(sim) + sim->waiting.size);
+    if (tune_run(&t, &opt->tune_cfg, sim) != 0) {
+        fprintf(stderr, "cannot write the tuning snapshot next to %s\n", opt->tune_cfg.out);
+        return 1;
+    }
+    fprintf(log->fp, "# Tuning: %d runs, report in %s\n\n", t.nres, t.cfg.out);
+    FILE* f = fopen(t.cfg.out, "w");
+    if (f) {
+        tune_report(&t, f);
+        fclose(f);
+    }
+    if (t.best >= 0) {
+        const TuneResult* b = &t.res[t.best];
+        printf("Best of %d runs for %s: ", t.nres, tuneobj_name(t.cfg.obj));
+        if (b->quantum > 0) printf("quantum %g, ", to_ticks(b->quantum));
+        printf("aging %d, %d cores (score %.3f)\n", b->age_every, b->ncores, b->score);
+    } else {
+        printf("No tuning run finished\n");
+    }
+    if (f) printf("Wrote tuning report to %s\n", t.cfg.out);
+    else   printf("Failed to write %s\n", t.cfg.out);
+    tune_free(&t);
+    return 0;
+}
 
-    // Admit arrivals for tick 0 from workload -> ready
-    workload_admit_tick(&workload, &ready, SIM_TIME);
+/* a preset run as set up interactively, rebuilt for another seed */
+typedef struct {
+    const SimOptions* opt;
+    Setup setup;
+} PresetRun;
 
-    // MAIN SIMULATION LOOP
-    for (;;) {
-        // add processes that arrive at current tick to ready qeue
-        workload_admit_tick(&workload, &ready, SIM_TIME);
-        waiting_resolve(&waiting, &ready, SIM_TIME);     // move threads from waiting queue to ready queue if block_time has been met
-
-        random_interrupts(&intr, &cpu, &waiting, &log);  // simulate random IO interrupts
-    
-        // Schedule with selected policy
-        switch (algo) {
-            case DISP_FIFO:  dispatch_fifo(&cpu, &ready); break;
-            case DISP_SJF:   dispatch_sjf(&cpu, &ready);  break;
-            case DISP_SRTCF: dispatch_srtcf(&cpu, &ready); break;
-            case DISP_RR: dispatch_rr(&cpu, &ready, rr_quantum); break;
-            case DISP_PR: dispatch_priority(&cpu, &ready); break;
+static int build_preset(Sim* s, unsigned long long seed, void* ctx) {
+    const PresetRun* p = (const PresetRun*)ctx;
+    sim_init(s, p->setup.algo, p->setup.quantum, p->setup.ncores, 1);
+    if (apply_policy(s, p->opt) != 0) {
+        sim_free(s);
+        return 1;
+    }
+    apply_timing(s, p->opt);
+    rng_seed(&s->rng, seed);
+    s->intr.enable_random = p->setup.intr;
+    load_drawn(&s->workload, p->opt, &p->setup, seed);
+    apply_jobs(s, p->opt, seed);
+    apply_gangs(s, p->opt, seed);
+    apply_locks(s, p->opt, seed);
+    apply_groups(s, p->opt, seed);
+    apply_mem(s, p->opt, seed);
+    return 0;
+}
+
+/* Run the set-up simulation under successive seeds; preset is NULL unless
+   the workload is a preset or --synth, which is then drawn again for each
+   seed. */
+static int run_replications(const Sim* sim, const SimOptions* opt, PresetRun* preset, Log* log) {
+    Replicator r;
+    printf("Replicating %s from seed %llu...\n", sched_name(&sim->sched), opt->seed);
+    if (replicate_run(&r, &opt->replicate_cfg, sim, opt->seed,
+                      preset ? build_preset : NULL, preset) != 0) {
+        fprintf(stderr, "cannot write the replication snapshot next to %s\n",
+                opt->replicate_cfg.out);
+        return 1;
+    }
+    fprintf(log->fp, "# Replications: %d runs, report in %s\n\n", r.n, r.cfg.out);
+    FILE* f = fopen(r.cfg.out, "w");
+    if (f) {
+        replicate_report(&r, f);
+        if (opt->synth && r.n > 0) {
+            /* the models next to the means over every replication */
+            double wait, turn, half;
+            replicate_ci(&r, REP_WAIT, &wait, &half);
+            replicate_ci(&r, REP_TURN, &turn, &half);
+            fprintf(f, "\n");
+            qmodel_report(&opt->synth_cfg, sim->cpu.ncores,
+                          sim->sched.path[0] ? -1 : (int)sim->algo, wait, turn, f);
         }
+        fclose(f);
+    }
+    if (r.n > 0) {
+        double mean, half;
+        replicate_ci(&r, r.cfg.metric, &mean, &half);
+        printf("%d runs: %s %.3f +- %.3f (95%% CI)\n",
+               r.n, repmetric_name(r.cfg.metric), mean, half);
+    } else {
+        printf("No replication could be built\n");
+    }
+    if (f) printf("Wrote replication report to %s\n", r.cfg.out);
+    else   printf("Failed to write %s\n", r.cfg.out);
+    int rc = r.n > 0 ? 0 : 1;
+    replicate_free(&r);
+    return rc;
+}
 
-        // everyone still queued this tick accrues 1 unit of waiting
-        bump_queue_wait(&ready);
+/* Run the captured workload for real and write the comparison report. */
+static void run_validation(RealExec* rx, const Sim* sim, const SimOptions* opt) {
+    printf("Running %d threads for real on %d cores...\n", rx->ntasks, sim->cpu.ncores);
+    int rc = realexec_run(rx, sim->cpu.ncores, opt->validate_policy, opt->validate_scale,
+                          !sim->sched.path[0] && sim->algo == DISP_PR);
+    if (rc == 3) {
+        printf("Real execution failed: could not create %d threads (host thread limit?)\n", rx->ntasks);
+        return;
+    }
+    if (rc != 0) {
+        printf("Real execution failed\n");
+        return;
+    }
+    FILE* vf = fopen(opt->validate_report, "w");
+    if (!vf) {
+        printf("Failed to write %s\n", opt->validate_report);
+        return;
+    }
+    realexec_report(rx, &sim->finished, vf);
+    fclose(vf);
+    printf("Wrote real-execution comparison to %s\n", opt->validate_report);
+}
 
-        /* log state*/
-        log_snapshot(&log, SIM_TIME, &ready, &waiting, &cpu, &finished);
+/* one M:N runtime task: burn its CPU time, yielding every mn_slice */
+typedef struct {
+    simtime_t cpu;
+    simtime_t slice;
+} BenchTask;
 
-        /* run one tick on all cores */
-        cpu_step(&cpu);
+static void bench_task(void* arg) {
+    const BenchTask* b = (const BenchTask*)arg;
+    rt_spin(b->cpu, b->slice);
+}
 
-        /* decay priority (only effective in priority policy)*/
-        decay_priority(&waiting, &ready);
+/* Run the captured workload's CPU time on the M:N runtime. */
+static void run_mn_bench(const RealExec* rx, const Sim* sim, const SimOptions* opt) {
+    Runtime* rt = rt_create(sim->cpu.ncores, sim->algo, sim->rr_quantum, sim->sched.path);
+    BenchTask* bt = (BenchTask*)malloc(sizeof(BenchTask) * (rx->ntasks > 0 ? rx->ntasks : 1));
+    if (!rt || !bt) {
+        printf("Cannot start the M:N runtime\n");
+        rt_destroy(rt);
+        free(bt);
+        return;
+    }
+    for (int i = 0; i < rx->ntasks; ++i) {
+        bt[i].cpu = 0;
+        for (int k = 0; k < rx->task[i].nphases; ++k) bt[i].cpu += rx->task[i].phases[k].cpu;
+        bt[i].slice = opt->mn_slice;
+        rt_spawn(rt, bench_task, &bt[i], bt[i].cpu, rx->task[i].priority);
+    }
+    printf("Running %d fibers on %d workers...\n", rx->ntasks, sim->cpu.ncores);
+    if (rt_run(rt) != 0) {
+        printf("M:N runtime failed: could not start any worker thread\n");
+        rt_destroy(rt);
+        free(bt);
+        return;
+    }
 
-        /* move completed to finished */
-        collect_completions(&cpu, &finished);
+    FILE* f = fopen(opt->mn_report, "w");
+    if (f) {
+        rt_report(rt, f);
+        fclose(f);
+        printf("Wrote M:N runtime report to %s\n", opt->mn_report);
+    } else {
+        printf("Failed to write %s\n", opt->mn_report);
+    }
+    rt_destroy(rt);
+    free(bt);
+}
 
-        /* stop when all done */
-        if (all_done(&ready, &waiting, &cpu)) break;
+int main(int argc, char** argv) {
+    SimOptions opt;
+    int prc = parse_args(argc, argv, &opt);
+    if (prc != 0) return prc < 0 ? 2 : 0;
+    if (opt.predict) {
+        qmodel_plan(&opt.synth_cfg, opt.ncores, stdout);
+        return 0;
     }
 
-    // final log
-    log_snapshot(&log, SIM_TIME, &ready, &waiting, &cpu, &finished);
-    log_final_averages(&log, &finished);
-    log_close(&log);
+    /* --------- INIT LOGGING ----------- */
+    /* open log */
+    Log log;
+    if (log_open(&log, "sim_log.txt") != 0) {
+        fprintf(stderr, "cannot open sim_log.txt\n");
+        return 1;
+    }
+    log_set_multiline(&log, 1);  // turn on the indented block style
 
-    // output CPU core trace
-    if (write_core_trace_default(&cpu) == 0) {
-        printf("Wrote per-core trace to core trace.txt\n");
+    /* --------- INIT SIMULATION ---------- */
+    Sim sim;
+    ReplayTrace rt;
+    int replaying = 0;
+    PresetRun preset = { &opt, { DISP_FIFO, 0, 0, 0, 0 } };
+    if (opt.replay) {
+        if (replay_load(&rt, opt.replay) != 0) {
+            fprintf(stderr, "no sched_switch events read from %s\n", opt.replay);
+            log_close(&log);
+            return 1;
+        }
+        replaying = 1;
+        /* the kernel's CFS is closest to RR; cores default to the CPUs traced */
+        DispatchAlgo algo = opt.algo_set ? opt.algo : DISP_RR;
+        simtime_t quantum = opt.rr_quantum > 0 ? opt.rr_quantum : 4 * NS_PER_MS;
+        sim_init(&sim, algo, quantum, opt.ncores > 0 ? opt.ncores : rt.ncpus, opt.max_ticks);
+        if (apply_policy(&sim, &opt) != 0) {
+            sim_free(&sim);
+            replay_free(&rt);
+            log_close(&log);
+            return 1;
+        }
+        apply_timing(&sim, &opt);
+        int n = replay_build_workload(&rt, &sim.workload);
+        apply_jobs(&sim, &opt, opt.seed);
+        apply_gangs(&sim, &opt, opt.seed);
+        apply_locks(&sim, &opt, opt.seed);
+        apply_groups(&sim, &opt, opt.seed);
+        apply_mem(&sim, &opt, opt.seed);
+        printf("Replaying %s: %d tasks on %d cores with %s\n",
+               opt.replay, n, sim.cpu.ncores, sched_name(&sim.sched));
+        fprintf(log.fp, "# Replay of %s (%d tasks, %s, %d cores)\n\n",
+                opt.replay, n, sched_name(&sim.sched), sim.cpu.ncores);
+        log_workload(&log, "Workload before simulation", &sim.workload);
+    } else if (opt.restore) {
+        if (sim_checkpoint_load(&sim, opt.restore, opt.max_ticks) != 0) {
+            fprintf(stderr, "cannot restore snapshot %s\n", opt.restore);
+            log_close(&log);
+            return 1;
+        }
+        /* fork: continue under a different policy / core count if asked */
+        if (opt.algo_set || opt.policy || opt.rr_quantum > 0) {
+            DispatchAlgo algo = opt.algo_set ? opt.algo : sim.algo;
+            simtime_t quantum = opt.rr_quantum > 0 ? opt.rr_quantum : sim.rr_quantum;
+            /* --algo alone switches back to a built-in policy */
+            const char* path = opt.policy ? opt.policy : opt.algo_set ? "" : sim.sched.path;
+            char keep[SCHED_PATH_LEN];
+            snprintf(keep, sizeof(keep), "%s", path);   // path may point into sim.sched
+            if (sim_set_policy(&sim, algo, quantum, keep) != 0) {
+                fprintf(stderr, "cannot load scheduling policy %s\n", keep);
+                sim_free(&sim);
+                log_close(&log);
+                return 1;
+            }
+        }
+        if (opt.ctx_switch) sim.cpu.cs_ns = opt.ctx_switch;
+        apply_smt(&sim.cpu, &opt);
+        if (opt.aging) sim.age_every = opt.aging;
+        if (opt.seed_set) rng_seed(&sim.rng, opt.seed);
+        for (int d = 0; d < opt.ndev; ++d) sim_add_device(&sim, &opt.dev[d]);
+        if (opt.power) sim_enable_power(&sim, &opt.power_cfg);
+        if (opt.ncores > 0 && opt.ncores != sim.cpu.ncores) sim_set_cores(&sim, opt.ncores);
+        apply_scaling(&sim, &opt);
+        apply_admit(&sim, &opt);
+        printf("Restored %s at t=%g: %s on %d cores\n",
+               opt.restore, to_ticks(sim.now), sched_name(&sim.sched), sim.cpu.ncores);
+        fprintf(log.fp, "# Restored from %s at t=%g (%s, %d cores)\n\n",
+                opt.restore, to_ticks(sim.now), sched_name(&sim.sched), sim.cpu.ncores);
     } else {
-        printf("Failed to write per-core trace\n");
+        if (setup_interactive(&sim, &opt, &preset.setup) != 0) {
+            log_close(&log);
+            return 1;
+        }
+        apply_jobs(&sim, &opt, opt.seed);
+        apply_gangs(&sim, &opt, opt.seed);
+        apply_locks(&sim, &opt, opt.seed);
+        apply_groups(&sim, &opt, opt.seed);
+        apply_mem(&sim, &opt, opt.seed);
+        log_interrupts_config(&log, sim.intr.enable_random, sim.intr.pct_io,
+                              sim.intr.io_min, sim.intr.io_max);
+        /* show what will be simulated */
+        log_workload(&log, "Workload before simulation", &sim.workload);
+    }
+    if (opt.tune || opt.replicate) {
+        int fresh = preset.setup.workload == 1 || preset.setup.workload == 2 ||
+                    preset.setup.workload == 4;
+        int rc = opt.tune ? run_tuning(&sim, &opt, &log)
+                          : run_replications(&sim, &opt, fresh ? &preset : NULL, &log);
+        log_close(&log);
+        if (replaying) replay_free(&rt);
+        sim_free(&sim);
+        return rc;
+    }
+    /* both real-work modes replay the workload as it was before simulating */
+    RealExec rx;
+    int captured = (opt.validate || opt.mn_bench) && realexec_capture(&rx, &sim.workload) == 0;
+    if (!captured) opt.validate = opt.mn_bench = 0;
+
+    if (opt.partitions > 0) {
+        int rc = run_partitioned(&sim, &opt, &log);
+        log_close(&log);
+        if (rc == 0 && opt.validate) run_validation(&rx, &sim, &opt);
+        if (rc == 0 && opt.mn_bench) run_mn_bench(&rx, &sim, &opt);
+        if (captured) realexec_free(&rx);
+        sim_free(&sim);
+        return rc;
+    }
+    /* the flight recorder replaces per-tick logging */
+    Flight flight;
+    if (opt.flight) {
+        if (flight_init(&flight, &opt.flight_cfg) != 0) {
+            fprintf(stderr, "cannot open %s\n", opt.flight_cfg.path);
+            log_close(&log);
+            if (captured) realexec_free(&rx);
+            sim_free(&sim);
+            return 1;
+        }
+        sim.flight = &flight;
+    } else {
+        sim.log = &log;
+    }
+
+    // MAIN SIMULATION LOOP
+    sim_run(&sim, opt.checkpoint_at);
+
+    if (opt.flight) {
+        flight_finish(&flight, sim.now, log.fp);
+        printf("Flight recorder: %d dumps written to %s\n", flight.dumps, opt.flight_cfg.path);
+        flight_free(&flight);
+        sim.flight = NULL;
+        sim.log = &log;   // the final state is still logged
     }
 
-    /* free thread objects from finished queue only, since we moved all into it */
-    while (!q_empty(&finished)) {
-        Thread* t = q_pop(&finished);
-        free(t);
+    if (opt.checkpoint_at >= 0 && sim.now == opt.checkpoint_at && !sim_done(&sim)) {
+        int rc = sim_checkpoint_save(&sim, opt.checkpoint);
+        if (rc == 0) printf("Paused at t=%g, snapshot written to %s\n", to_ticks(sim.now), opt.checkpoint);
+        else         printf("Failed to write snapshot %s\n", opt.checkpoint);
+        fprintf(log.fp, "# Paused at t=%g\n", to_ticks(sim.now));
+        log_close(&log);
+        if (captured) realexec_free(&rx);
+        sim_free(&sim);
+        return rc == 0 ? 0 : 1;
     }
 
-    // free
-    for (int c = 0; c < ncores_for_trace; ++c) free(run_trace[c]);
-    free(run_trace);
+    // final log
+    SIM_TIME = sim.now;
+    sim_log_snapshot(&sim);
+    log_final_averages(&log, &sim.finished);
+    report_model(&sim, &opt, preset.setup.ncores, log.fp);
+    device_report(sim.dev, sim.ndev, sim.now, log.fp);
+    lock_report(sim.lock, sim.nlock, sim.now, log.fp);
+    group_report(sim.group, sim.ngroup, &sim.finished, sim.now, sim.cpu.ncores, log.fp);
+    job_report(sim.job, sim.njob, sim.cpu.ncores, log.fp);
+    if (sim.ngang > 0) {
+        GangMatrixStats m;
+        int have = dispatch_gang_stats(sim.sched.ops, sim.sched.priv, &m) == 0;
+        gang_report(sim.gang, sim.ngang, have ? &m : NULL, sim.idle_ready_ns, sim.core_ns, log.fp);
+    }
+    if (sim.cpu.smt > 1)
+        fprintf(log.fp, "# SMT: %d threads per physical core, +%d%% per extra busy sibling\n\n",
+                sim.cpu.smt, sim.cpu.smt_gain * 100 / CPU_RATE_ONE);
+    if (sim.power) power_report(sim.power, &sim.finished, sim.now, log.fp);
+    if (sim.scale || sim.nhotplug > 0)
+        autoscale_report(sim.scale, sim.core_ns, sim.now, log.fp);
+    if (sim.admit) admit_report(sim.admit, &sim.finished, sim.now, log.fp);
+    if (sim.mem) mem_report(sim.mem, cpu_time_run(&sim), log.fp);
+    log_close(&log);
+
+    if (replaying) {
+        FILE* rf = fopen(opt.replay_report, "w");
+        if (rf) {
+            replay_report(&rt, &sim.finished, rf);
+            fclose(rf);
+            printf("Wrote replay divergence report to %s\n", opt.replay_report);
+        } else {
+            printf("Failed to write %s\n", opt.replay_report);
+        }
+        replay_free(&rt);
+    }
+
+    write_traces(&sim.cpu, &opt);
+
+    if (opt.validate) run_validation(&rx, &sim, &opt);
+    if (opt.mn_bench) run_mn_bench(&rx, &sim, &opt);
+    if (captured) realexec_free(&rx);
 
-    free(cpu.core);
+    /* frees the thread objects (all in finished by now) and the CPU */
+    sim_free(&sim);
     return 0;
 }
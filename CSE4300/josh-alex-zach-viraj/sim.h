@@ -18,29 +18,87 @@
        3) cpu advances one tick
        4) we log the snapshot of all queues/cores to a txt file
    - Keep room to grow (multi-core, waiting/blocked, stats), but stay simple now.
+
+  Time is kept in 64-bit nanoseconds (simtime_t). A tick is the timer
+  interrupt period (SIM_TICK_NS): logging, priority decay, random interrupts
+  and RR slice expiry happen on ticks. Within a tick, arrivals, wakeups,
+  completions and phase ends happen at their exact time and the dispatcher
+  runs again at each of them, so sub-tick bursts and I/O are not rounded.
 */
 
+#include <stdint.h>
+
+typedef int64_t simtime_t;
+
+#define SIMTIME_NEVER  INT64_MAX
+
+/* unit helpers */
+#define NS_PER_US  1000LL
+#define NS_PER_MS  1000000LL
+#define NS_PER_S   1000000000LL
+
 typedef enum {
     ST_NEW = 0,
     ST_READY,
     ST_RUNNING,
     ST_WAITING,
-    ST_FINISHED
+    ST_FINISHED,
+    ST_DROPPED       // turned away by admission control
 } ThreadState;
 
+/* One step of a scripted thread: run cpu ns, then block for io ns. */
+typedef struct {
+    simtime_t cpu;
+    simtime_t io;
+} Phase;
+
+/* One point of a lock script: after at ns of CPU time, acquire (or
+   release) lock number lock (see lock.h). */
+typedef struct {
+    simtime_t at;
+    int lock;
+    int acquire;              // 1 = acquire, 0 = release
+} LockOp;
+
 typedef struct Thread {
-    int tid;            // integer thread id
-    int arrival_time;   // arrival time
-    int burst_time;     // total CPU time needed to complete
-    int remaining;      // remaining run time
-    ThreadState state;  // current state / queue
-    int unblocked_at;   // for handling IO blocking
-    struct Thread* next;    // for singly-linked queues
-    int start_time;         // first time it ever ran; -1 until set
-    int finish_time;        // completion time; -1 until set
-    int wait_time;          // ticks spent in ready qeue
-    int quanta_rem;         // ticks remaining in this threads timeslice (for RR)
-    int priority;           // priority of thread
+    int tid;                  // integer thread id
+    simtime_t arrival_time;   // arrival time
+    simtime_t burst_time;     // total CPU time needed to complete
+    simtime_t remaining;      // remaining run time
+    ThreadState state;        // current state / queue
+    simtime_t unblocked_at;   // for handling IO blocking
+    struct Thread* next;      // for singly-linked queues
+    simtime_t start_time;     // first time it ever ran; -1 until set
+    simtime_t finish_time;    // completion time; -1 until set
+    simtime_t wait_time;      // time spent in ready qeue
+    simtime_t ready_since;    // when it last entered Ready
+    simtime_t quanta_rem;     // time remaining in this threads timeslice (for RR)
+    int priority;             // priority of thread
+    Phase* phases;            // optional CPU/IO script (owned); NULL = one burst
+    int nphases;
+    int phase;                // index of the current phase
+    simtime_t stop_at;        // cpu_step stops when remaining reaches this (phase end or lock point)
+    int ready_count;          // times the thread entered Ready (wait_time / this = latency)
+    simtime_t phase_end;      // remaining at the end of the current phase (0 = no phases)
+    LockOp* lockops;          // optional lock script (owned), sorted by at
+    int nlockops;
+    int lockop;               // index of the next lock point
+    int blocked_on;           // lock it waits for, -1 = none
+    int boosted;              // priority raised by a lock protocol
+    int base_priority;        // own priority while boosted
+    simtime_t lock_since;     // first attempt at the pending acquire, -1 = none
+    double energy;            // joules its cores spent running it (power model)
+    int group;                // CPU bandwidth group (see cgroup.h), -1 = none
+    int job;                  // DAG job (see dag.h), -1 = none
+    int task;                 // index within the job
+    int deps_left;            // unfinished predecessors
+    simtime_t cp_tail;        // longest CPU path through the successors
+    simtime_t cp_due;         // job arrival + critical path (ideal finish)
+    int gang;                 // gang (see gang.h), -1 = none
+    int gang_rank;            // index within the gang
+    int gang_size;            // members of the gang
+    struct PageTable* pages;  // working set (see mem.h, owned), NULL = no paging
+    simtime_t mem_at;         // remaining at the next page reference, 0 = none
 } Thread;
 
 /* -------- Generic queue of Thread* (singly linked) -------- */
@@ -51,25 +109,83 @@ typedef struct {
 } Queue;
 
 /* -------- CPU with N cores (one thread per core) -------- */
-typedef struct {
+#define CPU_RATE_ONE 1024   // CPU.rate of a core running at full speed
+
+typedef struct CPU {
     int ncores;
     Thread** core;  // core[i] points to the running thread or NULL
 
+    // context switch cost: a core switching to a different thread spends
+    // cs_ns of overhead before the thread makes progress
+    simtime_t  cs_ns;
+    simtime_t* cs_left;   // overhead still to pay on each core (switches,
+                          // frequency transitions, wakeups from sleep)
+    int*       last_tid;  // last thread each core ran, -1 = none
+
+    // work per ns of each core in 1/CPU_RATE_ONE (remaining is counted at
+    // full speed); NULL = every core at full speed
+    int*       rate;
+
+    // SMT: each run of smt consecutive logical cores shares one physical
+    // core. With k of them busy, together they do 1 + (k - 1) * smt_gain /
+    // CPU_RATE_ONE of one core's work, split evenly. smt <= 1 = no sharing
+    int        smt;
+    int        smt_gain;
+
+    // optional placement: idle cores are filled in increasing cost order
+    // (ties in core order); NULL = core order
+    int      (*place_cost)(const struct CPU* cpu, int core, void* ctx);
+    void*      place_ctx;
+
+    // running threads' state copied into flat per-core arrays by cpu_load,
+    // so cpu_next_event and cpu_step stream over them instead of chasing
+    // core[i]; idle cores hold rate 0. cpu_step writes remaining and
+    // quanta_rem back, so outside it the threads stay the real state
+    Thread**   run_thr;   // thread the copy is of; NULL after a bind
+    simtime_t* run_left;  // remaining - stop_at: work to the next stop
+    simtime_t* run_q;     // quanta_rem
+    simtime_t* run_rate;  // work per ns in 1/CPU_RATE_ONE, shared with siblings
+    int*       run_tid;
+    int*       trace_at;  // tick whose run_trace slot the core last filled
+    uint8_t*   run_flag;  // cpu_step's attn bits unpacked, padded to words
+    uint64_t*  attn;      // bit c: core c reached its stop point or the end
+                          // of its quantum in the last cpu_step
+
     // to trace core activity / schedule
     int  **run_trace;     // run_trace[c][t] = tid or -1
     int    trace_len;     // MAX_TICKS (bounds check convenience)
 } CPU;
 
+#define CPU_ATTN_WORDS(n) (((n) + 63) / 64)
+
 /* ---------------- Interrupt Configuration ---------------- */
 typedef struct {
     int enable_random;   // 0/1
-    int pct_io;          // % chance a running thread blocks for I/O
-    int io_min;          // min I/O duration (ticks)
-    int io_max;          // max I/O duration (ticks)
+    int pct_io;          // % chance per tick a running thread blocks for I/O
+    simtime_t io_min;    // min I/O duration (ns)
+    simtime_t io_max;    // max I/O duration (ns)
 } InterruptConfig;
 
-/* -------- Global clock (integer ticks) -------- */
-extern int SIM_TIME;
+/* ---------------- Random number state ---------------- */
+/* Owned by the simulation (not rand()) so it can be checkpointed. */
+typedef struct {
+    unsigned long long s;
+} Rng;
+
+/* Inline into every caller even at -O2, so a call with constant
+   arguments (a feature flag, a policy's functions) specializes the body */
+#if defined(__GNUC__)
+#define SIM_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define SIM_ALWAYS_INLINE inline
+#endif
+
+/* -------- Global clock (nanoseconds) -------- */
+/* Thread-local so independent simulations can run on separate host threads. */
+extern _Thread_local simtime_t SIM_TIME;
+
+/* Timer tick length in ns (default 1 ms); set once before simulating. */
+extern simtime_t SIM_TICK_NS;
 
 /* ===== util.h will expose queue and logging helpers ===== */
 #include "util.h"
@@ -82,9 +198,16 @@ extern int SIM_TIME;
 /* Build an empty, sorted-by-arrival "arrivals" queue through finalize() */
 /* workload api you requested */
 void workload_init(Queue* workload);
-void workload_add(Queue* workload, int tid, int arrival, int burst, int priority);
-/* Move any threads whose arrival_time == now from workload -> ready */
-void workload_admit_tick(Queue* workload, Queue* ready, int now);
+void workload_add(Queue* workload, int tid, simtime_t arrival, simtime_t burst, int priority);
+/* Scripted thread: burst is the sum of phases[i].cpu; after each phase the
+   thread blocks for phases[i].io. phases is copied. */
+void workload_add_phases(Queue* workload, int tid, simtime_t arrival,
+                         const Phase* phases, int nphases, int priority);
+/* Free a thread and anything it owns. */
+void thread_free(Thread* t);
+/* Move any threads whose arrival_time <= now from workload -> ready.
+   Returns the earliest arrival still pending, or SIMTIME_NEVER. */
+simtime_t workload_admit_tick(Queue* workload, Queue* ready, simtime_t now);
 
 /* Utility to free the simple workload list (after finalize). */
 void workload_clear(void);
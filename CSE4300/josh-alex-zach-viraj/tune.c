@@ -0,0 +1,465 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <unistd.h>
+#include <math.h>
+#include "tune.h"
+#include "checkpoint.h"
+#include "util.h"
+
+// most interval shrinks per parameter and round
+#define TUNE_MAX_STEPS 16
+
+const char* tuneobj_name(TuneObjective o) {
+    switch (o) {
+        case TUNE_P99:  return "p99 response";
+        case TUNE_TURN: return "mean turnaround";
+        case TUNE_TPUT: return "throughput (makespan)";
+    }
+    return "?";
+}
+
+/* "LO:HI", "N" (LO = HI) or "off"; values parsed by one_val */
+static int parse_range(const char* v, long long* lo, long long* hi, int allow_off,
+                       int (*one_val)(const char* s, long long* x)) {
+    char buf[64];
+    if (strlen(v) >= sizeof(buf)) return -1;
+    if (strcmp(v, "off") == 0) {
+        if (!allow_off) return -1;
+        *lo = *hi = 0;
+        return 0;
+    }
+    strcpy(buf, v);
+    char* h = strchr(buf, ':');
+    if (h) *h++ = '\0';
+    if (one_val(buf, lo) != 0 || one_val(h ? h : buf, hi) != 0) return -1;
+    return *lo >= 1 && *hi >= *lo ? 0 : -1;
+}
+
+static int dur_val(const char* s, long long* x) {
+    simtime_t t;
+    if (parse_duration(s, &t) != 0) return -1;
+    *x = t;
+    return 0;
+}
+
+static int int_val(const char* s, long long* x) {
+    char* end;
+    *x = strtoll(s, &end, 10);
+    return end != s && *end == '\0' ? 0 : -1;
+}
+
+int tune_parse(const char* spec, TuneConfig* cfg) {
+    char buf[512], *opts, *k, *v;
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->obj    = TUNE_P99;
+    cfg->q_lo   = cfg->q_hi = -1;
+    cfg->age_lo = cfg->age_hi = -1;
+    cfg->probes = 5;
+    cfg->rounds = 2;
+    snprintf(cfg->out, sizeof(cfg->out), "tune_report.txt");
+    if (spec_split(spec, buf, sizeof(buf), 0, NULL, &opts) != 0) return -1;
+
+    while ((k = spec_next(&opts, &v)) != NULL) {
+        if (!v) return -1;
+        long long lo, hi;
+        if (strcmp(k, "obj") == 0) {
+            if      (strcmp(v, "p99") == 0)  cfg->obj = TUNE_P99;
+            else if (strcmp(v, "turn") == 0) cfg->obj = TUNE_TURN;
+            else if (strcmp(v, "tput") == 0) cfg->obj = TUNE_TPUT;
+            else return -1;
+        } else if (strcmp(k, "quantum") == 0) {
+            if (parse_range(v, &lo, &hi, 1, dur_val) != 0) return -1;
+            cfg->q_lo = lo;
+            cfg->q_hi = hi;
+        } else if (strcmp(k, "aging") == 0) {
+            if (parse_range(v, &lo, &hi, 1, int_val) != 0 || hi > 1000000) return -1;
+            cfg->age_lo = (int)lo;
+            cfg->age_hi = (int)hi;
+        } else if (strcmp(k, "cores") == 0) {
+            if (parse_range(v, &lo, &hi, 0, int_val) != 0 || hi > 4096) return -1;
+            cfg->cores_lo = (int)lo;
+            cfg->cores_hi = (int)hi;
+        } else if (strcmp(k, "probes") == 0) {
+            cfg->probes = atoi(v);
+            if (cfg->probes < 3 || cfg->probes > 64) return -1;
+        } else if (strcmp(k, "rounds") == 0) {
+            cfg->rounds = atoi(v);
+            if (cfg->rounds < 1) return -1;
+        } else if (strcmp(k, "workers") == 0) {
+            cfg->workers = atoi(v);
+            if (cfg->workers < 1) return -1;
+        } else if (strcmp(k, "out") == 0) {
+            if (v[0] == '\0' || strlen(v) >= sizeof(cfg->out)) return -1;
+            snprintf(cfg->out, sizeof(cfg->out), "%s", v);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* ---------------- Running candidates ---------------- */
+
+/* a loaded candidate and where its result goes */
+typedef struct {
+    Sim sim;
+    int ok;                 // loaded and configured
+    TuneResult* res;
+} TuneRun;
+
+typedef struct {
+    TuneRun* run;
+    int n;
+    int next;               // next run to take
+    pthread_mutex_t lock;
+    simtime_t t0;           // start state's clock
+    int base_finished;      // threads already finished in the start state
+    TuneObjective obj;
+} Batch;
+
+static void measure(const Sim* s, const Batch* b, TuneResult* r) {
+    FinishStats st;
+    finish_stats(&s->finished, &st);
+    r->p99      = st.p99_resp;
+    r->turn     = st.turn;
+    r->makespan = to_ticks(s->now - b->t0);
+    r->finished = s->finished.size - b->base_finished;
+    switch (b->obj) {
+        case TUNE_P99:  r->score = r->p99;      break;
+        case TUNE_TURN: r->score = r->turn;     break;
+        case TUNE_TPUT: r->score = r->makespan; break;
+    }
+}
+
+static void* tune_worker(void* arg) {
+    Batch* b = (Batch*)arg;
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        int i = b->next++;
+        pthread_mutex_unlock(&b->lock);
+        if (i >= b->n) break;
+        TuneRun* r = &b->run[i];
+        if (!r->ok) continue;
+        sim_run(&r->sim, -1);
+        measure(&r->sim, b, r->res);
+        sim_free(&r->sim);
+    }
+    return NULL;
+}
+
+/* Load t->res[first..nres-1] from the snapshot on this thread (loading
+   sets the global tick length), then run them on the workers. */
+static void run_batch(Tuner* t, int first, const char* snap, const Sim* base) {
+    Batch b;
+    b.n    = t->nres - first;
+    b.run  = (TuneRun*)calloc(b.n, sizeof(TuneRun));
+    b.next = 0;
+    b.t0   = base->now;
+    b.base_finished = base->finished.size;
+    b.obj  = t->cfg.obj;
+    pthread_mutex_init(&b.lock, NULL);
+
+    for (int i = 0; i < b.n; ++i) {
+        TuneRun* r = &b.run[i];
+        TuneResult* res = &t->res[first + i];
+        r->res = res;
+        res->finished = -1;
+        res->score    = HUGE_VAL;
+        if (sim_checkpoint_load(&r->sim, snap, 1) != 0) continue;
+        Sim* s = &r->sim;
+        if (res->quantum != s->rr_quantum) {
+            char keep[SCHED_PATH_LEN];
+            snprintf(keep, sizeof(keep), "%s", s->sched.path);
+            if (sim_set_policy(s, s->algo, res->quantum, keep) != 0) {
+                sim_free(s);
+                continue;
+            }
+        }
+        s->age_every = res->age_every;
+        sim_set_cores(s, res->ncores);
+        r->ok = 1;
+    }
+
+    int nw = t->workers < b.n ? t->workers : b.n;
+    pthread_t* tids = (pthread_t*)malloc(sizeof(pthread_t) * (nw > 0 ? nw : 1));
+    /* workers draw from the shared batch, so one the host refuses only
+       means fewer hands; join the ones that started */
+    int started = 1;   // the calling thread is worker 0
+    for (int w = 1; w < nw; ++w)
+        if (pthread_create(&tids[started], NULL, tune_worker, &b) == 0) started++;
+    tune_worker(&b);
+    for (int w = 1; w < started; ++w) pthread_join(tids[w], NULL);
+
+    pthread_mutex_destroy(&b.lock);
+    free(tids);
+    free(b.run);
+    t->batches++;
+}
+
+/* ---------------- Search ---------------- */
+
+static int find(const Tuner* t, int ncores, simtime_t q, int age) {
+    for (int i = 0; i < t->nres; ++i)
+        if (t->res[i].ncores == ncores && t->res[i].quantum == q && t->res[i].age_every == age)
+            return i;
+    return -1;
+}
+
+/* index of the point, queueing it for the next batch if it is new */
+static int want(Tuner* t, int ncores, simtime_t q, int age, int* added) {
+    int i = find(t, ncores, q, age);
+    if (i >= 0) return i;
+    if (t->nres == t->cap) {
+        t->cap = t->cap ? 2 * t->cap : 64;
+        t->res = (TuneResult*)realloc(t->res, sizeof(TuneResult) * t->cap);
+    }
+    TuneResult* r = &t->res[t->nres];
+    memset(r, 0, sizeof(*r));
+    r->ncores    = ncores;
+    r->quantum   = q;
+    r->age_every = age;
+    *added = 1;
+    return t->nres++;
+}
+
+/* one line search per core count, over one parameter */
+typedef struct {
+    int       ncores;
+    simtime_t quantum;      // current setting
+    int       age;
+    double    lo, hi;       // interval, log scale
+    int       steps;
+    int       active;
+    int*      pt;           // result index of each probe this step
+} Line;
+
+enum { DIM_QUANTUM = 0, DIM_AGING };
+
+/* parameter value at log-scale x, snapped to its grid */
+static long long value_at(const TuneConfig* c, int dim, double x) {
+    if (dim == DIM_AGING) {
+        long long a = llround(exp(x));
+        return a < c->age_lo ? c->age_lo : a > c->age_hi ? c->age_hi : a;
+    }
+    simtime_t unit = SIM_TICK_NS / 100 > 0 ? SIM_TICK_NS / 100 : 1;
+    simtime_t q = llround(exp(x) / unit) * unit;
+    return q < c->q_lo ? c->q_lo : q > c->q_hi ? c->q_hi : q;
+}
+
+static double probe_x(const Line* l, int i, int k) {
+    return l->lo + (l->hi - l->lo) * i / (k - 1);
+}
+
+static void search_dim(Tuner* t, Line* line, int nline, int dim, const char* snap, const Sim* base) {
+    const TuneConfig* c = &t->cfg;
+    int k = c->probes;
+    for (int li = 0; li < nline; ++li) {
+        Line* l = &line[li];
+        l->lo = log((double)(dim == DIM_QUANTUM ? c->q_lo : c->age_lo));
+        l->hi = log((double)(dim == DIM_QUANTUM ? c->q_hi : c->age_hi));
+        l->steps  = 0;
+        l->active = 1;
+    }
+
+    for (;;) {
+        int first = t->nres, any = 0;
+        for (int li = 0; li < nline; ++li) {
+            Line* l = &line[li];
+            if (!l->active) continue;
+            any = 1;
+            int added = 0;
+            for (int i = 0; i < k; ++i) {
+                long long v = value_at(c, dim, probe_x(l, i, k));
+                l->pt[i] = dim == DIM_QUANTUM ? want(t, l->ncores, v, l->age, &added)
+                                              : want(t, l->ncores, l->quantum, (int)v, &added);
+            }
+            /* nothing new: the interval is down to the grid */
+            if (!added || ++l->steps >= TUNE_MAX_STEPS) l->active = 0;
+        }
+        if (!any) break;
+        if (t->nres > first) run_batch(t, first, snap, base);
+
+        /* move each line to its best probe and narrow around it */
+        for (int li = 0; li < nline; ++li) {
+            Line* l = &line[li];
+            if (l->steps == 0) continue;
+            int b = 0;
+            for (int i = 1; i < k; ++i)
+                if (t->res[l->pt[i]].score < t->res[l->pt[b]].score) b = i;
+            const TuneResult* r = &t->res[l->pt[b]];
+            if (dim == DIM_QUANTUM) l->quantum = r->quantum;
+            else                    l->age     = r->age_every;
+            double lo = probe_x(l, b > 0 ? b - 1 : 0, k);
+            double hi = probe_x(l, b < k - 1 ? b + 1 : k - 1, k);
+            l->lo = lo;
+            l->hi = hi;
+        }
+    }
+}
+
+int tune_run(Tuner* t, const TuneConfig* cfg, const Sim* base) {
+    memset(t, 0, sizeof(*t));
+    t->cfg  = *cfg;
+    t->best = -1;
+    TuneConfig* c = &t->cfg;
+
+    /* defaults by policy: sliced ones and external policies have a quantum, the
+       priority policy and external ones age in their tick */
+    int ext = base->sched.path[0] != '\0';
+    if (c->q_lo < 0) {
+        c->q_lo = ext || dispatch_sliced(base->algo) ? SIM_TICK_NS : 0;
+        c->q_hi = ext || dispatch_sliced(base->algo) ? 50 * SIM_TICK_NS : 0;
+    }
+    if (c->age_lo < 0) {
+        c->age_lo = ext || base->algo == DISP_PR ? 1 : 0;
+        c->age_hi = ext || base->algo == DISP_PR ? 32 : 0;
+    }
+    if (c->cores_lo < 1) c->cores_lo = c->cores_hi = base->cpu.ncores;
+
+    t->workers = c->workers;
+    if (t->workers < 1) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        t->workers = n < 1 ? 1 : n > 64 ? 64 : (int)n;
+    }
+
+    char snap[TUNE_PATH_LEN + 16];
+    snprintf(snap, sizeof(snap), "%s.XXXXXX", c->out);
+    int fd = mkstemp(snap);
+    if (fd < 0) return 1;
+    close(fd);
+    if (sim_checkpoint_save(base, snap) != 0) {
+        remove(snap);
+        return 1;
+    }
+
+    /* core counts, evenly spaced over the range */
+    int span = c->cores_hi - c->cores_lo;
+    int nline = span + 1 < TUNE_MAX_CORES ? span + 1 : TUNE_MAX_CORES;
+    Line* line = (Line*)calloc(nline, sizeof(Line));
+    for (int li = 0; li < nline; ++li) {
+        Line* l = &line[li];
+        l->ncores  = nline > 1 ? c->cores_lo + (int)((long long)span * li / (nline - 1)) : c->cores_lo;
+        l->quantum = c->q_lo > 0 ? c->q_lo : base->rr_quantum;
+        l->age     = c->age_lo > 0 ? c->age_lo : base->age_every;
+        l->pt      = (int*)malloc(sizeof(int) * c->probes);
+    }
+
+    int ndim = 0, dims[2];
+    if (c->q_lo > 0)   dims[ndim++] = DIM_QUANTUM;
+    if (c->age_lo > 0) dims[ndim++] = DIM_AGING;
+    if (ndim == 0) {
+        /* only the core count varies */
+        int first = t->nres, added = 0;
+        for (int li = 0; li < nline; ++li)
+            (void)want(t, line[li].ncores, line[li].quantum, line[li].age, &added);
+        run_batch(t, first, snap, base);
+    }
+    for (int r = 0; r < c->rounds && ndim > 0; ++r)
+        for (int d = 0; d < ndim; ++d) search_dim(t, line, nline, dims[d], snap, base);
+
+    for (int i = 0; i < t->nres; ++i)
+        if (t->res[i].finished >= 0 && (t->best < 0 || t->res[i].score < t->res[t->best].score))
+            t->best = i;
+
+    for (int li = 0; li < nline; ++li) free(line[li].pt);
+    free(line);
+    remove(snap);
+    return 0;
+}
+
+void tune_free(Tuner* t) {
+    free(t->res);
+    t->res = NULL;
+    t->nres = t->cap = 0;
+}
+
+/* ---------------- Report ---------------- */
+
+/* a is no worse than b everywhere and better somewhere; of equal runs
+   the first one (a_first) stands for the others */
+static int dominates(const TuneResult* a, const TuneResult* b, int a_first) {
+    if (a->p99 > b->p99 || a->turn > b->turn || a->makespan > b->makespan || a->ncores > b->ncores)
+        return 0;
+    return a->p99 < b->p99 || a->turn < b->turn || a->makespan < b->makespan ||
+           a->ncores < b->ncores || a_first;
+}
+
+static int cmp_score(const void* a, const void* b) {
+    const TuneResult* x = (const TuneResult*)a;
+    const TuneResult* y = (const TuneResult*)b;
+    if (x->score != y->score) return x->score < y->score ? -1 : 1;
+    return x->ncores - y->ncores;
+}
+
+static int cmp_cores(const void* a, const void* b) {
+    const TuneResult* x = (const TuneResult*)a;
+    const TuneResult* y = (const TuneResult*)b;
+    if (x->ncores != y->ncores) return x->ncores - y->ncores;
+    return cmp_score(a, b);
+}
+
+static void print_row(const TuneResult* r, FILE* out) {
+    char q[32], age[16];
+    if (r->quantum > 0) snprintf(q, sizeof(q), "%.2f", to_ticks(r->quantum));
+    else                snprintf(q, sizeof(q), "-");
+    snprintf(age, sizeof(age), "%d", r->age_every);
+    fprintf(out, "%5d %8s %6s %8d %9.3f %10.3f %9.3f %11.4f\n",
+            r->ncores, q, age, r->finished, r->p99, r->turn, r->makespan,
+            r->makespan > 0 ? r->finished / r->makespan : 0.0);
+}
+
+static void print_head(FILE* out) {
+    fprintf(out, "%5s %8s %6s %8s %9s %10s %9s %11s\n",
+            "CORES", "QUANTUM", "AGING", "FINISHED", "P99_RESP", "MEAN_TURN", "MAKESPAN", "THROUGHPUT");
+}
+
+void tune_report(const Tuner* t, FILE* out) {
+    const TuneConfig* c = &t->cfg;
+    fprintf(out, "# Tuning: minimize %s (times in ticks)\n", tuneobj_name(c->obj));
+    fprintf(out, "Searched: quantum ");
+    if (c->q_lo > 0) fprintf(out, "%.2f..%.2f", to_ticks(c->q_lo), to_ticks(c->q_hi));
+    else             fprintf(out, "fixed");
+    fprintf(out, ", aging ");
+    if (c->age_lo > 0) fprintf(out, "%d..%d", c->age_lo, c->age_hi);
+    else               fprintf(out, "fixed");
+    fprintf(out, ", cores %d..%d\n", c->cores_lo, c->cores_hi);
+    fprintf(out, "Runs: %d in %d batches on %d workers, %d probes, %d rounds\n\n",
+            t->nres, t->batches, t->workers, c->probes, c->rounds);
+    if (t->best < 0) {
+        fprintf(out, "No run finished.\n\n");
+        return;
+    }
+
+    /* by core count, then objective: the first of each core count is its best */
+    TuneResult* v = (TuneResult*)malloc(sizeof(TuneResult) * t->nres);
+    int nv = 0;
+    for (int i = 0; i < t->nres; ++i)
+        if (t->res[i].finished >= 0) v[nv++] = t->res[i];
+    qsort(v, nv, sizeof(TuneResult), cmp_cores);
+    fprintf(out, "# Best per core count\n");
+    print_head(out);
+    for (int i = 0; i < nv; ++i)
+        if (i == 0 || v[i].ncores != v[i - 1].ncores) print_row(&v[i], out);
+    free(v);
+    fprintf(out, "\nBest: ");
+    print_row(&t->res[t->best], out);
+
+    /* Pareto front over every run, best objective first */
+    TuneResult* front = (TuneResult*)malloc(sizeof(TuneResult) * t->nres);
+    int nf = 0;
+    for (int i = 0; i < t->nres; ++i) {
+        const TuneResult* r = &t->res[i];
+        if (r->finished < 0) continue;
+        int dom = 0;
+        for (int j = 0; j < t->nres && !dom; ++j)
+            if (j != i && t->res[j].finished >= 0 && dominates(&t->res[j], r, j < i)) dom = 1;
+        if (!dom) front[nf++] = *r;
+    }
+    qsort(front, nf, sizeof(TuneResult), cmp_score);
+    fprintf(out, "\n# Pareto front over (p99, mean turnaround, throughput, cores): %d of %d runs\n",
+            nf, t->nres);
+    print_head(out);
+    for (int i = 0; i < nf; ++i) print_row(&front[i], out);
+    fprintf(out, "(AGING = ticks between priority aging steps, THROUGHPUT = threads per tick)\n\n");
+    free(front);
+}
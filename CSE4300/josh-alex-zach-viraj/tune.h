@@ -0,0 +1,88 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "engine.h"
+
+/*
+  Policy parameter tuner: searches the RR quantum, the priority aging
+  interval (Sim.age_every) and the core count for the setting that
+  minimizes an objective on one workload.
+
+  Every candidate is a full run from the same starting state, a snapshot
+  of the set-up Sim, so devices, locks, groups, jobs and the power model
+  take part as in a normal run. The base Sim's context switch cost is
+  kept: it is what makes a short quantum expensive.
+
+  Search: each core count in the range (at most TUNE_MAX_CORES values,
+  evenly spaced) is tuned on its own. In each round every searched
+  parameter in turn is narrowed by k-section search, the parallel form of
+  golden-section search: probes points spread over the interval (on a log
+  scale, both parameters act as ratios) run at once, and the interval
+  shrinks to the best point's neighbours until it holds no new point.
+  The core counts advance in lockstep so one batch keeps every worker
+  busy, and every point run is cached.
+
+  Objectives (all minimized):
+    p99   99th percentile response time (first run - arrival)
+    turn  mean turnaround
+    tput  makespan, the inverse of the workload's throughput
+*/
+
+#define TUNE_MAX_CORES 16
+#define TUNE_PATH_LEN  256
+
+typedef enum { TUNE_P99 = 0, TUNE_TURN, TUNE_TPUT } TuneObjective;
+
+typedef struct {
+    TuneObjective obj;
+    simtime_t q_lo, q_hi;      // quantum range; 0 = not searched, -1 = by policy
+    int  age_lo, age_hi;       // aging interval range in ticks; same
+    int  cores_lo, cores_hi;   // 0 = the base Sim's core count
+    int  probes;               // points per interval (endpoints included)
+    int  rounds;               // passes over the parameters
+    int  workers;              // host threads, 0 = online CPUs
+    char out[TUNE_PATH_LEN];   // report
+} TuneConfig;
+
+/* one point run */
+typedef struct {
+    int       ncores;
+    simtime_t quantum;
+    int       age_every;
+    int       finished;        // threads finished, -1 = the run could not start
+    double    p99, turn;       // ticks
+    double    makespan;        // ticks from the start state to the end
+    double    score;           // objective, HUGE_VAL if the run failed
+} TuneResult;
+
+typedef struct {
+    TuneConfig  cfg;
+    TuneResult* res;           // every point run, in run order
+    int         nres;
+    int         cap;
+    int         batches;
+    int         workers;       // host threads used
+    int         best;          // index into res, -1 = none
+} Tuner;
+
+/* Parse "key=val,..." with keys obj=p99|turn|tput, quantum=LO:HI|off,
+   aging=LO:HI|off, cores=LO:HI, probes=N, rounds=N, workers=N, out=PATH
+   (quantum and aging are durations and ticks; by default the quantum is
+   searched over 1:50 ticks for RR and external policies, aging over 1:32
+   for the priority policy and external ones, cores are fixed, probes=5,
+   rounds=2, out=tune_report.txt). Returns 0 on success, -1 on error. */
+int  tune_parse(const char* spec, TuneConfig* cfg);
+
+/* Run the search from base's current state; base is not changed. Returns
+   0 on success, nonzero if the starting snapshot could not be written. */
+int  tune_run(Tuner* t, const TuneConfig* cfg, const Sim* base);
+
+/* Best setting per core count, the overall best and the Pareto front of
+   every point run over (p99, mean turnaround, throughput, cores). */
+void tune_report(const Tuner* t, FILE* out);
+
+void tune_free(Tuner* t);
+
+const char* tuneobj_name(TuneObjective o);
+
+#endif /* TUNE_H */
@@ -1,38 +1,9 @@
+#include <limits.h>
 #include "util.h"
-#define INT_MAX 2147483647
+#include "aout.h"
 
 /* ---------------- Queue ---------------- */
 
-void q_init(Queue* q) {
-    q->front = q->rear = NULL;
-    q->size = 0;
-}
-
-int q_empty(const Queue* q) {
-    return q->size == 0;
-}
-
-void q_push(Queue* q, Thread* t) {
-    t->next = NULL;
-    if (!q->rear) {
-        q->front = q->rear = t;
-    } else {
-        q->rear->next = t;
-        q->rear = t;
-    }
-    q->size++;
-}
-
-Thread* q_pop(Queue* q) {
-    if (!q->front) return NULL;
-    Thread* t = q->front;
-    q->front = t->next;
-    if (!q->front) q->rear = NULL;
-    t->next = NULL;
-    q->size--;
-    return t;
-}
-
 static Thread* q_remove_after(Queue* q, Thread* prev) {
     if (prev == NULL) {
         return q_pop(q);  // remove head (uses your existing q_pop)
@@ -47,11 +18,18 @@ static Thread* q_remove_after(Queue* q, Thread* prev) {
     }
 }
 
+Thread* q_remove(Queue* q, Thread* t) {
+    Thread* prev = NULL;
+    for (Thread* cur = q->front; cur; prev = cur, cur = cur->next)
+        if (cur == t) return q_remove_after(q, prev);
+    return NULL;
+}
+
 /* ----- selection pops ----- */
 Thread* q_pop_min_burst(Queue* q) {
     if (!q || q->size == 0) return NULL;
     Thread* best_prev = NULL;
-    int best = INT_MAX;
+    simtime_t best = SIMTIME_NEVER;
     Thread* prev = NULL;
     for (Thread* cur = q->front; cur; prev = cur, cur = cur->next) {
         if (cur->burst_time < best) {
@@ -65,7 +43,7 @@ Thread* q_pop_min_burst(Queue* q) {
 Thread* q_pop_min_remaining(Queue* q) {
     if (!q || q->size == 0) return NULL;
     Thread* best_prev = NULL;
-    int best = INT_MAX;
+    simtime_t best = SIMTIME_NEVER;
     Thread* prev = NULL;
     for (Thread* cur = q->front; cur; prev = cur, cur = cur->next) {
         if (cur->remaining < best) {
@@ -93,32 +71,29 @@ Thread* q_pop_highest_priority(Queue* q) {
     return q_remove_after(q, best_prev);
 }
 
-void bump_queue_wait(Queue* q) {
-    for (Thread* p = q->front; p; p = p->next) {
-        p->wait_time += 1;
-    }
-}
-
 void q_clear_shallow(Queue* q) {
     while (!q_empty(q)) {
         (void)q_pop(q);
     }
 }
 
-void waiting_resolve(Queue* waiting, Queue* ready, int now) {
-    if (q_empty(waiting)) return;
+simtime_t waiting_resolve(Queue* waiting, Queue* ready, simtime_t now) {
+    simtime_t next = SIMTIME_NEVER;
+    if (q_empty(waiting)) return next;
     Queue keep; q_init(&keep);
     while (!q_empty(waiting)) {
         Thread* t = q_pop(waiting);
         if (t->unblocked_at <= now) {
-            t->state = ST_READY;
+            mark_ready(t);
             q_push(ready, t);
         } else {
+            if (t->unblocked_at < next) next = t->unblocked_at;
             q_push(&keep, t);
         }
     }
     // keep original order of waiting threads
     while (!q_empty(&keep)) q_push(waiting, q_pop(&keep));
+    return next;
 }
 
 void decay_priority(Queue* waiting, Queue* ready) {
@@ -138,6 +113,120 @@ void decay_priority(Queue* waiting, Queue* ready) {
     }
 }
 
+/* ---------- Random numbers ---------- */
+
+void rng_seed(Rng* r, unsigned long long seed) {
+    r->s = seed;
+}
+
+unsigned rng_next(Rng* r) {
+    unsigned long long z = (r->s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (unsigned)(z >> 32);
+}
+
+int rng_range(Rng* r, int a, int b) {
+    return a + (int)(rng_next(r) % (unsigned)(b - a + 1));
+}
+
+simtime_t rng_time(Rng* r, simtime_t a, simtime_t b) {
+    unsigned long long span = (unsigned long long)(b - a) + 1;
+    unsigned long long hi = rng_next(r);
+    unsigned long long x = (hi << 32) | rng_next(r);
+    return a + (simtime_t)(x % span);
+}
+
+/* ---------- Time ---------- */
+
+int parse_duration(const char* s, simtime_t* out) {
+    if (!s || !*s) return -1;
+    char* end;
+    double v = strtod(s, &end);
+    if (end == s || v < 0) return -1;
+
+    double scale;
+    if      (*end == '\0')            scale = (double)SIM_TICK_NS;   // bare = ticks
+    else if (strcmp(end, "ns") == 0)  scale = 1.0;
+    else if (strcmp(end, "us") == 0)  scale = (double)NS_PER_US;
+    else if (strcmp(end, "ms") == 0)  scale = (double)NS_PER_MS;
+    else if (strcmp(end, "s")  == 0)  scale = (double)NS_PER_S;
+    else return -1;
+
+    *out = (simtime_t)(v * scale + 0.5);
+    return 0;
+}
+
+double to_ticks(simtime_t ns) {
+    return (double)ns / (double)SIM_TICK_NS;
+}
+
+/* ---------- Option specs ---------- */
+
+int spec_split(const char* spec, char* buf, size_t size, size_t name_len,
+               char** name, char** opts) {
+    if (!spec) spec = "";
+    if (strlen(spec) >= size) return -1;
+    strcpy(buf, spec);
+    *opts = buf;
+    if (name_len == 0) return 0;
+
+    char* colon = strchr(buf, ':');
+    if (colon) *colon++ = '\0';
+    if (buf[0] == '\0' || strlen(buf) >= name_len) return -1;
+    *name = buf;
+    *opts = colon;
+    return 0;
+}
+
+char* spec_next(char** opts, char** val) {
+    char* p = *opts;
+    while (p && *p == ',') ++p;
+    if (!p || *p == '\0') {
+        *opts = p;
+        return NULL;
+    }
+    char* end = strchr(p, ',');
+    if (end) *end++ = '\0';
+    else     end = p + strlen(p);
+    *opts = end;
+    *val  = strchr(p, '=');
+    if (*val) *(*val)++ = '\0';
+    return p;
+}
+
+/* ---------- Statistics ---------- */
+
+static int cmp_time(const void* a, const void* b) {
+    simtime_t x = *(const simtime_t*)a, y = *(const simtime_t*)b;
+    return (x > y) - (x < y);
+}
+
+void finish_stats(const Queue* finished, FinishStats* out) {
+    simtime_t* resp = (simtime_t*)malloc(sizeof(simtime_t) * (finished->size + 1));
+    simtime_t sum_resp = 0, sum_turn = 0, sum_wait = 0;
+    int n = 0;
+    for (const Thread* p = finished->front; p; p = p->next) {
+        if (p->start_time < 0 || p->finish_time < 0) continue;
+        resp[n] = p->start_time - p->arrival_time;
+        sum_resp += resp[n++];
+        sum_turn += p->finish_time - p->arrival_time;
+        sum_wait += p->wait_time;
+    }
+    memset(out, 0, sizeof(*out));
+    out->n = n;
+    if (n > 0) {
+        qsort(resp, n, sizeof(simtime_t), cmp_time);
+        int k = (99 * n + 99) / 100;   // ceil(0.99 n)
+        out->resp     = to_ticks(sum_resp) / n;
+        out->turn     = to_ticks(sum_turn) / n;
+        out->wait     = to_ticks(sum_wait) / n;
+        out->p99_resp = to_ticks(resp[k - 1]);
+    }
+    free(resp);
+}
+
 /* ---------- Logging ---------- */
 
 static void fprint_queue_flat(FILE* fp, const char* label, const Queue* q) {
@@ -149,6 +238,25 @@ static void fprint_queue_flat(FILE* fp, const char* label, const Queue* q) {
     fprintf(fp, "]");
 }
 
+static void fprint_array_flat(FILE* fp, const char* label, Thread* const* v, int n) {
+    fprintf(fp, "%s[", label);
+    for (int i = 0; i < n; ++i) {
+        fprintf(fp, "T%d", v[i]->tid);
+        if (i + 1 < n) fprintf(fp, " ");
+    }
+    fprintf(fp, "]");
+}
+
+static void fprint_array_block(FILE* fp, const char* label, Thread* const* v, int n,
+                               const char* indent) {
+    fprintf(fp, "%s%s: [", indent, label);
+    for (int i = 0; i < n; ++i) {
+        if (i > 0) fprintf(fp, ", ");
+        fprintf(fp, "T%d", v[i]->tid);
+    }
+    fprintf(fp, "]\n");
+}
+
 static void fprint_queue_block(FILE* fp, const char* label, const Queue* q, const char* indent) {
     fprintf(fp, "%s%s: [", indent, label);
     int first = 1;
@@ -161,7 +269,7 @@ static void fprint_queue_block(FILE* fp, const char* label, const Queue* q, cons
 }
 
 int log_open(Log* L, const char* path) {
-    L->fp = fopen(path, "w");
+    L->fp = aout_open(path, 0);   // written by a background thread
     L->multiline = 0;               // default is one-line
     if (!L->fp) return -1;
     fprintf(L->fp, "# Simple CPU scheduler simulation log\n");
@@ -188,8 +296,8 @@ static void fprint_cores_array(FILE* fp, const CPU* cpu) {
     fprintf(fp, "]");
 }
 
-void log_snapshot(Log* L, int t,
-                  const Queue* ready,
+void log_snapshot(Log* L, simtime_t t,
+                  Thread* const* ready, int nready,
                   const Queue* waiting,
                   const CPU* cpu,
                   const Queue* finished)
@@ -198,8 +306,8 @@ void log_snapshot(Log* L, int t,
 
     if (!L || !L->multiline) {
         // compact one-line (your original style)
-        fprintf(fp, "t=%d  ", t);
-        fprint_queue_flat(fp, "Ready", ready);
+        fprintf(fp, "t=%lld  ", (long long)(t / SIM_TICK_NS));
+        fprint_array_flat(fp, "Ready", ready, nready);
         fprintf(fp, " ");
         fprint_queue_flat(fp, "Waiting", waiting);
         fprintf(fp, " ");
@@ -211,8 +319,8 @@ void log_snapshot(Log* L, int t,
     }
 
     // pretty multi-line block
-    fprintf(fp, "t=%d\n", t);
-    fprint_queue_block(fp, "Ready",   ready,   "\t");
+    fprintf(fp, "t=%lld\n", (long long)(t / SIM_TICK_NS));
+    fprint_array_block(fp, "Ready", ready, nready, "\t");
     fprint_queue_block(fp, "Waiting", waiting, "\t");
 
     fprintf(fp, "\t");
@@ -231,6 +339,7 @@ static const char* state_str(ThreadState s) {
         case ST_RUNNING:  return "RUN";
         case ST_WAITING:  return "WAIT";
         case ST_FINISHED: return "DONE";
+        case ST_DROPPED:  return "DROP";
         default:          return "?";
     }
 }
@@ -245,9 +354,12 @@ static void fprint_table_header(FILE* fp, const char* title) {
 
 /* internal: print one thread row */
 static void fprint_thread_row(FILE* fp, const Thread* t) {
-    /* print t->priority at the end */
-    fprintf(fp, "%-6d %-8d %-8d %-8s %-6d\n",
-            t->tid, t->arrival_time, t->burst_time, state_str(t->state), t->priority);
+    /* print t->priority at the end; "-" = waits for DAG predecessors */
+    char arr[32];
+    if (t->arrival_time == SIMTIME_NEVER) snprintf(arr, sizeof(arr), "-");
+    else                                  snprintf(arr, sizeof(arr), "%g", to_ticks(t->arrival_time));
+    fprintf(fp, "%-6d %-8s %-8g %-8s %-6d\n",
+            t->tid, arr, to_ticks(t->burst_time), state_str(t->state), t->priority);
 }
 
 /* public: print the workload queue as a table */
@@ -274,15 +386,15 @@ void log_final_averages(Log* L, const Queue* finished) {
     FILE* fp = L && L->fp ? L->fp : stdout;
 
     int n = 0;
-    long long sum_resp = 0;
-    long long sum_turn = 0;
-    long long sum_wait = 0;
+    simtime_t sum_resp = 0;
+    simtime_t sum_turn = 0;
+    simtime_t sum_wait = 0;
 
     for (Thread* p = finished->front; p; p = p->next) {
         if (p->start_time >= 0 && p->finish_time >= 0) {
-            int resp = p->start_time  - p->arrival_time;
-            int turn = p->finish_time - p->arrival_time;
-            int wait = p->wait_time;  // accumulated per tick from queues
+            simtime_t resp = p->start_time  - p->arrival_time;
+            simtime_t turn = p->finish_time - p->arrival_time;
+            simtime_t wait = p->wait_time;  // accumulated while in Ready
 
             sum_resp += resp;
             sum_turn += turn;
@@ -291,31 +403,59 @@ void log_final_averages(Log* L, const Queue* finished) {
         }
     }
 
-    fprintf(fp, "\n# Final statistics\n");
+    fprintf(fp, "\n# Final statistics (ticks; 1 tick = %lld ns)\n", (long long)SIM_TICK_NS);
     if (n > 0) {
-        fprintf(fp, "Average response time:   %.3f\n", (double)sum_resp / n);
-        fprintf(fp, "Average turnaround time: %.3f\n", (double)sum_turn / n);
-        fprintf(fp, "Average waiting time:    %.3f\n", (double)sum_wait / n);
+        fprintf(fp, "Average response time:   %.3f\n", to_ticks(sum_resp) / n);
+        fprintf(fp, "Average turnaround time: %.3f\n", to_ticks(sum_turn) / n);
+        fprintf(fp, "Average waiting time:    %.3f\n", to_ticks(sum_wait) / n);
     } else {
         fprintf(fp, "No completed threads to compute stats.\n");
     }
     fprintf(fp, "\n");
 }
 
-void log_interrupts_config(Log* L, int enabled, int pct_io, int io_min, int io_max) {
+void log_interrupts_config(Log* L, int enabled, int pct_io, simtime_t io_min, simtime_t io_max) {
     FILE* fp = (L && L->fp) ? L->fp : stdout;
     fprintf(fp, "# Random I/O interrupts: %s", enabled ? "ENABLED" : "DISABLED");
     if (enabled) {
-        fprintf(fp, "  (pct_io=%d%%, io_min=%d, io_max=%d)", pct_io, io_min, io_max);
+        fprintf(fp, "  (pct_io=%d%%, io_min=%g, io_max=%g ticks)",
+                pct_io, to_ticks(io_min), to_ticks(io_max));
     }
     fprintf(fp, "\n\n");
 }
 
-void log_io_event(Log* L, int t, int core_idx, int tid, int duration, int unblock_at) {
+void log_io_event(Log* L, simtime_t t, int core_idx, int tid, simtime_t duration, simtime_t unblock_at) {
+    FILE* fp = (L && L->fp) ? L->fp : stdout;
+    /* One concise line per event (times in ticks) */
+    fprintf(fp, "INT t=%g core=%d T%d IO_BLOCK duration=%.3f unblock_at=%.3f\n",
+            to_ticks(t), core_idx, tid, to_ticks(duration), to_ticks(unblock_at));
+}
+
+void log_dev_event(Log* L, simtime_t t, int core_idx, int tid, const char* dev, int qlen) {
+    FILE* fp = (L && L->fp) ? L->fp : stdout;
+    fprintf(fp, "INT t=%g core=%d T%d IO_SUBMIT dev=%s queued=%d\n",
+            to_ticks(t), core_idx, tid, dev, qlen);
+}
+
+void log_lock_event(Log* L, simtime_t t, int core_idx, int tid, const char* lock, int owner, int nwait) {
+    FILE* fp = (L && L->fp) ? L->fp : stdout;
+    fprintf(fp, "LOCK t=%g core=%d T%d BLOCK lock=%s owner=T%d waiters=%d\n",
+            to_ticks(t), core_idx, tid, lock, owner, nwait);
+}
+
+void log_cores_event(Log* L, simtime_t t, int from, int to, const char* why) {
+    FILE* fp = (L && L->fp) ? L->fp : stdout;
+    fprintf(fp, "CORES t=%g %d -> %d (%s)\n", to_ticks(t), from, to, why);
+}
+
+void log_fault_event(Log* L, simtime_t t, int core_idx, int tid, simtime_t served_at) {
     FILE* fp = (L && L->fp) ? L->fp : stdout;
-    /* One concise line per event */
-    fprintf(fp, "INT t=%d core=%d T%d IO_BLOCK duration=%d unblock_at=%d\n",
-            t, core_idx, tid, duration, unblock_at);
+    fprintf(fp, "FAULT t=%g core=%d T%d served_at=%.3f\n", to_ticks(t), core_idx, tid, to_ticks(served_at));
+}
+
+void log_admit_event(Log* L, simtime_t t, int tid, const char* what, const char* policy) {
+    FILE* fp = (L && L->fp) ? L->fp : stdout;
+    fprintf(fp, "ADMIT t=%g T%d %s (%s)\n", to_ticks(t), tid, what, policy);
 }
 
 /* ---------------- Core trace writing ---------------- */
@@ -351,7 +491,7 @@ static void fprint_core_line(FILE* fp, int core_idx, const int* lane, int len) {
 
 int write_core_trace(const CPU* cpu, const char* path) {
     if (!cpu || !path || !cpu->run_trace) return 1;
-    FILE* f = fopen(path, "w");
+    FILE* f = aout_open(path, 0);
     if (!f) return 2;
 
     int used = trace_used_len(cpu);
@@ -367,3 +507,84 @@ int write_core_trace(const CPU* cpu, const char* path) {
 int write_core_trace_default(const CPU* cpu) {
     return write_core_trace(cpu, "core_trace.txt");
 }
+
+/* ---------------- Binary core trace ---------------- */
+
+#define CTRB_VERSION 1
+
+/* one merged run of a single tid on a single core */
+typedef struct {
+    int32_t core;
+    int32_t tid;
+    int32_t start;
+    int32_t len;
+} TraceRec;
+
+/* The file is little-endian whatever the host: store n int32s in place in
+   that byte order (nothing to do on little-endian hosts). */
+static void trace_le(int32_t* v, int n) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    (void)v; (void)n;
+#else
+    for (int i = 0; i < n; ++i) {
+        uint32_t x = (uint32_t)v[i];
+        unsigned char b[4] = { (unsigned char)x, (unsigned char)(x >> 8),
+                               (unsigned char)(x >> 16), (unsigned char)(x >> 24) };
+        memcpy(&v[i], b, 4);
+    }
+#endif
+}
+
+int write_core_trace_bin(const CPU* cpu, const char* path) {
+    if (!cpu || !path || !cpu->run_trace) return 1;
+    FILE* f = fopen(path, "wb");
+    if (!f) return 2;
+
+    int used = trace_used_len(cpu);
+
+    /* header is patched with the record count once the lanes are written */
+    int32_t hdr[4] = { CTRB_VERSION, cpu->ncores, used, 0 };
+    trace_le(hdr, 4);
+    fwrite("CTRB", 1, 4, f);
+    fwrite(hdr, sizeof(hdr[0]), 4, f);
+
+    /* buffer records and write them cap at a time, not one fwrite per interval */
+    int cap = 4096, n = 0, total = 0;
+    TraceRec* buf = (TraceRec*)malloc(sizeof(TraceRec) * cap);
+    if (!buf) { fclose(f); return 3; }
+
+    for (int c = 0; c < cpu->ncores; ++c) {
+        const int* lane = cpu->run_trace[c];
+        int t = 0;
+        while (t < used) {
+            int tid = lane[t];
+            int start = t;
+            while (t < used && lane[t] == tid) ++t;
+            if (tid < 0) continue;              /* idle gap: implicit */
+            if (n == cap) {
+                trace_le(&buf[0].core, 4 * n);
+                fwrite(buf, sizeof(TraceRec), n, f);
+                n = 0;
+            }
+            buf[n].core  = c;
+            buf[n].tid   = tid;
+            buf[n].start = start;
+            buf[n].len   = t - start;
+            ++n; ++total;
+        }
+    }
+    if (n) {
+        trace_le(&buf[0].core, 4 * n);
+        fwrite(buf, sizeof(TraceRec), n, f);
+    }
+    free(buf);
+
+    hdr[3] = total;
+    trace_le(&hdr[3], 1);
+    fseek(f, 4, SEEK_SET);
+    fwrite(hdr, sizeof(hdr[0]), 4, f);
+
+    int err = ferror(f);
+    fclose(f);
+    return err ? 4 : 0;
+}
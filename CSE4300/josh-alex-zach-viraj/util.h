@@ -4,12 +4,47 @@
 #include "sim.h"
 
 /* ---------- Queue primitives ---------- */
-void q_init(Queue* q);
-int  q_empty(const Queue* q);
-void q_push(Queue* q, Thread* t);
-Thread* q_pop(Queue* q);
-/* Add 1 tick of waiting to every thread in q (use for Ready; optionally Waiting) */
-void bump_queue_wait(Queue* q);
+/* Inline: every hand-off between queues, policies and cores goes through
+   them, several times per event. */
+static inline void q_init(Queue* q) {
+    q->front = q->rear = NULL;
+    q->size = 0;
+}
+
+static inline int q_empty(const Queue* q) {
+    return q->size == 0;
+}
+
+static inline void q_push(Queue* q, Thread* t) {
+    t->next = NULL;
+    if (!q->rear) {
+        q->front = q->rear = t;
+    } else {
+        q->rear->next = t;
+        q->rear = t;
+    }
+    q->size++;
+}
+
+static inline Thread* q_pop(Queue* q) {
+    if (!q->front) return NULL;
+    Thread* t = q->front;
+    q->front = t->next;
+    if (!q->front) q->rear = NULL;
+    t->next = NULL;
+    q->size--;
+    return t;
+}
+
+/* Mark t as entering Ready now (state, ready_since, ready_count). */
+static inline void mark_ready(Thread* t) {
+    t->state = ST_READY;
+    t->ready_since = SIM_TIME;   // wait_time is charged when it gets a core
+    t->ready_count++;
+}
+
+/* Unlink t from q; returns t, or NULL if it is not in q. */
+Thread* q_remove(Queue* q, Thread* t);
 
 // Queue operations specific to shceduling policies
 Thread* q_pop_min_remaining(Queue* q);
@@ -19,12 +54,56 @@ Thread* q_pop_highest_priority(Queue* q);  // smaller priority value wins
 /* (Optional) clear queue nodes (does NOT free Thread objects themselves) */
 void q_clear_shallow(Queue* q);
 
-/* Move any WAITING threads whose unblocked_at <= now back to Ready. */
-void waiting_resolve(Queue* waiting, Queue* ready, int now);
+/* Move any WAITING threads whose unblocked_at <= now back to Ready.
+   Returns the earliest unblocked_at still pending, or SIMTIME_NEVER. */
+simtime_t waiting_resolve(Queue* waiting, Queue* ready, simtime_t now);
 
 // Priority Decay for Priority Queue system
 void decay_priority(Queue* waiting, Queue* ready);
 
+/* ---------- Random numbers (splitmix64) ---------- */
+void     rng_seed(Rng* r, unsigned long long seed);
+unsigned rng_next(Rng* r);
+/* uniform integer in [a, b] */
+int      rng_range(Rng* r, int a, int b);
+/* uniform time in [a, b] ns */
+simtime_t rng_time(Rng* r, simtime_t a, simtime_t b);
+
+/* ---------- Time ---------- */
+/* Parse a duration: "250us", "3ms", "1.5s", "800ns", or a bare number of
+   ticks ("4" = 4 * SIM_TICK_NS). Returns 0 on success, -1 if malformed. */
+int    parse_duration(const char* s, simtime_t* out);
+/* ns -> ticks (fractional) for reporting */
+double to_ticks(simtime_t ns);
+
+/* ---------- Option specs ---------- */
+/* Specs are "key=val,..." lists, optionally after "name:" (--lock,
+   --job, ...). Both helpers work in place on a copy the caller owns. */
+
+/* Copy spec (NULL = "") into buf of size bytes. When name_len > 0, split
+   the copy at its first ':': *name is the part before it, which must be
+   non-empty and shorter than name_len, and *opts the part after (NULL if
+   there is none); otherwise *opts is the whole copy. Returns 0, or -1 if
+   spec does not fit or the name is bad. */
+int    spec_split(const char* spec, char* buf, size_t size, size_t name_len,
+                  char** name, char** opts);
+/* Next item of the comma-separated list at *opts: returns its key and
+   moves *opts past it, or NULL at the end (or if *opts is NULL). *val is
+   the text after '=', NULL for an item without one. Empty items are
+   skipped. */
+char*  spec_next(char** opts, char** val);
+
+/* ---------- Statistics ---------- */
+/* Over the finished threads that ran: averages and the 99th percentile
+   (nearest rank) of the response time, in ticks. */
+typedef struct {
+    int    n;
+    double resp, turn, wait;
+    double p99_resp;
+} FinishStats;
+
+void finish_stats(const Queue* finished, FinishStats* out);
+
 /* ---------- Logging ---------- */
 typedef struct {
     FILE* fp;
@@ -35,8 +114,10 @@ int  log_open(Log* L, const char* path);
 void log_close(Log* L);
 void log_set_multiline(Log* L, int enable);  // NEW
 
-void log_snapshot(Log* L, int t,
-                  const Queue* ready,
+/* ready lists the nready Ready threads (the policy owns them, so they are
+   not a Queue) */
+void log_snapshot(Log* L, simtime_t t,
+                  Thread* const* ready, int nready,
                   const Queue* waiting,
                   const CPU* cpu,
                   const Queue* finished);
@@ -51,10 +132,25 @@ void log_queue_detailed(Log* L, const char* heading, const Queue* q);
 void log_final_averages(Log* L, const Queue* finished);
 
 /* Log whether random I/O interrupts are enabled and their parameters */
-void log_interrupts_config(Log* L, int enabled, int pct_io, int io_min, int io_max);
+void log_interrupts_config(Log* L, int enabled, int pct_io, simtime_t io_min, simtime_t io_max);
 
 /* Log a single I/O interrupt event */
-void log_io_event(Log* L, int t, int core_idx, int tid, int duration, int unblock_at);
+void log_io_event(Log* L, simtime_t t, int core_idx, int tid, simtime_t duration, simtime_t unblock_at);
+
+/* Log a thread blocking on a device queue (qlen includes it if still queued) */
+void log_dev_event(Log* L, simtime_t t, int core_idx, int tid, const char* dev, int qlen);
+
+/* Log a thread blocking on a lock held by owner (nwait includes it) */
+void log_lock_event(Log* L, simtime_t t, int core_idx, int tid, const char* lock, int owner, int nwait);
+
+/* Log a core count change (why: "hotplug" or "autoscale") */
+void log_cores_event(Log* L, simtime_t t, int from, int to, const char* why);
+
+/* Log a page fault: the thread waits until served_at */
+void log_fault_event(Log* L, simtime_t t, int core_idx, int tid, simtime_t served_at);
+
+/* Log an arrival rejected or a Ready thread shed by admission control */
+void log_admit_event(Log* L, simtime_t t, int tid, const char* what, const char* policy);
 
 /* Write per-core run traces to "core trace.txt".
    Format:
@@ -66,4 +162,12 @@ int write_core_trace_default(const CPU* cpu);
 /* Same as above but lets you choose the output path. */
 int write_core_trace(const CPU* cpu, const char* path);
 
+/* Compact binary trace of busy intervals (idle time is implicit).
+   Layout, all little-endian int32:
+     header:  'C','T','R','B', version, ncores, nticks, nrecords
+     records: { core, tid, start, len } sorted by core, then start
+   plot_core_trace.py loads this with numpy.memmap instead of parsing text.
+   Returns 0 on success, nonzero on error. */
+int write_core_trace_bin(const CPU* cpu, const char* path);
+
 #endif /* UTIL_H */